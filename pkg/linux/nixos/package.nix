@@ -104,9 +104,6 @@ stdenv.mkDerivation rec {
     substituteInPlace sh/ntty --replace \
       /usr/bin/picocom ${picocom}/bin/picocom
 
-    substituteInPlace sh/upgrade_db.sh --replace \
-      sqlite3 ${sqlite}/bin/sqlite3
-
     substituteInPlace sh/setup_nemu_nonroot.sh --replace \
       /usr/bin/nemu $out/bin/$pname
 
@@ -28,7 +28,8 @@ _nemu_completions()
         COMPREPLY=( $(compgen -W "-h --help -l --list -s --start -p --powerdown \
             -f --force-stop -z --reset -k --kill -i --info -v --version \
             -d --daemon -c --create-veth -m --cmd -C --cfg \
-            --name --snap-list --snap-save --snap-del --snap-load" -- "$curr") )
+            --name --snap-list --snap-save --snap-del --snap-load \
+            --db-profile" -- "$curr") )
     elif [[ "$COMP_CWORD" == 2 ]]; then
         case "$prev" in
             "-s"|"--start")
@@ -131,12 +131,11 @@ static void nm_9p_fields_setup(const nm_vmctl_data_t *cur)
     field_opts_off(fields[NM_FLD_9PNAME], O_STATIC);
 
     set_field_buffer(fields[NM_FLD_9PMODE], 0,
-        (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_9FLG),
-            NM_ENABLE) == NM_OK) ? "yes" : "no");
+        nm_db_bool(&cur->main, 0, NM_SQL_9FLG) ? "yes" : "no");
     set_field_buffer(fields[NM_FLD_9PPATH], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_9PTH));
+            nm_db_text(&cur->main, 0, NM_SQL_9PTH));
     set_field_buffer(fields[NM_FLD_9PNAME], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_9ID));
+            nm_db_text(&cur->main, 0, NM_SQL_9ID));
 }
 
 static size_t nm_9p_labels_setup(void)
@@ -187,8 +186,7 @@ static int nm_9p_get_data(nm_9p_data_t *data, const nm_vmctl_data_t *cur)
         if (nm_str_cmp_st(&data->mode, "no") == NM_OK) {
             goto out;
         }
-    } else if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_9FLG),
-                NM_ENABLE) != NM_OK) {
+    } else if (!nm_db_bool(&cur->main, 0, NM_SQL_9FLG)) {
             goto out;
     }
 
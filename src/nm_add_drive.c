@@ -21,7 +21,7 @@ static size_t nm_add_drive_labels_setup(void);
 static void nm_add_drive_to_db(const nm_str_t *name,
                                const nm_str_t *size,
                                const nm_str_t *type,
-                               const nm_vect_t *drives,
+                               const nm_db_res_t *drives,
                                const nm_str_t *discard,
                                const nm_str_t *format);
 
@@ -69,7 +69,7 @@ void nm_add_drive(const nm_str_t *name)
     size_t msg_len;
 
     nm_vmctl_get_data(name, &vm);
-    if ((vm.drives.n_memb / NM_DRV_IDX_COUNT) == NM_DRIVE_LIMIT) {
+    if ((nm_db_rows(&vm.drives)) == NM_DRIVE_LIMIT) {
         nm_str_t warn_msg = NM_INIT_STR;
 
         nm_str_format(&warn_msg, _("%zu %s"), NM_DRIVE_LIMIT, NM_NSG_DRV_LIM);
@@ -310,17 +310,17 @@ out:
 }
 
 int nm_add_drive_to_fs(const nm_str_t *name, const nm_str_t *size,
-    const nm_vect_t *drives, const nm_str_t *format)
+    const nm_db_res_t *drives, const nm_str_t *format)
 {
     nm_str_t buf = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
 
     nm_str_format(&buf, "%s/qemu-img", nm_cfg_get()->qemu_bin_path.data);
-    nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(&argv, buf.data);
 
-    nm_vect_insert_cstr(&argv, "create");
-    nm_vect_insert_cstr(&argv, "-f");
-    nm_vect_insert_cstr(&argv, format->data);
+    nm_argv_add(&argv, "create");
+    nm_argv_add(&argv, "-f");
+    nm_argv_add(&argv, format->data);
 
 /*
  * @TODO Fix conversion from size_t to char
@@ -329,7 +329,7 @@ int nm_add_drive_to_fs(const nm_str_t *name, const nm_str_t *size,
     size_t drive_count = 0;
 
     if (drives != NULL) {
-        drive_count = drives->n_memb / NM_DRV_IDX_COUNT;
+        drive_count = nm_db_rows(drives);
     }
 
     char drv_ch = 'a' + drive_count;
@@ -337,31 +337,30 @@ int nm_add_drive_to_fs(const nm_str_t *name, const nm_str_t *size,
 /* @TODO Why add VM name twice (in directory name and in filename)? */
     nm_str_format(&buf, "%s/%s/%s_%c.img",
         nm_cfg_get()->vm_dir.data, name->data, name->data, drv_ch);
-    nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(&argv, buf.data);
 
     nm_str_format(&buf, "%sG", size->data);
-    nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(&argv, buf.data);
 
-    nm_vect_end_zero(&argv);
     if (nm_spawn_process(&argv, NULL) != NM_OK) {
         return NM_ERR;
     }
 
     nm_str_free(&buf);
-    nm_vect_free(&argv, NULL);
+    nm_argv_free(&argv);
 
     return NM_OK;
 }
 
 static void nm_add_drive_to_db(const nm_str_t *name, const nm_str_t *size,
-                               const nm_str_t *type, const nm_vect_t *drives,
+                               const nm_str_t *type, const nm_db_res_t *drives,
                                const nm_str_t *discard, const nm_str_t *format)
 {
 /*
  * @TODO Fix conversion from size_t to char
  * (might be a problem if there is too many drives)
  */
-    size_t drive_count = drives->n_memb / NM_DRV_IDX_COUNT;
+    size_t drive_count = nm_db_rows(drives);
     char drv_ch = 'a' + drive_count;
     nm_str_t query = NM_INIT_STR;
 
@@ -378,57 +378,72 @@ out:
 void nm_add_vm_to_db(nm_vm_t *vm, uint64_t mac,
                      int imported, const nm_vect_t *drives)
 {
-    nm_str_t query = NM_INIT_STR;
+    nm_str_t drive_name = NM_INIT_STR;
+    nm_sqlite_stmt_t *stmt;
+    int64_t vm_id;
+
+    /* VM, drives and interfaces appear together */
+    nm_db_begin_transaction();
 
     /* insert main VM data */
-    nm_str_format(&query, NM_SQL_VMS_INSERT_NEW,
-        vm->name.data, vm->memo.data, vm->cpus.data,
+    stmt = nm_db_stmt(NM_STMT_VMS_INSERT);
+    nm_db_bind_text(stmt, 1, vm->name.data);
+    nm_db_bind_text(stmt, 2, vm->memo.data);
+    nm_db_bind_text(stmt, 3, vm->cpus.data);
 #if defined(NM_OS_LINUX) || defined(NM_OS_DARWIN)
-        NM_ENABLE, NM_ENABLE, /* enable KVM and host CPU by default */
+    /* enable KVM and host CPU by default */
+    nm_db_bind_int(stmt, 4, 1);
+    nm_db_bind_int(stmt, 5, 1);
 #else
-        NM_DISABLE, NM_DISABLE, /* disable KVM on non supported platform */
+    /* disable KVM on non supported platform */
+    nm_db_bind_int(stmt, 4, 0);
+    nm_db_bind_int(stmt, 5, 0);
 #endif
-        vm->vncp.data, vm->arch.data,
-        imported ? "" : vm->srcp.data,
-        /* if imported, then no need to install */
-        imported ? NM_DISABLE : NM_ENABLE,
-        nm_mach_get_default(&vm->arch), /* setup default machine type */
-        NM_DISABLE, /* mouse override */
-        vm->usb_enable ? NM_ENABLE : NM_DISABLE, /* USB enabled */
-        NM_DEFAULT_USBVER, /* set USB 3.0 by default */
-        NM_DISABLE, /* default usb_status is off */
-        NM_DISABLE, /* disable 9pfs by default */
-        /* SPICE enabled */
-        (nm_cfg_get()->spice_default) ? NM_ENABLE : NM_DISABLE,
-        "", /* GDB debug port */
-        NM_DISABLE, /* disable GDB debug by default */
-        NM_DEFAULT_DISPLAY, /* Display type */
-        NM_DISABLE /* disable SPICE agent debug by default */
-    );
-
-    nm_db_edit(query.data);
+    nm_db_bind_text(stmt, 6, vm->vncp.data);
+    nm_db_bind_text(stmt, 7, vm->arch.data);
+    nm_db_bind_text(stmt, 8, imported ? "" : vm->srcp.data);
+    /* if imported, then no need to install */
+    nm_db_bind_int(stmt, 9, !imported);
+    /* setup default machine type */
+    nm_db_bind_text(stmt, 10, nm_mach_get_default(&vm->arch));
+    nm_db_bind_int(stmt, 11, 0); /* mouse override */
+    nm_db_bind_int(stmt, 12, vm->usb_enable ? 1 : 0); /* USB enabled */
+    nm_db_bind_text(stmt, 13, NM_DEFAULT_USBVER); /* set USB 3.0 by default */
+    nm_db_bind_int(stmt, 14, 0); /* default usb_status is off */
+    nm_db_bind_int(stmt, 15, 0); /* disable 9pfs by default */
+    /* SPICE enabled */
+    nm_db_bind_int(stmt, 16, nm_cfg_get()->spice_default ? 1 : 0);
+    nm_db_bind_text(stmt, 17, ""); /* GDB debug port */
+    nm_db_bind_int(stmt, 18, 0); /* disable GDB debug by default */
+    nm_db_bind_text(stmt, 19, NM_DEFAULT_DISPLAY); /* Display type */
+    nm_db_bind_int(stmt, 20, 0); /* disable SPICE agent by default */
+    nm_db_exec(stmt);
+
+    vm_id = nm_db_last_id();
 
     /* insert drive info */
     if (drives == NULL) {
-        nm_str_format(&query, NM_SQL_DRIVES_INSERT_NEW,
-                vm->name.data, vm->name.data, vm->drive.driver.data,
-                vm->drive.size.data,
-                NM_ENABLE, /* boot flag */
-                vm->drive.discard ? NM_ENABLE : NM_DISABLE,
-                vm->drive.format.data
-                );
-        nm_db_edit(query.data);
+        nm_str_format(&drive_name, "%s_a.img", vm->name.data);
+        stmt = nm_db_stmt(NM_STMT_DRIVES_INSERT);
+        nm_db_bind_int(stmt, 1, vm_id);
+        nm_db_bind_text(stmt, 2, drive_name.data);
+        nm_db_bind_text(stmt, 3, vm->drive.driver.data);
+        nm_db_bind_text(stmt, 4, vm->drive.size.data);
+        nm_db_bind_int(stmt, 5, 1); /* boot flag */
+        nm_db_bind_int(stmt, 6, vm->drive.discard ? 1 : 0);
+        nm_db_bind_text(stmt, 7, vm->drive.format.data);
+        nm_db_exec(stmt);
     } else { /* imported from OVF */
         for (size_t n = 0; n < drives->n_memb; n++) {
-            nm_str_format(&query, NM_SQL_DRIVES_INSERT_IMPORTED,
-                vm->name.data,
-                nm_drive_file(drives->data[n])->data, NM_DEFAULT_DRVINT,
-                nm_drive_size(drives->data[n])->data,
-                n == 0 ? NM_ENABLE : NM_DISABLE, /* boot flag */
-                vm->drive.discard ? NM_ENABLE : NM_DISABLE,
-                vm->drive.format.data
-                );
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_DRIVES_INSERT);
+            nm_db_bind_int(stmt, 1, vm_id);
+            nm_db_bind_text(stmt, 2, nm_drive_file(drives->data[n])->data);
+            nm_db_bind_text(stmt, 3, NM_DEFAULT_DRVINT);
+            nm_db_bind_text(stmt, 4, nm_drive_size(drives->data[n])->data);
+            nm_db_bind_int(stmt, 5, n == 0); /* boot flag */
+            nm_db_bind_int(stmt, 6, vm->drive.discard ? 1 : 0);
+            nm_db_bind_text(stmt, 7, vm->drive.format.data);
+            nm_db_exec(stmt);
         }
     }
 
@@ -446,53 +461,57 @@ void nm_add_vm_to_db(nm_vm_t *vm, uint64_t mac,
         nm_str_copy(&if_name_copy, &if_name);
         altname = nm_net_fix_tap_name(&if_name, &maddr);
 
-        nm_str_format(&query, NM_SQL_IFACES_INSERT_NEW,
-            vm->name.data, if_name.data, maddr.data, vm->ifs.driver.data,
+        stmt = nm_db_stmt(NM_STMT_IFACES_INSERT);
+        nm_db_bind_int(stmt, 1, vm_id);
+        nm_db_bind_text(stmt, 2, if_name.data);
+        nm_db_bind_text(stmt, 3, maddr.data);
+        nm_db_bind_text(stmt, 4, vm->ifs.driver.data);
 #if defined (NM_OS_LINUX)
-            nm_str_cmp_st(&vm->ifs.driver, NM_DEFAULT_NETDRV) == NM_OK ?
-            "1" : "0", /* enable vhost by default for virtio-net-pci device */
+        /* enable vhost by default for virtio-net-pci device */
+        nm_db_bind_int(stmt, 5,
+                nm_str_cmp_st(&vm->ifs.driver, NM_DEFAULT_NETDRV) == NM_OK);
 #else
-            "0",
+        nm_db_bind_int(stmt, 5, 0);
 #endif
-            "0", /* disable macvtap by default */
-            (altname) ? if_name_copy.data : "",
-            NM_ENABLE /* enable user-net */
-        );
-        nm_db_edit(query.data);
+        nm_db_bind_int(stmt, 6, 0); /* disable macvtap by default */
+        nm_db_bind_text(stmt, 8, (altname) ? if_name_copy.data : "");
+        nm_db_bind_int(stmt, 9, 1); /* enable user-net */
+        nm_db_exec(stmt);
 
         nm_str_free(&if_name);
         nm_str_free(&if_name_copy);
         nm_str_free(&maddr);
     }
 
-    nm_str_free(&query);
+    nm_db_commit();
+
+    nm_str_free(&drive_name);
 }
 
 static void nm_convert_drives(const nm_str_t *vm_dir, const nm_str_t *src_img,
         const nm_str_t *dst_img, const nm_str_t *format)
 {
     nm_str_t buf = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
 
     nm_str_format(&buf, "%s/qemu-img", nm_cfg_get()->qemu_bin_path.data);
-    nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(&argv, buf.data);
 
-    nm_vect_insert_cstr(&argv, "convert");
-    nm_vect_insert_cstr(&argv, "-O");
-    nm_vect_insert_cstr(&argv, format->data);
-    nm_vect_insert_cstr(&argv, src_img->data);
-    nm_vect_insert_cstr(&argv, dst_img->data);
+    nm_argv_add(&argv, "convert");
+    nm_argv_add(&argv, "-O");
+    nm_argv_add(&argv, format->data);
+    nm_argv_add(&argv, src_img->data);
+    nm_argv_add(&argv, dst_img->data);
 
     nm_cmd_str(&buf, &argv);
     nm_debug("add_vm: exec: %s\n", buf.data);
 
-    nm_vect_end_zero(&argv);
     if (nm_spawn_process(&argv, NULL) != NM_OK) {
         rmdir(vm_dir->data);
         nm_bug(_("%s: cannot convert image file"), __func__);
     }
 
-    nm_vect_free(&argv, NULL);
+    nm_argv_free(&argv);
     nm_str_free(&buf);
 }
 
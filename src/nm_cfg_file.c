@@ -32,6 +32,7 @@ static const char NM_DEFAULT_QEMUDIR[]  = "/usr/bin";
 #endif /* NM_WITH_QEMU */
 
 static const int NM_DEFAULT_REFRESH = 500;
+static const int NM_DEFAULT_DB_BUSY = 5000;
 
 static const char NM_DEFAULT_VNCARG[]   = ":%p";
 static const char NM_DEFAULT_SPICEARG[] = "--title %t spice://127.0.0.1:%p";
@@ -40,6 +41,9 @@ static const char NM_DEFAULT_TARGET[]   = "x86_64,i386";
 
 static const char NM_DEFAULT_PID[]      = "/tmp/nemu.pid";
 static const char NM_DEFAULT_PNG[]      = "/tmp/nemu.png";
+static const char NM_DEFAULT_SOCK_EXT[] = ".sock";
+static const char NM_DEFAULT_CTL_EXT[]  = ".ctl";
+static const char NM_DEFAULT_SHM_EXT[]  = ".status";
 
 static const char NM_INI_S_MAIN[]       = "main";
 static const char NM_INI_S_VIEW[]       = "viewer";
@@ -67,9 +71,15 @@ static const char NM_INI_P_QLOG[]       = "log_cmd";
 static const char NM_INI_P_PID[]        = "pid";
 static const char NM_INI_P_AUTO[]       = "autostart";
 static const char NM_INI_P_SLP[]        = "sleep";
+static const char NM_INI_P_SOCK[]       = "socket";
+static const char NM_INI_P_CTL[]        = "control";
+static const char NM_INI_P_WORKERS[]    = "qmp_workers";
+static const char NM_INI_P_EXPORTER[]   = "exporter";
 static const char NM_INI_P_GL_SEP[]     = "glyph_separator";
 static const char NM_INI_P_GL_CHECK[]   = "glyph_checkbox";
 static const char NM_INI_P_REFRESH[]    = "refresh_timeout";
+static const char NM_INI_P_DB_BUSY[]    = "db_busy_timeout";
+static const char NM_INI_P_DB_PROF[]    = "db_profile";
 #if defined (NM_WITH_REMOTE)
 static const char NM_INI_P_API_SRV[]    = "remote_control";
 static const char NM_INI_P_API_IFACE[]  = "remote_interface";
@@ -111,6 +121,7 @@ static inline void nm_cfg_get_color(size_t pos, short *color,
         const nm_str_t *buf);
 static void nm_cfg_get_targets(nm_str_t *buf, const nm_str_t *path);
 static void nm_cfg_get_view(nm_view_args_t *view, const nm_str_t *buf);
+static void nm_cfg_daemon_path(nm_str_t *res, const char *ext);
 
 void nm_cfg_init(bool bypass_cfg)
 {
@@ -353,6 +364,17 @@ void nm_cfg_init(bool bypass_cfg)
     }
 
     nm_get_param(ini, NM_INI_S_DMON, NM_INI_P_PID, &cfg.daemon_pid, NULL);
+    if (nm_get_opt_param(ini, NM_INI_S_DMON, NM_INI_P_SOCK,
+                &cfg.daemon_sock) != NM_OK) {
+        nm_cfg_daemon_path(&cfg.daemon_sock, NM_DEFAULT_SOCK_EXT);
+    }
+    if (nm_get_opt_param(ini, NM_INI_S_DMON, NM_INI_P_CTL,
+                &cfg.daemon_ctl) != NM_OK) {
+        nm_cfg_daemon_path(&cfg.daemon_ctl, NM_DEFAULT_CTL_EXT);
+    }
+    nm_cfg_daemon_path(&cfg.daemon_shm, NM_DEFAULT_SHM_EXT);
+    nm_get_opt_param(ini, NM_INI_S_DMON, NM_INI_P_EXPORTER,
+            &cfg.daemon_exporter);
     nm_str_trunc(&tmp_buf, 0);
     if (nm_get_opt_param(ini, NM_INI_S_DMON, NM_INI_P_SLP,
                 &tmp_buf) == NM_OK) {
@@ -360,6 +382,18 @@ void nm_cfg_init(bool bypass_cfg)
     } else {
         cfg.daemon_sleep = NM_MON_SLEEP;
     }
+    nm_str_trunc(&tmp_buf, 0);
+    if (nm_get_opt_param(ini, NM_INI_S_DMON, NM_INI_P_WORKERS,
+                &tmp_buf) == NM_OK) {
+        cfg.daemon_workers = nm_str_stoui(&tmp_buf, 10);
+        if (!cfg.daemon_workers ||
+                cfg.daemon_workers > NM_MON_MAX_WORKERS) {
+            nm_bug(_("cfg: %s must be in range 1-%d"),
+                    NM_INI_P_WORKERS, NM_MON_MAX_WORKERS);
+        }
+    } else {
+        cfg.daemon_workers = NM_MON_WORKERS;
+    }
 
     nm_str_trunc(&tmp_buf, 0);
     if (nm_get_opt_param(ini, NM_INI_S_MAIN, NM_INI_P_GL_SEP,
@@ -380,6 +414,24 @@ void nm_cfg_init(bool bypass_cfg)
         cfg.refresh_timeout = NM_DEFAULT_REFRESH;
     }
 
+    nm_str_trunc(&tmp_buf, 0);
+    if (nm_get_opt_param(ini, NM_INI_S_MAIN, NM_INI_P_DB_BUSY,
+                &tmp_buf) == NM_OK) {
+        cfg.db_busy_timeout = nm_str_stoul(&tmp_buf, 10);
+    } else {
+        cfg.db_busy_timeout = NM_DEFAULT_DB_BUSY;
+    }
+
+    if (nm_get_opt_param(ini, NM_INI_S_MAIN, NM_INI_P_DB_PROF,
+                &cfg.db_profile) == NM_OK) {
+        FILE *fp;
+
+        if ((fp = fopen(cfg.db_profile.data, "a")) == NULL) {
+            nm_bug(_("cfg: no write access to %s"), cfg.db_profile.data);
+        }
+        fclose(fp);
+    }
+
     /* VM preview */
     nm_str_trunc(&tmp_buf, 0);
     if (nm_get_opt_param(ini, NM_INI_S_PREV, NM_INI_P_PREV_FLAG,
@@ -466,6 +518,7 @@ void nm_cfg_free(void)
     nm_str_free(&cfg.vm_dir);
     nm_str_free(&cfg.db_path);
     nm_str_free(&cfg.debug_path);
+    nm_str_free(&cfg.db_profile);
     nm_str_free(&cfg.vnc_bin);
     nm_str_free(&cfg.spice_bin);
     nm_str_free(&cfg.vnc_args);
@@ -473,6 +526,10 @@ void nm_cfg_free(void)
     nm_str_free(&cfg.log_path);
     nm_str_free(&cfg.pid);
     nm_str_free(&cfg.daemon_pid);
+    nm_str_free(&cfg.daemon_sock);
+    nm_str_free(&cfg.daemon_ctl);
+    nm_str_free(&cfg.daemon_shm);
+    nm_str_free(&cfg.daemon_exporter);
     nm_str_free(&cfg.qemu_bin_path);
     nm_str_free(&cfg.preview.path);
     free(cfg.preview.b64_path);
@@ -655,6 +712,12 @@ static void nm_generate_cfg(const char *home, const nm_str_t *cfg_path)
                     "# cursor_style = 1\n\n");
             fprintf(cfg_file, "# Properties refresh timeout (ms)\n"
                     "# refresh_timeout = 500\n\n");
+            fprintf(cfg_file, "# How long to wait for a database locked "
+                    "by another nEMU process (ms)\n"
+                    "# db_busy_timeout = 5000\n\n");
+            fprintf(cfg_file, "# append SQL statements profile to file "
+                    "on exit. Example:\n"
+                    "# db_profile = /tmp/nemu_sql.log\n\n");
             fprintf(cfg_file, "[preview]\n");
             fprintf(cfg_file, "# enabled = 0\n# scale = 0\n"
                     "# png_path = /tmp/nemu.png\n\n");
@@ -687,7 +750,18 @@ static void nm_generate_cfg(const char *home, const nm_str_t *cfg_path)
                     "# Auto start monitoring daemon\nautostart = 1\n\n"
                     "# Daemon sleep interval (ms) (default: 1000)\n"
                     "#sleep = 1000\n\n"
-                    "# Monitoring daemon pid file\npid = /tmp/nemu-monitor.pid"
+                    "# Monitoring daemon pid file\npid = /tmp/nemu-monitor.pid\n\n"
+                    "# Monitoring daemon notification socket\n"
+                    "# (default: pid file path with .sock extension)\n"
+                    "#socket = /tmp/nemu-monitor.sock\n\n"
+                    "# Monitoring daemon control socket\n"
+                    "# (default: pid file path with .ctl extension)\n"
+                    "#control = /tmp/nemu-monitor.ctl\n\n"
+                    "# Snapshot jobs executed concurrently (default: 4)\n"
+                    "#qmp_workers = 4\n\n"
+                    "# Serve OpenMetrics on http://<host:port>/metrics\n"
+                    "# or on unix socket path (default: disabled)\n"
+                    "#exporter = 127.0.0.1:9638"
 #ifdef NM_WITH_DBUS
                     "\n\n# Enable D-Bus feature\ndbus_enabled = 1\n\n"
                     "# Message timeout (ms)\ndbus_timeout = 2000"
@@ -825,6 +899,20 @@ static void nm_cfg_get_targets(nm_str_t *buf, const nm_str_t *path)
     }
 }
 
+/* /tmp/nemu-monitor.pid -> /tmp/nemu-monitor<ext> */
+static void nm_cfg_daemon_path(nm_str_t *res, const char *ext)
+{
+    char *dot = strrchr(cfg.daemon_pid.data, '.');
+
+    if (dot && !strchr(dot, '/')) {
+        nm_str_add_text_part(res, cfg.daemon_pid.data,
+                dot - cfg.daemon_pid.data);
+    } else {
+        nm_str_copy(res, &cfg.daemon_pid);
+    }
+    nm_str_add_text(res, ext);
+}
+
 static void nm_cfg_get_view(nm_view_args_t *view, const nm_str_t *buf)
 {
     int label_found = 0;
@@ -45,6 +45,10 @@ typedef struct {
     nm_str_t log_path;
     nm_str_t pid;
     nm_str_t daemon_pid;
+    nm_str_t daemon_sock;
+    nm_str_t daemon_ctl;
+    nm_str_t daemon_shm;
+    nm_str_t daemon_exporter; /* host:port or socket path, empty if off */
     nm_str_t qemu_bin_path;
     nm_vect_t qemu_targets;
     nm_rgb_t hl_color;
@@ -52,8 +56,11 @@ typedef struct {
     nm_glyph_t glyphs;
     nm_preview_t preview;
     nm_str_t debug_path;
+    nm_str_t db_profile; /* SQL profile report path, empty if off */
     uint64_t daemon_sleep;
+    uint32_t daemon_workers;
     uint64_t refresh_timeout;
+    uint64_t db_busy_timeout;
     uint32_t cursor_style;
 #if defined (NM_WITH_DBUS)
     uint32_t dbus_enabled:1;
@@ -15,7 +15,7 @@ static const char NM_LC_CLONE_NAME_MSG[] = "Name";
 
 static void nm_clone_vm_init_windows(nm_form_t *form);
 static void nm_clone_vm_to_fs(const nm_str_t *src, const nm_str_t *dst,
-                              const nm_vect_t *drives);
+                              const nm_db_res_t *drives);
 static void nm_clone_vm_to_db(const nm_str_t *src, const nm_str_t *dst,
                               const nm_vmctl_data_t *vm);
 
@@ -123,7 +123,7 @@ out:
 }
 
 static void nm_clone_vm_to_fs(const nm_str_t *src, const nm_str_t *dst,
-                              const nm_vect_t *drives)
+                              const nm_db_res_t *drives)
 {
     nm_str_t old_vm_path = NM_INIT_STR;
     nm_str_t new_vm_path = NM_INIT_STR;
@@ -143,11 +143,10 @@ static void nm_clone_vm_to_fs(const nm_str_t *src, const nm_str_t *dst,
     nm_str_format(&old_vm_path, "%s/%s/",
         nm_cfg_get()->vm_dir.data, src->data);
 
-    drives_count = drives->n_memb / NM_DRV_IDX_COUNT;
+    drives_count = nm_db_rows(drives);
 
     for (size_t n = 0; n < drives_count; n++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * n;
-        nm_str_t *drive_name = nm_vect_str(drives, NM_SQL_DRV_NAME + idx_shift);
+        const nm_str_t *drive_name = nm_db_str(drives, n, NM_SQL_DRV_NAME);
 
         nm_str_add_str(&old_vm_path, drive_name);
         nm_str_append_format(&new_vm_path, "_%c.img", drv_ch);
@@ -167,26 +166,34 @@ static void nm_clone_vm_to_fs(const nm_str_t *src, const nm_str_t *dst,
 static void nm_clone_vm_to_db(const nm_str_t *src, const nm_str_t *dst,
                               const nm_vmctl_data_t *vm)
 {
-    nm_str_t query = NM_INIT_STR;
+    nm_str_t drive_name = NM_INIT_STR;
+    nm_sqlite_stmt_t *stmt;
     uint64_t last_mac;
     uint32_t last_vnc;
     size_t ifs_count;
     size_t drives_count;
     char drv_ch = 'a';
+    int64_t vm_id;
 
     last_mac = nm_form_get_last_mac();
     last_vnc = nm_form_get_free_vnc();
 
-    nm_str_format(&query, NM_SQL_VMS_INSERT_CLONE,
-            dst->data, last_vnc, src->data);
-    nm_db_edit(query.data);
+    /* clone appears with all its drives and interfaces at once */
+    nm_db_begin_transaction();
+
+    stmt = nm_db_stmt(NM_STMT_VMS_INSERT_CLONE);
+    nm_db_bind_text(stmt, 1, dst->data);
+    nm_db_bind_int(stmt, 2, last_vnc);
+    nm_db_bind_text(stmt, 3, src->data);
+    nm_db_exec(stmt);
+
+    vm_id = nm_db_last_id();
 
     /* insert network interface info */
-    ifs_count = vm->ifs.n_memb / NM_IFS_IDX_COUNT;
+    ifs_count = nm_db_rows(&vm->ifs);
 
     for (size_t n = 0; n < ifs_count; n++) {
         int altname;
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
         nm_str_t if_name = NM_INIT_STR;
         nm_str_t if_name_copy = NM_INIT_STR;
         nm_str_t maddr = NM_INIT_STR;
@@ -198,17 +205,19 @@ static void nm_clone_vm_to_db(const nm_str_t *src, const nm_str_t *dst,
         nm_str_copy(&if_name_copy, &if_name);
         altname = nm_net_fix_tap_name(&if_name, &maddr);
 
-        nm_str_format(&query, NM_SQL_IFACES_INSERT_CLONED,
-            dst->data, if_name.data, maddr.data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_DRV + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_VHO + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_MVT + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_PET + idx_shift)->data,
-            (altname) ? if_name_copy.data : "",
-            nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_FWD + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_SMB + idx_shift)->data);
-        nm_db_edit(query.data);
+        stmt = nm_db_stmt(NM_STMT_IFACES_INSERT);
+        nm_db_bind_int(stmt, 1, vm_id);
+        nm_db_bind_text(stmt, 2, if_name.data);
+        nm_db_bind_text(stmt, 3, maddr.data);
+        nm_db_bind_text(stmt, 4, nm_db_text(&vm->ifs, n, NM_SQL_IF_DRV));
+        nm_db_bind_int(stmt, 5, nm_db_int(&vm->ifs, n, NM_SQL_IF_VHO));
+        nm_db_bind_int(stmt, 6, nm_db_int(&vm->ifs, n, NM_SQL_IF_MVT));
+        nm_db_bind_text(stmt, 7, nm_db_text(&vm->ifs, n, NM_SQL_IF_PET));
+        nm_db_bind_text(stmt, 8, (altname) ? if_name_copy.data : "");
+        nm_db_bind_int(stmt, 9, nm_db_int(&vm->ifs, n, NM_SQL_IF_USR));
+        nm_db_bind_text(stmt, 10, nm_db_text(&vm->ifs, n, NM_SQL_IF_FWD));
+        nm_db_bind_text(stmt, 11, nm_db_text(&vm->ifs, n, NM_SQL_IF_SMB));
+        nm_db_exec(stmt);
 
         nm_str_free(&if_name);
         nm_str_free(&if_name_copy);
@@ -216,24 +225,28 @@ static void nm_clone_vm_to_db(const nm_str_t *src, const nm_str_t *dst,
     }
 
     /* insert drive info */
-    drives_count = vm->drives.n_memb / NM_DRV_IDX_COUNT;
+    drives_count = nm_db_rows(&vm->drives);
 
     for (size_t n = 0; n < drives_count; n++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * n;
-
-        nm_str_format(&query, NM_SQL_DRIVES_INSERT_CLONED,
-            dst->data, dst->data, drv_ch,
-            nm_vect_str(&vm->drives, NM_SQL_DRV_TYPE + idx_shift)->data,
-            nm_vect_str(&vm->drives, NM_SQL_DRV_SIZE + idx_shift)->data,
-            nm_vect_str(&vm->drives, NM_SQL_DRV_BOOT + idx_shift)->data,
-            nm_vect_str(&vm->drives, NM_SQL_DRV_DISC + idx_shift)->data,
-            nm_vect_str(&vm->drives, NM_SQL_DRV_FMT + idx_shift)->data);
-        nm_db_edit(query.data);
+        nm_str_format(&drive_name, "%s_%c.img", dst->data, drv_ch);
+
+        stmt = nm_db_stmt(NM_STMT_DRIVES_INSERT);
+        nm_db_bind_int(stmt, 1, vm_id);
+        nm_db_bind_text(stmt, 2, drive_name.data);
+        nm_db_bind_text(stmt, 3, nm_db_text(&vm->drives, n, NM_SQL_DRV_TYPE));
+        /* capacity of imported drives may be fractional, like 8.5 */
+        nm_db_bind_text(stmt, 4, nm_db_text(&vm->drives, n, NM_SQL_DRV_SIZE));
+        nm_db_bind_int(stmt, 5, nm_db_int(&vm->drives, n, NM_SQL_DRV_BOOT));
+        nm_db_bind_int(stmt, 6, nm_db_int(&vm->drives, n, NM_SQL_DRV_DISC));
+        nm_db_bind_text(stmt, 7, nm_db_text(&vm->drives, n, NM_SQL_DRV_FMT));
+        nm_db_exec(stmt);
 
         drv_ch++;
     }
 
-    nm_str_free(&query);
+    nm_db_commit();
+
+    nm_str_free(&drive_name);
 }
 
 /* vim:set ts=4 sw=4: */
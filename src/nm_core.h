@@ -70,8 +70,8 @@ static const char NM_DEFAULT_DRVFMT[]  = "qcow2";
 static const char NM_DEFAULT_USBVER[]  = "XHCI";
 static const char NM_VM_PID_FILE[]     = "qemu.pid";
 static const char NM_VM_QMP_FILE[]     = "qmp.sock";
+static const char NM_VM_QMP_MON_FILE[] = "qmp-mon.sock";
 static const char NM_DEFAULT_DISPLAY[] = "qxl";
-static const char NM_MQ_PATH[]         = "/nemu-qmp";
 
 static inline char *__attribute__((format_arg(1))) _(const char *str)
 {
@@ -80,7 +80,7 @@ static inline char *__attribute__((format_arg(1))) _(const char *str)
 static inline void nm_init_core(void)
 {
     nm_cfg_init(false);
-    nm_db_init();
+    nm_db_init(NM_DB_RW);
 }
 static inline void __attribute__((noreturn)) nm_exit_core(void)
 {
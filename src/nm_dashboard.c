@@ -0,0 +1,447 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_window.h>
+#include <nm_database.h>
+#include <nm_mon_shm.h>
+#include <nm_dashboard.h>
+#include <nm_mon_metrics.h>
+
+enum {
+    NM_DASH_COL_NAME = 0,
+    NM_DASH_COL_CPU,
+    NM_DASH_COL_RSS,
+    NM_DASH_COL_IOPS,
+    NM_DASH_COL_NET,
+    NM_DASH_COL_COUNT
+};
+
+enum {
+    NM_DASH_CELL_LEN = 64,  /* longer names are truncated */
+    NM_DASH_HEAD_ROW = 3,   /* column names, below the title */
+    NM_DASH_FIRST_ROW = 4,
+    NM_DASH_MIN_NAME = 8,
+};
+
+typedef struct {
+    const nm_str_t *name;
+    double cpu;         /* percent of one host CPU */
+    uint64_t rss;       /* bytes */
+    double iops;        /* read + write requests per second */
+    double net;         /* rx + tx bytes per second */
+} nm_dash_row_t;
+
+/* text on the screen, cells are redrawn only when they change */
+typedef struct {
+    char cell[NM_DASH_COL_COUNT][NM_DASH_CELL_LEN];
+    bool hl;
+    bool valid;
+} nm_dash_line_t;
+
+typedef struct {
+    nm_window_t *win;
+    nm_panel_t *panel;
+    nm_dash_line_t *lines;  /* visible table rows */
+    size_t n_lines;
+    int pos[NM_DASH_COL_COUNT];
+    int width[NM_DASH_COL_COUNT];
+    nm_dash_row_t *rows;    /* running VMs */
+    size_t n_rows;
+    size_t first;           /* row shown at the top */
+    size_t sel;
+    nm_str_t sel_name;      /* selection follows VM when rows are resorted */
+} nm_dash_t;
+
+#define NM_INIT_DASH (nm_dash_t) { .sel_name = NM_INIT_STR }
+
+static const char *nm_dash_titles[NM_DASH_COL_COUNT] = {
+    "NAME", "CPU%", "RSS MiB", "IOPS", "NET Mbit/s"
+};
+
+/* width of numeric columns, name takes the rest */
+static const int nm_dash_widths[NM_DASH_COL_COUNT] = { 0, 8, 10, 10, 12 };
+
+/* qsort(3) has no context argument, kept between views */
+static int nm_dash_sort = NM_DASH_COL_CPU;
+static bool nm_dash_reverse;
+
+static int nm_dash_min_cols(void);
+static void nm_dash_init_window(nm_dash_t *d);
+static void nm_dash_free_window(nm_dash_t *d);
+static void nm_dash_head(const nm_dash_t *d);
+static void nm_dash_collect(nm_dash_t *d, const nm_vect_t *names);
+static void nm_dash_order(nm_dash_t *d);
+static void nm_dash_scroll(nm_dash_t *d, int ch);
+static void nm_dash_draw(nm_dash_t *d);
+static int nm_dash_cmp(const void *a, const void *b);
+
+void nm_dashboard(void)
+{
+    nm_dash_t dash = NM_INIT_DASH;
+    nm_vect_t names = NM_INIT_VECT;
+    bool resized = false;
+    uint64_t next = 0;
+    int ch = ERR;
+
+    if (getmaxx(stdscr) < nm_dash_min_cols()) {
+        nm_warn(_(NM_MSG_SMALL_WIN));
+        return;
+    }
+
+    nm_db_stmt_select(nm_db_stmt(NM_STMT_VMS_SELECT_NAMES), &names);
+    dash.rows = nm_calloc(nm_max(names.n_memb, (size_t) 1),
+            sizeof(nm_dash_row_t));
+
+    nm_dash_init_window(&dash);
+    werase(help_window);
+    nm_init_help_dashboard();
+
+    do {
+        uint64_t now;
+
+        if (ch >= '1' && ch < '1' + NM_DASH_COL_COUNT) {
+            int col = ch - '1';
+
+            nm_dash_reverse = (col == nm_dash_sort) ? !nm_dash_reverse : false;
+            nm_dash_sort = col;
+            nm_dash_head(&dash);
+            nm_dash_order(&dash);
+        } else if (ch != ERR) {
+            nm_dash_scroll(&dash, ch);
+        }
+
+        /* main windows are recreated by the main loop on return */
+        if (redraw_window) {
+            nm_dash_free_window(&dash);
+            endwin();
+            refresh();
+            nm_dash_init_window(&dash);
+            nm_dash_order(&dash);
+            redraw_window = 0;
+            resized = true;
+        }
+
+        now = nm_mono_ms();
+        if (now >= next) {
+            nm_dash_collect(&dash, &names);
+            nm_dash_order(&dash);
+            next = now + NM_METRICS_INTERVAL;
+        }
+
+        nm_dash_draw(&dash);
+
+        now = nm_mono_ms();
+        wtimeout(dash.win, (next > now) ? (int) (next - now) : 0);
+    } while ((ch = wgetch(dash.win)) != NM_KEY_Q);
+
+    nm_dash_free_window(&dash);
+    touchwin(side_window);
+    touchwin(action_window);
+    werase(help_window);
+    nm_init_help_main();
+    redraw_window = resized;
+
+    free(dash.rows);
+    nm_str_free(&dash.sel_name);
+    nm_vect_free(&names, nm_str_vect_free_cb);
+}
+
+static int nm_dash_min_cols(void)
+{
+    int cols = NM_DASH_MIN_NAME + 2;
+
+    for (int n = NM_DASH_COL_NAME + 1; n < NM_DASH_COL_COUNT; n++) {
+        cols += nm_dash_widths[n] + 1;
+    }
+
+    return cols;
+}
+
+static void nm_dash_init_window(nm_dash_t *d)
+{
+    int screen_x, screen_y, x;
+    nm_cord_t size;
+
+    getmaxyx(stdscr, screen_y, screen_x);
+    size = NM_SET_POS(screen_y - 1, screen_x, 0, 1);
+    d->win = nm_init_window(&size);
+    d->panel = new_panel(d->win);
+
+    /* numeric columns are aligned to the right border */
+    x = getmaxx(d->win) - 1;
+    for (int n = NM_DASH_COL_COUNT - 1; n > NM_DASH_COL_NAME; n--) {
+        d->width[n] = nm_dash_widths[n];
+        x -= d->width[n];
+        d->pos[n] = x--;
+    }
+    d->pos[NM_DASH_COL_NAME] = 1;
+    d->width[NM_DASH_COL_NAME] = nm_min(nm_max(x - 2, NM_DASH_MIN_NAME),
+            NM_DASH_CELL_LEN - 1);
+
+    d->n_lines = nm_max(getmaxy(d->win) - NM_DASH_FIRST_ROW - 1, 0);
+    d->lines = nm_calloc(nm_max(d->n_lines, (size_t) 1),
+            sizeof(nm_dash_line_t));
+
+    nm_dash_head(d);
+}
+
+static void nm_dash_free_window(nm_dash_t *d)
+{
+    del_panel(d->panel);
+    delwin(d->win);
+    free(d->lines);
+    d->lines = NULL;
+    d->n_lines = 0;
+}
+
+/* box, title and column names, sort column is marked */
+static void nm_dash_head(const nm_dash_t *d)
+{
+    int cols = getmaxx(d->win);
+    nm_str_t title = NM_INIT_STR;
+
+    werase(d->win);
+    box(d->win, 0, 0);
+    nm_str_format(&title, _("Running VMs [%zu]"), d->n_rows);
+    mvwprintw(d->win, 1, (cols - title.len) / 2, "%s", title.data);
+    mvwaddch(d->win, 2, 0, ACS_LTEE);
+    mvwhline(d->win, 2, 1, ACS_HLINE, cols - 2);
+    mvwaddch(d->win, 2, cols - 1, ACS_RTEE);
+
+    wattron(d->win, A_BOLD);
+    for (int n = 0; n < NM_DASH_COL_COUNT; n++) {
+        nm_str_format(&title, "%s%s", _(nm_dash_titles[n]),
+                (n != nm_dash_sort) ? "" : (nm_dash_reverse) ? "^" : "v");
+        mvwprintw(d->win, NM_DASH_HEAD_ROW, d->pos[n],
+                (n == NM_DASH_COL_NAME) ? "%-*.*s" : "%*.*s",
+                d->width[n], d->width[n], title.data);
+    }
+    wattroff(d->win, A_BOLD);
+
+    /* everything is redrawn */
+    for (size_t n = 0; n < d->n_lines; n++) {
+        d->lines[n].valid = false;
+    }
+
+    nm_str_free(&title);
+}
+
+static void nm_dash_collect(nm_dash_t *d, const nm_vect_t *names)
+{
+    size_t prev = d->n_rows;
+
+    d->n_rows = 0;
+
+    for (size_t n = 0; n < names->n_memb; n++) {
+        const nm_str_t *name = nm_vect_at(names, n);
+        nm_metrics_drive_t drives[NM_METRICS_DRIVES];
+        nm_metrics_iface_t ifaces[NM_METRICS_IFACES];
+        nm_dash_row_t *row = &d->rows[d->n_rows];
+        nm_metrics_rate_t rate;
+        nm_shm_vm_t vm;
+        size_t count;
+
+        if (nm_mon_shm_get(name, &vm) != NM_OK || vm.state != NM_TRUE) {
+            continue;
+        }
+
+        memset(row, 0, sizeof(*row));
+        row->name = name;
+
+        if (nm_mon_metrics_last(name, &rate) == NM_OK) {
+            row->cpu = rate.cpu;
+            row->rss = rate.rss;
+        }
+
+        count = nm_mon_metrics_get_drives(name, drives, NM_METRICS_DRIVES);
+        for (size_t i = 0; i < count; i++) {
+            row->iops += drives[i].rd_iops + drives[i].wr_iops;
+        }
+
+        count = nm_mon_metrics_get_ifaces(name, ifaces, NM_METRICS_IFACES);
+        for (size_t i = 0; i < count; i++) {
+            row->net += ifaces[i].rx_bps + ifaces[i].tx_bps;
+        }
+
+        d->n_rows++;
+    }
+
+    if (prev != d->n_rows) {
+        nm_dash_head(d);
+    }
+}
+
+/* sort rows, keep the selected VM selected and visible */
+static void nm_dash_order(nm_dash_t *d)
+{
+    qsort(d->rows, d->n_rows, sizeof(nm_dash_row_t), nm_dash_cmp);
+
+    if (d->sel_name.len) {
+        for (size_t n = 0; n < d->n_rows; n++) {
+            if (nm_str_cmp_ss(d->rows[n].name, &d->sel_name) == NM_OK) {
+                d->sel = n;
+                break;
+            }
+        }
+    }
+
+    if (d->sel >= d->n_rows) {
+        d->sel = (d->n_rows) ? d->n_rows - 1 : 0;
+    }
+
+    if (d->sel < d->first) {
+        d->first = d->sel;
+    } else if (d->n_lines && d->sel >= d->first + d->n_lines) {
+        d->first = d->sel - d->n_lines + 1;
+    }
+
+    /* no empty lines at the bottom if rows were removed */
+    if (d->first + d->n_lines > d->n_rows) {
+        d->first = (d->n_rows > d->n_lines) ? d->n_rows - d->n_lines : 0;
+    }
+
+    if (d->n_rows) {
+        nm_str_copy(&d->sel_name, d->rows[d->sel].name);
+    }
+}
+
+static void nm_dash_scroll(nm_dash_t *d, int ch)
+{
+    size_t page = nm_max(d->n_lines, (size_t) 1);
+
+    if (!d->n_rows) {
+        return;
+    }
+
+    switch (ch) {
+    case KEY_UP:
+        d->sel = (d->sel) ? d->sel - 1 : d->n_rows - 1;
+        break;
+    case KEY_DOWN:
+        d->sel = (d->sel + 1 < d->n_rows) ? d->sel + 1 : 0;
+        break;
+    case KEY_PPAGE:
+        d->sel = (d->sel > page) ? d->sel - page : 0;
+        break;
+    case KEY_NPAGE:
+        d->sel = nm_min(d->sel + page, d->n_rows - 1);
+        break;
+    case KEY_HOME:
+        d->sel = 0;
+        break;
+    case KEY_END:
+        d->sel = d->n_rows - 1;
+        break;
+    default:
+        return;
+    }
+
+    nm_str_copy(&d->sel_name, d->rows[d->sel].name);
+    nm_dash_order(d);
+}
+
+static void nm_dash_cells(const nm_dash_t *d, const nm_dash_row_t *row,
+        char cell[][NM_DASH_CELL_LEN])
+{
+    const int *w = d->width;
+
+    if (!row) {
+        for (int n = 0; n < NM_DASH_COL_COUNT; n++) {
+            snprintf(cell[n], NM_DASH_CELL_LEN, "%*s", w[n], "");
+        }
+        return;
+    }
+
+    snprintf(cell[NM_DASH_COL_NAME], NM_DASH_CELL_LEN, "%-*.*s",
+            w[NM_DASH_COL_NAME], w[NM_DASH_COL_NAME], row->name->data);
+    snprintf(cell[NM_DASH_COL_CPU], NM_DASH_CELL_LEN, "%*.1f",
+            w[NM_DASH_COL_CPU], row->cpu);
+    snprintf(cell[NM_DASH_COL_RSS], NM_DASH_CELL_LEN, "%*.1f",
+            w[NM_DASH_COL_RSS], (double) row->rss / 1048576);
+    snprintf(cell[NM_DASH_COL_IOPS], NM_DASH_CELL_LEN, "%*.0f",
+            w[NM_DASH_COL_IOPS], row->iops);
+    snprintf(cell[NM_DASH_COL_NET], NM_DASH_CELL_LEN, "%*.2f",
+            w[NM_DASH_COL_NET], row->net * 8 / 1e6);
+}
+
+/*
+ * Only visible rows are formatted. A cell is written to the window
+ * if its text differs from what is on the screen, the whole line is
+ * rewritten when the selection moves to or from it.
+ */
+static void nm_dash_draw(nm_dash_t *d)
+{
+    bool changed = false;
+
+    for (size_t n = 0; n < d->n_lines; n++) {
+        size_t idx = d->first + n;
+        const nm_dash_row_t *row = (idx < d->n_rows) ? &d->rows[idx] : NULL;
+        nm_dash_line_t *line = &d->lines[n];
+        char cell[NM_DASH_COL_COUNT][NM_DASH_CELL_LEN];
+        bool hl = (row && idx == d->sel);
+        int y = NM_DASH_FIRST_ROW + n;
+
+        nm_dash_cells(d, row, cell);
+
+        if (hl != line->hl) {
+            line->valid = false;
+            line->hl = hl;
+        }
+
+        if (hl) {
+            wattron(d->win, A_REVERSE);
+        }
+        for (int c = 0; c < NM_DASH_COL_COUNT; c++) {
+            if (line->valid && strcmp(line->cell[c], cell[c]) == 0) {
+                continue;
+            }
+            mvwaddstr(d->win, y, d->pos[c], cell[c]);
+            /* gap between the columns */
+            if (c < NM_DASH_COL_COUNT - 1) {
+                waddch(d->win, ' ');
+            }
+            memcpy(line->cell[c], cell[c], NM_DASH_CELL_LEN);
+            changed = true;
+        }
+        if (hl) {
+            wattroff(d->win, A_REVERSE);
+        }
+
+        line->valid = true;
+    }
+
+    if (changed) {
+        wrefresh(d->win);
+    }
+}
+
+static int nm_dash_cmp(const void *a, const void *b)
+{
+    const nm_dash_row_t *ra = a, *rb = b;
+    int rc = 0;
+
+    /* numeric columns are sorted in descending order */
+    switch (nm_dash_sort) {
+    case NM_DASH_COL_CPU:
+        rc = (ra->cpu < rb->cpu) - (ra->cpu > rb->cpu);
+        break;
+    case NM_DASH_COL_RSS:
+        rc = (ra->rss < rb->rss) - (ra->rss > rb->rss);
+        break;
+    case NM_DASH_COL_IOPS:
+        rc = (ra->iops < rb->iops) - (ra->iops > rb->iops);
+        break;
+    case NM_DASH_COL_NET:
+        rc = (ra->net < rb->net) - (ra->net > rb->net);
+        break;
+    }
+
+    /* equal rows keep their place between refreshes */
+    if (!rc) {
+        rc = strcmp(ra->name->data, rb->name->data);
+    }
+
+    return (nm_dash_reverse) ? -rc : rc;
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,11 @@
+#ifndef NM_DASHBOARD_H_
+#define NM_DASHBOARD_H_
+
+/*
+ * Resource usage of all running VMs in one sortable table,
+ * refreshed from metrics collected by the monitoring daemon.
+ */
+void nm_dashboard(void);
+
+#endif /* NM_DASHBOARD_H_ */
+/* vim:set ts=4 sw=4: */
@@ -4,16 +4,43 @@
 #include <nm_vector.h>
 #include <nm_cfg_file.h>
 #include <nm_database.h>
+#include <nm_db_migrate.h>
+#include <nm_db_profile.h>
 
 #include <pthread.h>
 
-static const char db_script[] = NM_FULL_DATAROOTDIR
-    "/nemu/scripts/upgrade_db.sh";
 static pthread_key_t db_conn_key;
 static pthread_once_t key_once = PTHREAD_ONCE_INIT;
 
+static const char *const db_stmt_sql[NM_STMT_COUNT] = {
+    [NM_STMT_BEGIN]                    = "BEGIN",
+    [NM_STMT_COMMIT]                   = "COMMIT",
+    [NM_STMT_VMS_SELECT_ALL]           = NM_STMT_SQL_VMS_SELECT_ALL,
+    [NM_STMT_VMS_SELECT_VNC]           = NM_STMT_SQL_VMS_SELECT_VNC,
+    [NM_STMT_VMS_SELECT_NAMES]         = NM_SQL_VMS_SELECT_NAMES,
+    [NM_STMT_VMS_SELECT_NAMES_BY_TEAM] = NM_STMT_SQL_VMS_SELECT_NAMES_BY_TEAM,
+    [NM_STMT_IFACES_SELECT_BY_ID]      = NM_STMT_SQL_IFACES_SELECT_BY_ID,
+    [NM_STMT_DRIVES_SELECT_BY_ID]      = NM_STMT_SQL_DRIVES_SELECT_BY_ID,
+    [NM_STMT_USB_SELECT_BY_ID]         = NM_STMT_SQL_USB_SELECT_BY_ID,
+    [NM_STMT_USB_SELECT_BY_NAME]       = NM_STMT_SQL_USB_SELECT_BY_NAME,
+    [NM_STMT_VMS_INSERT]               = NM_STMT_SQL_VMS_INSERT,
+    [NM_STMT_VMS_INSERT_CLONE]         = NM_STMT_SQL_VMS_INSERT_CLONE,
+    [NM_STMT_IFACES_INSERT]            = NM_STMT_SQL_IFACES_INSERT,
+    [NM_STMT_DRIVES_INSERT]            = NM_STMT_SQL_DRIVES_INSERT,
+    [NM_STMT_VMS_UPDATE_SMP_BY_TEAM]   = NM_STMT_SQL_VMS_UPDATE_SMP_BY_TEAM,
+    [NM_STMT_VMS_UPDATE_MEM_BY_TEAM]   = NM_STMT_SQL_VMS_UPDATE_MEM_BY_TEAM,
+    [NM_STMT_VMS_UPDATE_KVM_BY_TEAM]   = NM_STMT_SQL_VMS_UPDATE_KVM_BY_TEAM,
+    [NM_STMT_VMS_UPDATE_HCPU_BY_TEAM]  = NM_STMT_SQL_VMS_UPDATE_HCPU_BY_TEAM,
+    [NM_STMT_VMS_UPDATE_SMP]           = NM_STMT_SQL_VMS_UPDATE_SMP,
+    [NM_STMT_VMS_UPDATE_MEM]           = NM_STMT_SQL_VMS_UPDATE_MEM,
+    [NM_STMT_VMS_UPDATE_KVM]           = NM_STMT_SQL_VMS_UPDATE_KVM,
+    [NM_STMT_VMS_UPDATE_HCPU]          = NM_STMT_SQL_VMS_UPDATE_HCPU,
+    [NM_STMT_DRIVES_UPDATE_DRV]        = NM_STMT_SQL_DRIVES_UPDATE_DRV
+};
+
 static void nm_db_check_version(void);
-static int nm_db_update(void);
+static void nm_db_set_wal(db_conn_t *db);
+static int nm_db_busy_cb(void *ctx, int count);
 static int nm_db_select_cb(void *v, int argc, char **argv,
                            char **unused NM_UNUSED);
 static int nm_db_select_value_cb(void *s, int argc, char **argv,
@@ -27,7 +54,7 @@ static void nm_db_init_key(void)
     }
 }
 
-void nm_db_init(void)
+void nm_db_init(enum nm_db_mode mode)
 {
     const nm_cfg_t *cfg = nm_cfg_get();
     int need_create_db = 0;
@@ -44,7 +71,14 @@ void nm_db_init(void)
         NM_SQL_SNAPS_CREATE,
         NM_SQL_VETH_CREATE,
         NM_SQL_USB_CREATE,
-        NM_SQL_VETH_CREATE_TRIGGER
+        NM_SQL_VETH_CREATE_TRIGGER,
+        NM_SQL_VMS_NAME_INDEX,
+        NM_SQL_VMS_TEAM_INDEX,
+        NM_SQL_IFACES_VM_INDEX,
+        NM_SQL_IFACES_NAME_INDEX,
+        NM_SQL_DRIVES_VM_INDEX,
+        NM_SQL_SNAPS_VM_INDEX,
+        NM_SQL_USB_VM_INDEX
     };
 
     if (stat(cfg->db_path.data, &file_info) == -1) {
@@ -53,6 +87,7 @@ void nm_db_init(void)
 
     db_conn = nm_calloc(1, sizeof(*db_conn));
     db_conn->in_transaction = false;
+    db_conn->busy_timeout = cfg->db_busy_timeout;
 
     if ((rc = sqlite3_open(cfg->db_path.data,
                     &db_conn->handler)) != SQLITE_OK) {
@@ -61,6 +96,12 @@ void nm_db_init(void)
         nm_debug("%s: db handler %p\n", __func__, (void *) db_conn->handler);
     }
 
+    sqlite3_busy_handler(db_conn->handler, nm_db_busy_cb, db_conn);
+
+    if (cfg->db_profile.len) {
+        nm_db_prof_attach(db_conn->handler);
+    }
+
     if (pthread_once(&key_once, nm_db_init_key) != 0) {
         nm_bug(_("%s: pthread_once error: %s"), __func__, strerror(errno));
     }
@@ -84,23 +125,90 @@ void nm_db_init(void)
 
     if (!need_create_db) {
         nm_db_check_version();
-        return;
-    }
+    } else {
+        for (size_t n = 0; n < nm_arr_len(query); n++) {
+            nm_debug("%s: \"%s\"\n", __func__, query[n]);
 
-    for (size_t n = 0; n < nm_arr_len(query); n++) {
-        nm_debug("%s: \"%s\"\n", __func__, query[n]);
+            if (db_conn->in_transaction) {
+                nm_bug(_("%s: database in transaction"), __func__);
+            }
 
-        if (db_conn->in_transaction) {
-            nm_bug(_("%s: database in transaction"), __func__);
+            if (sqlite3_exec(db_conn->handler, query[n],
+                        NULL, NULL, &db_errmsg) != SQLITE_OK) {
+                nm_bug(_("%s: database error: %s"), __func__, db_errmsg);
+            }
         }
+    }
 
-        if (sqlite3_exec(db_conn->handler, query[n],
-                    NULL, NULL, &db_errmsg) != SQLITE_OK) {
-            nm_bug(_("%s: database error: %s"), __func__, db_errmsg);
-        }
+    nm_db_set_wal(db_conn);
+
+    if (mode == NM_DB_RO && sqlite3_exec(db_conn->handler,
+                NM_SQL_PRAGMA_QUERY_ONLY, NULL, NULL,
+                &db_errmsg) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__, db_errmsg);
     }
 }
 
+static void nm_db_set_wal(db_conn_t *db)
+{
+    const char *mode;
+    sqlite3_stmt *stmt;
+
+    /* journal mode is kept in the file, this is a no-op after the 1st run */
+    if (sqlite3_prepare_v2(db->handler, NM_SQL_PRAGMA_WAL, -1,
+                &stmt, NULL) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(db->handler));
+    }
+
+    if (sqlite3_step(stmt) != SQLITE_ROW) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(db->handler));
+    }
+
+    /* e.g. no shared memory support on a network filesystem */
+    mode = (const char *) sqlite3_column_text(stmt, 0);
+    if (!mode || nm_str_cmp_tt(mode, "wal") != NM_OK) {
+        nm_debug("%s: WAL is not available, journal mode: %s\n",
+                __func__, mode ? mode : "unknown");
+    }
+
+    sqlite3_finalize(stmt);
+}
+
+/*
+ * Called by sqlite while the lock is held by another connection.
+ * Sleep with growing delay until db_busy_timeout is spent,
+ * returning 0 makes the statement fail with SQLITE_BUSY.
+ */
+static int nm_db_busy_cb(void *ctx, int count)
+{
+    db_conn_t *db = ctx;
+    uint64_t now = nm_mono_ms();
+    uint64_t delay;
+    struct timespec ts;
+
+    if (count == 0) {
+        db->busy_since = now;
+        nm_debug("%s: database is locked, waiting\n", __func__);
+    }
+
+    if (now - db->busy_since >= db->busy_timeout) {
+        nm_debug("%s: database is still locked after %d retries\n",
+                __func__, count);
+        return 0;
+    }
+
+    /* 1, 2, 4 ... 32, then 50 ms */
+    delay = nm_min(1ULL << nm_min(count, 6), 50ULL);
+    delay = nm_min(delay, db->busy_timeout - (now - db->busy_since));
+    ts.tv_sec = 0;
+    ts.tv_nsec = delay * 1000000;
+    nanosleep(&ts, NULL);
+
+    return 1;
+}
+
 static void nm_db_select_common(const char *query, void *res,
         int (*cb)(void *, int, char **, char **))
 {
@@ -175,9 +283,13 @@ void nm_db_begin_transaction(void)
         nm_bug(_("%s: database already in transaction"), __func__);
     }
 
-    nm_debug("%s: BEGIN TRANSACTION\n", __func__);
+    nm_debug("%s: BEGIN IMMEDIATE\n", __func__);
 
-    if (sqlite3_exec(db->handler, "BEGIN TRANSACTION",
+    /*
+     * Take the write lock now: waiting for it is possible only here,
+     * a deferred transaction could fail on the first write instead.
+     */
+    if (sqlite3_exec(db->handler, "BEGIN IMMEDIATE",
                 NULL, NULL, &db_errmsg) != SQLITE_OK) {
         nm_bug(_("%s: database error: %s"), __func__, db_errmsg);
     }
@@ -261,80 +373,262 @@ void nm_db_close(void)
         return;
     }
 
+    for (size_t n = 0; n < NM_STMT_COUNT; n++) {
+        sqlite3_finalize(db->stmt[n]);
+    }
+
     sqlite3_close(db->handler);
     pthread_key_delete(db_conn_key);
     free(db);
 }
 
-static void nm_db_check_version(void)
+nm_sqlite_stmt_t *nm_db_stmt(enum nm_db_stmt_id id)
 {
-    nm_str_t query = NM_INIT_STR;
-    nm_vect_t res = NM_INIT_VECT;
+    nm_sqlite_stmt_t *stmt;
+    db_conn_t *db;
+    int rc;
 
-    nm_str_alloc_text(&query, NM_SQL_PRAGMA_USER_VERSION_GET);
-    nm_db_select(query.data, &res);
+    if ((db = pthread_getspecific(db_conn_key)) == NULL) {
+        nm_bug(_("%s: got NULL db_conn"), __func__);
+    }
 
-    if (!res.n_memb) {
-        fprintf(stderr, _("%s: cannot get database version"), __func__);
-        nm_exit(NM_ERR);
+    if ((stmt = db->stmt[id]) != NULL) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
+        return stmt;
     }
 
-    if (nm_str_cmp_st(nm_vect_at(&res, 0), NM_DB_VERSION) != NM_OK) {
-        printf(_("Database version is not up do date."
-                    " I will try to update it.\n"));
-        if (nm_db_update() != NM_OK) {
-            fprintf(stderr, _("Cannot update database\n"));
-            nm_exit(NM_ERR);
+    /*
+     * PERSISTENT hints sqlite that the statement lives long,
+     * so it is not allocated from the lookaside memory.
+     */
+    if ((rc = sqlite3_prepare_v3(db->handler, db_stmt_sql[id], -1,
+                    SQLITE_PREPARE_PERSISTENT, &stmt, NULL)) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(db->handler));
+    }
+
+    nm_debug("%s: prepared \"%s\"\n", __func__, db_stmt_sql[id]);
+    db->stmt[id] = stmt;
+
+    return stmt;
+}
+
+void nm_db_bind_text(nm_sqlite_stmt_t *stmt, int idx, const char *text)
+{
+    if (sqlite3_bind_text(stmt, idx, text, -1, SQLITE_STATIC) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    }
+}
+
+void nm_db_bind_int(nm_sqlite_stmt_t *stmt, int idx, int64_t val)
+{
+    if (sqlite3_bind_int64(stmt, idx, val) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    }
+}
+
+bool nm_db_step(nm_sqlite_stmt_t *stmt)
+{
+    int rc = sqlite3_step(stmt);
+
+    if (rc == SQLITE_ROW) {
+        return true;
+    }
+
+    /* release read lock right away, do not wait for the next use */
+    sqlite3_reset(stmt);
+
+    if (rc != SQLITE_DONE) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    }
+
+    return false;
+}
+
+int nm_db_exec(nm_sqlite_stmt_t *stmt)
+{
+    int rc;
+
+    nm_debug("%s: \"%s\"\n", __func__, sqlite3_sql(stmt));
+
+    if ((rc = sqlite3_step(stmt)) != SQLITE_DONE) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(sqlite3_db_handle(stmt)));
+    }
+
+    sqlite3_reset(stmt);
+
+    return sqlite3_changes(sqlite3_db_handle(stmt));
+}
+
+int64_t nm_db_last_id(void)
+{
+    db_conn_t *db;
+
+    if ((db = pthread_getspecific(db_conn_key)) == NULL) {
+        nm_bug(_("%s: got NULL db_conn"), __func__);
+    }
+
+    return sqlite3_last_insert_rowid(db->handler);
+}
+
+void nm_db_stmt_select(nm_sqlite_stmt_t *stmt, nm_vect_t *res)
+{
+    nm_str_t value = NM_INIT_STR;
+    int cols = sqlite3_column_count(stmt);
+
+    nm_debug("%s: \"%s\"\n", __func__, sqlite3_sql(stmt));
+
+    while (nm_db_step(stmt)) {
+        for (int n = 0; n < cols; n++) {
+            const unsigned char *text = sqlite3_column_text(stmt, n);
+
+            nm_str_alloc_text(&value, text ? (const char *) text : "");
+            nm_vect_insert(res, &value, sizeof(nm_str_t), nm_str_vect_ins_cb);
         }
     }
 
-    nm_vect_free(&res, nm_str_vect_free_cb);
-    nm_str_free(&query);
+    nm_str_free(&value);
 }
 
-static int nm_db_update(void)
+void nm_db_stmt_fetch(nm_sqlite_stmt_t *stmt, nm_db_res_t *res)
 {
-    const nm_cfg_t *cfg = nm_cfg_get();
-    nm_str_t backup = NM_INIT_STR;
-    nm_str_t answer = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
-    int rc = NM_OK;
+    size_t cols = sqlite3_column_count(stmt);
+    size_t ncells = 0;
+
+    nm_debug("%s: \"%s\"\n", __func__, sqlite3_sql(stmt));
+
+    res->rows = 0;
+    res->cols = cols;
+    res->text_len = 0;
+
+    while (nm_db_step(stmt)) {
+        if (ncells + cols > res->cells_alloc) {
+            res->cells_alloc = nm_max(res->cells_alloc * 2, ncells + cols);
+            res->cells = nm_realloc(res->cells,
+                    res->cells_alloc * sizeof(nm_db_cell_t));
+        }
+
+        for (size_t n = 0; n < cols; n++) {
+            nm_db_cell_t *cell = &res->cells[ncells++];
+            const unsigned char *text;
+            size_t len;
+
+            /* int first: text conversion of numbers is kept by sqlite */
+            cell->num = sqlite3_column_int64(stmt, n);
+            text = sqlite3_column_text(stmt, n);
+            len = sqlite3_column_bytes(stmt, n);
+            cell->null = (text == NULL);
+
+            if (res->text_len + len + 1 > res->text_alloc) {
+                res->text_alloc = nm_max(res->text_alloc * 2,
+                        res->text_len + len + 1);
+                res->text = nm_realloc(res->text, res->text_alloc);
+            }
+
+            cell->off = res->text_len;
+            cell->str.len = len;
+            cell->str.alloc_bytes = 0;
+            if (len) {
+                memcpy(res->text + res->text_len, text, len);
+            }
+            res->text[res->text_len + len] = '\0';
+            res->text_len += len + 1;
+        }
+
+        res->rows++;
+    }
+
+    /* arena is not moved anymore */
+    for (size_t n = 0; n < ncells; n++) {
+        res->cells[n].str.data = res->text + res->cells[n].off;
+    }
+}
+
+void nm_db_fetch(const char *query, nm_db_res_t *res)
+{
+    nm_sqlite_stmt_t *stmt;
     db_conn_t *db;
 
     if ((db = pthread_getspecific(db_conn_key)) == NULL) {
         nm_bug(_("%s: got NULL db_conn"), __func__);
     }
 
-    if (db->in_transaction) {
-        nm_bug(_("%s: database in transaction"), __func__);
+    if (sqlite3_prepare_v2(db->handler, query, -1, &stmt, NULL) != SQLITE_OK) {
+        nm_bug(_("%s: database error: %s"), __func__,
+                sqlite3_errmsg(db->handler));
     }
 
-    nm_str_format(&backup, "%s-backup", cfg->db_path.data);
-    nm_copy_file(&cfg->db_path, &backup);
+    nm_db_stmt_fetch(stmt, res);
+    sqlite3_finalize(stmt);
+}
 
-    nm_vect_insert_cstr(&argv, db_script);
-    nm_vect_insert_cstr(&argv, cfg->db_path.data);
-    nm_vect_insert_cstr(&argv, cfg->qemu_bin_path.data);
+void nm_db_res_free(nm_db_res_t *res)
+{
+    free(res->cells);
+    free(res->text);
+    *res = (nm_db_res_t) NM_INIT_DB_RES;
+}
+
+const nm_db_cell_t *nm_db_cell(const nm_db_res_t *res, size_t row, size_t col)
+{
+    if (row >= res->rows || col >= res->cols) {
+        nm_bug(_("%s: invalid index %zu:%zu"), __func__, row, col);
+    }
+
+    return &res->cells[row * res->cols + col];
+}
 
-    nm_vect_end_zero(&argv);
+void nm_db_read_begin(void)
+{
+    db_conn_t *db;
 
-    if (nm_spawn_process(&argv, &answer) != NM_OK) {
-        rc = NM_ERR;
-        unlink(cfg->db_path.data);
-        nm_copy_file(&backup, &cfg->db_path);
+    if ((db = pthread_getspecific(db_conn_key)) == NULL) {
+        nm_bug(_("%s: got NULL db_conn"), __func__);
     }
 
-    if (answer.len) {
-        printf("%s\n", answer.data);
+    if (db->in_transaction || !sqlite3_get_autocommit(db->handler)) {
+        nm_bug(_("%s: database in transaction"), __func__);
+    }
+
+    nm_db_step(nm_db_stmt(NM_STMT_BEGIN));
+}
+
+void nm_db_read_end(void)
+{
+    nm_db_step(nm_db_stmt(NM_STMT_COMMIT));
+}
+
+static void nm_db_check_version(void)
+{
+    nm_vect_t res = NM_INIT_VECT;
+    db_conn_t *db;
+
+    if ((db = pthread_getspecific(db_conn_key)) == NULL) {
+        nm_bug(_("%s: got NULL db_conn"), __func__);
     }
 
-    unlink(backup.data);
+    nm_db_select(NM_SQL_PRAGMA_USER_VERSION_GET, &res);
 
-    nm_vect_free(&argv, NULL);
-    nm_str_free(&backup);
-    nm_str_free(&answer);
+    if (!res.n_memb) {
+        fprintf(stderr, _("%s: cannot get database version"), __func__);
+        nm_exit(NM_ERR);
+    }
 
-    return rc;
+    if (nm_str_cmp_st(nm_vect_at(&res, 0), NM_DB_VERSION) != NM_OK) {
+        printf(_("Database version is not up do date."
+                    " I will try to update it.\n"));
+        if (nm_db_migrate(db->handler) != NM_OK) {
+            fprintf(stderr, _("Cannot update database\n"));
+            nm_exit(NM_ERR);
+        }
+    }
+
+    nm_vect_free(&res, nm_str_vect_free_cb);
 }
 
 static int nm_db_select_cb(void *v, int argc, char **argv,
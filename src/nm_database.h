@@ -2,11 +2,13 @@
 #define NM_DATABASE_H_
 
 #include <nm_vector.h>
+#include <nm_string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <sqlite3.h>
 
-#define NM_DB_VERSION "21"
+#define NM_DB_VERSION "22"
 
 /* PRAGMAS */
 static const char NM_SQL_PRAGMA_FOREIGN_ON[] =
@@ -15,6 +17,10 @@ static const char NM_SQL_PRAGMA_USER_VERSION_GET[] =
     "PRAGMA user_version";
 static const char NM_SQL_PRAGMA_USER_VERSION_SET[] =
     "PRAGMA user_version=" NM_DB_VERSION;
+static const char NM_SQL_PRAGMA_WAL[] =
+    "PRAGMA journal_mode=WAL";
+static const char NM_SQL_PRAGMA_QUERY_ONLY[] =
+    "PRAGMA query_only=ON";
 
 /* CREATE */
 static const char NM_SQL_VMS_CREATE[] =
@@ -64,22 +70,33 @@ static const char NM_SQL_VETH_CREATE_TRIGGER[] =
     "BEGIN UPDATE ifaces SET macvtap='0', parent_eth='' "
     "WHERE parent_eth=old.l_name OR parent_eth=old.r_name; END";
 
-/* VMS */
-static const char NM_SQL_VMS_INSERT_CLONE[] =
-    "INSERT INTO vms SELECT NULL, '%s', mem, smp, kvm, hcpu, %d, arch, "
-    "iso, install, usb, usb_status, bios, kernel, mouse_override, "
-    "kernel_append, tty_path, socket_path, initrd, machine, fs9p_enable, "
-    "fs9p_path, fs9p_name, usb_type, spice, debug_port, debug_freeze, "
-    "cmdappend, team, display_type, pflash, spice_agent "
-    "FROM vms WHERE name='%s'";
+/*
+ * Indexes for lookups by VM name and by vm_id, they also serve
+ * ON DELETE CASCADE when a VM is removed. Sort columns are included,
+ * so per-VM lists come in index order without a sort step.
+ */
+static const char NM_SQL_VMS_NAME_INDEX[] =
+    "CREATE INDEX vms_name_idx ON vms(name)";
 
-static const char NM_SQL_VMS_INSERT_NEW[] =
-    "INSERT INTO vms(name, mem, smp, kvm, hcpu, vnc, arch, iso, "
-    "install, machine, mouse_override, usb, usb_type, usb_status, fs9p_enable, "
-    "spice, debug_port, debug_freeze, display_type, spice_agent) "
-    "VALUES('%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', "
-    "'%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', %s)";
+static const char NM_SQL_VMS_TEAM_INDEX[] =
+    "CREATE INDEX vms_team_idx ON vms(team, name)";
+
+static const char NM_SQL_IFACES_VM_INDEX[] =
+    "CREATE INDEX ifaces_vm_idx ON ifaces(vm_id, if_name)";
+
+static const char NM_SQL_IFACES_NAME_INDEX[] =
+    "CREATE INDEX ifaces_name_idx ON ifaces(if_name, vm_id)";
 
+static const char NM_SQL_DRIVES_VM_INDEX[] =
+    "CREATE INDEX drives_vm_idx ON drives(vm_id, drive_name)";
+
+static const char NM_SQL_SNAPS_VM_INDEX[] =
+    "CREATE INDEX vmsnapshots_vm_idx ON vmsnapshots(vm_id, snap_name)";
+
+static const char NM_SQL_USB_VM_INDEX[] =
+    "CREATE INDEX usb_vm_idx ON usb(vm_id)";
+
+/* VMS */
 static const char NM_SQL_VMS_SELECT_ID[] =
     "SELECT id FROM vms WHERE name='%s'";
 
@@ -210,18 +227,6 @@ static const char NM_SQL_VMS_DELETE_VM[] =
     "DELETE FROM vms WHERE name='%s'";
 
 /* IFACES */
-static const char NM_SQL_IFACES_INSERT_CLONED[] =
-    "INSERT INTO ifaces(vm_id, if_name, mac_addr, if_drv, vhost, "
-    "macvtap, parent_eth, altname, netuser, hostfwd, smb) "
-    "VALUES ((SELECT id FROM vms WHERE name='%s'), "
-    "'%s', '%s', '%s', %s, %s, '%s', '%s', %s, '%s', '%s')";
-
-static const char NM_SQL_IFACES_INSERT_NEW[] =
-    "INSERT INTO ifaces(vm_id, if_name, mac_addr, "
-    "if_drv, vhost, macvtap, altname, netuser) "
-    "VALUES((SELECT id FROM vms WHERE name='%s'), "
-    "'%s', '%s', '%s', %s, %s, '%s', %s)";
-
 static const char NM_SQL_IFACES_SELECT_MAX_MADDR[] =
     "SELECT COALESCE(MAX(mac_addr), 'de:ad:be:ef:00:00') FROM ifaces";
 
@@ -244,6 +249,11 @@ static const char NM_SQL_IFACES_SELECT_JOIN_TEAM[] =
     "SELECT name, if_name FROM ifaces JOIN vms ON vms.id=ifaces.vm_id "
     "AND vms.team='%s' WHERE parent_eth='%s' OR parent_eth='%s'";
 
+static const char NM_SQL_IFACES_SELECT_NAMES[] =
+    "SELECT if_name FROM ifaces WHERE vm_id="
+    "(SELECT id FROM vms WHERE name='%s') AND netuser=0 "
+    "ORDER BY if_name ASC";
+
 static const char NM_SQL_IFACES_SELECT_BY_PARENT[] =
     "SELECT if_name FROM ifaces WHERE parent_eth='%s'";
 
@@ -300,30 +310,12 @@ static const char NM_SQL_IFACES_UPDATE_RESET[] =
     "WHERE parent_eth='%s' OR parent_eth='%s'";
 
 /* DRIVES */
-static const char NM_SQL_DRIVES_INSERT_CLONED[] =
-    "INSERT INTO drives(vm_id, drive_name, drive_drv, "
-    "capacity, boot, discard, format) "
-    "VALUES((SELECT id FROM vms WHERE name='%s'), "
-    "'%s_%c.img', '%s', '%s', %s, %s, '%s')";
-
-static const char NM_SQL_DRIVES_INSERT_NEW[] =
-    "INSERT INTO drives(vm_id, drive_name, drive_drv, "
-    "capacity, boot, discard, format) "
-    "VALUES((SELECT id FROM vms WHERE name='%s'), "
-    "'%s_a.img', '%s', '%s', %s, %s, '%s')";
-
 static const char NM_SQL_DRIVES_INSERT_ADD[] =
     "INSERT INTO drives(vm_id, drive_name, drive_drv, "
     "capacity, boot, discard, format) "
     "VALUES((SELECT id FROM vms WHERE name='%s'), "
     "'%s_%c.img', '%s', '%s', 0, %s, '%s')";
 
-static const char NM_SQL_DRIVES_INSERT_IMPORTED[] =
-    "INSERT INTO drives(vm_id, drive_name, drive_drv, "
-    "capacity, boot, discard, format) "
-    "VALUES((SELECT id FROM vms WHERE name='%s'), "
-    "'%s', '%s', '%s', '%s', '%s', '%s')";
-
 static const char NM_SQL_DRIVES_SELECT[] =
     "SELECT drive_name, drive_drv, capacity, boot, discard, format "
     "FROM drives WHERE vm_id=(SELECT id FROM vms WHERE name='%s') "
@@ -441,16 +433,165 @@ static const char NM_SQL_VETH_SELECT_NAME[] =
 static const char NM_SQL_VETH_DELETE[] =
     "DELETE FROM veth WHERE l_name='%s'";
 
+/*
+ * Statements prepared once per connection, see nm_db_stmt().
+ * Parameters are bound, so values need no quoting.
+ */
+static const char NM_STMT_SQL_VMS_SELECT_ALL[] =
+    "SELECT * FROM vms WHERE name=?1";
+
+static const char NM_STMT_SQL_VMS_SELECT_VNC[] =
+    "SELECT vnc, spice FROM vms WHERE name=?1";
+
+static const char NM_STMT_SQL_VMS_SELECT_NAMES_BY_TEAM[] =
+    "SELECT name FROM vms WHERE team=?1 ORDER BY name ASC";
+
+static const char NM_STMT_SQL_IFACES_SELECT_BY_ID[] =
+    "SELECT if_name, mac_addr, if_drv, ipv4_addr, vhost, "
+    "macvtap, parent_eth, altname, netuser, hostfwd, smb FROM ifaces "
+    "WHERE vm_id=?1 ORDER BY if_name ASC";
+
+static const char NM_STMT_SQL_DRIVES_SELECT_BY_ID[] =
+    "SELECT drive_name, drive_drv, capacity, boot, discard, format "
+    "FROM drives WHERE vm_id=?1 ORDER BY drive_name ASC";
+
+static const char NM_STMT_SQL_USB_SELECT_BY_ID[] =
+    "SELECT * FROM usb WHERE vm_id=?1";
+
+static const char NM_STMT_SQL_USB_SELECT_BY_NAME[] =
+    "SELECT * FROM usb WHERE vm_id=(SELECT id FROM vms WHERE name=?1)";
+
+/* batch writes, see nm_db_exec() */
+static const char NM_STMT_SQL_VMS_INSERT[] =
+    "INSERT INTO vms(name, mem, smp, kvm, hcpu, vnc, arch, iso, "
+    "install, machine, mouse_override, usb, usb_type, usb_status, "
+    "fs9p_enable, spice, debug_port, debug_freeze, display_type, "
+    "spice_agent) VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, "
+    "?11, ?12, ?13, ?14, ?15, ?16, ?17, ?18, ?19, ?20)";
+
+static const char NM_STMT_SQL_VMS_INSERT_CLONE[] =
+    "INSERT INTO vms SELECT NULL, ?1, mem, smp, kvm, hcpu, ?2, arch, "
+    "iso, install, usb, usb_status, bios, kernel, mouse_override, "
+    "kernel_append, tty_path, socket_path, initrd, machine, fs9p_enable, "
+    "fs9p_path, fs9p_name, usb_type, spice, debug_port, debug_freeze, "
+    "cmdappend, team, display_type, pflash, spice_agent "
+    "FROM vms WHERE name=?3";
+
+static const char NM_STMT_SQL_IFACES_INSERT[] =
+    "INSERT INTO ifaces(vm_id, if_name, mac_addr, if_drv, vhost, "
+    "macvtap, parent_eth, altname, netuser, hostfwd, smb) "
+    "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11)";
+
+static const char NM_STMT_SQL_DRIVES_INSERT[] =
+    "INSERT INTO drives(vm_id, drive_name, drive_drv, "
+    "capacity, boot, discard, format) "
+    "VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7)";
+
+static const char NM_STMT_SQL_VMS_UPDATE_SMP_BY_TEAM[] =
+    "UPDATE vms SET smp=?1 WHERE team=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_MEM_BY_TEAM[] =
+    "UPDATE vms SET mem=?1 WHERE team=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_KVM_BY_TEAM[] =
+    "UPDATE vms SET kvm=?1 WHERE team=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_HCPU_BY_TEAM[] =
+    "UPDATE vms SET hcpu=?1 WHERE team=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_SMP[] =
+    "UPDATE vms SET smp=?1 WHERE name=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_MEM[] =
+    "UPDATE vms SET mem=?1 WHERE name=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_KVM[] =
+    "UPDATE vms SET kvm=?1 WHERE name=?2";
+
+static const char NM_STMT_SQL_VMS_UPDATE_HCPU[] =
+    "UPDATE vms SET hcpu=?1 WHERE name=?2";
+
+static const char NM_STMT_SQL_DRIVES_UPDATE_DRV[] =
+    "UPDATE drives SET drive_drv=?1 "
+    "WHERE vm_id=(SELECT id FROM vms WHERE name=?2)";
+
+enum nm_db_stmt_id {
+    NM_STMT_BEGIN,
+    NM_STMT_COMMIT,
+    NM_STMT_VMS_SELECT_ALL,
+    NM_STMT_VMS_SELECT_VNC,
+    NM_STMT_VMS_SELECT_NAMES,
+    NM_STMT_VMS_SELECT_NAMES_BY_TEAM,
+    NM_STMT_IFACES_SELECT_BY_ID,
+    NM_STMT_DRIVES_SELECT_BY_ID,
+    NM_STMT_USB_SELECT_BY_ID,
+    NM_STMT_USB_SELECT_BY_NAME,
+    NM_STMT_VMS_INSERT,
+    NM_STMT_VMS_INSERT_CLONE,
+    NM_STMT_IFACES_INSERT,
+    NM_STMT_DRIVES_INSERT,
+    NM_STMT_VMS_UPDATE_SMP_BY_TEAM,
+    NM_STMT_VMS_UPDATE_MEM_BY_TEAM,
+    NM_STMT_VMS_UPDATE_KVM_BY_TEAM,
+    NM_STMT_VMS_UPDATE_HCPU_BY_TEAM,
+    NM_STMT_VMS_UPDATE_SMP,
+    NM_STMT_VMS_UPDATE_MEM,
+    NM_STMT_VMS_UPDATE_KVM,
+    NM_STMT_VMS_UPDATE_HCPU,
+    NM_STMT_DRIVES_UPDATE_DRV,
+    NM_STMT_COUNT
+};
+
 typedef sqlite3 nm_sqlite_t;
+typedef sqlite3_stmt nm_sqlite_stmt_t;
 
 typedef struct {
     nm_sqlite_t *handler;
     bool in_transaction;
+    uint64_t busy_timeout; /* ms */
+    uint64_t busy_since;
+    nm_sqlite_stmt_t *stmt[NM_STMT_COUNT];
 } db_conn_t;
 
-#define NM_INIT_DB_CONN (db_conn_t) {NULL, false}
+#define NM_INIT_DB_CONN (db_conn_t) {NULL, false, 0, 0, {NULL}}
+
+/*
+ * The database runs in WAL mode: readers see the last committed
+ * snapshot and never wait for a writer. Writers wait for each other
+ * up to db_busy_timeout. Connections that only read are opened
+ * with NM_DB_RO and reject writes.
+ */
+enum nm_db_mode {
+    NM_DB_RW,
+    NM_DB_RO
+};
+
+/*
+ * Result set: cells of all rows are kept in one array and their text
+ * in one arena, so a query costs a couple of allocations instead of
+ * two per cell. Text of NULL cells is "". Buffers are reused when the
+ * same result is fetched again.
+ */
+typedef struct {
+    nm_str_t str;   /* view into arena, must not be modified */
+    int64_t num;
+    size_t off;
+    bool null;
+} nm_db_cell_t;
 
-void nm_db_init(void);
+typedef struct {
+    nm_db_cell_t *cells;
+    char *text;
+    size_t rows;
+    size_t cols;
+    size_t cells_alloc;
+    size_t text_len;
+    size_t text_alloc;
+} nm_db_res_t;
+
+#define NM_INIT_DB_RES { NULL, NULL, 0, 0, 0, 0, 0 }
+
+void nm_db_init(enum nm_db_mode mode);
 void nm_db_select(const char *query, nm_vect_t *v);
 void nm_db_select_value(const char *query, nm_str_t *res);
 void nm_db_edit(const char *query);
@@ -461,6 +602,35 @@ void nm_db_commit(void);
 void nm_db_rollback(void);
 void nm_db_close(void);
 
+/*
+ * Cached statement of the calling thread connection, reset and
+ * with bindings cleared. Bind indexes start from 1.
+ */
+nm_sqlite_stmt_t *nm_db_stmt(enum nm_db_stmt_id id);
+void nm_db_bind_text(nm_sqlite_stmt_t *stmt, int idx, const char *text);
+void nm_db_bind_int(nm_sqlite_stmt_t *stmt, int idx, int64_t val);
+/* returns true if a row is available, resets stmt when done */
+bool nm_db_step(nm_sqlite_stmt_t *stmt);
+/*
+ * Runs a write statement, returns the number of changed rows.
+ * Multi-row changes call it between nm_db_begin_transaction()
+ * and nm_db_commit(), so they cost one commit.
+ */
+int nm_db_exec(nm_sqlite_stmt_t *stmt);
+/* rowid of the last row inserted on the calling thread connection */
+int64_t nm_db_last_id(void);
+/* all rows as nm_str_t cells, same layout as nm_db_select() */
+void nm_db_stmt_select(nm_sqlite_stmt_t *stmt, nm_vect_t *res);
+/* replaces content of res with all rows of stmt */
+void nm_db_stmt_fetch(nm_sqlite_stmt_t *stmt, nm_db_res_t *res);
+/* same for a formatted query, statement is not cached */
+void nm_db_fetch(const char *query, nm_db_res_t *res);
+void nm_db_res_free(nm_db_res_t *res);
+const nm_db_cell_t *nm_db_cell(const nm_db_res_t *res, size_t row, size_t col);
+/* statements between begin and end read the same database snapshot */
+void nm_db_read_begin(void);
+void nm_db_read_end(void);
+
 enum select_main_idx {
     NM_SQL_ID = 0,
     NM_SQL_NAME,
@@ -539,5 +709,29 @@ enum {
 };
 
 
+static inline size_t nm_db_rows(const nm_db_res_t *res)
+{
+    return res->rows;
+}
+static inline const nm_str_t *nm_db_str(const nm_db_res_t *res,
+        size_t row, size_t col)
+{
+    return &nm_db_cell(res, row, col)->str;
+}
+static inline const char *nm_db_text(const nm_db_res_t *res,
+        size_t row, size_t col)
+{
+    return nm_db_cell(res, row, col)->str.data;
+}
+static inline int64_t nm_db_int(const nm_db_res_t *res,
+        size_t row, size_t col)
+{
+    return nm_db_cell(res, row, col)->num;
+}
+static inline bool nm_db_bool(const nm_db_res_t *res, size_t row, size_t col)
+{
+    return nm_db_cell(res, row, col)->num != 0;
+}
+
 #endif /* NM_DATABASE_H_ */
 /* vim:set ts=4 sw=4: */
@@ -0,0 +1,460 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_machine.h>
+#include <nm_database.h>
+#include <nm_db_migrate.h>
+
+/*
+ * Schema history. Step n upgrades user_version NM_DB_MIG_FIRST + n
+ * to the next one. Steps are never changed once released: a new
+ * schema change is a new step at the end and NM_DB_VERSION bump.
+ */
+
+#define NM_DB_MIG_FIRST 3
+
+typedef struct {
+    const char *const *sql; /* NULL terminated */
+    int (*run)(nm_sqlite_t *db);
+} nm_db_mig_step_t;
+
+static int nm_db_mig_fk_check(nm_sqlite_t *db);
+static int nm_db_mig_machine(nm_sqlite_t *db);
+
+static const nm_db_mig_step_t nm_db_steps[] = {
+    { /* 3 -> 4 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD initrd char",
+            "ALTER TABLE vms ADD machine char",
+            NULL
+        }, NULL
+    },
+    { /* 4 -> 5 */
+        (const char *const []) {
+            "CREATE TABLE snapshots(id integer primary key autoincrement, "
+            "vm_name char, snap_name char, backing_drive char, "
+            "snap_idx integer, active integer, "
+            "TIMESTAMP DEFAULT CURRENT_TIMESTAMP NOT NULL)",
+            "ALTER TABLE ifaces ADD vhost integer",
+            "UPDATE ifaces SET vhost='0'",
+            "UPDATE ifaces SET if_drv='virtio-net-pci' WHERE if_drv='virtio'",
+            NULL
+        }, NULL
+    },
+    { /* 5 -> 6 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD fs9p_enable integer",
+            "ALTER TABLE vms ADD fs9p_path char",
+            "ALTER TABLE vms ADD fs9p_name char",
+            "UPDATE vms SET fs9p_enable='0'",
+            "ALTER TABLE ifaces ADD macvtap integer",
+            "ALTER TABLE ifaces ADD parent_eth char",
+            "UPDATE ifaces SET macvtap='0'",
+            "CREATE TABLE veth(id integer primary key autoincrement, "
+            "l_name char, r_name char)",
+            NULL
+        }, NULL
+    },
+    { /* 6 -> 7 */
+        (const char *const []) {
+            "CREATE TABLE vmsnapshots(id integer primary key autoincrement, "
+            "vm_name char, snap_name char, load integer, timestamp char)",
+            "CREATE TABLE usb(id integer primary key autoincrement, "
+            "vm_name char, dev_name char, vendor_id char, "
+            "product_id char, serial char)",
+            NULL
+        }, NULL
+    },
+    { /* 7 -> 8 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD usb_type char",
+            "UPDATE vms SET usb_type='XHCI'",
+            NULL
+        }, NULL
+    },
+    { /* 8 -> 9 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD spice integer",
+            "UPDATE vms SET spice='1'",
+            NULL
+        }, NULL
+    },
+    { /* 9 -> 10 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD debug_port integer",
+            "UPDATE vms SET debug_port=''",
+            "ALTER TABLE vms ADD debug_freeze integer",
+            "UPDATE vms SET debug_freeze='0'",
+            NULL
+        }, NULL
+    },
+    { /* 10 -> 11 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD cmdappend char",
+            "ALTER TABLE ifaces ADD altname char",
+            NULL
+        }, NULL
+    },
+    { /* 11 -> 12 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD team char",
+            "DROP TABLE IF EXISTS lastval",
+            NULL
+        }, nm_db_mig_machine
+    },
+    { /* 12 -> 13 */
+        (const char *const []) {
+            "ALTER TABLE vms RENAME TO tmp",
+            "CREATE TABLE vms(id integer PRIMARY KEY AUTOINCREMENT, "
+            "name char(31), mem integer, smp char, kvm integer, "
+            "hcpu integer, vnc integer, arch char(32), iso char, "
+            "install integer, usb integer, usbid char, bios char, "
+            "kernel char, mouse_override integer, kernel_append char, "
+            "tty_path char, socket_path char, initrd char, machine char, "
+            "fs9p_enable integer, fs9p_path char, fs9p_name char, "
+            "usb_type char, spice integer, debug_port integer, "
+            "debug_freeze integer, cmdappend char, team char)",
+            "INSERT INTO vms SELECT * FROM tmp",
+            "DROP TABLE tmp",
+            NULL
+        }, NULL
+    },
+    { /* 13 -> 14 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD display_type char",
+            "UPDATE vms SET display_type='qxl'",
+            NULL
+        }, NULL
+    },
+    { /* 14 -> 15 */
+        (const char *const []) {
+            "ALTER TABLE drives ADD discard integer",
+            "UPDATE drives SET discard='0'",
+            NULL
+        }, NULL
+    },
+    { /* 15 -> 16 */
+        (const char *const []) {
+            "ALTER TABLE ifaces ADD netuser integer",
+            "ALTER TABLE ifaces ADD hostfwd char",
+            "UPDATE ifaces SET netuser='0'",
+            NULL
+        }, NULL
+    },
+    { /* 16 -> 17 */
+        (const char *const []) {
+            "ALTER TABLE ifaces ADD smb char",
+            NULL
+        }, NULL
+    },
+    { /* 17 -> 18 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD pflash char",
+            NULL
+        }, NULL
+    },
+    { /* 18 -> 19 */
+        (const char *const []) {
+            "ALTER TABLE vms ADD spice_agent integer",
+            "UPDATE vms SET spice_agent='0'",
+            NULL
+        }, NULL
+    },
+    { /* 19 -> 20: typed columns, devices refer to vms(id) */
+        (const char *const []) {
+            "ALTER TABLE vms RENAME TO vms_tmp",
+            "ALTER TABLE vmsnapshots RENAME TO vmsnapshots_tmp",
+            "ALTER TABLE drives RENAME TO drives_tmp",
+            "ALTER TABLE ifaces RENAME TO ifaces_tmp",
+            "ALTER TABLE usb RENAME TO usb_tmp",
+            "ALTER TABLE veth RENAME TO veth_tmp",
+            "CREATE TABLE vms(id INTEGER NOT NULL PRIMARY KEY, "
+            "name TEXT NOT NULL, mem INTEGER NOT NULL, smp TEXT NOT NULL, "
+            "kvm INTEGER NOT NULL, hcpu INTEGER NOT NULL, "
+            "vnc INTEGER NOT NULL, arch TEXT NOT NULL, iso TEXT, "
+            "install INTEGER NOT NULL, usb INTEGER NOT NULL, "
+            "usb_status INTEGER NOT NULL, bios TEXT, kernel TEXT, "
+            "mouse_override INTEGER NOT NULL, kernel_append TEXT, "
+            "tty_path TEXT, socket_path TEXT, initrd TEXT, "
+            "machine TEXT NOT NULL, fs9p_enable INTEGER NOT NULL, "
+            "fs9p_path TEXT, fs9p_name TEXT, usb_type TEXT NOT NULL, "
+            "spice INTEGER NOT NULL, debug_port INTEGER, "
+            "debug_freeze INTEGER NOT NULL, cmdappend TEXT, team TEXT, "
+            "display_type TEXT NOT NULL, pflash TEXT, "
+            "spice_agent INTEGER NOT NULL)",
+            "INSERT INTO vms SELECT * FROM vms_tmp",
+            "CREATE TABLE vmsnapshots(snap_name TEXT NOT NULL, "
+            "load INTEGER NOT NULL, timestamp TEXT NOT NULL, "
+            "vm_id INTEGER NOT NULL, "
+            "FOREIGN KEY(vm_id) REFERENCES vms(id) ON DELETE CASCADE)",
+            "INSERT INTO vmsnapshots(snap_name, load, timestamp, vm_id) "
+            "SELECT s.snap_name, s.load, s.timestamp, v.id "
+            "FROM vmsnapshots_tmp s JOIN vms v ON v.name=s.vm_name",
+            "CREATE TABLE ifaces(if_name TEXT NOT NULL, "
+            "mac_addr TEXT NOT NULL, ipv4_addr TEXT, if_drv TEXT NOT NULL, "
+            "vhost INTEGER NOT NULL, macvtap INTEGER NOT NULL, "
+            "parent_eth TEXT, altname TEXT, netuser INTEGER NOT NULL, "
+            "hostfwd TEXT, smb TEXT, vm_id INTEGER NOT NULL, "
+            "FOREIGN KEY(vm_id) REFERENCES vms(id) ON DELETE CASCADE)",
+            "INSERT INTO ifaces(if_name, mac_addr, ipv4_addr, if_drv, "
+            "vhost, macvtap, parent_eth, altname, netuser, hostfwd, smb, "
+            "vm_id) SELECT i.if_name, i.mac_addr, i.ipv4_addr, i.if_drv, "
+            "i.vhost, i.macvtap, i.parent_eth, i.altname, i.netuser, "
+            "i.hostfwd, i.smb, v.id "
+            "FROM ifaces_tmp i JOIN vms v ON v.name=i.vm_name",
+            "CREATE TABLE usb(dev_name TEXT NOT NULL, "
+            "vendor_id TEXT NOT NULL, product_id TEXT NOT NULL, "
+            "serial TEXT NOT NULL, vm_id INTEGER NOT NULL, "
+            "FOREIGN KEY(vm_id) REFERENCES vms(id) ON DELETE CASCADE)",
+            "INSERT INTO usb(dev_name, vendor_id, product_id, serial, vm_id) "
+            "SELECT u.dev_name, u.vendor_id, u.product_id, u.serial, v.id "
+            "FROM usb_tmp u JOIN vms v ON v.name=u.vm_name",
+            "CREATE TABLE drives(drive_name TEXT NOT NULL, "
+            "drive_drv TEXT NOT NULL, capacity INTEGER NOT NULL, "
+            "boot INTEGER NOT NULL, discard INTEGER NOT NULL, "
+            "vm_id INTEGER NOT NULL, "
+            "FOREIGN KEY(vm_id) REFERENCES vms(id) ON DELETE CASCADE)",
+            "INSERT INTO drives(drive_name, drive_drv, capacity, boot, "
+            "discard, vm_id) SELECT d.drive_name, d.drive_drv, d.capacity, "
+            "d.boot, d.discard, v.id "
+            "FROM drives_tmp d JOIN vms v ON v.name=d.vm_name",
+            "CREATE TABLE veth(l_name TEXT NOT NULL, "
+            "r_name char TEXT NOT NULL)",
+            "INSERT INTO veth(l_name, r_name) "
+            "SELECT l_name, r_name FROM veth_tmp",
+            "DROP TABLE vmsnapshots_tmp",
+            "DROP TABLE ifaces_tmp",
+            "DROP TABLE drives_tmp",
+            "DROP TABLE veth_tmp",
+            "DROP TABLE usb_tmp",
+            "DROP TABLE vms_tmp",
+            "CREATE TRIGGER clear_deleted_veth AFTER DELETE ON veth "
+            "BEGIN UPDATE ifaces SET macvtap='0', parent_eth='' "
+            "WHERE parent_eth=old.l_name OR parent_eth=old.r_name; END",
+            NULL
+        }, NULL
+    },
+    { /* 20 -> 21 */
+        (const char *const []) {
+            "ALTER TABLE drives ADD format TEXT NOT NULL DEFAULT 'qcow2'",
+            NULL
+        }, NULL
+    },
+    { /* 21 -> 22: lookups by VM name and vm_id */
+        (const char *const []) {
+            "CREATE INDEX vms_name_idx ON vms(name)",
+            "CREATE INDEX vms_team_idx ON vms(team, name)",
+            "CREATE INDEX ifaces_vm_idx ON ifaces(vm_id, if_name)",
+            "CREATE INDEX ifaces_name_idx ON ifaces(if_name, vm_id)",
+            "CREATE INDEX drives_vm_idx ON drives(vm_id, drive_name)",
+            "CREATE INDEX vmsnapshots_vm_idx "
+            "ON vmsnapshots(vm_id, snap_name)",
+            "CREATE INDEX usb_vm_idx ON usb(vm_id)",
+            NULL
+        }, NULL
+    }
+};
+
+static int nm_db_mig_exec(nm_sqlite_t *db, const char *query)
+{
+    char *db_errmsg;
+
+    nm_debug("%s: \"%s\"\n", __func__, query);
+
+    if (sqlite3_exec(db, query, NULL, NULL, &db_errmsg) != SQLITE_OK) {
+        fprintf(stderr, _("Database upgrade error: %s\n%s\n"),
+                db_errmsg, query);
+        sqlite3_free(db_errmsg);
+        return NM_ERR;
+    }
+
+    return NM_OK;
+}
+
+static int nm_db_mig_query_int(nm_sqlite_t *db, const char *query)
+{
+    sqlite3_stmt *stmt;
+    int val = -1;
+
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, _("Database upgrade error: %s\n%s\n"),
+                sqlite3_errmsg(db), query);
+        return -1;
+    }
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        val = sqlite3_column_int(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+
+    return val;
+}
+
+/* clean only if the check ran to the end and found nothing */
+static int nm_db_mig_fk_check(nm_sqlite_t *db)
+{
+    static const char query[] = "PRAGMA foreign_key_check";
+    sqlite3_stmt *stmt;
+    int rc;
+
+    if (sqlite3_prepare_v2(db, query, -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, _("Database upgrade error: %s\n%s\n"),
+                sqlite3_errmsg(db), query);
+        return NM_ERR;
+    }
+
+    switch ((rc = sqlite3_step(stmt))) {
+    case SQLITE_DONE:
+        break;
+    case SQLITE_ROW:
+        fprintf(stderr, _("Database upgrade error: foreign key violation "
+                    "in %s, rowid %lld, parent %s\n"),
+                sqlite3_column_text(stmt, 0),
+                (long long) sqlite3_column_int64(stmt, 1),
+                sqlite3_column_text(stmt, 2));
+        break;
+    default:
+        fprintf(stderr, _("Database upgrade error: %s\n%s\n"),
+                sqlite3_errmsg(db), query);
+    }
+
+    sqlite3_finalize(stmt);
+
+    return (rc == SQLITE_DONE) ? NM_OK : NM_ERR;
+}
+
+/* machine column was added empty, set QEMU default for the arch */
+static int nm_db_mig_machine(nm_sqlite_t *db)
+{
+    nm_vect_t archs = NM_INIT_VECT;
+    nm_str_t arch = NM_INIT_STR;
+    sqlite3_stmt *stmt;
+    int rc = NM_OK;
+
+    if (sqlite3_prepare_v2(db, "SELECT DISTINCT arch FROM vms "
+                "WHERE machine IS NULL", -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, _("Database upgrade error: %s\n"),
+                sqlite3_errmsg(db));
+        return NM_ERR;
+    }
+
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *text = (const char *) sqlite3_column_text(stmt, 0);
+
+        nm_vect_insert_cstr(&archs, text ? text : "");
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db, "UPDATE vms SET machine=?1 "
+                "WHERE machine IS NULL AND arch=?2",
+                -1, &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, _("Database upgrade error: %s\n"),
+                sqlite3_errmsg(db));
+        nm_vect_free(&archs, NULL);
+        return NM_ERR;
+    }
+
+    for (size_t n = 0; n < archs.n_memb; n++) {
+        const char *def;
+
+        nm_str_alloc_text(&arch, archs.data[n]);
+        if ((def = nm_mach_get_default(&arch)) == NULL) {
+            fprintf(stderr, _("Cannot get default machine for %s\n"),
+                    arch.data);
+            rc = NM_ERR;
+            break;
+        }
+
+        sqlite3_reset(stmt);
+        sqlite3_bind_text(stmt, 1, def, -1, SQLITE_STATIC);
+        sqlite3_bind_text(stmt, 2, arch.data, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            fprintf(stderr, _("Database upgrade error: %s\n"),
+                    sqlite3_errmsg(db));
+            rc = NM_ERR;
+            break;
+        }
+    }
+
+    sqlite3_finalize(stmt);
+    nm_vect_free(&archs, NULL);
+    nm_str_free(&arch);
+
+    return rc;
+}
+
+int nm_db_migrate(nm_sqlite_t *db)
+{
+    const int last = NM_DB_MIG_FIRST + nm_arr_len(nm_db_steps);
+    nm_str_t query = NM_INIT_STR;
+    int version, rc = NM_ERR;
+
+    if (last != (int) strtol(NM_DB_VERSION, NULL, 10)) {
+        nm_bug(_("%s: no migration to version %s"), __func__, NM_DB_VERSION);
+    }
+
+    /* tables are rebuilt, foreign keys are checked once at the end */
+    if (nm_db_mig_exec(db, "PRAGMA foreign_keys=OFF") != NM_OK) {
+        return NM_ERR;
+    }
+
+    /* the write lock keeps other nEMU instances from a parallel upgrade */
+    if (nm_db_mig_exec(db, "BEGIN IMMEDIATE") != NM_OK) {
+        goto out;
+    }
+
+    version = nm_db_mig_query_int(db, NM_SQL_PRAGMA_USER_VERSION_GET);
+    printf(_("database version: %d\n"), version);
+
+    if (version == last) {
+        rc = NM_OK;
+        goto rollback;
+    }
+
+    if (version < NM_DB_MIG_FIRST || version > last) {
+        fprintf(stderr, _("Unsupported database user_version %d\n"), version);
+        goto rollback;
+    }
+
+    for (; version < last; version++) {
+        const nm_db_mig_step_t *step = &nm_db_steps[version - NM_DB_MIG_FIRST];
+
+        nm_debug("%s: upgrade %d -> %d\n", __func__, version, version + 1);
+
+        for (const char *const *sql = step->sql; *sql; sql++) {
+            if (nm_db_mig_exec(db, *sql) != NM_OK) {
+                goto rollback;
+            }
+        }
+
+        if (step->run && step->run(db) != NM_OK) {
+            goto rollback;
+        }
+    }
+
+    if (nm_db_mig_fk_check(db) != NM_OK) {
+        goto rollback;
+    }
+
+    nm_str_format(&query, "PRAGMA user_version=%d", last);
+    if (nm_db_mig_exec(db, query.data) != NM_OK ||
+            nm_db_mig_exec(db, "COMMIT") != NM_OK) {
+        goto rollback;
+    }
+
+    printf(_("database upgrade complete.\n"));
+    rc = NM_OK;
+    goto out;
+
+rollback:
+    nm_db_mig_exec(db, "ROLLBACK");
+out:
+    nm_db_mig_exec(db, NM_SQL_PRAGMA_FOREIGN_ON);
+    nm_str_free(&query);
+
+    return rc;
+}
+
+/* vim:set ts=4 sw=4: */
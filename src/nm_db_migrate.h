@@ -0,0 +1,13 @@
+#ifndef NM_DB_MIGRATE_H_
+#define NM_DB_MIGRATE_H_
+
+#include <nm_database.h>
+
+/*
+ * Upgrade database schema from its user_version to NM_DB_VERSION.
+ * All steps run in one transaction: on error nothing is changed.
+ */
+int nm_db_migrate(nm_sqlite_t *db);
+
+#endif /* NM_DB_MIGRATE_H_ */
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,355 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_cfg_file.h>
+#include <nm_database.h>
+#include <nm_db_profile.h>
+
+#include <pthread.h>
+#include <inttypes.h>
+#include <ctype.h>
+
+/*
+ * Latency histogram is log-linear: values below 2^NM_DB_PROF_SUB us
+ * have own buckets, every power of two above is split into
+ * 2^NM_DB_PROF_SUB buckets, so percentiles are within 12.5%.
+ */
+enum {
+    NM_DB_PROF_SUB = 3,
+    NM_DB_PROF_BUCKETS = (64 - NM_DB_PROF_SUB + 1) << NM_DB_PROF_SUB,
+    NM_DB_PROF_PENDING = 64     /* statements running at the same time */
+};
+
+static const char NM_DB_PROF_HEAD[] =
+    "SQL profile, %s, pid %d, %zu statements, %" PRIu64 " calls\n"
+    "%9s %10s %9s %9s %9s %9s  %s\n";
+static const char NM_DB_PROF_LINE[] =
+    "%9" PRIu64 " %10.3f %9" PRIu64 " %9" PRIu64 " %9" PRIu64
+    " %9" PRIu64 "  %s\n";
+
+typedef struct {
+    uint64_t hash;
+    nm_str_t sql;
+    uint64_t count;
+    uint64_t total;         /* us */
+    uint64_t max;           /* us */
+    uint32_t hist[NM_DB_PROF_BUCKETS];
+} nm_db_prof_entry_t;
+
+typedef struct {
+    const nm_sqlite_stmt_t *stmt;
+    uint64_t start;         /* nm_mono_us() */
+} nm_db_prof_run_t;
+
+typedef struct {
+    pthread_mutex_t mtx;
+    nm_vect_t entries;
+    nm_db_prof_run_t running[NM_DB_PROF_PENDING];
+    nm_str_t path;
+    pid_t pid;
+    bool enabled;
+} nm_db_prof_t;
+
+static nm_db_prof_t prof = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .entries = NM_INIT_VECT
+};
+static pthread_once_t prof_once = PTHREAD_ONCE_INIT;
+
+static void nm_db_prof_init(void);
+static void nm_db_prof_dump(void);
+static int nm_db_prof_trace(unsigned type, void *ctx NM_UNUSED,
+        void *p, void *x);
+static void nm_db_prof_add(const char *sql, uint64_t us);
+static void nm_db_prof_template(const char *sql, nm_str_t *tpl);
+static size_t nm_db_prof_bucket(uint64_t us);
+static uint64_t nm_db_prof_bucket_max(size_t bucket);
+static uint64_t nm_db_prof_percentile(const nm_db_prof_entry_t *e,
+        unsigned pct);
+static int nm_db_prof_cmp(const void *a, const void *b);
+static void nm_db_prof_entry_free(void *unit_p);
+
+void nm_db_prof_attach(nm_sqlite_t *db)
+{
+    if (pthread_once(&prof_once, nm_db_prof_init) != 0) {
+        nm_bug(_("%s: pthread_once error: %s"), __func__, strerror(errno));
+    }
+
+    /*
+     * SQLITE_TRACE_PROFILE time has only millisecond resolution,
+     * statements are timed from SQLITE_TRACE_STMT instead.
+     */
+    sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE,
+            nm_db_prof_trace, NULL);
+}
+
+bool nm_db_prof_enabled(void)
+{
+    return prof.enabled;
+}
+
+void nm_db_prof_report(nm_str_t *out, bool reset)
+{
+    const nm_db_prof_entry_t **sorted;
+    uint64_t calls = 0;
+    char date[32];
+    time_t now;
+    size_t count;
+
+    now = time(NULL);
+    strftime(date, sizeof(date), "%F %T", localtime(&now));
+
+    pthread_mutex_lock(&prof.mtx);
+
+    count = prof.entries.n_memb;
+    sorted = nm_calloc(count + 1, sizeof(*sorted));
+    for (size_t n = 0; n < count; n++) {
+        sorted[n] = nm_vect_at(&prof.entries, n);
+        calls += sorted[n]->count;
+    }
+    qsort(sorted, count, sizeof(*sorted), nm_db_prof_cmp);
+
+    nm_str_append_format(out, NM_DB_PROF_HEAD, date,
+            (int) getpid(), count, calls, "calls", "total ms", "avg us",
+            "p50 us", "p99 us", "max us", "statement");
+    for (size_t n = 0; n < count; n++) {
+        const nm_db_prof_entry_t *e = sorted[n];
+
+        nm_str_append_format(out, NM_DB_PROF_LINE, e->count,
+                e->total / 1000.0, e->total / e->count,
+                nm_db_prof_percentile(e, 50), nm_db_prof_percentile(e, 99),
+                e->max, e->sql.data);
+    }
+
+    if (reset) {
+        nm_vect_free(&prof.entries, nm_db_prof_entry_free);
+    }
+
+    pthread_mutex_unlock(&prof.mtx);
+    free(sorted);
+}
+
+static void nm_db_prof_init(void)
+{
+    const nm_cfg_t *cfg = nm_cfg_get();
+
+    /* cfg is released before atexit handlers are run */
+    nm_str_copy(&prof.path, &cfg->db_profile);
+    prof.pid = getpid();
+    prof.enabled = true;
+
+    if (atexit(nm_db_prof_dump) != 0) {
+        nm_bug(_("%s: atexit error"), __func__);
+    }
+}
+
+static void nm_db_prof_dump(void)
+{
+    nm_str_t report = NM_INIT_STR;
+    FILE *fp;
+
+    /* children that failed to exec must not write parent's report */
+    if (getpid() != prof.pid) {
+        return;
+    }
+
+    nm_db_prof_report(&report, true);
+
+    if ((fp = fopen(prof.path.data, "a")) == NULL) {
+        fprintf(stderr, "%s: cannot open %s: %s\n", __func__,
+                prof.path.data, strerror(errno));
+    } else {
+        fprintf(fp, "%s\n", report.data);
+        fclose(fp);
+    }
+
+    nm_str_free(&report);
+    nm_str_free(&prof.path);
+}
+
+static int nm_db_prof_trace(unsigned type, void *ctx NM_UNUSED,
+        void *p, void *x)
+{
+    const nm_sqlite_stmt_t *stmt = p;
+    nm_db_prof_run_t *slot = NULL;
+    uint64_t now = nm_mono_us();
+    uint64_t us;
+
+    if (type == SQLITE_TRACE_STMT) {
+        /* trigger programs are reported as "-- TRIGGER name" */
+        if (strncmp(x, "--", 2) == 0) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&prof.mtx);
+        for (size_t n = 0; n < NM_DB_PROF_PENDING; n++) {
+            if (prof.running[n].stmt == stmt || !prof.running[n].stmt) {
+                slot = &prof.running[n];
+                break;
+            }
+        }
+        if (slot) {
+            slot->stmt = stmt;
+            slot->start = now;
+        }
+        pthread_mutex_unlock(&prof.mtx);
+
+        return 0;
+    }
+
+    /* SQLITE_TRACE_PROFILE, falls back to sqlite's estimate */
+    us = *(const int64_t *) x / 1000;
+
+    pthread_mutex_lock(&prof.mtx);
+    for (size_t n = 0; n < NM_DB_PROF_PENDING; n++) {
+        if (prof.running[n].stmt == stmt) {
+            us = now - prof.running[n].start;
+            prof.running[n].stmt = NULL;
+            break;
+        }
+    }
+    nm_db_prof_add(sqlite3_sql((nm_sqlite_stmt_t *) stmt), us);
+    pthread_mutex_unlock(&prof.mtx);
+
+    return 0;
+}
+
+/* called with prof mutex held */
+static void nm_db_prof_add(const char *sql, uint64_t us)
+{
+    nm_db_prof_entry_t *e = NULL;
+    nm_str_t tpl = NM_INIT_STR;
+    uint64_t hash = 14695981039346656037ULL; /* FNV-1a */
+
+    nm_db_prof_template(sql, &tpl);
+    for (size_t n = 0; n < tpl.len; n++) {
+        hash = (hash ^ (unsigned char) tpl.data[n]) * 1099511628211ULL;
+    }
+
+    for (size_t n = 0; n < prof.entries.n_memb; n++) {
+        nm_db_prof_entry_t *cur = nm_vect_at(&prof.entries, n);
+
+        if (cur->hash == hash && nm_str_cmp_ss(&cur->sql, &tpl) == NM_OK) {
+            e = cur;
+            break;
+        }
+    }
+
+    if (!e) {
+        nm_db_prof_entry_t new = { .hash = hash, .sql = NM_INIT_STR };
+
+        nm_vect_insert(&prof.entries, &new, sizeof(new), NULL);
+        e = nm_vect_at(&prof.entries, prof.entries.n_memb - 1);
+        nm_str_copy(&e->sql, &tpl);
+    }
+
+    e->count++;
+    e->total += us;
+    e->max = nm_max(e->max, us);
+    e->hist[nm_db_prof_bucket(us)]++;
+
+    nm_str_free(&tpl);
+}
+
+/*
+ * String and numeric literals become '?', whitespace runs are
+ * squeezed: "SELECT id FROM vms WHERE name='a' AND mem=256"
+ * is "SELECT id FROM vms WHERE name=? AND mem=?".
+ */
+static void nm_db_prof_template(const char *sql, nm_str_t *tpl)
+{
+    const char *p = sql;
+
+    while (*p) {
+        if (*p == '\'') {
+            /* '' is an escaped quote */
+            for (p++; *p; p++) {
+                if (*p == '\'' && *(++p) != '\'') {
+                    break;
+                }
+            }
+            nm_str_add_char_opt(tpl, '?');
+        } else if (isdigit((unsigned char) *p) && (p == sql ||
+                    (!isalnum((unsigned char) *(p - 1)) &&
+                     *(p - 1) != '_' && *(p - 1) != '?'))) {
+            while (isalnum((unsigned char) *p) || *p == '.') {
+                p++;
+            }
+            nm_str_add_char_opt(tpl, '?');
+        } else if (isspace((unsigned char) *p)) {
+            while (isspace((unsigned char) *p)) {
+                p++;
+            }
+            if (tpl->len && *p) {
+                nm_str_add_char_opt(tpl, ' ');
+            }
+        } else {
+            nm_str_add_char_opt(tpl, *p++);
+        }
+    }
+}
+
+static size_t nm_db_prof_bucket(uint64_t us)
+{
+    int msb;
+
+    if (us < (1 << NM_DB_PROF_SUB)) {
+        return us;
+    }
+
+    msb = 63 - __builtin_clzll(us);
+
+    return ((size_t) (msb - NM_DB_PROF_SUB + 1) << NM_DB_PROF_SUB) |
+        ((us >> (msb - NM_DB_PROF_SUB)) & ((1 << NM_DB_PROF_SUB) - 1));
+}
+
+static uint64_t nm_db_prof_bucket_max(size_t bucket)
+{
+    size_t sub = bucket & ((1 << NM_DB_PROF_SUB) - 1);
+    int msb;
+
+    if (bucket < (1 << NM_DB_PROF_SUB)) {
+        return bucket;
+    }
+
+    msb = (bucket >> NM_DB_PROF_SUB) + NM_DB_PROF_SUB - 1;
+
+    return (1ULL << msb) + ((sub + 1) << (msb - NM_DB_PROF_SUB)) - 1;
+}
+
+static uint64_t nm_db_prof_percentile(const nm_db_prof_entry_t *e,
+        unsigned pct)
+{
+    uint64_t rank = (e->count * pct + 99) / 100;
+    uint64_t seen = 0;
+
+    for (size_t n = 0; n < NM_DB_PROF_BUCKETS; n++) {
+        seen += e->hist[n];
+        if (seen >= rank) {
+            return nm_min(nm_db_prof_bucket_max(n), e->max);
+        }
+    }
+
+    return e->max;
+}
+
+static int nm_db_prof_cmp(const void *a, const void *b)
+{
+    const nm_db_prof_entry_t *ea = *(const nm_db_prof_entry_t **) a;
+    const nm_db_prof_entry_t *eb = *(const nm_db_prof_entry_t **) b;
+
+    if (ea->total != eb->total) {
+        return (ea->total < eb->total) ? 1 : -1;
+    }
+
+    return (ea->count < eb->count) - (ea->count > eb->count);
+}
+
+static void nm_db_prof_entry_free(void *unit_p)
+{
+    nm_db_prof_entry_t *e = unit_p;
+
+    nm_str_free(&e->sql);
+}
+/* vim:set ts=4 sw=4: */
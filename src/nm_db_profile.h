@@ -0,0 +1,21 @@
+#ifndef NM_DB_PROFILE_H_
+#define NM_DB_PROFILE_H_
+
+#include <nm_string.h>
+#include <nm_database.h>
+
+/*
+ * SQL profiler, enabled with [main] db_profile = /path/to/report.
+ * Statements of all connections of the process are timed and
+ * aggregated by template: literals of formatted queries are replaced
+ * with '?', so every NM_SQL_* query is one line of the report.
+ * The report is appended to the file on exit, the monitoring daemon
+ * also returns it on "db_profile" control request.
+ */
+void nm_db_prof_attach(nm_sqlite_t *db);
+bool nm_db_prof_enabled(void);
+/* text report sorted by total time, counters are cleared if reset */
+void nm_db_prof_report(nm_str_t *out, bool reset);
+
+#endif /* NM_DB_PROFILE_H_ */
+/* vim:set ts=4 sw=4: */
@@ -153,30 +153,28 @@ static void nm_edit_boot_fields_setup(const nm_vmctl_data_t *cur)
         field_opts_off(fields[n], O_STATIC);
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_INST),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&cur->main, 0, NM_SQL_INST)) {
         set_field_buffer(fields[NM_FLD_INST], 0, nm_form_yes_no[1]);
     } else {
         set_field_buffer(fields[NM_FLD_INST], 0, nm_form_yes_no[0]);
     }
 
     set_field_buffer(fields[NM_FLD_SRCP], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_ISO));
+            nm_db_text(&cur->main, 0, NM_SQL_ISO));
     set_field_buffer(fields[NM_FLD_BIOS], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_BIOS));
+            nm_db_text(&cur->main, 0, NM_SQL_BIOS));
     set_field_buffer(fields[NM_FLD_FLSH], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_FLASH));
+            nm_db_text(&cur->main, 0, NM_SQL_FLASH));
     set_field_buffer(fields[NM_FLD_KERN], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_KERN));
+            nm_db_text(&cur->main, 0, NM_SQL_KERN));
     set_field_buffer(fields[NM_FLD_CMDL], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_KAPP));
+            nm_db_text(&cur->main, 0, NM_SQL_KAPP));
     set_field_buffer(fields[NM_FLD_INIT], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_INIT));
+            nm_db_text(&cur->main, 0, NM_SQL_INIT));
     set_field_buffer(fields[NM_FLD_DEBP], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_DEBP));
+            nm_db_text(&cur->main, 0, NM_SQL_DEBP));
 
-    if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_DEBF),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&cur->main, 0, NM_SQL_DEBF)) {
         set_field_buffer(fields[NM_FLD_DEBF], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_DEBF], 0, nm_form_yes_no[1]);
@@ -289,60 +287,64 @@ static void nm_edit_boot_update_db(const nm_str_t *name, nm_vm_boot_t *vm)
 {
     nm_str_t query = NM_INIT_STR;
 
+    nm_db_begin_transaction();
+
     if (field_status(fields[NM_FLD_INST])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_INSTALL,
                 vm->installed ? NM_ENABLE : NM_DISABLE, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_SRCP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_ISO,
                 vm->inst_path.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_BIOS])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_BIOS,
                 vm->bios.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_FLSH])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_FLASH,
                 vm->pflash.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_KERN])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_KERN,
                 vm->kernel.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_CMDL])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_KERN_CMD,
                 vm->cmdline.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_INIT])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_INITRD,
                 vm->initrd.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_DEBP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_DBG_PORT,
                 vm->debug_port.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_DEBF])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_DBG_FREEZE,
                 vm->debug_freeze ? NM_ENABLE : NM_DISABLE, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
+    nm_db_commit();
+
     nm_str_free(&query);
 }
 
@@ -35,7 +35,7 @@ static size_t nm_edit_net_labels_setup(void);
 static int nm_edit_net_get_data(const nm_str_t *name,
         nm_iface_t *ifp, bool add);
 static void nm_edit_net_update_db(const nm_str_t *name,
-        nm_iface_t *ifp, bool add);
+        const nm_vmctl_data_t *vm, nm_iface_t *ifp, bool add);
 static inline void nm_edit_net_iface_free(nm_iface_t *ifp);
 static int nm_edit_net_maddr_busy(const nm_str_t *mac);
 static bool nm_check_nic_name_busy(const nm_str_t *name);
@@ -117,7 +117,7 @@ void nm_edit_net(const nm_str_t *name)
     do {
         switch (ch) {
         case NM_KEY_ENTER:
-            if (vm.ifs.n_memb) {
+            if (nm_db_rows(&vm.ifs)) {
                 regen_data = true;
                 if (nm_edit_net_action(name, &vm, ifs.highlight, false)
                         == NM_OK) {
@@ -165,7 +165,7 @@ void nm_edit_net(const nm_str_t *name)
             nm_vect_free(&ifaces, NULL);
             nm_vmctl_free_data(&vm);
             nm_vmctl_get_data(name, &vm);
-            iface_count = vm.ifs.n_memb / NM_IFS_IDX_COUNT;
+            iface_count = nm_db_rows(&vm.ifs);
             nic_list_len = (getmaxy(side_window) - 4);
             ifs.highlight = 1;
 
@@ -184,13 +184,9 @@ void nm_edit_net(const nm_str_t *name)
             }
 
             for (size_t n = 0; n < iface_count; n++) {
-                size_t idx_shift = NM_IFS_IDX_COUNT * n;
-
                 nm_vect_insert(&ifaces,
-                               nm_vect_str_ctx(&vm.ifs,
-                                   NM_SQL_IF_NAME + idx_shift),
-                               nm_vect_str_len(&vm.ifs,
-                                   NM_SQL_IF_NAME + idx_shift) + 1,
+                               nm_db_text(&vm.ifs, n, NM_SQL_IF_NAME),
+                               nm_db_str(&vm.ifs, n, NM_SQL_IF_NAME)->len + 1,
                                NULL);
             }
 
@@ -210,7 +206,7 @@ void nm_edit_net(const nm_str_t *name)
         }
 
         if (redraw_window) {
-            size_t iface_count = vm.ifs.n_memb / NM_IFS_IDX_COUNT;
+            size_t iface_count = nm_db_rows(&vm.ifs);
 
             nm_edit_net_init_main_windows(true);
 
@@ -303,8 +299,8 @@ nm_edit_net_unplug(const nm_str_t *name, const nm_vmctl_data_t *vm,
 {
     nm_iface_t iface_data = NM_INIT_NET_IF;
     nm_str_t query = NM_INIT_STR;
-    nm_str_t *if_name;
-    size_t idx_shift;
+    const nm_str_t *if_name;
+    size_t row;
     int rc = NM_OK;
 
     if (!if_idx) {
@@ -312,15 +308,15 @@ nm_edit_net_unplug(const nm_str_t *name, const nm_vmctl_data_t *vm,
         goto out;
     }
 
-    idx_shift = NM_IFS_IDX_COUNT * (--if_idx);
+    row = --if_idx;
 
     if (nm_qmp_test_socket(name) == NM_OK) {
         nm_str_format(&iface_data.maddr, "%s",
-                nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_MAC + idx_shift));
+                nm_db_text(&vm->ifs, row, NM_SQL_IF_MAC));
         nm_qmp_nic_detach(name, &iface_data);
     }
 
-    if_name = nm_vect_str(&vm->ifs, NM_SQL_IF_NAME + idx_shift);
+    if_name = nm_db_str(&vm->ifs, row, NM_SQL_IF_NAME);
     nm_str_format(&query, NM_SQL_IFACES_DELETE, name->data, if_name->data);
     nm_db_edit(query.data);
 #if defined(NM_OS_LINUX)
@@ -357,7 +353,7 @@ nm_edit_net_action(const nm_str_t *name, const nm_vmctl_data_t *vm,
     nm_form_t *form = NULL;
     int rc = NM_OK;
     nm_iface_t iface_data = NM_INIT_NET_IF;
-    size_t idx_shift;
+    size_t row;
     size_t msg_len;
 
     if (!if_idx) {
@@ -365,12 +361,12 @@ nm_edit_net_action(const nm_str_t *name, const nm_vmctl_data_t *vm,
         goto out;
     }
 
-    idx_shift = NM_IFS_IDX_COUNT * (--if_idx);
+    row = --if_idx;
     if_idx++; /* restore idx */
 
     if (!add) {
         nm_str_format(&iface_data.name, "%s",
-            nm_vect_str(&vm->ifs, NM_SQL_IF_NAME + idx_shift)->data);
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_NAME));
 
         if (!iface_data.name.len) {
             rc = NM_ERR;
@@ -455,7 +451,7 @@ nm_edit_net_action(const nm_str_t *name, const nm_vmctl_data_t *vm,
         goto out;
     }
 
-    nm_edit_net_update_db(name, &iface_data, add);
+    nm_edit_net_update_db(name, vm, &iface_data, add);
 
     if (add && (nm_qmp_test_socket(name) == NM_OK)) {
         nm_edit_net_plug(name, &iface_data);
@@ -477,12 +473,12 @@ static void
 nm_edit_net_fields_setup(const nm_vmctl_data_t *vm, size_t if_idx, bool add)
 {
     size_t mvtap_idx = 0;
-    size_t idx_shift;
+    size_t row;
 
     if (!if_idx) {
         return;
     }
-    idx_shift = NM_IFS_IDX_COUNT * (--if_idx);
+    row = --if_idx;
 
     field_opts_off(fields[NM_FLD_NAME], O_STATIC);
     field_opts_off(fields[NM_FLD_MADR], O_STATIC);
@@ -510,44 +506,41 @@ nm_edit_net_fields_setup(const nm_vmctl_data_t *vm, size_t if_idx, bool add)
     }
 
     set_field_buffer(fields[NM_FLD_NAME], 0,
-        nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_NAME + idx_shift));
+        nm_db_text(&vm->ifs, row, NM_SQL_IF_NAME));
     set_field_buffer(fields[NM_FLD_NDRV], 0,
-        nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_DRV + idx_shift));
+        nm_db_text(&vm->ifs, row, NM_SQL_IF_DRV));
     set_field_buffer(fields[NM_FLD_MADR], 0,
-        nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_MAC + idx_shift));
-    if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_IP4 + idx_shift) > 0) {
+        nm_db_text(&vm->ifs, row, NM_SQL_IF_MAC));
+    if (nm_db_str(&vm->ifs, row, NM_SQL_IF_IP4)->len > 0) {
         set_field_buffer(fields[NM_FLD_IPV4], 0,
-                nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_IP4 + idx_shift));
+                nm_db_text(&vm->ifs, row, NM_SQL_IF_IP4));
     }
 #if defined (NM_OS_LINUX)
     set_field_buffer(fields[NM_FLD_VHST], 0,
-        (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_VHO + idx_shift),
-            NM_ENABLE) == NM_OK) ? "yes" : "no");
+        nm_db_bool(&vm->ifs, row, NM_SQL_IF_VHO) ? "yes" : "no");
 
-    mvtap_idx = nm_str_stoui(nm_vect_str(&vm->ifs,
-                NM_SQL_IF_MVT + idx_shift), 10);
+    mvtap_idx = nm_str_stoui(nm_db_str(&vm->ifs, row, NM_SQL_IF_MVT), 10);
     if (mvtap_idx > NM_NET_MACVTAP_NUM) {
         nm_bug("%s: invalid macvtap array index: %zu", __func__, mvtap_idx);
     }
     set_field_buffer(fields[NM_FLD_MTAP], 0, nm_form_macvtap[mvtap_idx]);
-    if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_PET + idx_shift) > 0) {
+    if (nm_db_str(&vm->ifs, row, NM_SQL_IF_PET)->len > 0) {
         set_field_buffer(fields[NM_FLD_PETH], 0,
-            nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_PET + idx_shift));
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_PET));
     }
 #else
     (void) mvtap_idx;
 #endif
     set_field_buffer(fields[NM_FLD_USER], 0,
-        (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift),
-                       NM_ENABLE) == NM_OK) ?
+        nm_db_bool(&vm->ifs, row, NM_SQL_IF_USR) ?
         nm_form_yes_no[0] : nm_form_yes_no[1]);
-    if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_FWD + idx_shift) > 0) {
+    if (nm_db_str(&vm->ifs, row, NM_SQL_IF_FWD)->len > 0) {
         set_field_buffer(fields[NM_FLD_FWD], 0,
-            nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_FWD + idx_shift));
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_FWD));
     }
-    if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_SMB + idx_shift) > 0) {
+    if (nm_db_str(&vm->ifs, row, NM_SQL_IF_SMB)->len > 0) {
         set_field_buffer(fields[NM_FLD_SMB], 0,
-            nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_SMB + idx_shift));
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_SMB));
     }
 }
 
@@ -755,42 +748,49 @@ out:
 }
 
 static void
-nm_edit_net_update_db(const nm_str_t *name, nm_iface_t *ifp, bool add)
+nm_edit_net_update_db(const nm_str_t *name, const nm_vmctl_data_t *vm,
+        nm_iface_t *ifp, bool add)
 {
     nm_str_t query = NM_INIT_STR;
 
+    /* all fields of the interface are changed with one commit */
+    nm_db_begin_transaction();
+
     if (add) {
-        nm_str_format(&query, NM_SQL_IFACES_INSERT_NEW,
-                name->data,
-                ifp->name.data,
-                "",
-                NM_DEFAULT_NETDRV,
+        nm_sqlite_stmt_t *stmt = nm_db_stmt(NM_STMT_IFACES_INSERT);
+
+        nm_db_bind_int(stmt, 1, nm_db_int(&vm->main, 0, NM_SQL_ID));
+        nm_db_bind_text(stmt, 2, ifp->name.data);
+        nm_db_bind_text(stmt, 3, "");
+        nm_db_bind_text(stmt, 4, NM_DEFAULT_NETDRV);
 #if defined(NM_OS_LINUX)
-                NM_ENABLE,
+        nm_db_bind_int(stmt, 5, 1);
 #else
-                NM_DISABLE,
+        nm_db_bind_int(stmt, 5, 0);
 #endif
-                NM_DISABLE, "", NM_DISABLE);
-        nm_db_edit(query.data);
+        nm_db_bind_int(stmt, 6, 0);
+        nm_db_bind_text(stmt, 8, "");
+        nm_db_bind_int(stmt, 9, 0);
+        nm_db_exec(stmt);
     } else {
         if (field_status(fields[NM_FLD_NAME])) {
             nm_str_format(&query, NM_SQL_IFACES_UPDATE_NAME,
                     ifp->name.data, name->data, ifp->oldname.data);
-            nm_db_edit(query.data);
+            nm_db_atomic(query.data);
         }
     }
 
     if (field_status(fields[NM_FLD_NDRV]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_DRV,
                 ifp->drv.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
 
 #if defined(NM_OS_LINUX)
         /* disable vhost if driver is not virtio-net */
         if (nm_str_cmp_st(&ifp->drv, NM_DEFAULT_NETDRV) != NM_OK) {
             nm_str_format(&query, NM_SQL_IFACES_UPDATE_VHOST,
                     NM_DISABLE, name->data, ifp->name.data);
-            nm_db_edit(query.data);
+            nm_db_atomic(query.data);
         }
 #endif
     }
@@ -798,13 +798,13 @@ nm_edit_net_update_db(const nm_str_t *name, nm_iface_t *ifp, bool add)
     if (field_status(fields[NM_FLD_MADR]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_MADDR,
                 ifp->maddr.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_IPV4]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_IPV4,
                 ifp->ipv4.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
 #if defined (NM_OS_LINUX)
@@ -813,7 +813,7 @@ nm_edit_net_update_db(const nm_str_t *name, nm_iface_t *ifp, bool add)
                 (nm_str_cmp_st(&ifp->vhost, "yes") == NM_OK) ?
                 NM_ENABLE : NM_DISABLE,
                 name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_MTAP]) || add) {
@@ -833,13 +833,13 @@ nm_edit_net_update_db(const nm_str_t *name, nm_iface_t *ifp, bool add)
 
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_MACVTAP,
             macvtap_idx, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_PETH]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_PARENT,
             ifp->parent_eth.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 #endif
 
@@ -847,21 +847,23 @@ nm_edit_net_update_db(const nm_str_t *name, nm_iface_t *ifp, bool add)
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_USERNET,
             (nm_str_cmp_st(&ifp->netuser, "yes") == NM_OK) ?
             NM_ENABLE : NM_DISABLE, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_FWD]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_HOSTFWD,
             ifp->hostfwd.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_SMB]) || add) {
         nm_str_format(&query, NM_SQL_IFACES_UPDATE_SMB,
             ifp->smb.data, name->data, ifp->name.data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
+    nm_db_commit();
+
     nm_str_free(&query);
 }
 
@@ -136,7 +136,7 @@ void nm_edit_vm(const nm_str_t *name)
         case NM_FLD_MACH:
             fields[n] = nm_field_enum_new(
                 n / 2, form_data,
-                nm_mach_get(nm_vect_str(&cur_settings.main, NM_SQL_ARCH)),
+                nm_mach_get(nm_db_str(&cur_settings.main, 0, NM_SQL_ARCH)),
                 false, false
             );
             break;
@@ -189,49 +189,45 @@ static void nm_edit_vm_fields_setup(const nm_vmctl_data_t *cur)
     field_opts_off(fields[NM_FLD_ARGS], O_STATIC);
 
     set_field_buffer(fields[NM_FLD_CPUNUM], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_SMP));
+            nm_db_text(&cur->main, 0, NM_SQL_SMP));
     set_field_buffer(fields[NM_FLD_RAMTOT], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_MEM));
+            nm_db_text(&cur->main, 0, NM_SQL_MEM));
 
-    if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_KVM),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&cur->main, 0, NM_SQL_KVM)) {
         set_field_buffer(fields[NM_FLD_KVMFLG], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_KVMFLG], 0, nm_form_yes_no[1]);
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_HCPU),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&cur->main, 0, NM_SQL_HCPU)) {
         set_field_buffer(fields[NM_FLD_HOSCPU], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_HOSCPU], 0, nm_form_yes_no[1]);
     }
 
-    nm_str_format(&buf, "%zu", cur->ifs.n_memb / NM_IFS_IDX_COUNT);
+    nm_str_format(&buf, "%zu", nm_db_rows(&cur->ifs));
     set_field_buffer(fields[NM_FLD_IFSCNT], 0, buf.data);
     set_field_buffer(fields[NM_FLD_DISKIN], 0,
-            nm_vect_str_ctx(&cur->drives, NM_SQL_DRV_TYPE));
-    if (nm_str_cmp_st(nm_vect_str(&cur->drives, NM_SQL_DRV_DISC),
-                NM_ENABLE) == NM_OK) {
+            nm_db_text(&cur->drives, 0, NM_SQL_DRV_TYPE));
+    if (nm_db_bool(&cur->drives, 0, NM_SQL_DRV_DISC)) {
         set_field_buffer(fields[NM_FLD_DISCARD], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_DISCARD], 0, nm_form_yes_no[1]);
     }
-    if (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_USBF),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&cur->main, 0, NM_SQL_USBF)) {
         set_field_buffer(fields[NM_FLD_USBUSE], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_USBUSE], 0, nm_form_yes_no[1]);
     }
 
     set_field_buffer(fields[NM_FLD_USBTYP], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_USBT));
+            nm_db_text(&cur->main, 0, NM_SQL_USBT));
     set_field_buffer(fields[NM_FLD_MACH], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_MACH));
+            nm_db_text(&cur->main, 0, NM_SQL_MACH));
     set_field_buffer(fields[NM_FLD_ARGS], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_ARGS));
+            nm_db_text(&cur->main, 0, NM_SQL_ARGS));
     set_field_buffer(fields[NM_FLD_GROUP], 0,
-            nm_vect_str_ctx(&cur->main, NM_SQL_GROUP));
+            nm_db_text(&cur->main, 0, NM_SQL_GROUP));
 
 #if defined(NM_OS_FREEBSD)
     field_opts_off(fields[NM_FLD_USBUSE], O_ACTIVE);
@@ -365,8 +361,7 @@ static int nm_edit_vm_get_data(nm_vm_t *vm, const nm_vmctl_data_t *cur)
             vm->kvm.enable = 1;
         } else {
             if (!field_status(fields[NM_FLD_HOSCPU]) &&
-                    (nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_HCPU),
-                                   NM_ENABLE) == NM_OK)) {
+                    (nm_db_bool(&cur->main, 0, NM_SQL_HCPU))) {
                 rc = NM_ERR;
                 NM_FORM_RESET();
                 nm_warn(_(NM_MSG_HCPU_KVM));
@@ -384,8 +379,7 @@ static int nm_edit_vm_get_data(nm_vm_t *vm, const nm_vmctl_data_t *cur)
     if (field_status(fields[NM_FLD_HOSCPU])) {
         if (nm_str_cmp_st(&hcpu, "yes") == NM_OK) {
             if (((!vm->kvm.enable) && (field_status(fields[NM_FLD_KVMFLG]))) ||
-                    ((nm_str_cmp_st(nm_vect_str(&cur->main, NM_SQL_KVM),
-                                    NM_DISABLE) == NM_OK) &&
+                    (!nm_db_bool(&cur->main, 0, NM_SQL_KVM) &&
                      !field_status(fields[NM_FLD_KVMFLG]))) {
                 rc = NM_ERR;
                 NM_FORM_RESET();
@@ -422,30 +416,32 @@ nm_edit_vm_update_db(nm_vm_t *vm, const nm_vmctl_data_t *cur, uint64_t mac)
 {
     nm_str_t query = NM_INIT_STR;
 
+    nm_db_begin_transaction();
+
     if (field_status(fields[NM_FLD_CPUNUM])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_SMP,
-            vm->cpus.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+            vm->cpus.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_RAMTOT])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_MEM,
-            vm->memo.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+            vm->memo.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_KVMFLG])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_KVM,
             vm->kvm.enable ? NM_ENABLE : NM_DISABLE,
-            nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+            nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_HOSCPU])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_HCPU,
             vm->kvm.hostcpu_enable ? NM_ENABLE : NM_DISABLE,
-            nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+            nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_IFSCNT])) {
@@ -455,51 +451,53 @@ nm_edit_vm_update_db(nm_vm_t *vm, const nm_vmctl_data_t *cur, uint64_t mac)
     if (field_status(fields[NM_FLD_DISKIN])) {
         nm_str_format(&query, NM_SQL_DRIVES_UPDATE_DRV,
                 vm->drive.driver.data,
-                nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_DISCARD])) {
         nm_str_format(&query, NM_SQL_DRIVES_UPDATE_DISCARD,
                 vm->drive.discard ? NM_ENABLE : NM_DISABLE,
-                nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_USBUSE])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_USB,
                 vm->usb_enable ? NM_ENABLE : NM_DISABLE,
-                nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_USBTYP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_USBTYPE,
-                vm->usb_type.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                vm->usb_type.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_MACH])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_MACHINE,
-                vm->mach.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                vm->mach.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_ARGS])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_CMD,
-                vm->cmdappend.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                vm->cmdappend.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_GROUP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_TEAM,
-                vm->group.data, nm_vect_str_ctx(&cur->main, NM_SQL_NAME));
-        nm_db_edit(query.data);
+                vm->group.data, nm_db_text(&cur->main, 0, NM_SQL_NAME));
+        nm_db_atomic(query.data);
         if (nm_filter.type == NM_FILTER_GROUP) {
             nm_filter.flags |= NM_FILTER_UPDATE;
         }
     }
 
+    nm_db_commit();
+
     nm_str_free(&query);
 }
 
@@ -507,16 +505,15 @@ void
 nm_edit_update_ifs(nm_str_t *query, const nm_vmctl_data_t *vm_cur,
         const nm_vm_t *vm_new, uint64_t mac)
 {
-    size_t cur_count = vm_cur->ifs.n_memb / NM_IFS_IDX_COUNT;
+    size_t cur_count = nm_db_rows(&vm_cur->ifs);
+    nm_sqlite_stmt_t *stmt;
 
     if (vm_new->ifs.count < cur_count) {
         for (; cur_count > vm_new->ifs.count; cur_count--) {
-            size_t idx_shift = NM_IFS_IDX_COUNT * (cur_count - 1);
-
             nm_str_format(query, NM_SQL_IFACES_DELETE,
-                    nm_vect_str_ctx(&vm_cur->main, NM_SQL_NAME),
-                    nm_vect_str_ctx(&vm_cur->ifs, NM_SQL_IF_NAME + idx_shift));
-            nm_db_edit(query->data);
+                    nm_db_text(&vm_cur->main, 0, NM_SQL_NAME),
+                    nm_db_text(&vm_cur->ifs, cur_count - 1, NM_SQL_IF_NAME));
+            nm_db_atomic(query->data);
         }
     }
 
@@ -531,25 +528,25 @@ nm_edit_update_ifs(nm_str_t *query, const nm_vmctl_data_t *vm_cur,
 
             nm_net_mac_n2s(mac, &maddr);
             nm_str_format(&if_name, "%s_eth%zu",
-                    nm_vect_str_ctx(&vm_cur->main, NM_SQL_NAME), n);
+                    nm_db_text(&vm_cur->main, 0, NM_SQL_NAME), n);
             nm_str_copy(&if_name_copy, &if_name);
 
             altname = nm_net_fix_tap_name(&if_name, &maddr);
 
-            nm_str_format(query, NM_SQL_IFACES_INSERT_NEW,
-                    nm_vect_str_ctx(&vm_cur->main, NM_SQL_NAME),
-                    if_name.data,
-                    maddr.data,
-                    NM_DEFAULT_NETDRV,
+            stmt = nm_db_stmt(NM_STMT_IFACES_INSERT);
+            nm_db_bind_int(stmt, 1, nm_db_int(&vm_cur->main, 0, NM_SQL_ID));
+            nm_db_bind_text(stmt, 2, if_name.data);
+            nm_db_bind_text(stmt, 3, maddr.data);
+            nm_db_bind_text(stmt, 4, NM_DEFAULT_NETDRV);
 #if defined(NM_OS_LINUX)
-                    NM_ENABLE,
+            nm_db_bind_int(stmt, 5, 1);
 #else
-                    NM_DISABLE,
+            nm_db_bind_int(stmt, 5, 0);
 #endif
-                    NM_DISABLE,
-                    (altname) ? if_name_copy.data : "",
-                    NM_DISABLE);
-            nm_db_edit(query->data);
+            nm_db_bind_int(stmt, 6, 0);
+            nm_db_bind_text(stmt, 8, (altname) ? if_name_copy.data : "");
+            nm_db_bind_int(stmt, 9, 0);
+            nm_db_exec(stmt);
 
             nm_str_free(&if_name);
             nm_str_free(&if_name_copy);
@@ -6,6 +6,7 @@
 #include <nm_vm_control.h>
 
 void nm_edit_vm(const nm_str_t *name);
+/* called inside a write transaction */
 void nm_edit_update_ifs(nm_str_t *query, const nm_vmctl_data_t *vm_cur,
         const nm_vm_t *vm_new, uint64_t mac);
 
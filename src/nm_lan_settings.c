@@ -10,6 +10,7 @@
 #include <nm_database.h>
 #include <nm_cfg_file.h>
 #include <nm_lan_settings.h>
+#include <nm_mon_metrics.h>
 
 #if defined(NM_OS_LINUX)
 
@@ -24,6 +25,7 @@ static void nm_lan_del_veth(const nm_str_t *name);
 static void nm_lan_up_veth(const nm_str_t *name);
 static void nm_lan_down_veth(const nm_str_t *name);
 static void nm_lan_veth_info(const nm_str_t *name);
+static void nm_lan_veth_rate(const nm_str_t *name, char *buf, size_t len);
 static int nm_lan_add_get_data(nm_str_t *ln, nm_str_t *rn);
 
 enum {
@@ -112,7 +114,7 @@ void nm_lan_settings(void)
     int ch = 0, regen_data = 1, renew_status = 0;
     nm_str_t query = NM_INIT_STR;
     nm_vect_t veths = NM_INIT_VECT;
-    nm_vect_t veths_list = NM_INIT_VECT;
+    nm_svect_t veths_list = NM_INIT_SVECT(nm_menu_item_t);
     nm_menu_data_t veths_data = NM_INIT_MENU_DATA;
     size_t veth_list_len, old_hl;
 
@@ -123,6 +125,9 @@ void nm_lan_settings(void)
     nm_lan_init_main_windows(false);
 
     do {
+        /* forms reset the timeout, link rates are redrawn every second */
+        wtimeout(action_window, NM_METRICS_INTERVAL);
+
         if (ch == NM_KEY_QUESTION) {
             nm_lan_help();
         } else if (ch == NM_KEY_A) {
@@ -161,7 +166,7 @@ void nm_lan_settings(void)
         }
 
         if (regen_data) {
-            nm_vect_free(&veths_list, NULL);
+            nm_svect_free(&veths_list, NULL);
             nm_vect_free(&veths, nm_str_vect_free_cb);
             nm_db_select(NM_SQL_VETH_SELECT_FORMATED, &veths);
             veth_list_len = (getmaxy(side_window) - 4);
@@ -183,14 +188,14 @@ void nm_lan_settings(void)
                 veths_data.item_last = veth_list_len = veths.n_memb;
             }
 
+            nm_svect_reserve(&veths_list, veths.n_memb);
             for (size_t n = 0; n < veths.n_memb; n++) {
-                nm_menu_item_t veth = NM_INIT_MENU_ITEM;
+                nm_menu_item_t *veth = nm_svect_emplace(&veths_list);
 
-                veth.name = (nm_str_t *) nm_vect_at(&veths, n);
-                nm_vect_insert(&veths_list, &veth, sizeof(veth), NULL);
+                veth->name = (nm_str_t *) nm_vect_at(&veths, n);
             }
 
-            veths_data.v = &veths_list;
+            veths_data.items = &veths_list;
 
             regen_data = 0;
             renew_status = 1;
@@ -228,11 +233,13 @@ void nm_lan_settings(void)
         }
     } while ((ch = wgetch(action_window)) != NM_KEY_Q);
 
+    wtimeout(action_window, -1);
     werase(side_window);
     werase(help_window);
     nm_init_help_main();
+    nm_mon_metrics_links_free();
     nm_vect_free(&veths, nm_str_vect_free_cb);
-    nm_vect_free(&veths_list, NULL);
+    nm_svect_free(&veths_list, NULL);
     nm_str_free(&query);
 }
 
@@ -431,6 +438,29 @@ static void nm_lan_down_veth(const nm_str_t *name)
     nm_str_free(&rname);
 }
 
+/*
+ * veth links are not watched by the monitoring daemon, take
+ * counters while the view is open.
+ */
+static void nm_lan_veth_rate(const nm_str_t *name, char *buf, size_t len)
+{
+    static uint64_t last;
+    nm_metrics_iface_t rate;
+    uint64_t now = nm_mono_ms();
+
+    if (now - last >= NM_METRICS_INTERVAL) {
+        nm_mon_metrics_links();
+        last = now;
+    }
+
+    *buf = '\0';
+    if (nm_mon_metrics_link(name->data, &rate) == NM_OK) {
+        snprintf(buf, len, "%-12s%.0f/%.0f pps, %.2f/%.2f Mbit/s rx/tx", "",
+                rate.rx_pps, rate.tx_pps,
+                rate.rx_bps * 8 / 1e6, rate.tx_bps * 8 / 1e6);
+    }
+}
+
 static void nm_lan_veth_info(const nm_str_t *name)
 {
     chtype ch1, ch2;
@@ -440,10 +470,13 @@ static void nm_lan_veth_info(const nm_str_t *name)
     nm_str_t query = NM_INIT_STR;
     nm_str_t buf = NM_INIT_STR;
     nm_vect_t ifs = NM_INIT_VECT;
+    char lrate[80], rrate[80];
 
     ch1 = ch2 = 0;
     getmaxyx(action_window, rows, cols);
     nm_lan_parse_name(name, &buf, &rname);
+    nm_lan_veth_rate(&buf, lrate, sizeof(lrate));
+    nm_lan_veth_rate(&rname, rrate, sizeof(rrate));
 
     nm_str_format(&query, NM_SQL_IFACES_SELECT_BY_PARENT, buf.data);
     nm_db_select(query.data, &ifs);
@@ -458,6 +491,10 @@ static void nm_lan_veth_info(const nm_str_t *name)
     }
 
     NM_PR_VM_INFO();
+    if (*lrate) {
+        nm_str_format(&buf, "%s", lrate);
+        NM_PR_VM_INFO();
+    }
     nm_str_trunc(&buf, 0);
 
     nm_vect_free(&ifs, nm_str_vect_free_cb);
@@ -475,6 +512,10 @@ static void nm_lan_veth_info(const nm_str_t *name)
         nm_str_add_text(&buf, _(" [none]"));
     }
     NM_PR_VM_INFO();
+    if (*rrate) {
+        nm_str_format(&buf, "%s", rrate);
+        NM_PR_VM_INFO();
+    }
 
     nm_vect_free(&ifs, nm_str_vect_free_cb);
     nm_str_free(&rname);
@@ -99,7 +99,7 @@ void nm_mach_free(void)
 static void nm_mach_get_data(const char *arch)
 {
     nm_str_t buf = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
     nm_str_t answer = NM_INIT_STR;
     nm_mach_t mach_list = NM_INIT_MLIST;
 
@@ -107,12 +107,11 @@ static void nm_mach_get_data(const char *arch)
 
     nm_str_format(&buf, "%s/qemu-system-%s",
         nm_cfg_get()->qemu_bin_path.data, arch);
-    nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(&argv, buf.data);
 
-    nm_vect_insert_cstr(&argv, "-M");
-    nm_vect_insert_cstr(&argv, "help");
+    nm_argv_add(&argv, "-M");
+    nm_argv_add(&argv, "help");
 
-    nm_vect_end_zero(&argv);
     if (nm_spawn_process(&argv, &answer) != NM_OK) {
         nm_str_t warn_msg = NM_INIT_STR;
 
@@ -131,7 +130,7 @@ static void nm_mach_get_data(const char *arch)
         sizeof(mach_list), nm_mach_vect_ins_mlist_cb);
 out:
     nm_str_free(&buf);
-    nm_vect_free(&argv, NULL);
+    nm_argv_free(&argv);
     nm_str_free(&answer);
     nm_str_free(&mach_list.arch);
     nm_str_free(&mach_list.def);
@@ -4,6 +4,8 @@
 #include <nm_database.h>
 #include <nm_cfg_file.h>
 #include <nm_main_loop.h>
+#include <nm_mon_ctl.h>
+#include <nm_mon_shm.h>
 #include <nm_mon_daemon.h>
 #include <nm_ovf_import.h>
 #include <nm_vm_control.h>
@@ -17,9 +19,12 @@
     static const char NM_OPT_ARGS[] = "s:p:f:z:k:i:m:C:vhld";
 #endif
 
+enum {NM_DB_PROF_TIMEOUT = 5000}; /* ms */
+
 static void signals_handler(int signal);
 static void nm_process_args(int argc, char **argv);
 static void nm_print_feset(void);
+static int nm_print_db_profile(void);
 
 volatile sig_atomic_t redraw_window;
 
@@ -42,7 +47,7 @@ int main(int argc, char **argv)
     nm_process_args(argc, argv);
 
     nm_cfg_init(false);
-    nm_db_init();
+    nm_db_init(NM_DB_RW);
     nm_mon_start();
 #if defined (NM_OS_LINUX)
     nm_lan_create_veth(NM_FALSE);
@@ -92,7 +97,8 @@ static void nm_process_args(int argc, char **argv)
         OPT_SNAP_LOAD = CHAR_MAX + 2,
         OPT_SNAP_DEL  = CHAR_MAX + 3,
         OPT_SNAP_LIST = CHAR_MAX + 4,
-        OPT_SNAP_NAME = CHAR_MAX + 5
+        OPT_SNAP_NAME = CHAR_MAX + 5,
+        OPT_DB_PROFILE = CHAR_MAX + 6
     };
 
     enum snap_action {
@@ -113,6 +119,7 @@ static void nm_process_args(int argc, char **argv)
         { "snap-del",    required_argument, NULL, OPT_SNAP_DEL  },
         { "snap-list",   required_argument, NULL, OPT_SNAP_LIST },
         { "name",        required_argument, NULL, OPT_SNAP_NAME },
+        { "db-profile",  no_argument,       NULL, OPT_DB_PROFILE },
         { "start",       required_argument, NULL, 's' },
         { "powerdown",   required_argument, NULL, 'p' },
         { "force-stop",  required_argument, NULL, 'f' },
@@ -235,7 +242,7 @@ static void nm_process_args(int argc, char **argv)
             nm_init_core();
             {
                 nm_vmctl_data_t vm = NM_VMCTL_INIT_DATA;
-                nm_vect_t _argv = NM_INIT_VECT;
+                nm_argv_t _argv = NM_INIT_ARGV;
                 nm_str_t name = NM_INIT_STR;
                 int flags = 0;
 
@@ -244,13 +251,13 @@ static void nm_process_args(int argc, char **argv)
                 nm_vmctl_get_data(&name, &vm);
                 nm_vmctl_gen_cmd(&_argv, &vm, &name, &flags, NULL, NULL);
 
-                for (size_t n = 0; n < _argv.n_memb; n++) {
-                    printf("%s%s", (char *) nm_vect_at(&_argv, n),
-                            (n != _argv.n_memb - 1) ? " " : "");
+                for (size_t n = 0; n < nm_argv_count(&_argv); n++) {
+                    printf("%s%s", nm_argv_at(&_argv, n),
+                            (n != nm_argv_count(&_argv) - 1) ? " " : "");
                 }
 
                 nm_str_free(&name);
-                nm_vect_free(&_argv, NULL);
+                nm_argv_free(&_argv);
                 nm_vmctl_free_data(&vm);
             }
             nm_exit_core();
@@ -266,7 +273,7 @@ static void nm_process_args(int argc, char **argv)
             nm_db_select(NM_SQL_VMS_SELECT_NAMES, &vm_list);
             for (size_t i = 0; i < vm_list.n_memb; ++i) {
                 const nm_str_t *name = (nm_str_t *)vm_list.data[i];
-                int status = nm_qmp_test_socket(name);
+                int status = nm_mon_vm_status(name);
 
                 printf("%s - %s\n", name->data, status == NM_OK ?
                         "running" : "stopped");
@@ -289,6 +296,8 @@ static void nm_process_args(int argc, char **argv)
                 nm_str_free(&name);
             }
             nm_exit_core();
+        case OPT_DB_PROFILE:
+            nm_exit(nm_print_db_profile());
         case OPT_SNAP_SAVE:
             action = ACTION_SNAP_SAVE;
             nm_str_format(&vmname, "%s", optarg);
@@ -328,6 +337,8 @@ static void nm_process_args(int argc, char **argv)
                     _(" delete snapshot"));
             printf("%s%s\n", _("    --snap-list <vm-name>"),
                     _(" show snapshots"));
+            printf("%s\n", _("    --db-profile        print SQL profile "
+                        "of the monitoring daemon"));
             nm_exit(NM_OK);
         default:
             nm_exit(NM_ERR);
@@ -368,6 +379,34 @@ static void nm_process_args(int argc, char **argv)
     }
 }
 
+static int nm_print_db_profile(void)
+{
+    struct json_object *reply, *member;
+    int rc;
+
+    nm_cfg_init(false);
+
+    rc = nm_mon_ctl_call("db_profile", NULL, NM_DB_PROF_TIMEOUT, &reply);
+    if (rc == NM_OK &&
+            json_object_object_get_ex(reply, "report", &member)) {
+        printf("%s", json_object_get_string(member));
+    } else if (reply && json_object_object_get_ex(reply, "desc", &member)) {
+        fprintf(stderr, "%s\n", json_object_get_string(member));
+        rc = NM_ERR;
+    } else {
+        fprintf(stderr, "%s\n", _("monitoring daemon is not running"));
+        rc = NM_ERR;
+    }
+
+    if (reply) {
+        json_object_put(reply);
+    }
+
+    nm_cfg_free();
+
+    return rc;
+}
+
 #define NM_FESET(feset, _g_, _c_) \
     (cfg->glyphs.checkbox) ? NM_GLYPH_CK_##_g_ feset : _c_ feset
 
@@ -20,14 +20,21 @@
 #include <nm_edit_boot.h>
 #include <nm_ovf_import.h>
 #include <nm_vm_control.h>
+#include <nm_mon_shm.h>
 #include <nm_mon_daemon.h>
 #include <nm_easter_egg.h>
 #include <nm_vm_snapshot.h>
 #include <nm_qmp_control.h>
 #include <nm_lan_settings.h>
+#include <nm_dashboard.h>
+
+#include <poll.h>
 
 static const char NM_SEARCH_STR[] = "Search:";
 
+/* retry interval (ms) for connecting to the monitoring daemon */
+static const int NM_MON_RETRY = 5000;
+
 nm_filter_t nm_filter;
 
 static size_t nm_search_vm(const nm_vect_t *list, int *err);
@@ -35,6 +42,11 @@ static int nm_filter_check(const nm_str_t *input);
 static int nm_search_cmp_cb(const void *s1, const void *s2);
 static void nm_iterate_groups(bool forward);
 static void nm_store_pid(void);
+static bool nm_vms_probe(nm_menu_data_t *vms, size_t first, size_t last);
+static int nm_vms_update(nm_menu_data_t *vms, const nm_str_t *name, int status);
+static int nm_vms_cmp_cb(const void *s1, const void *s2);
+static int nm_wait_input(int mon_sd, int timeout, bool *mon_ready);
+static int nm_timer_left(uint64_t deadline, uint64_t now, int timeout);
 
 static inline void nm_filter_clean(void)
 {
@@ -46,11 +58,14 @@ static inline void nm_filter_clean(void)
 void nm_start_main_loop(void)
 {
     int nemu = 0, regen_data = 1;
-    int clear_action = 1;
+    int clear_action = 1, redraw = 1;
     size_t vm_list_len, old_hl = 0;
+    int mon_sd = -1;
+    nm_str_t mon_buf = NM_INIT_STR;
+    uint64_t next_stat = 0, next_probe = 0, next_mon = 0;
     nm_menu_data_t vms = NM_INIT_MENU_DATA;
     nm_vmctl_data_t vm_props = NM_VMCTL_INIT_DATA;
-    nm_vect_t vms_v = NM_INIT_VECT;
+    nm_svect_t vms_v = NM_INIT_SVECT(nm_menu_item_t);
     nm_vect_t vm_list = NM_INIT_VECT;
     const nm_cfg_t *cfg = nm_cfg_get();
 
@@ -78,7 +93,12 @@ void nm_start_main_loop(void)
     nm_init_side();
     nm_init_action(NULL);
 
+    mon_sd = nm_mon_subscribe();
+
     for (;;) {
+        bool mon_ready = false;
+        uint64_t now;
+        int timeout = -1;
         int ch;
 
         if (nm_filter.flags & NM_FILTER_UPDATE) {
@@ -99,23 +119,22 @@ void nm_start_main_loop(void)
         }
 
         if (regen_data) {
-            nm_str_t query = NM_INIT_STR;
+            nm_sqlite_stmt_t *stmt = NULL;
 
             nm_vect_free(&vm_list, nm_str_vect_free_cb);
-            nm_vect_free(&vms_v, NULL);
+            nm_svect_free(&vms_v, NULL);
 
             switch (nm_filter.type) {
             case NM_FILTER_NONE:
-                nm_str_format(&query, "%s", NM_SQL_VMS_SELECT_NAMES);
+                stmt = nm_db_stmt(NM_STMT_VMS_SELECT_NAMES);
                 break;
             case NM_FILTER_GROUP:
-                nm_str_format(&query, NM_SQL_VMS_SELECT_NAMES_BY_TEAM,
-                        nm_filter.query.data);
+                stmt = nm_db_stmt(NM_STMT_VMS_SELECT_NAMES_BY_TEAM);
+                nm_db_bind_text(stmt, 1, nm_filter.query.data);
                 break;
             }
 
-            nm_db_select(query.data, &vm_list);
-            nm_str_free(&query);
+            nm_db_stmt_select(stmt, &vm_list);
 
             vm_list_len = (getmaxy(side_window) - 4);
 
@@ -136,19 +155,31 @@ void nm_start_main_loop(void)
                 vms.item_last = vm_list_len = vm_list.n_memb;
             }
 
+            nm_svect_reserve(&vms_v, vm_list.n_memb);
             for (size_t n = 0; n < vm_list.n_memb; n++) {
-                nm_menu_item_t vm = NM_INIT_MENU_ITEM;
+                nm_menu_item_t *vm = nm_svect_emplace(&vms_v);
 
-                vm.name = (nm_str_t *) nm_vect_at(&vm_list, n);
-                nm_vect_insert(&vms_v, &vm, sizeof(vm), NULL);
+                vm->name = (nm_str_t *) nm_vect_at(&vm_list, n);
             }
 
-            vms.v = &vms_v;
+            vms.items = &vms_v;
+
+            /*
+             * Probe visible VMs right away, and resubscribe to get
+             * status of the whole new list from the daemon.
+             */
+            nm_vms_probe(&vms, vms.item_first, vms.item_last);
+            if (mon_sd != -1) {
+                close(mon_sd);
+                nm_str_free(&mon_buf);
+                mon_sd = nm_mon_subscribe();
+            }
 
             regen_data = 0;
+            redraw = 1;
         }
 
-        if (vm_list.n_memb > 0) {
+        if (redraw && vm_list.n_memb > 0) {
             const nm_str_t *name = nm_vect_item_name_cur(&vms);
             int status = nm_vect_item_status_cur(&vms);
 
@@ -173,15 +204,74 @@ void nm_start_main_loop(void)
                 nm_init_side();
                 nm_init_action(NULL);
                 continue;
-        } else {
+        } else if (redraw) {
             if (clear_action) {
                 werase(action_window);
                 nm_init_action(NULL);
                 clear_action = 0;
             }
         }
+        redraw = 0;
+
+        /*
+         * Nothing is redrawn until a key is pressed or VM status
+         * is changed. Runtime statistics of the selected VM are
+         * refreshed by timer only while it is running. Without the
+         * monitoring daemon visible VMs are probed by timer too.
+         */
+        now = nm_mono_ms();
+        if (vm_list.n_memb > 0 && nm_vect_item_status_cur(&vms)) {
+            if (now >= next_stat) {
+                if (next_stat) {
+                    nm_print_vm_info(NULL, NULL, 0);
+                    wrefresh(action_window);
+                }
+                next_stat = now + cfg->refresh_timeout;
+            }
+            timeout = nm_timer_left(next_stat, now, timeout);
+        } else {
+            next_stat = 0;
+        }
 
-        ch = wgetch(side_window);
+        if (mon_sd == -1) {
+            if (now >= next_mon) {
+                if ((mon_sd = nm_mon_subscribe()) == -1) {
+                    next_mon = now + NM_MON_RETRY;
+                }
+            }
+            if (mon_sd == -1 && now >= next_probe) {
+                next_probe = now + cfg->refresh_timeout;
+                if (nm_vms_probe(&vms, vms.item_first, vms.item_last)) {
+                    redraw = 1;
+                    continue;
+                }
+            }
+            if (mon_sd == -1) {
+                timeout = nm_timer_left(next_mon, now, timeout);
+                timeout = nm_timer_left(next_probe, now, timeout);
+            }
+        }
+
+        ch = nm_wait_input(mon_sd, timeout, &mon_ready);
+
+        if (mon_ready) {
+            nm_str_t vm_name = NM_INIT_STR;
+            int vm_status;
+
+            if (nm_mon_event_recv(mon_sd, &mon_buf) != NM_OK) {
+                close(mon_sd);
+                nm_str_free(&mon_buf);
+                mon_sd = -1;
+                next_mon = 0;
+            }
+
+            while (nm_mon_event_next(&mon_buf, &vm_name, &vm_status) == NM_OK) {
+                if (nm_vms_update(&vms, &vm_name, vm_status) == NM_OK) {
+                    redraw = 1;
+                }
+            }
+            nm_str_free(&vm_name);
+        }
 
         /*
          * Clear action window only if key pressed.
@@ -193,13 +283,23 @@ void nm_start_main_loop(void)
                 fflush(stdout);
             }
             clear_action = 1;
+            redraw = 1;
         }
 
-        if (vm_list.n_memb > 0) {
+        if (vm_list.n_memb > 0 && ch != ERR) {
+            size_t cur;
+
             nm_menu_scroll(&vms, vm_list_len, ch);
+
+            /* keys below act on the selected VM, make sure status is actual */
+            cur = vms.item_first + vms.highlight - 1;
+            nm_vms_probe(&vms, cur, cur + 1);
         }
 
         if (ch == NM_KEY_Q) {
+            if (mon_sd != -1) {
+                close(mon_sd);
+            }
             if (unlink(cfg->pid.data) != 0) {
                 nm_debug("error delete nemu pidfile\n");
             }
@@ -469,6 +569,14 @@ void nm_start_main_loop(void)
         if (ch == NM_KEY_U) {
             nm_vmctl_clear_all_tap();
         }
+
+        if (ch == NM_KEY_T_UP) {
+            if (access(cfg->daemon_pid.data, R_OK) == -1) {
+                nm_warn(_(NM_MSG_NO_DAEMON));
+            } else {
+                nm_dashboard();
+            }
+        }
 #if defined(NM_WITH_OVF_SUPPORT)
         if (ch == NM_KEY_O_UP) {
             nm_ovf_import();
@@ -530,17 +638,132 @@ void nm_start_main_loop(void)
             } else {
                 vms.item_last = vm_list_len = vm_list.n_memb;
             }
+            nm_vms_probe(&vms, vms.item_first, vms.item_last);
 
             redraw_window = 0;
+            redraw = 1;
         }
     }
 
     nm_filter_clean();
+    nm_str_free(&mon_buf);
     nm_vmctl_free_data(&vm_props);
-    nm_vect_free(&vms_v, NULL);
+    nm_svect_free(&vms_v, NULL);
     nm_vect_free(&vm_list, nm_str_vect_free_cb);
 }
 
+static bool nm_vms_probe(nm_menu_data_t *vms, size_t first, size_t last)
+{
+    bool changed = false;
+
+    if (!vms->items) {
+        return false;
+    }
+
+    for (size_t n = first; n < last && n < vms->items->n_memb; n++) {
+        int status =
+            (nm_mon_vm_status(nm_vect_item_name(vms->items, n)) == NM_OK);
+
+        if (status != nm_vect_item_status(vms->items, n)) {
+            nm_vect_set_item_status(vms->items, n, status);
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+/*
+ * Apply status received from the daemon.
+ * Returns NM_OK if screen must be redrawn.
+ */
+static int nm_vms_update(nm_menu_data_t *vms, const nm_str_t *name, int status)
+{
+    nm_menu_item_t *match;
+    size_t idx;
+
+    if (!vms->items || !vms->items->n_memb) {
+        return NM_ERR;
+    }
+
+    /* list is sorted by name, see NM_SQL_VMS_SELECT_NAMES */
+    match = bsearch(name, vms->items->data, vms->items->n_memb,
+            vms->items->stride, nm_vms_cmp_cb);
+    if (!match || match->status == (uint32_t) !!status) {
+        return NM_ERR;
+    }
+
+    match->status = !!status;
+    idx = match - (nm_menu_item_t *) vms->items->data;
+
+    if (idx < vms->item_first || idx >= vms->item_last) {
+        return NM_ERR;
+    }
+
+    return NM_OK;
+}
+
+static int nm_vms_cmp_cb(const void *s1, const void *s2)
+{
+    const nm_str_t *name = s1;
+    const nm_menu_item_t *item = s2;
+
+    return strcmp(name->data, item->name->data);
+}
+
+/*
+ * Wait for a key, daemon event or timeout.
+ * Returns pressed key or ERR.
+ */
+static int nm_wait_input(int mon_sd, int timeout, bool *mon_ready)
+{
+    struct pollfd fds[2];
+    nfds_t nfds = 1;
+    int ch;
+
+    /* ncurses may have already buffered input */
+    if ((ch = wgetch(side_window)) != ERR) {
+        return ch;
+    }
+
+    fds[0].fd = STDIN_FILENO;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+
+    if (mon_sd != -1) {
+        fds[1].fd = mon_sd;
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        nfds++;
+    }
+
+    /* SIGWINCH interrupts poll(2), caller checks redraw_window */
+    if (poll(fds, nfds, timeout) <= 0) {
+        return ERR;
+    }
+
+    if (nfds > 1 && fds[1].revents) {
+        *mon_ready = true;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        return wgetch(side_window);
+    }
+
+    return ERR;
+}
+
+static int nm_timer_left(uint64_t deadline, uint64_t now, int timeout)
+{
+    int left = (deadline > now) ? (int) (deadline - now) : 0;
+
+    if (timeout == -1 || left < timeout) {
+        return left;
+    }
+
+    return timeout;
+}
+
 static void nm_search_init_windows(nm_form_t *form)
 {
     if (form) {
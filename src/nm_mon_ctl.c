@@ -0,0 +1,666 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_mon_ctl.h>
+#include <nm_mon_jobs.h>
+#include <nm_cfg_file.h>
+#include <nm_db_profile.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+
+static const char NM_MON_CTL_REQ[] =
+    "{\"id\":%" PRIu64 ",\"request\":\"%s\",\"arguments\":%s}\n";
+static const char NM_MON_CTL_RET[] = "{\"id\":%s,\"return\":%s}\n";
+static const char NM_MON_CTL_ERR[] = "{\"id\":%s,\"error\":{\"desc\":\"%s\"}}\n";
+static const char NM_MON_CTL_JOB[] = "{\"job-id\":\"%s\"}";
+
+enum {
+    NM_MON_CTL_POLL = 1000,         /* ms, stop flag check interval */
+    NM_MON_CTL_MAX_FRAME = 65536
+};
+
+typedef struct {
+    int sd;
+    uint64_t serial;
+    nm_str_t rbuf;
+} nm_mon_ctl_client_t;
+
+/* job waited by the client */
+typedef struct {
+    uint64_t client;
+    nm_str_t id;        /* request id as JSON text */
+    nm_str_t jobid;
+    int rc;
+} nm_mon_ctl_wait_t;
+
+typedef struct {
+    int sd;
+    int rebuild[2];
+    int done[2];
+    pthread_mutex_t mtx;
+    nm_vect_t finished; /* nm_mon_ctl_wait_t, protected by mtx */
+    nm_vect_t clients;  /* nm_mon_ctl_client_t, server thread only */
+    uint64_t serial;
+} nm_mon_ctl_t;
+
+static nm_mon_ctl_t nm_ctl = {
+    .sd = -1,
+    .rebuild = { -1, -1 },
+    .done = { -1, -1 },
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .finished = NM_INIT_VECT,
+    .clients = NM_INIT_VECT,
+};
+
+/* request ids of this process */
+static uint64_t nm_ctl_req_id;
+
+static int nm_mon_ctl_pipe_open(int *fds);
+static void nm_mon_ctl_pipe_close(int *fds);
+static bool nm_mon_ctl_pipe_drain(int fd);
+static void nm_mon_ctl_wake(int fd);
+static void nm_mon_ctl_accept(void);
+static void nm_mon_ctl_drop(size_t idx);
+static int nm_mon_ctl_read(nm_mon_ctl_client_t *cl);
+static int nm_mon_ctl_handle(nm_mon_ctl_client_t *cl, const char *frame);
+static const char *nm_mon_ctl_job(const nm_mon_ctl_client_t *cl,
+        const nm_str_t *id, struct json_object *args, nm_str_t *ret);
+static void nm_mon_ctl_job_done(int rc, const nm_str_t *jobid, void *ctx);
+static const char *nm_mon_ctl_db_profile(struct json_object *args,
+        nm_str_t *ret);
+static void nm_mon_ctl_finished(void);
+static int nm_mon_ctl_send(int sd, const nm_str_t *id,
+        const nm_str_t *ret, const char *err);
+static void nm_mon_ctl_wait_free_cb(void *unit_p);
+static int nm_mon_ctl_connect(void);
+static struct json_object *nm_mon_ctl_recv(int sd, uint64_t id,
+        uint64_t deadline);
+
+int nm_mon_ctl_open(void)
+{
+    const nm_str_t *path = &nm_cfg_get()->daemon_ctl;
+    struct sockaddr_un addr;
+    int sd;
+
+    if (path->len >= sizeof(addr.sun_path)) {
+        nm_debug("%s: socket path too long: %s\n", __func__, path->data);
+        return NM_ERR;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    nm_strlcpy(addr.sun_path, path->data, sizeof(addr.sun_path));
+
+    if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        nm_debug("%s: socket error: %s\n", __func__, strerror(errno));
+        return NM_ERR;
+    }
+
+    /* stale socket from the killed daemon */
+    unlink(path->data);
+
+    if (bind(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        nm_debug("%s: bind error: %s\n", __func__, strerror(errno));
+        close(sd);
+        return NM_ERR;
+    }
+
+    if (chmod(path->data, S_IRUSR | S_IWUSR) != 0 ||
+            listen(sd, NM_MON_MAX_CLIENTS) != 0 ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1 ||
+            nm_mon_ctl_pipe_open(nm_ctl.rebuild) != NM_OK ||
+            nm_mon_ctl_pipe_open(nm_ctl.done) != NM_OK) {
+        nm_debug("%s: setup error: %s\n", __func__, strerror(errno));
+        nm_mon_ctl_pipe_close(nm_ctl.rebuild);
+        nm_mon_ctl_pipe_close(nm_ctl.done);
+        close(sd);
+        unlink(path->data);
+        return NM_ERR;
+    }
+
+    nm_ctl.sd = sd;
+
+    return NM_OK;
+}
+
+void *nm_mon_ctl_server(void *ctx)
+{
+    nm_thr_ctrl_t *args = ctx;
+
+    while (!args->stop) {
+        struct pollfd fds[NM_MON_MAX_CLIENTS + 2];
+        nfds_t nfds = 0;
+
+        fds[nfds].fd = nm_ctl.sd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+        fds[nfds].fd = nm_ctl.done[0];
+        fds[nfds].events = POLLIN;
+        nfds++;
+        for (size_t n = 0; n < nm_ctl.clients.n_memb; n++) {
+            fds[nfds].fd = ((nm_mon_ctl_client_t *)
+                    nm_vect_at(&nm_ctl.clients, n))->sd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+
+        if (poll(fds, nfds, NM_MON_CTL_POLL) <= 0) {
+            continue;
+        }
+
+        /* walk backwards, nm_mon_ctl_drop() shifts the tail */
+        for (size_t n = nfds; n > 2; n--) {
+            if (fds[n - 1].revents &&
+                    nm_mon_ctl_read(nm_vect_at(&nm_ctl.clients,
+                            n - 3)) != NM_OK) {
+                nm_mon_ctl_drop(n - 3);
+            }
+        }
+
+        if (fds[1].revents) {
+            nm_mon_ctl_finished();
+        }
+
+        if (fds[0].revents) {
+            nm_mon_ctl_accept();
+        }
+    }
+
+    while (nm_ctl.clients.n_memb) {
+        nm_mon_ctl_drop(0);
+    }
+    nm_vect_free(&nm_ctl.clients, NULL);
+
+    pthread_exit(NULL);
+}
+
+void nm_mon_ctl_free(void)
+{
+    if (nm_ctl.sd == -1) {
+        return;
+    }
+
+    close(nm_ctl.sd);
+    nm_ctl.sd = -1;
+    unlink(nm_cfg_get()->daemon_ctl.data);
+
+    nm_mon_ctl_pipe_close(nm_ctl.rebuild);
+    nm_mon_ctl_pipe_close(nm_ctl.done);
+    nm_vect_free(&nm_ctl.finished, nm_mon_ctl_wait_free_cb);
+}
+
+int nm_mon_ctl_rebuild_fd(void)
+{
+    return nm_ctl.rebuild[0];
+}
+
+bool nm_mon_ctl_rebuild(void)
+{
+    return nm_mon_ctl_pipe_drain(nm_ctl.rebuild[0]);
+}
+
+int nm_mon_ctl_call(const char *request, struct json_object *args,
+        uint64_t timeout, struct json_object **reply)
+{
+    struct json_object *msg = NULL, *member = NULL;
+    nm_str_t buf = NM_INIT_STR;
+    uint64_t id, start;
+    int sd, rc = NM_ERR;
+
+    if (reply) {
+        *reply = NULL;
+    }
+
+    start = nm_mono_ms();
+    id = __atomic_add_fetch(&nm_ctl_req_id, 1, __ATOMIC_RELAXED);
+    nm_str_format(&buf, NM_MON_CTL_REQ, id, request,
+            args ? json_object_to_json_string_ext(args,
+                JSON_C_TO_STRING_PLAIN) : "{}");
+
+    if ((sd = nm_mon_ctl_connect()) == -1) {
+        nm_debug("%s: daemon is not running\n", __func__);
+        goto out;
+    }
+
+    if (write(sd, buf.data, buf.len) != (ssize_t) buf.len) {
+        nm_debug("%s: write error: %s\n", __func__, strerror(errno));
+        goto out;
+    }
+
+    if ((msg = nm_mon_ctl_recv(sd, id, start + timeout)) == NULL) {
+        nm_debug("%s: %s: no answer\n", __func__, request);
+        goto out;
+    }
+
+    if (json_object_object_get_ex(msg, "return", &member)) {
+        rc = NM_OK;
+    } else {
+        json_object_object_get_ex(msg, "error", &member);
+    }
+
+    nm_debug("%s: %s: %s in %" PRIu64 "ms\n", __func__, request,
+            json_object_to_json_string(member), nm_mono_ms() - start);
+
+    if (reply && member) {
+        *reply = json_object_get(member);
+    }
+
+out:
+    if (sd != -1) {
+        close(sd);
+    }
+    if (msg) {
+        json_object_put(msg);
+    }
+    if (args) {
+        json_object_put(args);
+    }
+    nm_str_free(&buf);
+
+    return rc;
+}
+
+static int nm_mon_ctl_pipe_open(int *fds)
+{
+    if (pipe(fds) != 0) {
+        return NM_ERR;
+    }
+
+    for (size_t n = 0; n < 2; n++) {
+        if (fcntl(fds[n], F_SETFL, O_NONBLOCK) == -1 ||
+                fcntl(fds[n], F_SETFD, FD_CLOEXEC) == -1) {
+            nm_mon_ctl_pipe_close(fds);
+            return NM_ERR;
+        }
+    }
+
+    return NM_OK;
+}
+
+static void nm_mon_ctl_pipe_close(int *fds)
+{
+    for (size_t n = 0; n < 2; n++) {
+        if (fds[n] != -1) {
+            close(fds[n]);
+            fds[n] = -1;
+        }
+    }
+}
+
+static bool nm_mon_ctl_pipe_drain(int fd)
+{
+    bool res = false;
+    char buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0) {
+        res = true;
+    }
+
+    return res;
+}
+
+static void nm_mon_ctl_wake(int fd)
+{
+    const char ch = 1;
+
+    /* full pipe is already readable */
+    if (write(fd, &ch, sizeof(ch)) == -1 && errno != EAGAIN) {
+        nm_debug("%s: write error: %s\n", __func__, strerror(errno));
+    }
+}
+
+static void nm_mon_ctl_accept(void)
+{
+    nm_mon_ctl_client_t cl = { -1, 0, NM_INIT_STR };
+
+    if ((cl.sd = accept(nm_ctl.sd, NULL, NULL)) == -1) {
+        return;
+    }
+
+    if (nm_ctl.clients.n_memb == NM_MON_MAX_CLIENTS ||
+            fcntl(cl.sd, F_SETFL, O_NONBLOCK) == -1) {
+        close(cl.sd);
+        return;
+    }
+
+    cl.serial = ++nm_ctl.serial;
+    nm_vect_insert(&nm_ctl.clients, &cl, sizeof(cl), NULL);
+}
+
+static void nm_mon_ctl_drop(size_t idx)
+{
+    nm_mon_ctl_client_t *cl = nm_vect_at(&nm_ctl.clients, idx);
+
+    close(cl->sd);
+    nm_str_free(&cl->rbuf);
+    nm_vect_delete(&nm_ctl.clients, idx, NULL);
+}
+
+static int nm_mon_ctl_read(nm_mon_ctl_client_t *cl)
+{
+    char chunk[1024];
+    ssize_t nread;
+    char *nl;
+
+    if ((nread = read(cl->sd, chunk, sizeof(chunk))) <= 0) {
+        return (nread < 0 && (errno == EAGAIN || errno == EINTR)) ?
+            NM_OK : NM_ERR;
+    }
+
+    nm_str_add_text_part(&cl->rbuf, chunk, nread);
+
+    while (cl->rbuf.len &&
+            (nl = memchr(cl->rbuf.data, '\n', cl->rbuf.len)) != NULL) {
+        size_t frame_len = nl - cl->rbuf.data + 1;
+        int rc;
+
+        *nl = '\0';
+        rc = nm_mon_ctl_handle(cl, cl->rbuf.data);
+
+        memmove(cl->rbuf.data, cl->rbuf.data + frame_len,
+                cl->rbuf.len - frame_len + 1);
+        cl->rbuf.len -= frame_len;
+
+        if (rc != NM_OK) {
+            return NM_ERR;
+        }
+    }
+
+    return (cl->rbuf.len > NM_MON_CTL_MAX_FRAME) ? NM_ERR : NM_OK;
+}
+
+/* returns NM_ERR if the client must be dropped */
+static int nm_mon_ctl_handle(nm_mon_ctl_client_t *cl, const char *frame)
+{
+    struct json_object *parsed, *js_id, *js_req, *args = NULL;
+    nm_str_t id = NM_INIT_STR;
+    nm_str_t ret = NM_INIT_STR;
+    const char *err = NULL;
+    const char *req;
+    int rc = NM_OK;
+
+    if ((parsed = json_tokener_parse(frame)) == NULL) {
+        nm_debug("%s: malformed request: %s\n", __func__, frame);
+        nm_str_format(&id, "null");
+        rc = nm_mon_ctl_send(cl->sd, &id, NULL, "malformed request");
+        nm_str_free(&id);
+        return rc;
+    }
+
+    if (json_object_object_get_ex(parsed, "id", &js_id)) {
+        nm_str_format(&id, "%s", json_object_to_json_string_ext(js_id,
+                    JSON_C_TO_STRING_PLAIN));
+    } else {
+        nm_str_format(&id, "null");
+    }
+
+    if (!json_object_object_get_ex(parsed, "request", &js_req)) {
+        err = "missing request";
+        goto out;
+    }
+    req = json_object_get_string(js_req);
+    json_object_object_get_ex(parsed, "arguments", &args);
+
+    if (nm_str_cmp_tt(req, "rebuild") == NM_OK) {
+        nm_mon_ctl_wake(nm_ctl.rebuild[1]);
+        nm_str_format(&ret, "{}");
+    } else if (nm_str_cmp_tt(req, "job") == NM_OK) {
+        err = nm_mon_ctl_job(cl, &id, args, &ret);
+    } else if (nm_str_cmp_tt(req, "db_profile") == NM_OK) {
+        err = nm_mon_ctl_db_profile(args, &ret);
+    } else {
+        err = "unknown request";
+    }
+
+out:
+    /* waited job is answered on completion */
+    if (err || ret.len) {
+        rc = nm_mon_ctl_send(cl->sd, &id, &ret, err);
+    }
+
+    json_object_put(parsed);
+    nm_str_free(&ret);
+    nm_str_free(&id);
+
+    return rc;
+}
+
+static const char *nm_mon_ctl_job(const nm_mon_ctl_client_t *cl,
+        const nm_str_t *id, struct json_object *args, nm_str_t *ret)
+{
+    struct json_object *cmd, *wait;
+    nm_mon_ctl_wait_t *w = NULL;
+    nm_str_t cmd_str = NM_INIT_STR;
+    nm_str_t jobid = NM_INIT_STR;
+    const char *err = NULL;
+    int rc;
+
+    if (!args || !json_object_object_get_ex(args, "command", &cmd)) {
+        return "missing command";
+    }
+
+    nm_str_format(&cmd_str, "%s",
+            json_object_to_json_string_ext(cmd, JSON_C_TO_STRING_PLAIN));
+
+    if (json_object_object_get_ex(args, "wait", &wait) &&
+            json_object_get_boolean(wait)) {
+        w = nm_calloc(1, sizeof(nm_mon_ctl_wait_t));
+        w->client = cl->serial;
+        nm_str_copy(&w->id, id);
+    }
+
+    rc = nm_mon_jobs_push(&cmd_str, &jobid,
+            w ? nm_mon_ctl_job_done : NULL, w);
+    if (rc != NM_OK) {
+        err = (rc == NM_MON_JOBS_FULL) ? "job queue is full" :
+            "job is not queued";
+        if (w) {
+            nm_mon_ctl_wait_free_cb(w);
+            free(w);
+        }
+    } else if (!w) {
+        nm_str_format(ret, NM_MON_CTL_JOB, jobid.data);
+    }
+
+    nm_str_free(&cmd_str);
+    nm_str_free(&jobid);
+
+    return err;
+}
+
+/* called by the job worker */
+static void nm_mon_ctl_job_done(int rc, const nm_str_t *jobid, void *ctx)
+{
+    nm_mon_ctl_wait_t *w = ctx;
+
+    w->rc = rc;
+    nm_str_copy(&w->jobid, jobid);
+
+    pthread_mutex_lock(&nm_ctl.mtx);
+    nm_vect_insert(&nm_ctl.finished, w, sizeof(nm_mon_ctl_wait_t), NULL);
+    pthread_mutex_unlock(&nm_ctl.mtx);
+    free(w);
+
+    nm_mon_ctl_wake(nm_ctl.done[1]);
+}
+
+static const char *nm_mon_ctl_db_profile(struct json_object *args,
+        nm_str_t *ret)
+{
+    struct json_object *js_reset, *js_ret;
+    nm_str_t report = NM_INIT_STR;
+    bool reset = false;
+
+    if (!nm_db_prof_enabled()) {
+        return "db_profile is not set";
+    }
+
+    if (args && json_object_object_get_ex(args, "reset", &js_reset)) {
+        reset = json_object_get_boolean(js_reset);
+    }
+
+    nm_db_prof_report(&report, reset);
+    js_ret = json_object_new_object();
+    json_object_object_add(js_ret, "report",
+            json_object_new_string(report.data));
+    nm_str_format(ret, "%s", json_object_to_json_string_ext(js_ret,
+                JSON_C_TO_STRING_PLAIN));
+
+    json_object_put(js_ret);
+    nm_str_free(&report);
+
+    return NULL;
+}
+
+static void nm_mon_ctl_finished(void)
+{
+    nm_vect_t done = NM_INIT_VECT;
+    nm_str_t ret = NM_INIT_STR;
+
+    nm_mon_ctl_pipe_drain(nm_ctl.done[0]);
+
+    pthread_mutex_lock(&nm_ctl.mtx);
+    done = nm_ctl.finished;
+    nm_ctl.finished = (nm_vect_t) NM_INIT_VECT;
+    pthread_mutex_unlock(&nm_ctl.mtx);
+
+    for (size_t n = 0; n < done.n_memb; n++) {
+        const nm_mon_ctl_wait_t *w = nm_vect_at(&done, n);
+
+        for (size_t c = 0; c < nm_ctl.clients.n_memb; c++) {
+            const nm_mon_ctl_client_t *cl = nm_vect_at(&nm_ctl.clients, c);
+
+            if (cl->serial != w->client) {
+                continue;
+            }
+
+            nm_str_format(&ret, NM_MON_CTL_JOB, w->jobid.data);
+            if (nm_mon_ctl_send(cl->sd, &w->id, &ret,
+                        (w->rc == NM_OK) ? NULL : "job failed") != NM_OK) {
+                nm_mon_ctl_drop(c);
+            }
+            break;
+        }
+    }
+
+    nm_vect_free(&done, nm_mon_ctl_wait_free_cb);
+    nm_str_free(&ret);
+}
+
+static int nm_mon_ctl_send(int sd, const nm_str_t *id,
+        const nm_str_t *ret, const char *err)
+{
+    nm_str_t msg = NM_INIT_STR;
+    int rc = NM_OK;
+
+    if (err) {
+        nm_str_format(&msg, NM_MON_CTL_ERR, id->data, err);
+    } else {
+        nm_str_format(&msg, NM_MON_CTL_RET, id->data, ret->data);
+    }
+
+    /* client that does not read its responses is dropped */
+    if (write(sd, msg.data, msg.len) != (ssize_t) msg.len) {
+        rc = NM_ERR;
+    }
+
+    nm_str_free(&msg);
+
+    return rc;
+}
+
+static void nm_mon_ctl_wait_free_cb(void *unit_p)
+{
+    nm_mon_ctl_wait_t *w = unit_p;
+
+    nm_str_free(&w->id);
+    nm_str_free(&w->jobid);
+}
+
+static int nm_mon_ctl_connect(void)
+{
+    const nm_str_t *path = &nm_cfg_get()->daemon_ctl;
+    struct sockaddr_un addr;
+    int sd;
+
+    if (path->len >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    nm_strlcpy(addr.sun_path, path->data, sizeof(addr.sun_path));
+
+    if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        return -1;
+    }
+
+    if (connect(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(sd);
+        return -1;
+    }
+
+    return sd;
+}
+
+/* wait for the response to request id */
+static struct json_object *nm_mon_ctl_recv(int sd, uint64_t id,
+        uint64_t deadline)
+{
+    struct json_object *msg = NULL;
+    nm_str_t buf = NM_INIT_STR;
+    char chunk[1024];
+
+    while (!msg) {
+        struct pollfd pfd = { .fd = sd, .events = POLLIN };
+        uint64_t now = nm_mono_ms();
+        ssize_t nread;
+        char *nl;
+        int rc;
+
+        if (now >= deadline) {
+            break;
+        }
+
+        if ((rc = poll(&pfd, 1, (int) (deadline - now))) < 0 &&
+                errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            break;
+        }
+
+        if ((nread = read(sd, chunk, sizeof(chunk))) <= 0) {
+            break;
+        }
+        nm_str_add_text_part(&buf, chunk, nread);
+
+        while (!msg && buf.len &&
+                (nl = memchr(buf.data, '\n', buf.len)) != NULL) {
+            size_t frame_len = nl - buf.data + 1;
+            struct json_object *parsed, *js_id;
+
+            *nl = '\0';
+            parsed = json_tokener_parse(buf.data);
+            if (parsed && json_object_object_get_ex(parsed, "id", &js_id) &&
+                    (uint64_t) json_object_get_int64(js_id) == id) {
+                msg = parsed;
+            } else if (parsed) {
+                json_object_put(parsed);
+            }
+
+            memmove(buf.data, buf.data + frame_len, buf.len - frame_len + 1);
+            buf.len -= frame_len;
+        }
+    }
+
+    nm_str_free(&buf);
+
+    return msg;
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,46 @@
+#ifndef NM_MON_CTL_H_
+#define NM_MON_CTL_H_
+
+#include <nm_string.h>
+#include <nm_mon_daemon.h>
+
+#include <stdint.h>
+
+#include <json.h>
+
+/*
+ * Daemon control socket. Each frame is one JSON object per line:
+ *   -> {"id": 1, "request": "job", "arguments": {...}}
+ *   <- {"id": 1, "return": {...}} or {"id": 1, "error": {"desc": "..."}}
+ *
+ * Requests:
+ *   "rebuild" - re-read VM list from the database.
+ *   "job"     - queue snapshot job, arguments: "command" (QMP command
+ *               with "job-id" argument) and optional "wait" (bool).
+ *               Returns {"job-id": "..."} once the job is queued, or
+ *               when it is finished if "wait" is true. Fails at once
+ *               with "job queue is full" if NM_MON_MAX_JOBS are waiting.
+ *   "db_profile" - SQL profile of the daemon and remote API, optional
+ *               argument "reset" (bool) clears the counters.
+ *               Returns {"report": "..."}.
+ */
+
+/* daemon side, socket is opened before the server thread is started */
+int nm_mon_ctl_open(void);
+void *nm_mon_ctl_server(void *ctx);
+void nm_mon_ctl_free(void);
+/* readable when the VM list must be rebuilt, see nm_mon_ctl_rebuild() */
+int nm_mon_ctl_rebuild_fd(void);
+bool nm_mon_ctl_rebuild(void);
+
+/*
+ * Send request and wait for the response, timeout is in milliseconds.
+ * args is released by the call. If reply is not NULL it gets "return"
+ * member on NM_OK, "error" member on NM_ERR or NULL if the daemon did
+ * not answer. The caller must release it.
+ */
+int nm_mon_ctl_call(const char *request, struct json_object *args,
+        uint64_t timeout, struct json_object **reply);
+
+#endif /* NM_MON_CTL_H_ */
+/* vim:set ts=4 sw=4: */
@@ -4,46 +4,69 @@
 #include <nm_core.h>
 #include <nm_dbus.h>
 #include <nm_utils.h>
+#include <nm_mon_ctl.h>
+#include <nm_mon_shm.h>
+#include <nm_mon_jobs.h>
+#include <nm_mon_live.h>
+#include <nm_mon_exporter.h>
 #include <nm_cfg_file.h>
 #include <nm_mon_daemon.h>
 #include <nm_remote_api.h>
 #include <nm_qmp_control.h>
+#include <nm_qmp_reactor.h>
 
 #include <sys/wait.h> /* waitpid(2) */
+#include <sys/resource.h> /* setrlimit(2) */
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <time.h> /* nanosleep(2) */
+#include <poll.h>
 #include <pthread.h>
 
-#if defined(NM_OS_DARWIN)
-#include <nm_sysv_queue.h>
-#include <nm_pthread_barrier.h>
-#else
-#include <mqueue.h>
-#endif
-
 #include <json.h>
 
-static volatile sig_atomic_t nm_mon_rebuild;
-
-static void nm_mon_check_vms(const nm_vect_t *mon_list);
-static void nm_mon_build_list(nm_vect_t *list, nm_vect_t *vms);
+static const char NM_MON_EVENT_FMT[] = "{\"name\":\"%s\",\"status\":%s}\n";
+
+/*
+ * Status change subscribers (nemu TUI instances).
+ * Accessed only from the daemon main thread.
+ */
+typedef struct nm_mon_notify {
+    int sd;
+    int clients[NM_MON_MAX_CLIENTS];
+    size_t n_clients;
+} nm_mon_notify_t;
+
+static nm_mon_notify_t nm_notify = { -1, { 0 }, 0 };
+
+static void nm_mon_check_vms(const nm_svect_t *mon_list);
+static void nm_mon_set_status(const nm_svect_t *mon_list,
+        size_t idx, bool running);
+static void nm_mon_qmp_events(const nm_svect_t *mon_list);
+static void nm_mon_sample_vms(const nm_svect_t *mon_list);
+static void nm_mon_load_ifaces(nm_mon_item_t *item);
+static void nm_mon_live_events(const nm_svect_t *mon_list);
+static pid_t nm_mon_vm_pid(const char *name);
+static int nm_mon_notify_open(void);
+static void nm_mon_notify_accept(const nm_svect_t *mon_list);
+static void nm_mon_notify_drop(size_t idx);
+static int nm_mon_notify_send(int sd, const char *name, int8_t status);
+static void nm_mon_notify_broadcast(const char *name, int8_t status);
+static bool nm_mon_update_list(nm_svect_t *list, nm_vect_t *vms);
+static void nm_mon_drop_item(const nm_svect_t *list, size_t idx);
+static void nm_mon_item_free_cb(void *unit_p);
 static void nm_mon_signals_handler(int signal);
 static int nm_mon_store_pid(void);
 
-typedef struct nm_qmp_w_data {
-    nm_str_t *cmd;
-    pthread_barrier_t *barrier;
-} nm_qmp_w_data_t;
-
 typedef struct nm_clean_data {
     nm_mon_vms_t vms;
     nm_vect_t *vm_list;
-    pthread_t *qmp_worker;
+    pthread_t *ctl_server;
     pthread_t *api_server;
-    nm_thr_ctrl_t qmp_ctrl;
+    nm_thr_ctrl_t ctl_ctrl;
     nm_thr_ctrl_t api_ctrl;
 } nm_clean_data_t;
 
-#define NM_QMP_W_INIT (nm_qmp_w_data_t) { NULL, NULL }
 #define NM_CLEAN_INIT (nm_clean_data_t) \
     { NM_MON_VMS_INIT, NULL, NULL, NULL, NM_THR_CTRL_INIT, NM_THR_CTRL_INIT }
 
@@ -59,11 +82,15 @@ static void nm_mon_cleanup(void)
         return;
     }
 
-    nm_vect_free(clean_ptr->vms.list, NULL);
+    nm_svect_free(clean_ptr->vms.list, nm_mon_item_free_cb);
     nm_vect_free(clean_ptr->vm_list, nm_str_vect_free_cb);
 
-    clean_ptr->qmp_ctrl.stop = true;
-    pthread_join(*clean_ptr->qmp_worker, NULL);
+    /* refuse jobs from clients served until the server stops */
+    nm_mon_jobs_stop();
+    if (clean_ptr->ctl_server) {
+        clean_ptr->ctl_ctrl.stop = true;
+        pthread_join(*clean_ptr->ctl_server, NULL);
+    }
 #if defined (NM_WITH_REMOTE)
     if (cfg->api_server) {
         clean_ptr->api_ctrl.stop = true;
@@ -71,181 +98,26 @@ static void nm_mon_cleanup(void)
     }
 #endif
 
-    if (unlink(cfg->daemon_pid.data) != 0) {
-        nm_debug("error delete mon daemon pidfile\n");
-    }
-    nm_exit_core();
-}
-
-void *nm_qmp_worker(void *data)
-{
-    struct json_object *parsed, *args, *jobid;
-    nm_str_t jobid_copy = NM_INIT_STR;
-    nm_str_t vmname = NM_INIT_STR;
-    nm_qmp_w_data_t *arg = data;
-    nm_str_t cmd = NM_INIT_STR;
-    const char *jobid_str;
-    char *name_start;
-
-    nm_str_copy(&cmd, arg->cmd);
-    pthread_barrier_wait(arg->barrier);
-
-    pthread_detach(pthread_self());
-
-    parsed = json_tokener_parse(cmd.data);
-
-    if (!parsed) {
-        nm_debug("%s: cannot parse json\n", __func__);
-        pthread_exit(NULL);
-    }
-    json_object_object_get_ex(parsed, "arguments", &args);
-    json_object_object_get_ex(args, "job-id", &jobid);
-
-    if (!args || !jobid) {
-        nm_debug("%s: malformed json\n", __func__);
-        pthread_exit(NULL);
-    }
-    jobid_str = json_object_get_string(jobid);
-
-    /*
-     *  Get VM name from job-id
-     *  input string example: vmdel-vmname-2021-05-27-15-14-12-tVusSMWY
-     */
-    nm_str_format(&jobid_copy, "%s", jobid_str);
-
-    /*
-     *  Cut job-id, we have 7 dashes in UID.
-     *  input:  vmdel-vmname-2021-05-27-15-14-12-tVusSMWY
-     *                      <----<--<--<--<--<--<--------
-     *                      7    6  5  4  3  2  1
-     *  result: vmdel-vmname
-     */
-    for (size_t sep = 0; sep < 7; sep++) {
-        char *dash = strrchr(jobid_copy.data, '-');
-
-        if (dash) {
-            *dash = '\0';
-        } else {
-            break;
-        }
-    }
-
-    /*
-     *  Cut VM name:
-     *  input:  vmdel-vmname
-     *          ----->
-     *  result: -vmname
-     */
-    name_start = strchr(jobid_copy.data, '-');
-    if (!name_start) {
-        nm_debug("%s: error get VM name from job-id\n", __func__);
-        pthread_exit(NULL);
-    }
-
-    name_start++; /* skip dash */
-    nm_str_format(&vmname, "%s", name_start);
-
-    nm_qmp_vm_exec_async(&vmname, cmd.data, jobid_str);
-
-    json_object_put(parsed);
-
-    nm_str_free(&cmd);
-    nm_str_free(&vmname);
-    nm_str_free(&jobid_copy);
-
-    pthread_exit(NULL);
-}
-
-void *nm_qmp_dispatcher(void *ctx)
-{
-    const nm_cfg_t *cfg = nm_cfg_get();
-    nm_thr_ctrl_t *args = ctx;
-    FILE *log;
-#if !defined(NM_OS_DARWIN)
-    struct mq_attr mq_attr;
-    char *msg = NULL;
-    mqd_t mq;
-#endif
-
-    if ((log = fopen(cfg->log_path.data, "w")) == NULL) {
-        pthread_exit(NULL);
-    }
-
-#if !defined(NM_OS_DARWIN)
-    if ((mq = mq_open(NM_MQ_PATH, O_RDWR | O_CREAT,
-                    0600, NULL)) == (mqd_t) -1) {
-        fprintf(log, "%s:cannot open mq: %s\n", __func__, strerror(errno));
-        fflush(log);
-        pthread_exit(NULL);
+    /* running jobs fail once the reactor is stopped */
+    nm_qmp_reactor_stop();
+    nm_mon_jobs_free();
+    nm_mon_ctl_free();
+    nm_mon_exporter_close();
+    nm_mon_live_free();
+    nm_mon_metrics_links_free();
+    nm_mon_shm_destroy();
+    while (nm_notify.n_clients) {
+        nm_mon_notify_drop(0);
     }
-
-    memset(&mq_attr, 0, sizeof(mq_attr));
-    if (mq_getattr(mq, &mq_attr) == -1) {
-        fprintf(log, "%s:cannot get mq attrs: %s\n", __func__, strerror(errno));
-        goto out;
+    if (nm_notify.sd != -1) {
+        close(nm_notify.sd);
+        unlink(cfg->daemon_sock.data);
     }
 
-    msg = nm_calloc(1, mq_attr.mq_msgsize + 1);
-#endif
-
-    while (!args->stop) {
-#if !defined(NM_OS_DARWIN)
-        struct timespec ts;
-        ssize_t rcv_len;
-        memset(msg, 0, mq_attr.mq_msgsize + 1);
-        memset(&ts, 0, sizeof(ts));
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec += 1;
-
-        rcv_len = mq_timedreceive(mq, msg, mq_attr.mq_msgsize, NULL, &ts);
-        if (rcv_len > 0) {
-            nm_str_t cmd = NM_INIT_STR;
-#else
-        nm_str_t cmd = NM_INIT_STR;
-
-        if (nm_sysv_queue_recv(&cmd)) {
-#endif
-            nm_qmp_w_data_t data = NM_QMP_W_INIT;
-            pthread_barrier_t barr;
-            pthread_t thr;
-
-            if (pthread_barrier_init(&barr, NULL, 2) != 0) {
-                fprintf(log, "%s:cannot init barrier\n", __func__);
-                fflush(log);
-            }
-
-            data.barrier = &barr;
-            data.cmd = &cmd;
-
-#if !defined(NM_OS_DARWIN)
-            nm_str_format(&cmd, "%s", msg);
-#endif
-
-            if (pthread_create(&thr, NULL, nm_qmp_worker, &data) != 0) {
-                nm_exit(EXIT_FAILURE);
-            }
-#if defined(NM_OS_LINUX)
-            pthread_setname_np(thr, "nemu-qmp-worker");
-#endif
-            pthread_barrier_wait(&barr);
-            pthread_barrier_destroy(&barr);
-            nm_str_free(&cmd);
-#if defined(NM_OS_DARWIN)
-        } else {
-            usleep(1000000); /* 1 sec */
-        }
-#else
-        }
-#endif /* NM_OS_DARWIN */
+    if (unlink(cfg->daemon_pid.data) != 0) {
+        nm_debug("error delete mon daemon pidfile\n");
     }
-
-#if !defined(NM_OS_DARWIN)
-out:
-    free(msg);
-    mq_close(mq);
-#endif
-    fclose(log);
-    pthread_exit(NULL);
+    nm_exit_core();
 }
 
 static bool nm_mon_check_version(pid_t *opid)
@@ -371,47 +243,8 @@ void nm_mon_start(void)
 
 void nm_mon_ping(void)
 {
-    pid_t pid;
-    int fd;
-    struct stat info;
-    const char *path = nm_cfg_get()->daemon_pid.data;
-    char *buf, *nl;
-
-    memset(&info, 0x0, sizeof(info));
-
-    if ((stat(path, &info) == -1) || (!info.st_size)) {
-        return;
-    }
-
-    buf = nm_calloc(1, info.st_size + 1);
-    fd = open(path, O_RDONLY);
-    if (fd == -1) {
-        nm_debug("%s: error open pid file: %s: %s",
-                __func__, path, strerror(errno));
-        free(buf);
-        return;
-    }
-
-    if (read(fd, buf, info.st_size) < 0) {
-        nm_debug("%s: error read pid file: %s: %s",
-                __func__, path, strerror(errno));
-        goto out;
-    }
-
-    if ((nl = strchr(buf, '\n')) != NULL) {
-        /* nEMU >= 3.0.0, cut version number */
-        *nl = '\0';
-    }
-
-    pid = nm_str_ttoul(buf, 10);
-
-    if (kill(pid, SIGUSR1) < 0) {
-        nm_debug("%s: error send signal to pid %d: %s",
-                __func__, pid, strerror(errno));
-    }
-out:
-    close(fd);
-    free(buf);
+    /* the daemon answers when the rebuild is scheduled */
+    nm_mon_ctl_call("rebuild", NULL, NM_MON_PING_TIMEOUT, NULL);
 }
 
 void nm_mon_loop(void)
@@ -420,12 +253,15 @@ void nm_mon_loop(void)
     nm_api_ctx_t api_ctx = NM_API_CTX_INIT;
 #endif
     nm_clean_data_t clean = NM_CLEAN_INIT;
-    nm_vect_t mon_list = NM_INIT_VECT;
+    nm_svect_t mon_list = NM_INIT_SVECT(nm_mon_item_t);
     nm_vect_t vm_list = NM_INIT_VECT;
-    pthread_t qmp_thr, api_srv;
+    pthread_t ctl_thr, api_srv;
     const nm_cfg_t *cfg;
     struct sigaction sa;
-    struct timespec ts;
+    struct rlimit rl;
+    uint64_t next_check, next_sample, next_sweep = 0;
+    bool rebuild = false;
+    bool live;
     pid_t pid;
 
     nm_cfg_init(false);
@@ -460,7 +296,6 @@ void nm_mon_loop(void)
 
     clean.vms.list = &mon_list;
     clean.vm_list = &vm_list;
-    clean.qmp_worker = &qmp_thr;
     clean.api_server = &api_srv;
 
     if (atexit(nm_mon_cleanup) != 0) {
@@ -475,25 +310,55 @@ void nm_mon_loop(void)
     sigemptyset(&sa.sa_mask);
     sa.sa_flags = 0;
     sa.sa_handler = nm_mon_signals_handler;
-    sigaction(SIGUSR1, &sa, NULL);
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
-
-    ts.tv_sec = cfg->daemon_sleep / 1000;
-    ts.tv_nsec = (cfg->daemon_sleep % 1000) * 1e+6;
+    signal(SIGPIPE, SIG_IGN);
 
     if (nm_mon_store_pid() != NM_OK) {
         nm_exit(EXIT_FAILURE);
     }
 
-    nm_db_init();
-    nm_mon_build_list(&mon_list, &vm_list);
-    if (pthread_create(&qmp_thr, NULL,
-                nm_qmp_dispatcher, &clean.qmp_ctrl) != 0) {
+    /* procfs files of every QEMU thread are kept open for sampling */
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+            nm_debug("%s: setrlimit error: %s\n", __func__, strerror(errno));
+        }
+    }
+
+    if (nm_mon_notify_open() != NM_OK) {
+        nm_debug("%s: status notifications disabled\n", __func__);
+    }
+
+    nm_db_init(NM_DB_RO);
+    nm_mon_update_list(&mon_list, &vm_list);
+    if ((live = (nm_mon_live_init() == NM_OK))) {
+        nm_mon_live_sync(&mon_list);
+    } else {
+        nm_debug("%s: liveness engine is not available\n", __func__);
+    }
+    if (nm_mon_shm_create(&mon_list) != NM_OK) {
+        nm_debug("%s: status table is not available\n", __func__);
+    }
+    nm_qmp_reactor_start();
+    nm_mon_jobs_start(cfg->daemon_workers);
+    if (nm_mon_ctl_open() != NM_OK) {
+        nm_exit(EXIT_FAILURE);
+    }
+    if (cfg->daemon_exporter.len) {
+        if (nm_mon_exporter_open() == NM_OK) {
+            nm_mon_exporter_sync(&mon_list);
+        } else {
+            nm_debug("%s: exporter is not available\n", __func__);
+        }
+    }
+    if (pthread_create(&ctl_thr, NULL,
+                nm_mon_ctl_server, &clean.ctl_ctrl) != 0) {
         nm_exit(EXIT_FAILURE);
     }
+    clean.ctl_server = &ctl_thr;
 #if defined (NM_OS_LINUX)
-    pthread_setname_np(qmp_thr, "nemu-qmp-dsp");
+    pthread_setname_np(ctl_thr, "nemu-ctl");
 #endif
 
 #if defined (NM_WITH_REMOTE)
@@ -509,68 +374,604 @@ void nm_mon_loop(void)
     }
 #endif /* NM_WITH_REMOTE */
 
+    next_check = next_sample = nm_mono_ms();
+
     for (;;) {
-        if (nm_mon_rebuild) {
+        struct pollfd fds[NM_MON_MAX_CLIENTS + NM_MON_EXP_CLIENTS + 5];
+        uint64_t now;
+        nfds_t nfds = 0;
+        int rc, timeout;
+
+        if (rebuild) {
+            bool changed;
+
             pthread_mutex_lock(&clean.vms.mtx);
-            nm_mon_build_list(&mon_list, &vm_list);
+            changed = nm_mon_update_list(&mon_list, &vm_list);
             pthread_mutex_unlock(&clean.vms.mtx);
-            nm_mon_rebuild = 0;
+            if (changed) {
+                nm_mon_shm_create(&mon_list);
+                nm_mon_live_sync(&mon_list);
+                nm_mon_exporter_sync(&mon_list);
+                next_check = next_sweep = nm_mono_ms();
+            }
+            rebuild = false;
         }
-        nm_mon_check_vms(&mon_list);
-        nanosleep(&ts, NULL);
+
+        now = nm_mono_ms();
+        if (now >= next_check) {
+            /* status changes are reported by the liveness engine */
+            if (!live || now >= next_sweep) {
+                nm_mon_check_vms(&mon_list);
+                next_sweep = now + NM_MON_SWEEP;
+            }
+            nm_mon_shm_heartbeat();
+            next_check = now + cfg->daemon_sleep;
+        }
+
+        if (now >= next_sample) {
+            nm_mon_sample_vms(&mon_list);
+            next_sample += NM_METRICS_INTERVAL;
+            /* do not try to catch up after a long stall */
+            if (next_sample <= now) {
+                next_sample = now + NM_METRICS_INTERVAL;
+            }
+        }
+
+        if (nm_notify.sd != -1) {
+            fds[nfds].fd = nm_notify.sd;
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        for (size_t n = 0; n < nm_notify.n_clients; n++) {
+            fds[nfds].fd = nm_notify.clients[n];
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        /* QMP sessions are served by the reactor thread */
+        fds[nfds].fd = nm_qmp_event_fd();
+        fds[nfds].events = POLLIN;
+        nfds++;
+        /* VM list rebuild requested on the control socket */
+        fds[nfds].fd = nm_mon_ctl_rebuild_fd();
+        fds[nfds].events = POLLIN;
+        nfds++;
+        if (live) {
+            fds[nfds].fd = nm_mon_live_fd();
+            fds[nfds].events = POLLIN;
+            nfds++;
+        }
+        /* metrics scrapes */
+        nfds += nm_mon_exporter_fds(fds + nfds);
+
+        /* sleep until the next heartbeat, sample or liveness retry */
+        timeout = (int) (((next_check < next_sample) ?
+                    next_check : next_sample) - now);
+        if (live && nm_mon_live_timeout() != -1 &&
+                nm_mon_live_timeout() < timeout) {
+            timeout = nm_mon_live_timeout();
+        }
+
+        rc = poll(fds, nfds, timeout);
+        if (rc < 0 && errno != EINTR) {
+            nm_debug("%s: poll error: %s\n", __func__, strerror(errno));
+        }
+
+        /* walk backwards, nm_mon_notify_drop() shifts the tail */
+        for (size_t n = nfds; rc > 0 && n > 0; n--) {
+            struct pollfd *pfd = &fds[n - 1];
+            char buf[64];
+
+            if (!pfd->revents) {
+                continue;
+            }
+
+            if (nm_mon_exporter_io(pfd, &mon_list)) {
+                continue;
+            }
+
+            if (pfd->fd == nm_qmp_event_fd() || pfd->fd == nm_mon_live_fd()) {
+                continue;
+            }
+
+            if (pfd->fd == nm_mon_ctl_rebuild_fd()) {
+                rebuild = nm_mon_ctl_rebuild();
+                continue;
+            }
+
+            if (pfd->fd == nm_notify.sd) {
+                nm_mon_notify_accept(&mon_list);
+                continue;
+            }
+
+            /* subscribers do not send anything, readable means hangup */
+            if (read(pfd->fd, buf, sizeof(buf)) <= 0 ||
+                    (pfd->revents & (POLLERR | POLLHUP | POLLNVAL))) {
+                nm_mon_notify_drop(n - 1 - (nm_notify.sd != -1));
+            }
+        }
+
+        nm_mon_qmp_events(&mon_list);
+        nm_mon_live_events(&mon_list);
     }
 }
 
-static void nm_mon_check_vms(const nm_vect_t *mon_list)
+static void nm_mon_check_vms(const nm_svect_t *mon_list)
 {
-    nm_str_t body = NM_INIT_STR;
-
     for (size_t n = 0; n < mon_list->n_memb; n++) {
-        char *name = nm_mon_item_get_name_cstr(mon_list, n);
-        int8_t status = nm_mon_item_get_status(mon_list, n);
+        nm_mon_set_status(mon_list, n, nm_qmp_test_socket(
+                    nm_mon_item_get_name(mon_list, n)) == NM_OK);
+    }
+}
 
-        if (nm_qmp_test_socket(nm_mon_item_get_name(mon_list, n)) == NM_OK) {
-            if (!status) {
-                nm_str_format(&body, "%s started", name);
+static void nm_mon_set_status(const nm_svect_t *mon_list,
+        size_t idx, bool running)
+{
+    nm_mon_item_t *item = nm_svect_at(mon_list, idx);
+    char *name = nm_mon_item_get_name_cstr(mon_list, idx);
+    int8_t status = nm_mon_item_get_status(mon_list, idx);
+    nm_str_t body = NM_INIT_STR;
+
+    if (running) {
+        if (!status) {
+            nm_str_format(&body, "%s started", name);
 #if defined (NM_WITH_DBUS)
-                nm_dbus_send_notify("VM status changed:", body.data);
+            nm_dbus_send_notify("VM status changed:", body.data);
 #endif
-            }
-            nm_mon_item_set_status(mon_list, n, NM_TRUE);
-        } else {
-            if (status == 1) {
-                nm_str_format(&body, "%s stopped", name);
+        }
+        nm_mon_item_set_status(mon_list, idx, NM_TRUE);
+        if (status != NM_TRUE) {
+            pid_t pid = nm_mon_vm_pid(name);
+
+            item->proc = nm_mon_metrics_open(pid);
+            nm_mon_load_ifaces(item);
+            nm_mon_shm_update(idx, NM_TRUE, pid);
+            nm_mon_live_track(nm_mon_item_get_name(mon_list, idx), pid);
+            nm_mon_notify_broadcast(name, NM_TRUE);
+            /* subscribe to VM events */
+            nm_qmp_subscribe(nm_mon_item_get_name(mon_list, idx));
+            nm_mon_metrics_vcpus(nm_mon_item_get_name(mon_list, idx), pid);
+        }
+    } else {
+        if (status == 1) {
+            nm_str_format(&body, "%s stopped", name);
 #if defined (NM_WITH_DBUS)
-                nm_dbus_send_notify("VM status changed:", body.data);
+            nm_dbus_send_notify("VM status changed:", body.data);
 #endif
+        }
+        nm_mon_item_set_status(mon_list, idx, NM_FALSE);
+        if (status != NM_FALSE) {
+            nm_qmp_sess_drop(nm_mon_item_get_name(mon_list, idx));
+            nm_mon_live_untrack(nm_mon_item_get_name(mon_list, idx));
+            nm_mon_metrics_close(item->proc);
+            item->proc = NULL;
+            nm_mon_shm_update(idx, NM_FALSE, 0);
+            nm_mon_notify_broadcast(name, NM_FALSE);
+        }
+    }
+    nm_str_free(&body);
+}
+
+/* add resource usage samples of running VMs to the status table */
+static void nm_mon_sample_vms(const nm_svect_t *mon_list)
+{
+    bool links = false;
+
+    for (size_t n = 0; n < mon_list->n_memb; n++) {
+        const nm_mon_item_t *item = nm_svect_at(mon_list, n);
+        nm_metrics_thread_t threads[NM_METRICS_THREADS];
+        nm_metrics_drive_t drives[NM_METRICS_DRIVES];
+        nm_metrics_iface_t ifaces[NM_METRICS_IFACES];
+        nm_metrics_sample_t sample;
+        size_t count;
+
+        if (item->state != NM_TRUE || !item->proc) {
+            continue;
+        }
+
+        /* one netlink dump covers interfaces of all VMs */
+        if (!links) {
+            nm_mon_metrics_links();
+            links = true;
+        }
+
+        if (nm_mon_metrics_sample(item->proc, &sample) == NM_OK) {
+            count = nm_mon_metrics_threads(item->proc,
+                    threads, NM_METRICS_THREADS);
+            nm_mon_shm_push_sample(n, &sample, threads, count);
+        }
+
+        /* reply comes later, rates are published on the next sample */
+        count = nm_mon_metrics_drives(item->proc, drives, NM_METRICS_DRIVES);
+        nm_mon_shm_set_drives(n, drives, count);
+        nm_mon_metrics_blockstats(item->name, item->proc);
+
+        count = nm_mon_metrics_ifaces(item->proc, ifaces, NM_METRICS_IFACES);
+        nm_mon_shm_set_ifaces(n, ifaces, count);
+    }
+}
+
+/* host interfaces of the running VM */
+static void nm_mon_load_ifaces(nm_mon_item_t *item)
+{
+    nm_str_t query = NM_INIT_STR;
+    nm_vect_t ifs = NM_INIT_VECT;
+
+    if (!item->proc) {
+        return;
+    }
+
+    nm_str_format(&query, NM_SQL_IFACES_SELECT_NAMES, item->name->data);
+    nm_db_select(query.data, &ifs);
+    nm_mon_metrics_set_ifaces(item->proc, &ifs);
+
+    nm_vect_free(&ifs, nm_str_vect_free_cb);
+    nm_str_free(&query);
+}
+
+/* apply VM events received from QEMU */
+static void nm_mon_qmp_events(const nm_svect_t *mon_list)
+{
+    nm_qmp_event_t ev = NM_INIT_QMP_EVENT;
+
+    while (nm_qmp_event_next(&ev) == NM_OK) {
+        for (size_t n = 0; n < mon_list->n_memb; n++) {
+            if (nm_str_cmp_ss(nm_mon_item_get_name(mon_list, n),
+                        &ev.name) != NM_OK) {
+                continue;
+            }
+
+            switch (ev.id) {
+            case NM_QMP_EV_STOP:
+                nm_mon_shm_set_paused(n, true);
+                break;
+            case NM_QMP_EV_RESUME:
+                nm_mon_shm_set_paused(n, false);
+                break;
+            case NM_QMP_EV_SHUTDOWN:
+            case NM_QMP_EV_CLOSED:
+                nm_mon_set_status(mon_list, n, false);
+                break;
             }
-            nm_mon_item_set_status(mon_list, n, NM_FALSE);
+            break;
         }
-        nm_str_free(&body);
+        nm_str_free(&ev.name);
     }
 }
 
-static void nm_mon_build_list(nm_vect_t *list, nm_vect_t *vms)
+/* apply VM state changes found by the liveness engine */
+static void nm_mon_live_events(const nm_svect_t *mon_list)
 {
-    nm_vect_free(list, NULL);
-    nm_vect_free(vms, nm_str_vect_free_cb);
+    nm_live_event_t ev = NM_INIT_LIVE_EVENT;
+
+    while (nm_mon_live_next(&ev) == NM_OK) {
+        for (size_t n = 0; n < mon_list->n_memb; n++) {
+            bool running;
+
+            if (nm_str_cmp_ss(nm_mon_item_get_name(mon_list, n),
+                        &ev.name) != NM_OK) {
+                continue;
+            }
+
+            if (ev.id == NM_LIVE_EV_EXIT) {
+                nm_mon_set_status(mon_list, n, false);
+                break;
+            }
+
+            running = (nm_qmp_test_socket(&ev.name) == NM_OK);
+            nm_mon_set_status(mon_list, n, running);
+            /* QEMU has written pid file, but QMP socket is not ready */
+            if (!running && nm_mon_vm_pid(ev.name.data) > 0) {
+                nm_mon_live_retry(&ev.name);
+            }
+            break;
+        }
+        nm_str_free(&ev.name);
+    }
+}
+
+static pid_t nm_mon_vm_pid(const char *name)
+{
+    nm_str_t path = NM_INIT_STR;
+    char buf[16] = {0};
+    pid_t pid = 0;
+    int fd;
+
+    nm_str_format(&path, "%s/%s/%s",
+            nm_cfg_get()->vm_dir.data, name, NM_VM_PID_FILE);
+
+    if ((fd = open(path.data, O_RDONLY)) != -1) {
+        if (read(fd, buf, sizeof(buf) - 1) > 0) {
+            pid = atoi(buf);
+        }
+        close(fd);
+    }
+
+    nm_str_free(&path);
+
+    return pid;
+}
+
+static int nm_mon_notify_open(void)
+{
+    const nm_str_t *path = &nm_cfg_get()->daemon_sock;
+    struct sockaddr_un addr;
+    int sd;
+
+    if (path->len >= sizeof(addr.sun_path)) {
+        nm_debug("%s: socket path too long: %s\n", __func__, path->data);
+        return NM_ERR;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    nm_strlcpy(addr.sun_path, path->data, sizeof(addr.sun_path));
+
+    if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        nm_debug("%s: socket error: %s\n", __func__, strerror(errno));
+        return NM_ERR;
+    }
+
+    /* stale socket from the killed daemon */
+    unlink(path->data);
+
+    if (bind(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        nm_debug("%s: bind error: %s\n", __func__, strerror(errno));
+        close(sd);
+        return NM_ERR;
+    }
+
+    if (chmod(path->data, S_IRUSR | S_IWUSR) != 0 ||
+            listen(sd, NM_MON_MAX_CLIENTS) != 0 ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1) {
+        nm_debug("%s: setup error: %s\n", __func__, strerror(errno));
+        close(sd);
+        unlink(path->data);
+        return NM_ERR;
+    }
+
+    nm_notify.sd = sd;
+
+    return NM_OK;
+}
+
+static void nm_mon_notify_accept(const nm_svect_t *mon_list)
+{
+    int sd;
+
+    if ((sd = accept(nm_notify.sd, NULL, NULL)) == -1) {
+        return;
+    }
+
+    if (nm_notify.n_clients == NM_MON_MAX_CLIENTS ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1) {
+        close(sd);
+        return;
+    }
+
+    /* send current state, then only changes */
+    for (size_t n = 0; n < mon_list->n_memb; n++) {
+        int8_t status = nm_mon_item_get_status(mon_list, n);
+
+        if (status == -1) {
+            continue;
+        }
+
+        if (nm_mon_notify_send(sd,
+                    nm_mon_item_get_name_cstr(mon_list, n), status) != NM_OK) {
+            close(sd);
+            return;
+        }
+    }
+
+    nm_notify.clients[nm_notify.n_clients++] = sd;
+}
+
+static void nm_mon_notify_drop(size_t idx)
+{
+    close(nm_notify.clients[idx]);
+    nm_notify.n_clients--;
+    memmove(nm_notify.clients + idx, nm_notify.clients + idx + 1,
+            (nm_notify.n_clients - idx) * sizeof(int));
+}
+
+static int nm_mon_notify_send(int sd, const char *name, int8_t status)
+{
+    nm_str_t msg = NM_INIT_STR;
+    int rc = NM_OK;
+
+    nm_str_format(&msg, NM_MON_EVENT_FMT, name,
+            (status == NM_TRUE) ? "true" : "false");
+
+    /*
+     * Socket is non-blocking: a subscriber that does not drain
+     * its queue is dropped, it will get full state on reconnect.
+     */
+    if (write(sd, msg.data, msg.len) != (ssize_t) msg.len) {
+        rc = NM_ERR;
+    }
+
+    nm_str_free(&msg);
+
+    return rc;
+}
+
+static void nm_mon_notify_broadcast(const char *name, int8_t status)
+{
+    for (size_t n = nm_notify.n_clients; n > 0; n--) {
+        if (nm_mon_notify_send(nm_notify.clients[n - 1],
+                    name, status) != NM_OK) {
+            nm_mon_notify_drop(n - 1);
+        }
+    }
+}
+
+int nm_mon_subscribe(void)
+{
+    const nm_str_t *path = &nm_cfg_get()->daemon_sock;
+    struct sockaddr_un addr;
+    int sd;
+
+    if (path->len >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    nm_strlcpy(addr.sun_path, path->data, sizeof(addr.sun_path));
+
+    if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        return -1;
+    }
+
+    if (connect(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1) {
+        close(sd);
+        return -1;
+    }
+
+    return sd;
+}
+
+int nm_mon_event_recv(int sd, nm_str_t *buf)
+{
+    char chunk[1024];
+    ssize_t nread;
+
+    for (;;) {
+        nread = read(sd, chunk, sizeof(chunk));
 
-    nm_db_select(NM_SQL_VMS_SELECT_NAMES, vms);
+        if (nread > 0) {
+            nm_str_add_text_part(buf, chunk, nread);
+            continue;
+        }
+
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
 
-    for (size_t n = 0; n < vms->n_memb; n++) {
+        if (nread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return NM_OK;
+        }
+
+        /* EOF or error: daemon has gone */
+        return NM_ERR;
+    }
+}
+
+int nm_mon_event_next(nm_str_t *buf, nm_str_t *name, int *status)
+{
+    struct json_object *parsed, *js_name, *js_status;
+    char *nl;
+    int rc = NM_ERR;
+
+    while (buf->len && (nl = memchr(buf->data, '\n', buf->len)) != NULL) {
+        size_t line_len = nl - buf->data + 1;
+
+        *nl = '\0';
+        parsed = json_tokener_parse(buf->data);
+        if (parsed &&
+                json_object_object_get_ex(parsed, "name", &js_name) &&
+                json_object_object_get_ex(parsed, "status", &js_status)) {
+            nm_str_format(name, "%s", json_object_get_string(js_name));
+            *status = json_object_get_boolean(js_status);
+            rc = NM_OK;
+        } else {
+            nm_debug("%s: malformed event: %s\n", __func__, buf->data);
+        }
+        if (parsed) {
+            json_object_put(parsed);
+        }
+
+        memmove(buf->data, buf->data + line_len, buf->len - line_len + 1);
+        buf->len -= line_len;
+
+        if (rc == NM_OK) {
+            break;
+        }
+    }
+
+    return rc;
+}
+
+/*
+ * Sync VM list with the database. Both lists are sorted by name,
+ * entries of remaining VMs keep their status, so only added VMs
+ * are reported as started. Returns true if the list was changed.
+ */
+static bool nm_mon_update_list(nm_svect_t *list, nm_vect_t *vms)
+{
+    nm_svect_t new_list = NM_INIT_SVECT(nm_mon_item_t);
+    nm_vect_t new_vms = NM_INIT_VECT;
+    bool changed;
+    size_t old = 0;
+
+    nm_db_stmt_select(nm_db_stmt(NM_STMT_VMS_SELECT_NAMES), &new_vms);
+    changed = (new_vms.n_memb != list->n_memb);
+    nm_svect_reserve(&new_list, new_vms.n_memb);
+
+    for (size_t n = 0; n < new_vms.n_memb; n++) {
+        const char *name = nm_vect_str_ctx(&new_vms, n);
         nm_mon_item_t item = NM_ITEM_INIT;
+        int cmp = 1;
+
+        while (old < list->n_memb && (cmp = strcmp(
+                        nm_mon_item_get_name_cstr(list, old), name)) < 0) {
+            nm_mon_drop_item(list, old++);
+            changed = true;
+        }
 
-        item.name = nm_vect_str(vms, n);
-        nm_vect_insert(list, &item, sizeof(nm_mon_item_t), NULL);
+        if (old < list->n_memb && !cmp) {
+            item.state = nm_mon_item_get_status(list, old);
+            item.proc = ((nm_mon_item_t *) nm_svect_at(list, old++))->proc;
+        } else {
+            changed = true;
+        }
+
+        item.name = nm_vect_str(&new_vms, n);
+        nm_svect_append(&new_list, &item, 1);
     }
+
+    while (old < list->n_memb) {
+        nm_mon_drop_item(list, old++);
+        changed = true;
+    }
+
+    if (!changed) {
+        nm_svect_free(&new_list, NULL);
+        nm_vect_free(&new_vms, nm_str_vect_free_cb);
+        return false;
+    }
+
+    nm_svect_free(list, NULL);
+    nm_vect_free(vms, nm_str_vect_free_cb);
+    *list = new_list;
+    *vms = new_vms;
+
+    return true;
+}
+
+/* VM was removed or renamed */
+static void nm_mon_drop_item(const nm_svect_t *list, size_t idx)
+{
+    nm_debug("%s: %s\n", __func__, nm_mon_item_get_name_cstr(list, idx));
+
+    if (nm_mon_item_get_status(list, idx) == NM_TRUE) {
+        nm_qmp_sess_drop(nm_mon_item_get_name(list, idx));
+    }
+    nm_mon_item_free_cb(nm_svect_at(list, idx));
+}
+
+static void nm_mon_item_free_cb(void *unit_p)
+{
+    nm_mon_item_t *item = unit_p;
+
+    nm_mon_metrics_close(item->proc);
+    item->proc = NULL;
 }
 
 static void nm_mon_signals_handler(int signal)
 {
     switch (signal) {
-    case SIGUSR1:
-        nm_mon_rebuild = 1;
-        break;
     case SIGINT:
         nm_exit(EXIT_SUCCESS);
     case SIGTERM:
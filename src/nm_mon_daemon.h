@@ -3,6 +3,7 @@
 
 #include <nm_string.h>
 #include <nm_vector.h>
+#include <nm_mon_metrics.h>
 
 #include <pthread.h>
 
@@ -15,12 +16,13 @@ typedef struct nm_thrctrl {
 typedef struct nm_mon_item {
     nm_str_t *name;
     int8_t state;
+    nm_metrics_proc_t *proc; /* QEMU process of the running VM */
 } nm_mon_item_t;
 
-#define NM_ITEM_INIT (nm_mon_item_t) { NULL, -1 }
+#define NM_ITEM_INIT (nm_mon_item_t) { NULL, -1, NULL }
 
 typedef struct nm_mon_vms {
-    nm_vect_t *list;
+    nm_svect_t *list;   /* nm_mon_item_t */
     pthread_mutex_t mtx;
 } nm_mon_vms_t;
 
@@ -30,30 +32,47 @@ void nm_mon_start(void);
 void nm_mon_loop(void);
 void nm_mon_ping(void);
 
+/*
+ * Subscribe to VM status changes. Daemon sends current status of
+ * all VMs right after connect and then one event per change.
+ * Returns non-blocking socket descriptor or -1 if daemon is not running.
+ */
+int nm_mon_subscribe(void);
+/* read pending data into buf, returns NM_ERR if daemon has gone */
+int nm_mon_event_recv(int sd, nm_str_t *buf);
+/* pop next complete event from buf, returns NM_ERR if there is none */
+int nm_mon_event_next(nm_str_t *buf, nm_str_t *name, int *status);
+
 static const int NM_MON_SLEEP = 1000;
+#define NM_MON_PING_TIMEOUT 1000 /* ms */
+#define NM_MON_SWEEP 30000  /* ms, full check with the liveness engine */
+#define NM_MON_MAX_CLIENTS 32
+#define NM_MON_WORKERS     4  /* default number of QMP job workers */
+#define NM_MON_MAX_WORKERS 64
+#define NM_MON_MAX_JOBS    64 /* queued QMP jobs */
 
 static inline int8_t
-nm_mon_item_get_status(const nm_vect_t *v, const size_t idx)
+nm_mon_item_get_status(const nm_svect_t *v, const size_t idx)
 {
-    return ((nm_mon_item_t *) nm_vect_at(v, idx))->state;
+    return ((nm_mon_item_t *) nm_svect_at(v, idx))->state;
 }
 
 static inline void
-nm_mon_item_set_status(const nm_vect_t *v, const size_t idx, int8_t s)
+nm_mon_item_set_status(const nm_svect_t *v, const size_t idx, int8_t s)
 {
-    ((nm_mon_item_t *) nm_vect_at(v, idx))->state = s;
+    ((nm_mon_item_t *) nm_svect_at(v, idx))->state = s;
 }
 
 static inline nm_str_t
-*nm_mon_item_get_name(const nm_vect_t *v, const size_t idx)
+*nm_mon_item_get_name(const nm_svect_t *v, const size_t idx)
 {
-    return ((nm_mon_item_t *) nm_vect_at(v, idx))->name;
+    return ((nm_mon_item_t *) nm_svect_at(v, idx))->name;
 }
 
 static inline char
-*nm_mon_item_get_name_cstr(const nm_vect_t *v, const size_t idx)
+*nm_mon_item_get_name_cstr(const nm_svect_t *v, const size_t idx)
 {
-    return ((nm_mon_item_t *) nm_vect_at(v, idx))->name->data;
+    return ((nm_mon_item_t *) nm_svect_at(v, idx))->name->data;
 }
 
 #endif
@@ -0,0 +1,671 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_network.h>
+#include <nm_cfg_file.h>
+#include <nm_mon_jobs.h>
+#include <nm_mon_daemon.h>
+#include <nm_mon_metrics.h>
+#include <nm_qmp_reactor.h>
+#include <nm_mon_exporter.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <inttypes.h>
+#include <stddef.h>
+
+static const char NM_EXP_PATH[] = "/metrics";
+static const char NM_EXP_HTTP[] =
+    "HTTP/1.1 %d %s\r\n"
+    "Content-Type: %s\r\n"
+    "Content-Length: %zu\r\n"
+    "Connection: close\r\n\r\n";
+static const char NM_EXP_CTYPE[] =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+static const char NM_EXP_CTYPE_TEXT[] = "text/plain; charset=utf-8";
+
+enum {
+    NM_EXP_MAX_REQUEST = 8192,
+    NM_EXP_TIMEOUT = 5000,      /* ms to send the request */
+    NM_EXP_LINE_LEN = 512,
+    NM_EXP_LABELS_LEN = 256,
+};
+
+typedef enum {
+    NM_EXP_GAUGE,
+    NM_EXP_COUNTER
+} nm_exp_type_t;
+
+/* metric family, value is uint64_t member of the source struct */
+typedef struct {
+    const char *name;
+    nm_exp_type_t type;
+    const char *help;
+    size_t off;
+    double scale;           /* 0 prints the value as integer */
+} nm_exp_family_t;
+
+typedef struct {
+    int sd;
+    uint64_t deadline;      /* nm_mono_ms() */
+    nm_str_t rbuf;
+    nm_str_t wbuf;
+    size_t wpos;
+} nm_exp_client_t;
+
+typedef struct {
+    int sd;
+    bool unix_sd;
+    nm_vect_t labels;       /* vm="name" of mon_list entries */
+    nm_str_t body;          /* kept between scrapes, it only grows */
+    nm_exp_client_t clients[NM_MON_EXP_CLIENTS];
+    size_t n_clients;
+} nm_exporter_t;
+
+static nm_exporter_t nm_exp = {
+    .sd = -1,
+    .labels = NM_INIT_VECT,
+};
+
+#define NM_EXP_SAMPLE(m) offsetof(nm_metrics_sample_t, m)
+#define NM_EXP_BLK(m) offsetof(nm_metrics_blk_cnt_t, m)
+#define NM_EXP_LINK(m) offsetof(nm_net_link_stats_t, m)
+
+/* scale of the cpu family is set to 1 / clock ticks on open */
+static nm_exp_family_t nm_exp_vm[] = {
+    { "nemu_vm_cpu_seconds", NM_EXP_COUNTER,
+        "CPU time of QEMU process.", NM_EXP_SAMPLE(cpu), 0.01 },
+    { "nemu_vm_memory_rss_bytes", NM_EXP_GAUGE,
+        "Resident memory of QEMU process.", NM_EXP_SAMPLE(rss), 0 },
+    { "nemu_vm_major_faults", NM_EXP_COUNTER,
+        "Major page faults of QEMU process.", NM_EXP_SAMPLE(majflt), 0 },
+    { "nemu_vm_context_switches", NM_EXP_COUNTER,
+        "Context switches of QEMU threads.", NM_EXP_SAMPLE(ctxsw), 0 },
+    { "nemu_vm_io_read_bytes", NM_EXP_COUNTER,
+        "Bytes read from storage by QEMU process.",
+        NM_EXP_SAMPLE(rd_bytes), 0 },
+    { "nemu_vm_io_write_bytes", NM_EXP_COUNTER,
+        "Bytes written to storage by QEMU process.",
+        NM_EXP_SAMPLE(wr_bytes), 0 },
+};
+
+static const nm_exp_family_t nm_exp_blk[] = {
+    { "nemu_vm_disk_read_bytes", NM_EXP_COUNTER,
+        "Bytes read by the guest.", NM_EXP_BLK(rd_bytes), 0 },
+    { "nemu_vm_disk_written_bytes", NM_EXP_COUNTER,
+        "Bytes written by the guest.", NM_EXP_BLK(wr_bytes), 0 },
+    { "nemu_vm_disk_reads_completed", NM_EXP_COUNTER,
+        "Read requests completed.", NM_EXP_BLK(rd_ops), 0 },
+    { "nemu_vm_disk_writes_completed", NM_EXP_COUNTER,
+        "Write requests completed.", NM_EXP_BLK(wr_ops), 0 },
+    { "nemu_vm_disk_read_time_seconds", NM_EXP_COUNTER,
+        "Time spent on read requests.", NM_EXP_BLK(rd_time), 1e-9 },
+    { "nemu_vm_disk_write_time_seconds", NM_EXP_COUNTER,
+        "Time spent on write requests.", NM_EXP_BLK(wr_time), 1e-9 },
+};
+
+/* counted on the host side of tap, macvtap or veth */
+static const nm_exp_family_t nm_exp_link[] = {
+    { "nemu_vm_network_transmit_bytes", NM_EXP_COUNTER,
+        "Bytes sent by the guest.", NM_EXP_LINK(rx_bytes), 0 },
+    { "nemu_vm_network_receive_bytes", NM_EXP_COUNTER,
+        "Bytes received by the guest.", NM_EXP_LINK(tx_bytes), 0 },
+    { "nemu_vm_network_transmit_packets", NM_EXP_COUNTER,
+        "Packets sent by the guest.", NM_EXP_LINK(rx_packets), 0 },
+    { "nemu_vm_network_receive_packets", NM_EXP_COUNTER,
+        "Packets received by the guest.", NM_EXP_LINK(tx_packets), 0 },
+};
+
+static int nm_exp_listen_unix(const nm_str_t *path);
+static int nm_exp_listen_inet(const nm_str_t *addr);
+static void nm_exp_accept(void);
+static void nm_exp_drop(size_t idx);
+static int nm_exp_read(nm_exp_client_t *cl, const nm_svect_t *mon_list);
+static int nm_exp_write(nm_exp_client_t *cl);
+static void nm_exp_reply(nm_exp_client_t *cl, const nm_svect_t *mon_list);
+static void nm_exp_collect(const nm_svect_t *mon_list, nm_str_t *out);
+static void nm_exp_head(nm_str_t *out, const nm_exp_family_t *fam);
+static void nm_exp_value(nm_str_t *out, const nm_exp_family_t *fam,
+        const char *labels, const void *src);
+static void nm_exp_label_cb(void *unit_p, const void *ctx);
+
+int nm_mon_exporter_open(void)
+{
+    const nm_str_t *addr = &nm_cfg_get()->daemon_exporter;
+    long hz = sysconf(_SC_CLK_TCK);
+
+    if (hz > 0) {
+        nm_exp_vm[0].scale = 1.0 / hz;
+    }
+
+    nm_exp.unix_sd = (addr->data[0] == '/');
+    nm_exp.sd = (nm_exp.unix_sd) ?
+        nm_exp_listen_unix(addr) : nm_exp_listen_inet(addr);
+
+    return (nm_exp.sd == -1) ? NM_ERR : NM_OK;
+}
+
+void nm_mon_exporter_close(void)
+{
+    while (nm_exp.n_clients) {
+        nm_exp_drop(0);
+    }
+
+    if (nm_exp.sd != -1) {
+        close(nm_exp.sd);
+        nm_exp.sd = -1;
+        if (nm_exp.unix_sd) {
+            unlink(nm_cfg_get()->daemon_exporter.data);
+        }
+    }
+
+    nm_vect_free(&nm_exp.labels, nm_str_vect_free_cb);
+    nm_str_free(&nm_exp.body);
+}
+
+void nm_mon_exporter_sync(const nm_svect_t *mon_list)
+{
+    if (nm_exp.sd == -1) {
+        return;
+    }
+
+    nm_vect_free(&nm_exp.labels, nm_str_vect_free_cb);
+    for (size_t n = 0; n < mon_list->n_memb; n++) {
+        nm_vect_insert(&nm_exp.labels, nm_mon_item_get_name(mon_list, n),
+                sizeof(nm_str_t), nm_exp_label_cb);
+    }
+}
+
+nfds_t nm_mon_exporter_fds(struct pollfd *fds)
+{
+    uint64_t now = nm_mono_ms();
+    nfds_t nfds = 0;
+
+    if (nm_exp.sd == -1) {
+        return 0;
+    }
+
+    /* clients that do not send the request */
+    for (size_t n = nm_exp.n_clients; n > 0; n--) {
+        if (nm_exp.clients[n - 1].deadline <= now) {
+            nm_exp_drop(n - 1);
+        }
+    }
+
+    fds[nfds].fd = nm_exp.sd;
+    fds[nfds].events = POLLIN;
+    nfds++;
+
+    for (size_t n = 0; n < nm_exp.n_clients; n++) {
+        fds[nfds].fd = nm_exp.clients[n].sd;
+        fds[nfds].events = (nm_exp.clients[n].wbuf.len) ? POLLOUT : POLLIN;
+        nfds++;
+    }
+
+    return nfds;
+}
+
+bool nm_mon_exporter_io(const struct pollfd *pfd, const nm_svect_t *mon_list)
+{
+    if (nm_exp.sd == -1) {
+        return false;
+    }
+
+    if (pfd->fd == nm_exp.sd) {
+        nm_exp_accept();
+        return true;
+    }
+
+    for (size_t n = 0; n < nm_exp.n_clients; n++) {
+        nm_exp_client_t *cl = &nm_exp.clients[n];
+        int rc;
+
+        if (cl->sd != pfd->fd) {
+            continue;
+        }
+
+        if (pfd->revents & (POLLERR | POLLNVAL)) {
+            rc = NM_ERR;
+        } else if (cl->wbuf.len) {
+            rc = nm_exp_write(cl);
+        } else {
+            rc = nm_exp_read(cl, mon_list);
+        }
+
+        /* NM_ERR also means the reply is sent */
+        if (rc != NM_OK) {
+            nm_exp_drop(n);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static int nm_exp_listen_unix(const nm_str_t *path)
+{
+    struct sockaddr_un addr;
+    int sd;
+
+    if (path->len >= sizeof(addr.sun_path)) {
+        nm_debug("%s: socket path too long: %s\n", __func__, path->data);
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    nm_strlcpy(addr.sun_path, path->data, sizeof(addr.sun_path));
+
+    if ((sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        nm_debug("%s: socket error: %s\n", __func__, strerror(errno));
+        return -1;
+    }
+
+    /* stale socket from the killed daemon */
+    unlink(path->data);
+
+    if (bind(sd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+            chmod(path->data, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP) != 0 ||
+            listen(sd, NM_MON_EXP_CLIENTS) != 0 ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1) {
+        nm_debug("%s: setup error: %s\n", __func__, strerror(errno));
+        close(sd);
+        unlink(path->data);
+        return -1;
+    }
+
+    return sd;
+}
+
+/* host:port, [ipv6]:port or :port for any address */
+static int nm_exp_listen_inet(const nm_str_t *addr)
+{
+    struct addrinfo hints, *res = NULL, *ai;
+    nm_str_t host = NM_INIT_STR;
+    const char *port = strrchr(addr->data, ':');
+    int sd = -1, on = 1, rc;
+
+    if (!port || !port[1]) {
+        nm_debug("%s: port is not set: %s\n", __func__, addr->data);
+        return -1;
+    }
+
+    nm_str_add_text_part(&host, addr->data, port - addr->data);
+    port++;
+    if (host.len > 1 && host.data[0] == '[' && host.data[host.len - 1] == ']') {
+        memmove(host.data, host.data + 1, host.len - 2);
+        nm_str_trunc(&host, host.len - 2);
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    if ((rc = getaddrinfo(host.len ? host.data : NULL,
+                    port, &hints, &res)) != 0) {
+        nm_debug("%s: %s: %s\n", __func__, addr->data, gai_strerror(rc));
+        nm_str_free(&host);
+        return -1;
+    }
+
+    for (ai = res; ai; ai = ai->ai_next) {
+        if ((sd = socket(ai->ai_family, ai->ai_socktype,
+                        ai->ai_protocol)) == -1) {
+            continue;
+        }
+
+        if (setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0 &&
+                bind(sd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+                listen(sd, NM_MON_EXP_CLIENTS) == 0 &&
+                fcntl(sd, F_SETFL, O_NONBLOCK) != -1) {
+            break;
+        }
+
+        nm_debug("%s: setup error: %s\n", __func__, strerror(errno));
+        close(sd);
+        sd = -1;
+    }
+
+    freeaddrinfo(res);
+    nm_str_free(&host);
+
+    return sd;
+}
+
+static void nm_exp_accept(void)
+{
+    nm_exp_client_t *cl;
+    int sd;
+
+    if ((sd = accept(nm_exp.sd, NULL, NULL)) == -1) {
+        return;
+    }
+
+    if (nm_exp.n_clients == NM_MON_EXP_CLIENTS ||
+            fcntl(sd, F_SETFL, O_NONBLOCK) == -1) {
+        close(sd);
+        return;
+    }
+
+    cl = &nm_exp.clients[nm_exp.n_clients++];
+    cl->sd = sd;
+    cl->deadline = nm_mono_ms() + NM_EXP_TIMEOUT;
+    cl->rbuf = NM_INIT_STR;
+    cl->wbuf = NM_INIT_STR;
+    cl->wpos = 0;
+}
+
+static void nm_exp_drop(size_t idx)
+{
+    nm_exp_client_t *cl = &nm_exp.clients[idx];
+
+    close(cl->sd);
+    nm_str_free(&cl->rbuf);
+    nm_str_free(&cl->wbuf);
+
+    nm_exp.n_clients--;
+    memmove(cl, cl + 1, (nm_exp.n_clients - idx) * sizeof(nm_exp_client_t));
+}
+
+static int nm_exp_read(nm_exp_client_t *cl, const nm_svect_t *mon_list)
+{
+    char chunk[1024];
+    ssize_t nread;
+
+    for (;;) {
+        nread = read(cl->sd, chunk, sizeof(chunk));
+
+        if (nread > 0) {
+            nm_str_add_text_part(&cl->rbuf, chunk, nread);
+            if (cl->rbuf.len > NM_EXP_MAX_REQUEST) {
+                return NM_ERR;
+            }
+            continue;
+        }
+
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (nread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+
+        return NM_ERR;
+    }
+
+    /* request body is not expected, headers are not used */
+    if (!cl->rbuf.len || !strstr(cl->rbuf.data, "\r\n\r\n")) {
+        return NM_OK;
+    }
+
+    nm_exp_reply(cl, mon_list);
+
+    return nm_exp_write(cl);
+}
+
+/* returns NM_ERR when the reply is sent or the client has gone */
+static int nm_exp_write(nm_exp_client_t *cl)
+{
+    while (cl->wpos < cl->wbuf.len) {
+        ssize_t nwrite = write(cl->sd, cl->wbuf.data + cl->wpos,
+                cl->wbuf.len - cl->wpos);
+
+        if (nwrite < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (nwrite < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            /* slow scraper, do not drop it in the middle of the reply */
+            cl->deadline = nm_mono_ms() + NM_EXP_TIMEOUT;
+            return NM_OK;
+        }
+
+        if (nwrite <= 0) {
+            return NM_ERR;
+        }
+
+        cl->wpos += nwrite;
+    }
+
+    return NM_ERR;
+}
+
+static void nm_exp_reply(nm_exp_client_t *cl, const nm_svect_t *mon_list)
+{
+    const char *req = cl->rbuf.data;
+    size_t plen = sizeof(NM_EXP_PATH) - 1;
+    bool head = false;
+    const char *path;
+
+    if (strncmp(req, "GET ", 4) == 0) {
+        path = req + 4;
+    } else if (strncmp(req, "HEAD ", 5) == 0) {
+        path = req + 5;
+        head = true;
+    } else {
+        nm_str_format(&cl->wbuf, NM_EXP_HTTP, 405, "Method Not Allowed",
+                NM_EXP_CTYPE_TEXT, (size_t) 0);
+        return;
+    }
+
+    if (strncmp(path, NM_EXP_PATH, plen) != 0 ||
+            (path[plen] != ' ' && path[plen] != '?')) {
+        nm_str_format(&cl->wbuf, NM_EXP_HTTP, 404, "Not Found",
+                NM_EXP_CTYPE_TEXT, (size_t) 0);
+        return;
+    }
+
+    nm_exp_collect(mon_list, &nm_exp.body);
+    nm_str_format(&cl->wbuf, NM_EXP_HTTP, 200, "OK",
+            NM_EXP_CTYPE, nm_exp.body.len);
+    if (!head) {
+        nm_str_add_str(&cl->wbuf, &nm_exp.body);
+    }
+}
+
+static void nm_exp_collect(const nm_svect_t *mon_list, nm_str_t *out)
+{
+    nm_qmp_stat_t stats[NM_QMP_MAX_STATS];
+    nm_mon_jobs_stat_t jobs;
+    char labels[NM_EXP_LABELS_LEN];
+    char line[NM_EXP_LINE_LEN];
+    size_t n_stats;
+    int len;
+
+    if (out->alloc_bytes) {
+        nm_str_trunc(out, 0);
+    }
+
+    /* labels are synced with the list on every change */
+    if (nm_exp.labels.n_memb != mon_list->n_memb) {
+        nm_mon_exporter_sync(mon_list);
+    }
+
+    nm_str_add_text(out, "# TYPE nemu_vm_up gauge\n"
+            "# HELP nemu_vm_up VM is running.\n");
+    for (size_t n = 0; n < mon_list->n_memb; n++) {
+        len = snprintf(line, sizeof(line), "nemu_vm_up{%s} %d\n",
+                nm_vect_str_ctx(&nm_exp.labels, n),
+                nm_mon_item_get_status(mon_list, n) == NM_TRUE);
+        nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+    }
+
+    for (size_t f = 0; f < nm_arr_len(nm_exp_vm); f++) {
+        nm_exp_head(out, &nm_exp_vm[f]);
+        for (size_t n = 0; n < mon_list->n_memb; n++) {
+            const nm_mon_item_t *item = nm_svect_at(mon_list, n);
+            const nm_metrics_sample_t *s;
+
+            if (item->state == NM_TRUE &&
+                    (s = nm_mon_metrics_counters(item->proc)) != NULL) {
+                nm_exp_value(out, &nm_exp_vm[f],
+                        nm_vect_str_ctx(&nm_exp.labels, n), s);
+            }
+        }
+    }
+
+    for (size_t f = 0; f < nm_arr_len(nm_exp_blk); f++) {
+        nm_exp_head(out, &nm_exp_blk[f]);
+        for (size_t n = 0; n < mon_list->n_memb; n++) {
+            const nm_mon_item_t *item = nm_svect_at(mon_list, n);
+            nm_metrics_blk_cnt_t blk[NM_METRICS_DRIVES];
+            size_t count;
+
+            if (item->state != NM_TRUE) {
+                continue;
+            }
+
+            count = nm_mon_metrics_blk_counters(item->proc,
+                    blk, NM_METRICS_DRIVES);
+            for (size_t i = 0; i < count; i++) {
+                snprintf(labels, sizeof(labels), "%s,drive=\"%.*s\"",
+                        nm_vect_str_ctx(&nm_exp.labels, n),
+                        NM_METRICS_NAME_LEN, blk[i].name);
+                nm_exp_value(out, &nm_exp_blk[f], labels, &blk[i]);
+            }
+        }
+    }
+
+    for (size_t f = 0; f < nm_arr_len(nm_exp_link); f++) {
+        nm_exp_head(out, &nm_exp_link[f]);
+        for (size_t n = 0; n < mon_list->n_memb; n++) {
+            const nm_mon_item_t *item = nm_svect_at(mon_list, n);
+            nm_net_link_stats_t links[NM_METRICS_IFACES];
+            size_t count;
+
+            if (item->state != NM_TRUE) {
+                continue;
+            }
+
+            count = nm_mon_metrics_link_counters(item->proc,
+                    links, NM_METRICS_IFACES);
+            for (size_t i = 0; i < count; i++) {
+                snprintf(labels, sizeof(labels), "%s,interface=\"%.*s\"",
+                        nm_vect_str_ctx(&nm_exp.labels, n),
+                        NM_NET_IFNAME_LEN, links[i].name);
+                nm_exp_value(out, &nm_exp_link[f], labels, &links[i]);
+            }
+        }
+    }
+
+    n_stats = nm_qmp_stats(stats, NM_QMP_MAX_STATS);
+    nm_str_add_text(out, "# TYPE nemu_qmp_command_duration_seconds histogram\n"
+            "# HELP nemu_qmp_command_duration_seconds "
+            "Time from QMP command submission to the reply.\n");
+    for (size_t n = 0; n < n_stats; n++) {
+        uint64_t total = 0;
+
+        for (size_t b = 0; b <= NM_QMP_LAT_BUCKETS; b++) {
+            total += stats[n].buckets[b];
+            if (b < NM_QMP_LAT_BUCKETS) {
+                len = snprintf(line, sizeof(line),
+                        "nemu_qmp_command_duration_seconds_bucket"
+                        "{command=\"%s\",le=\"%g\"} %" PRIu64 "\n",
+                        stats[n].cmd, nm_qmp_lat_bounds[b] / 1e6, total);
+            } else {
+                len = snprintf(line, sizeof(line),
+                        "nemu_qmp_command_duration_seconds_bucket"
+                        "{command=\"%s\",le=\"+Inf\"} %" PRIu64 "\n",
+                        stats[n].cmd, total);
+            }
+            nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+        }
+        len = snprintf(line, sizeof(line),
+                "nemu_qmp_command_duration_seconds_count"
+                "{command=\"%s\"} %" PRIu64 "\n"
+                "nemu_qmp_command_duration_seconds_sum"
+                "{command=\"%s\"} %.6f\n",
+                stats[n].cmd, stats[n].count,
+                stats[n].cmd, stats[n].sum_us / 1e6);
+        nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+    }
+
+    nm_str_add_text(out, "# TYPE nemu_qmp_command_failures counter\n"
+            "# HELP nemu_qmp_command_failures "
+            "QMP commands failed or not answered.\n");
+    for (size_t n = 0; n < n_stats; n++) {
+        len = snprintf(line, sizeof(line),
+                "nemu_qmp_command_failures_total"
+                "{command=\"%s\"} %" PRIu64 "\n",
+                stats[n].cmd, stats[n].failed);
+        nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+    }
+
+    nm_mon_jobs_stat(&jobs);
+    len = snprintf(line, sizeof(line),
+            "# TYPE nemu_jobs_queued gauge\n"
+            "# HELP nemu_jobs_queued Snapshot jobs waiting for a worker.\n"
+            "nemu_jobs_queued %zu\n"
+            "# TYPE nemu_jobs_running gauge\n"
+            "# HELP nemu_jobs_running Snapshot jobs being executed.\n"
+            "nemu_jobs_running %zu\n"
+            "# TYPE nemu_jobs_completed counter\n"
+            "# HELP nemu_jobs_completed Snapshot jobs finished.\n"
+            "nemu_jobs_completed_total %" PRIu64 "\n"
+            "# TYPE nemu_jobs_failed counter\n"
+            "# HELP nemu_jobs_failed Snapshot jobs finished with error.\n"
+            "nemu_jobs_failed_total %" PRIu64 "\n",
+            jobs.queued, jobs.running, jobs.done, jobs.failed);
+    nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+
+    nm_str_add_text(out, "# EOF\n");
+}
+
+static void nm_exp_head(nm_str_t *out, const nm_exp_family_t *fam)
+{
+    char line[NM_EXP_LINE_LEN];
+    int len;
+
+    len = snprintf(line, sizeof(line), "# TYPE %s %s\n# HELP %s %s\n",
+            fam->name, (fam->type == NM_EXP_COUNTER) ? "counter" : "gauge",
+            fam->name, fam->help);
+    nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+}
+
+static void nm_exp_value(nm_str_t *out, const nm_exp_family_t *fam,
+        const char *labels, const void *src)
+{
+    uint64_t value = *(const uint64_t *) ((const char *) src + fam->off);
+    const char *suffix = (fam->type == NM_EXP_COUNTER) ? "_total" : "";
+    char line[NM_EXP_LINE_LEN];
+    int len;
+
+    if (fam->scale) {
+        len = snprintf(line, sizeof(line), "%s%s{%s} %.6f\n",
+                fam->name, suffix, labels, value * fam->scale);
+    } else {
+        len = snprintf(line, sizeof(line), "%s%s{%s} %" PRIu64 "\n",
+                fam->name, suffix, labels, value);
+    }
+    nm_str_add_text_part(out, line, nm_min(len, NM_EXP_LINE_LEN - 1));
+}
+
+/* vm="name" with label value escaping */
+static void nm_exp_label_cb(void *unit_p, const void *ctx)
+{
+    nm_str_t *label = unit_p;
+    const nm_str_t *name = ctx;
+
+    nm_str_alloc_text(label, "vm=\"");
+    for (size_t n = 0; n < name->len; n++) {
+        switch (name->data[n]) {
+        case '\\':
+            nm_str_add_text(label, "\\\\");
+            break;
+        case '"':
+            nm_str_add_text(label, "\\\"");
+            break;
+        case '\n':
+            nm_str_add_text(label, "\\n");
+            break;
+        default:
+            nm_str_add_char(label, name->data[n]);
+        }
+    }
+    nm_str_add_char(label, '"');
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,30 @@
+#ifndef NM_MON_EXPORTER_H_
+#define NM_MON_EXPORTER_H_
+
+#include <nm_vector.h>
+
+#include <stdbool.h>
+#include <poll.h>
+
+/*
+ * OpenMetrics exporter of the monitoring daemon. Plain HTTP on the
+ * address or unix socket set by "exporter" config parameter, every
+ * request gets the metrics and the connection is closed.
+ * Served from the daemon main loop, so VM state, samples and QEMU
+ * counters are read without locks. VM labels are formatted once
+ * per VM list change.
+ */
+
+#define NM_MON_EXP_CLIENTS 8
+
+int nm_mon_exporter_open(void);
+void nm_mon_exporter_close(void);
+/* VM list was changed, mon_list holds nm_mon_item_t */
+void nm_mon_exporter_sync(const nm_svect_t *mon_list);
+/* add listener and clients to fds, returns number of added entries */
+nfds_t nm_mon_exporter_fds(struct pollfd *fds);
+/* returns false if the descriptor does not belong to the exporter */
+bool nm_mon_exporter_io(const struct pollfd *pfd, const nm_svect_t *mon_list);
+
+#endif /* NM_MON_EXPORTER_H_ */
+/* vim:set ts=4 sw=4: */
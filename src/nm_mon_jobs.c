@@ -0,0 +1,299 @@
+#if defined (NM_OS_LINUX)
+# define _GNU_SOURCE
+#endif
+
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_mon_jobs.h>
+#include <nm_mon_daemon.h>
+#include <nm_qmp_control.h>
+
+#include <pthread.h>
+
+#include <json.h>
+
+typedef struct {
+    nm_str_t name;
+    nm_str_t cmd;
+    nm_str_t jobid;
+    nm_mon_job_cb_t cb;
+    void *ctx;
+} nm_mon_job_t;
+
+#define NM_INIT_MON_JOB (nm_mon_job_t) \
+    { NM_INIT_STR, NM_INIT_STR, NM_INIT_STR, NULL, NULL }
+
+typedef struct {
+    pthread_mutex_t mtx;
+    pthread_cond_t ready;   /* job queued, VM released or pool stopped */
+    nm_vect_t queue;        /* nm_mon_job_t in arrival order */
+    nm_vect_t busy;         /* names of VMs served by workers */
+    pthread_t *workers;
+    size_t n_workers;
+    uint64_t done;
+    uint64_t failed;
+    bool stop;
+} nm_mon_jobs_t;
+
+static nm_mon_jobs_t nm_jobs = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .ready = PTHREAD_COND_INITIALIZER,
+    .queue = NM_INIT_VECT,
+    .busy = NM_INIT_VECT,
+};
+
+static void *nm_mon_jobs_worker(void *ctx);
+static int nm_mon_jobs_parse(const nm_str_t *cmd, nm_mon_job_t *job);
+static size_t nm_mon_jobs_next(void);
+static bool nm_mon_jobs_busy(const nm_str_t *name, size_t *idx);
+static void nm_mon_job_free(nm_mon_job_t *job);
+static void nm_mon_job_free_cb(void *unit_p);
+
+void nm_mon_jobs_start(size_t workers)
+{
+    nm_jobs.stop = false;
+    nm_jobs.workers = nm_calloc(workers, sizeof(pthread_t));
+
+    for (size_t n = 0; n < workers; n++) {
+        if (pthread_create(&nm_jobs.workers[n], NULL,
+                    nm_mon_jobs_worker, NULL) != 0) {
+            nm_bug("%s: cannot create worker thread", __func__);
+        }
+#if defined (NM_OS_LINUX)
+        pthread_setname_np(nm_jobs.workers[n], "nemu-qmp-worker");
+#endif
+        nm_jobs.n_workers++;
+    }
+}
+
+int nm_mon_jobs_push(const nm_str_t *cmd, nm_str_t *jobid,
+        nm_mon_job_cb_t cb, void *ctx)
+{
+    nm_mon_job_t job = NM_INIT_MON_JOB;
+
+    if (nm_mon_jobs_parse(cmd, &job) != NM_OK) {
+        nm_mon_job_free(&job);
+        return NM_ERR;
+    }
+    nm_str_copy(jobid, &job.jobid);
+    job.cb = cb;
+    job.ctx = ctx;
+
+    /* the control server must not stall, the sender gets an error */
+    pthread_mutex_lock(&nm_jobs.mtx);
+    if (nm_jobs.stop || nm_jobs.queue.n_memb >= NM_MON_MAX_JOBS) {
+        int rc = nm_jobs.stop ? NM_ERR : NM_MON_JOBS_FULL;
+
+        pthread_mutex_unlock(&nm_jobs.mtx);
+        nm_debug("%s: %s is refused\n", __func__, job.jobid.data);
+        nm_mon_job_free(&job);
+        return rc;
+    }
+
+    nm_debug("%s: queued %s (%zu)\n", __func__,
+            job.jobid.data, nm_jobs.queue.n_memb + 1);
+    nm_vect_insert(&nm_jobs.queue, &job, sizeof(job), NULL);
+    pthread_cond_signal(&nm_jobs.ready);
+    pthread_mutex_unlock(&nm_jobs.mtx);
+
+    return NM_OK;
+}
+
+void nm_mon_jobs_stat(nm_mon_jobs_stat_t *st)
+{
+    pthread_mutex_lock(&nm_jobs.mtx);
+    st->queued = nm_jobs.queue.n_memb;
+    st->running = nm_jobs.busy.n_memb;
+    st->done = nm_jobs.done;
+    st->failed = nm_jobs.failed;
+    pthread_mutex_unlock(&nm_jobs.mtx);
+}
+
+void nm_mon_jobs_stop(void)
+{
+    pthread_mutex_lock(&nm_jobs.mtx);
+    nm_jobs.stop = true;
+    pthread_cond_broadcast(&nm_jobs.ready);
+    pthread_mutex_unlock(&nm_jobs.mtx);
+}
+
+void nm_mon_jobs_free(void)
+{
+    nm_mon_jobs_stop();
+
+    for (size_t n = 0; n < nm_jobs.n_workers; n++) {
+        pthread_join(nm_jobs.workers[n], NULL);
+    }
+    free(nm_jobs.workers);
+    nm_jobs.workers = NULL;
+    nm_jobs.n_workers = 0;
+
+    /* jobs that were never started */
+    for (size_t n = 0; n < nm_jobs.queue.n_memb; n++) {
+        nm_mon_job_t *job = nm_vect_at(&nm_jobs.queue, n);
+
+        if (job->cb) {
+            job->cb(NM_ERR, &job->jobid, job->ctx);
+        }
+    }
+    nm_vect_free(&nm_jobs.queue, nm_mon_job_free_cb);
+    nm_vect_free(&nm_jobs.busy, nm_str_vect_free_cb);
+}
+
+static void *nm_mon_jobs_worker(void *ctx)
+{
+    (void) ctx;
+
+    pthread_mutex_lock(&nm_jobs.mtx);
+    for (;;) {
+        nm_mon_job_t job;
+        size_t idx;
+        int rc;
+
+        while (!nm_jobs.stop &&
+                (idx = nm_mon_jobs_next()) == nm_jobs.queue.n_memb) {
+            pthread_cond_wait(&nm_jobs.ready, &nm_jobs.mtx);
+        }
+
+        if (nm_jobs.stop) {
+            break;
+        }
+
+        job = *(nm_mon_job_t *) nm_vect_at(&nm_jobs.queue, idx);
+        nm_vect_delete(&nm_jobs.queue, idx, NULL);
+        nm_vect_insert(&nm_jobs.busy, &job.name, sizeof(nm_str_t),
+                nm_str_vect_ins_cb);
+        pthread_mutex_unlock(&nm_jobs.mtx);
+
+        rc = nm_qmp_vm_exec_async(&job.name, job.cmd.data, job.jobid.data);
+        if (job.cb) {
+            job.cb(rc, &job.jobid, job.ctx);
+        }
+
+        pthread_mutex_lock(&nm_jobs.mtx);
+        nm_jobs.done++;
+        if (rc != NM_OK) {
+            nm_jobs.failed++;
+        }
+        if (nm_mon_jobs_busy(&job.name, &idx)) {
+            nm_vect_delete(&nm_jobs.busy, idx, nm_str_vect_free_cb);
+        }
+        /* next job of this VM may be waiting */
+        pthread_cond_broadcast(&nm_jobs.ready);
+        nm_mon_job_free(&job);
+    }
+    pthread_mutex_unlock(&nm_jobs.mtx);
+
+    return NULL;
+}
+
+/*
+ * Get VM name from job-id.
+ * input string example: vmdel-vmname-2021-05-27-15-14-12-tVusSMWY
+ */
+static int nm_mon_jobs_parse(const nm_str_t *cmd, nm_mon_job_t *job)
+{
+    struct json_object *parsed, *args, *jobid;
+    nm_str_t jobid_copy = NM_INIT_STR;
+    char *name_start;
+    int rc = NM_ERR;
+
+    if ((parsed = json_tokener_parse(cmd->data)) == NULL) {
+        nm_debug("%s: cannot parse json\n", __func__);
+        return NM_ERR;
+    }
+
+    if (!json_object_object_get_ex(parsed, "arguments", &args) ||
+            !json_object_object_get_ex(args, "job-id", &jobid)) {
+        nm_debug("%s: malformed json\n", __func__);
+        goto out;
+    }
+
+    nm_str_format(&job->jobid, "%s", json_object_get_string(jobid));
+    nm_str_copy(&jobid_copy, &job->jobid);
+
+    /*
+     *  Cut job-id, we have 7 dashes in UID.
+     *  input:  vmdel-vmname-2021-05-27-15-14-12-tVusSMWY
+     *                      <----<--<--<--<--<--<--------
+     *                      7    6  5  4  3  2  1
+     *  result: vmdel-vmname
+     */
+    for (size_t sep = 0; sep < 7; sep++) {
+        char *dash = strrchr(jobid_copy.data, '-');
+
+        if (dash) {
+            *dash = '\0';
+        } else {
+            break;
+        }
+    }
+
+    /*
+     *  Cut VM name:
+     *  input:  vmdel-vmname
+     *          ----->
+     *  result: -vmname
+     */
+    name_start = strchr(jobid_copy.data, '-');
+    if (!name_start) {
+        nm_debug("%s: error get VM name from job-id\n", __func__);
+        goto out;
+    }
+
+    name_start++; /* skip dash */
+    nm_str_format(&job->name, "%s", name_start);
+    nm_str_copy(&job->cmd, cmd);
+    rc = NM_OK;
+
+out:
+    json_object_put(parsed);
+    nm_str_free(&jobid_copy);
+
+    return rc;
+}
+
+/* first job of idle VM, queue length if there is none */
+static size_t nm_mon_jobs_next(void)
+{
+    size_t n;
+
+    for (n = 0; n < nm_jobs.queue.n_memb; n++) {
+        const nm_mon_job_t *job = nm_vect_at(&nm_jobs.queue, n);
+
+        if (!nm_mon_jobs_busy(&job->name, NULL)) {
+            break;
+        }
+    }
+
+    return n;
+}
+
+static bool nm_mon_jobs_busy(const nm_str_t *name, size_t *idx)
+{
+    for (size_t n = 0; n < nm_jobs.busy.n_memb; n++) {
+        if (nm_str_cmp_ss(nm_vect_str(&nm_jobs.busy, n), name) == NM_OK) {
+            if (idx) {
+                *idx = n;
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void nm_mon_job_free(nm_mon_job_t *job)
+{
+    nm_str_free(&job->name);
+    nm_str_free(&job->cmd);
+    nm_str_free(&job->jobid);
+}
+
+static void nm_mon_job_free_cb(void *unit_p)
+{
+    nm_mon_job_free(unit_p);
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,39 @@
+#ifndef NM_MON_JOBS_H_
+#define NM_MON_JOBS_H_
+
+#include <nm_string.h>
+
+/*
+ * Snapshot jobs received by the monitoring daemon. Jobs are run by
+ * a fixed number of workers, jobs of one VM never run concurrently.
+ */
+void nm_mon_jobs_start(size_t workers);
+
+/* called by the worker when the job is finished */
+typedef void (*nm_mon_job_cb_t)(int rc, const nm_str_t *jobid, void *ctx);
+
+enum { NM_MON_JOBS_FULL = 1 };
+
+/*
+ * Queue QMP command with "job-id" argument, jobid gets its value.
+ * Does not block: returns NM_MON_JOBS_FULL if NM_MON_MAX_JOBS jobs
+ * are waiting, NM_ERR if the command is malformed or the pool is
+ * stopped. cb is not called then.
+ */
+int nm_mon_jobs_push(const nm_str_t *cmd, nm_str_t *jobid,
+        nm_mon_job_cb_t cb, void *ctx);
+typedef struct {
+    size_t queued;
+    size_t running;
+    uint64_t done;      /* finished since the daemon start */
+    uint64_t failed;
+} nm_mon_jobs_stat_t;
+
+void nm_mon_jobs_stat(nm_mon_jobs_stat_t *st);
+/* refuse new jobs and wake up idle workers */
+void nm_mon_jobs_stop(void);
+/* wait for running jobs to finish */
+void nm_mon_jobs_free(void);
+
+#endif /* NM_MON_JOBS_H_ */
+/* vim:set ts=4 sw=4: */
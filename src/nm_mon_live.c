@@ -0,0 +1,455 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_mon_live.h>
+#include <nm_cfg_file.h>
+#include <nm_mon_daemon.h>
+
+#if defined (NM_OS_LINUX)
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+
+enum {
+    NM_LIVE_RETRY_MS = 100,
+    NM_LIVE_RETRIES = 50,   /* QEMU may take a while to open QMP socket */
+    NM_LIVE_EPOLL_MAX = 16
+};
+
+/*
+ * Only directory entries are watched: IN_MODIFY would report
+ * every write to disk images.
+ */
+static const uint32_t NM_LIVE_MASK = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE |
+    IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR;
+
+typedef struct {
+    nm_str_t name;
+    int wd;             /* inotify watch of VM directory */
+    int pidfd;
+    pid_t pid;
+    uint64_t retry_at;  /* 0 if no retry is scheduled */
+    uint32_t retries;
+} nm_live_vm_t;
+
+typedef struct {
+    int epfd;
+    int ifd;
+    nm_vect_t vms;      /* nm_live_vm_t */
+    nm_vect_t events;   /* nm_live_event_t */
+} nm_live_t;
+
+static nm_live_t live = { -1, -1, NM_INIT_VECT, NM_INIT_VECT };
+
+static nm_live_vm_t *nm_mon_live_find(const nm_str_t *name);
+static void nm_mon_live_watch(nm_live_vm_t *vm);
+static void nm_mon_live_close(nm_live_vm_t *vm);
+static void nm_mon_live_collect(void);
+static void nm_mon_live_inotify(void);
+static void nm_mon_live_exited(int pidfd);
+static void nm_mon_live_push(const nm_str_t *name, int id);
+static void nm_mon_live_vm_free_cb(void *unit_p);
+static void nm_mon_live_event_free_cb(void *unit_p);
+
+int nm_mon_live_init(void)
+{
+    struct epoll_event ev = { .events = EPOLLIN };
+
+    if ((live.epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        nm_debug("%s: epoll_create1 error: %s\n", __func__, strerror(errno));
+        return NM_ERR;
+    }
+
+    if ((live.ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) == -1) {
+        nm_debug("%s: inotify_init1 error: %s\n", __func__, strerror(errno));
+        nm_mon_live_free();
+        return NM_ERR;
+    }
+
+    ev.data.fd = live.ifd;
+    if (epoll_ctl(live.epfd, EPOLL_CTL_ADD, live.ifd, &ev) == -1) {
+        nm_debug("%s: epoll_ctl error: %s\n", __func__, strerror(errno));
+        nm_mon_live_free();
+        return NM_ERR;
+    }
+
+    return NM_OK;
+}
+
+void nm_mon_live_free(void)
+{
+    nm_vect_free(&live.vms, nm_mon_live_vm_free_cb);
+    nm_vect_free(&live.events, nm_mon_live_event_free_cb);
+
+    if (live.ifd != -1) {
+        close(live.ifd);
+        live.ifd = -1;
+    }
+    if (live.epfd != -1) {
+        close(live.epfd);
+        live.epfd = -1;
+    }
+}
+
+int nm_mon_live_fd(void)
+{
+    return live.epfd;
+}
+
+void nm_mon_live_sync(const nm_svect_t *mon_list)
+{
+    if (live.epfd == -1) {
+        return;
+    }
+
+    /* forget removed VMs */
+    for (size_t n = live.vms.n_memb; n > 0; n--) {
+        const nm_live_vm_t *vm = nm_vect_at(&live.vms, n - 1);
+        bool found = false;
+
+        for (size_t m = 0; m < mon_list->n_memb; m++) {
+            if (nm_str_cmp_ss(&vm->name,
+                        nm_mon_item_get_name(mon_list, m)) == NM_OK) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            nm_vect_delete(&live.vms, n - 1, nm_mon_live_vm_free_cb);
+        }
+    }
+
+    for (size_t n = 0; n < mon_list->n_memb; n++) {
+        const nm_str_t *name = nm_mon_item_get_name(mon_list, n);
+        nm_live_vm_t vm = { NM_INIT_STR, -1, -1, 0, 0, 0 };
+
+        if (nm_mon_live_find(name)) {
+            continue;
+        }
+
+        nm_str_copy(&vm.name, name);
+        nm_mon_live_watch(&vm);
+        nm_vect_insert(&live.vms, &vm, sizeof(vm), NULL);
+    }
+}
+
+void nm_mon_live_track(const nm_str_t *name, pid_t pid)
+{
+    struct epoll_event ev = { .events = EPOLLIN };
+    nm_live_vm_t *vm;
+
+    if ((vm = nm_mon_live_find(name)) == NULL || pid <= 0) {
+        return;
+    }
+
+    vm->retry_at = 0;
+    vm->retries = 0;
+
+    if (vm->pidfd != -1 && vm->pid == pid) {
+        return;
+    }
+    nm_mon_live_close(vm);
+
+#if defined (SYS_pidfd_open)
+    vm->pidfd = syscall(SYS_pidfd_open, pid, 0);
+#endif
+    if (vm->pidfd == -1) {
+        nm_debug("%s: %s: pidfd_open error: %s\n",
+                __func__, name->data, strerror(errno));
+        return;
+    }
+
+    ev.data.fd = vm->pidfd;
+    if (epoll_ctl(live.epfd, EPOLL_CTL_ADD, vm->pidfd, &ev) == -1) {
+        nm_debug("%s: epoll_ctl error: %s\n", __func__, strerror(errno));
+        nm_mon_live_close(vm);
+        return;
+    }
+    vm->pid = pid;
+}
+
+void nm_mon_live_untrack(const nm_str_t *name)
+{
+    nm_live_vm_t *vm;
+
+    if ((vm = nm_mon_live_find(name)) != NULL) {
+        nm_mon_live_close(vm);
+    }
+}
+
+void nm_mon_live_retry(const nm_str_t *name)
+{
+    nm_live_vm_t *vm;
+
+    if ((vm = nm_mon_live_find(name)) == NULL) {
+        return;
+    }
+
+    if (vm->retries < NM_LIVE_RETRIES) {
+        vm->retries++;
+        vm->retry_at = nm_mono_ms() + NM_LIVE_RETRY_MS;
+    } else {
+        nm_debug("%s: %s: QMP socket is not available\n",
+                __func__, name->data);
+        vm->retry_at = 0;
+    }
+}
+
+int nm_mon_live_timeout(void)
+{
+    uint64_t now = nm_mono_ms();
+    int timeout = -1;
+
+    for (size_t n = 0; n < live.vms.n_memb; n++) {
+        const nm_live_vm_t *vm = nm_vect_at(&live.vms, n);
+        int left;
+
+        if (!vm->retry_at) {
+            continue;
+        }
+
+        left = (vm->retry_at > now) ? (int) (vm->retry_at - now) : 0;
+        if (timeout == -1 || left < timeout) {
+            timeout = left;
+        }
+    }
+
+    return timeout;
+}
+
+int nm_mon_live_next(nm_live_event_t *ev)
+{
+    const nm_live_event_t *cur;
+
+    if (live.epfd == -1) {
+        return NM_ERR;
+    }
+
+    if (!live.events.n_memb) {
+        nm_mon_live_collect();
+    }
+
+    if (!live.events.n_memb) {
+        return NM_ERR;
+    }
+
+    cur = nm_vect_at(&live.events, 0);
+    nm_str_copy(&ev->name, &cur->name);
+    ev->id = cur->id;
+    nm_vect_delete(&live.events, 0, nm_mon_live_event_free_cb);
+
+    return NM_OK;
+}
+
+static nm_live_vm_t *nm_mon_live_find(const nm_str_t *name)
+{
+    for (size_t n = 0; n < live.vms.n_memb; n++) {
+        nm_live_vm_t *vm = nm_vect_at(&live.vms, n);
+
+        if (nm_str_cmp_ss(&vm->name, name) == NM_OK) {
+            return vm;
+        }
+    }
+
+    return NULL;
+}
+
+static void nm_mon_live_watch(nm_live_vm_t *vm)
+{
+    nm_str_t path = NM_INIT_STR;
+
+    nm_str_format(&path, "%s/%s", nm_cfg_get()->vm_dir.data, vm->name.data);
+
+    /* VM without directory is still found by the periodic check */
+    if ((vm->wd = inotify_add_watch(live.ifd, path.data, NM_LIVE_MASK)) == -1) {
+        nm_debug("%s: %s: %s\n", __func__, path.data, strerror(errno));
+    }
+
+    nm_str_free(&path);
+}
+
+static void nm_mon_live_close(nm_live_vm_t *vm)
+{
+    if (vm->pidfd == -1) {
+        return;
+    }
+
+    epoll_ctl(live.epfd, EPOLL_CTL_DEL, vm->pidfd, NULL);
+    close(vm->pidfd);
+    vm->pidfd = -1;
+    vm->pid = 0;
+}
+
+static void nm_mon_live_collect(void)
+{
+    struct epoll_event evs[NM_LIVE_EPOLL_MAX];
+    uint64_t now = nm_mono_ms();
+    int nevents;
+
+    do {
+        nevents = epoll_wait(live.epfd, evs, NM_LIVE_EPOLL_MAX, 0);
+
+        for (int n = 0; n < nevents; n++) {
+            if (evs[n].data.fd == live.ifd) {
+                nm_mon_live_inotify();
+            } else {
+                nm_mon_live_exited(evs[n].data.fd);
+            }
+        }
+    } while (nevents == NM_LIVE_EPOLL_MAX);
+
+    for (size_t n = 0; n < live.vms.n_memb; n++) {
+        nm_live_vm_t *vm = nm_vect_at(&live.vms, n);
+
+        if (vm->retry_at && now >= vm->retry_at) {
+            vm->retry_at = 0;
+            nm_mon_live_push(&vm->name, NM_LIVE_EV_CHANGE);
+        }
+    }
+}
+
+static void nm_mon_live_inotify(void)
+{
+    char buf[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+
+    while ((len = read(live.ifd, buf, sizeof(buf))) > 0) {
+        const struct inotify_event *ie;
+
+        for (char *ptr = buf; ptr < buf + len;
+                ptr += sizeof(struct inotify_event) + ie->len) {
+            nm_live_vm_t *vm = NULL;
+
+            ie = (const struct inotify_event *) ptr;
+
+            for (size_t n = 0; n < live.vms.n_memb; n++) {
+                nm_live_vm_t *cur = nm_vect_at(&live.vms, n);
+
+                if (cur->wd == ie->wd) {
+                    vm = cur;
+                    break;
+                }
+            }
+
+            if (!vm) {
+                continue;
+            }
+
+            /* directory was removed */
+            if (ie->mask & IN_IGNORED) {
+                vm->wd = -1;
+                continue;
+            }
+
+            if (!ie->len ||
+                    (nm_str_cmp_tt(ie->name, NM_VM_PID_FILE) != NM_OK &&
+                     nm_str_cmp_tt(ie->name, NM_VM_QMP_FILE) != NM_OK)) {
+                continue;
+            }
+
+            vm->retries = 0;
+            nm_mon_live_push(&vm->name, NM_LIVE_EV_CHANGE);
+        }
+    }
+}
+
+static void nm_mon_live_exited(int pidfd)
+{
+    for (size_t n = 0; n < live.vms.n_memb; n++) {
+        nm_live_vm_t *vm = nm_vect_at(&live.vms, n);
+
+        if (vm->pidfd == pidfd) {
+            nm_debug("%s: %s: pid %d\n", __func__, vm->name.data, vm->pid);
+            nm_mon_live_close(vm);
+            nm_mon_live_push(&vm->name, NM_LIVE_EV_EXIT);
+            return;
+        }
+    }
+}
+
+static void nm_mon_live_push(const nm_str_t *name, int id)
+{
+    nm_live_event_t ev = NM_INIT_LIVE_EVENT;
+
+    /* several files are changed at VM start and stop */
+    for (size_t n = 0; n < live.events.n_memb; n++) {
+        const nm_live_event_t *cur = nm_vect_at(&live.events, n);
+
+        if (cur->id == id && nm_str_cmp_ss(&cur->name, name) == NM_OK) {
+            return;
+        }
+    }
+
+    nm_str_copy(&ev.name, name);
+    ev.id = id;
+    nm_vect_insert(&live.events, &ev, sizeof(ev), NULL);
+}
+
+static void nm_mon_live_vm_free_cb(void *unit_p)
+{
+    nm_live_vm_t *vm = unit_p;
+
+    nm_mon_live_close(vm);
+    if (vm->wd != -1) {
+        inotify_rm_watch(live.ifd, vm->wd);
+    }
+    nm_str_free(&vm->name);
+}
+
+static void nm_mon_live_event_free_cb(void *unit_p)
+{
+    nm_str_free(&((nm_live_event_t *) unit_p)->name);
+}
+
+#else /* NM_OS_LINUX */
+
+int nm_mon_live_init(void)
+{
+    return NM_ERR;
+}
+
+void nm_mon_live_free(void)
+{
+}
+
+int nm_mon_live_fd(void)
+{
+    return -1;
+}
+
+void nm_mon_live_sync(const nm_svect_t *mon_list)
+{
+    (void) mon_list;
+}
+
+void nm_mon_live_track(const nm_str_t *name, pid_t pid)
+{
+    (void) name;
+    (void) pid;
+}
+
+void nm_mon_live_untrack(const nm_str_t *name)
+{
+    (void) name;
+}
+
+void nm_mon_live_retry(const nm_str_t *name)
+{
+    (void) name;
+}
+
+int nm_mon_live_timeout(void)
+{
+    return -1;
+}
+
+int nm_mon_live_next(nm_live_event_t *ev)
+{
+    (void) ev;
+    return NM_ERR;
+}
+#endif /* NM_OS_LINUX */
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,46 @@
+#ifndef NM_MON_LIVE_H_
+#define NM_MON_LIVE_H_
+
+#include <nm_string.h>
+#include <nm_vector.h>
+
+#include <sys/types.h>
+
+/*
+ * VM liveness engine of the monitoring daemon. VM directories are
+ * watched with inotify for QEMU pid file and QMP socket changes,
+ * running QEMU processes are watched with pidfd. Both are collected
+ * by epoll, the daemon main loop polls nm_mon_live_fd() and takes
+ * events with nm_mon_live_next().
+ *
+ * nm_mon_live_init() returns NM_ERR if the engine is not supported,
+ * the daemon falls back to periodic QMP socket checks then.
+ */
+enum {
+    NM_LIVE_EV_CHANGE = 0,  /* pid file or QMP socket was changed */
+    NM_LIVE_EV_EXIT         /* QEMU process exited */
+};
+
+typedef struct {
+    nm_str_t name;
+    int id;
+} nm_live_event_t;
+
+#define NM_INIT_LIVE_EVENT (nm_live_event_t) { NM_INIT_STR, 0 }
+
+int nm_mon_live_init(void);
+void nm_mon_live_free(void);
+int nm_mon_live_fd(void);
+/* watch directories of VMs from the list, forget removed ones */
+void nm_mon_live_sync(const nm_svect_t *mon_list);
+/* watch QEMU process of the running VM */
+void nm_mon_live_track(const nm_str_t *name, pid_t pid);
+void nm_mon_live_untrack(const nm_str_t *name);
+/* VM is not reachable yet after CHANGE, report CHANGE again shortly */
+void nm_mon_live_retry(const nm_str_t *name);
+/* milliseconds until the next retry, -1 if there is none */
+int nm_mon_live_timeout(void);
+int nm_mon_live_next(nm_live_event_t *ev);
+
+#endif /* NM_MON_LIVE_H_ */
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,946 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_procfs.h>
+#include <nm_mon_shm.h>
+#include <nm_mon_metrics.h>
+#include <nm_qmp_reactor.h>
+
+#include <dirent.h>
+#include <pthread.h>
+
+#include <json.h>
+
+enum {
+    NM_METRICS_BUF_LEN = 4096,
+    NM_METRICS_PATH_LEN = 64,
+};
+
+/* fields of /proc/<pid>/stat after the process name */
+enum {
+    NM_METRICS_STAT_MAJFLT = 9,
+    NM_METRICS_STAT_UTIME = 11,
+    NM_METRICS_STAT_STIME = 12,
+    NM_METRICS_STAT_THREADS = 17,
+    NM_METRICS_STAT_RSS = 21,
+};
+
+typedef struct {
+    pid_t pid;
+    uint64_t ts;        /* ms when the reply was received */
+    nm_metrics_blk_cnt_t cnt;
+} nm_metrics_blk_t;
+
+typedef struct nm_metrics_task {
+    pid_t tid;
+    int fd;         /* /proc/<pid>/task/<tid>/status */
+    int sched_fd;   /* /proc/<pid>/task/<tid>/schedstat */
+    int32_t vcpu;   /* vCPU index, -1 for other threads */
+    char name[NM_METRICS_NAME_LEN];
+    uint64_t run;   /* ns on CPU */
+    uint64_t wait;  /* ns waiting on a run queue */
+    uint64_t ts;    /* ms of the last schedstat read, 0 if none */
+    float cpu;
+    float delay;
+    bool valid;     /* rates are computed from two reads */
+} nm_metrics_task_t;
+
+struct nm_metrics_proc {
+    pid_t pid;
+    int stat_fd;
+    int io_fd;      /* -1 if QEMU runs as another user */
+    nm_metrics_task_t *tasks;
+    size_t n_tasks;
+    uint64_t vcpu_gen;
+    nm_metrics_blk_t blk[NM_METRICS_DRIVES]; /* previous blockstats */
+    size_t n_blk;
+    uint64_t blk_ts;
+    nm_metrics_drive_t drives[NM_METRICS_DRIVES];
+    size_t n_drives;
+    nm_metrics_sample_t last;   /* ts is 0 if there is none */
+    char ifaces[NM_METRICS_IFACES][NM_METRICS_NAME_LEN];
+    size_t n_ifaces;
+};
+
+typedef struct {
+    pid_t pid;
+    pid_t tid;
+    int32_t vcpu;
+} nm_metrics_vcpu_t;
+
+/*
+ * Data reported by QEMU: vCPU thread ids from query-cpus-fast and
+ * block device counters from query-blockstats. Written by the QMP
+ * reactor thread, read by the daemon main loop while sampling.
+ */
+static struct {
+    pthread_mutex_t mtx;
+    nm_vect_t vcpus;    /* nm_metrics_vcpu_t */
+    uint64_t vcpu_gen;  /* incremented on every vCPU list change */
+    nm_vect_t blk;      /* nm_metrics_blk_t */
+} nm_qmp_data = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .vcpus = NM_INIT_VECT,
+    .blk = NM_INIT_VECT,
+};
+
+/*
+ * Two latest link counter dumps shared by all VMs.
+ * Accessed only from the daemon main loop or the TUI thread.
+ */
+static struct {
+    nm_vect_t prev;     /* nm_net_link_stats_t sorted by name */
+    nm_vect_t cur;
+    uint64_t prev_ts;   /* ms */
+    uint64_t cur_ts;
+} nm_links = {
+    .prev = NM_INIT_VECT,
+    .cur = NM_INIT_VECT,
+};
+
+static const char NM_METRICS_CMD_CPUS[] = "{\"execute\":\"query-cpus-fast\"}";
+static const char NM_METRICS_CMD_BLK[] = "{\"execute\":\"query-blockstats\"}";
+
+/* called with QMP data mutex held */
+static void nm_mon_metrics_vcpus_forget(pid_t pid)
+{
+    for (size_t n = nm_qmp_data.vcpus.n_memb; n > 0; n--) {
+        const nm_metrics_vcpu_t *vcpu = nm_vect_at(&nm_qmp_data.vcpus, n - 1);
+
+        if (vcpu->pid == pid) {
+            nm_vect_delete(&nm_qmp_data.vcpus, n - 1, NULL);
+        }
+    }
+    nm_qmp_data.vcpu_gen++;
+}
+
+/* called with QMP data mutex held */
+static void nm_mon_metrics_blk_forget(pid_t pid)
+{
+    for (size_t n = nm_qmp_data.blk.n_memb; n > 0; n--) {
+        const nm_metrics_blk_t *blk = nm_vect_at(&nm_qmp_data.blk, n - 1);
+
+        if (blk->pid == pid) {
+            nm_vect_delete(&nm_qmp_data.blk, n - 1, NULL);
+        }
+    }
+}
+
+static uint64_t nm_mon_metrics_json_u64(struct json_object *obj,
+        const char *key)
+{
+    struct json_object *val;
+
+    if (!json_object_object_get_ex(obj, key, &val)) {
+        return 0;
+    }
+
+    return (uint64_t) json_object_get_int64(val);
+}
+
+static void nm_mon_metrics_blk_cb(int rc, struct json_object *msg, void *ctx)
+{
+    pid_t pid = (pid_t) (intptr_t) ctx;
+    struct json_object *ret;
+    uint64_t ts = nm_mono_ms();
+
+    if (rc != NM_OK || !json_object_object_get_ex(msg, "return", &ret) ||
+            !json_object_is_type(ret, json_type_array)) {
+        return;
+    }
+
+    pthread_mutex_lock(&nm_qmp_data.mtx);
+    nm_mon_metrics_blk_forget(pid);
+    for (size_t n = 0; n < json_object_array_length(ret); n++) {
+        struct json_object *dev = json_object_array_get_idx(ret, n);
+        struct json_object *name, *stats;
+        nm_metrics_blk_t blk;
+
+        /*
+         * drives are started with node-name=hdN, or id=hdN if temporary,
+         * QEMU generated node names start with '#' then.
+         */
+        if (!json_object_object_get_ex(dev, "node-name", &name) ||
+                *json_object_get_string(name) == '#') {
+            if (!json_object_object_get_ex(dev, "device", &name)) {
+                continue;
+            }
+        }
+        if (!json_object_object_get_ex(dev, "stats", &stats)) {
+            continue;
+        }
+
+        memset(&blk, 0, sizeof(blk));
+        blk.pid = pid;
+        blk.ts = ts;
+        nm_strlcpy(blk.cnt.name, json_object_get_string(name),
+                sizeof(blk.cnt.name));
+        blk.cnt.rd_bytes = nm_mon_metrics_json_u64(stats, "rd_bytes");
+        blk.cnt.wr_bytes = nm_mon_metrics_json_u64(stats, "wr_bytes");
+        blk.cnt.rd_ops = nm_mon_metrics_json_u64(stats, "rd_operations");
+        blk.cnt.wr_ops = nm_mon_metrics_json_u64(stats, "wr_operations");
+        blk.cnt.rd_time = nm_mon_metrics_json_u64(stats, "rd_total_time_ns");
+        blk.cnt.wr_time = nm_mon_metrics_json_u64(stats, "wr_total_time_ns");
+        nm_vect_insert(&nm_qmp_data.blk, &blk, sizeof(blk), NULL);
+    }
+    pthread_mutex_unlock(&nm_qmp_data.mtx);
+}
+
+static void nm_mon_metrics_vcpus_cb(int rc, struct json_object *msg, void *ctx)
+{
+    pid_t pid = (pid_t) (intptr_t) ctx;
+    struct json_object *ret;
+
+    if (rc != NM_OK || !json_object_object_get_ex(msg, "return", &ret) ||
+            !json_object_is_type(ret, json_type_array)) {
+        nm_debug("%s: no vCPU threads of %d\n", __func__, pid);
+        return;
+    }
+
+    pthread_mutex_lock(&nm_qmp_data.mtx);
+    nm_mon_metrics_vcpus_forget(pid);
+    for (size_t n = 0; n < json_object_array_length(ret); n++) {
+        struct json_object *cpu = json_object_array_get_idx(ret, n);
+        struct json_object *idx, *tid;
+        nm_metrics_vcpu_t vcpu;
+
+        if (!json_object_object_get_ex(cpu, "cpu-index", &idx) ||
+                !json_object_object_get_ex(cpu, "thread-id", &tid)) {
+            continue;
+        }
+
+        vcpu.pid = pid;
+        vcpu.tid = json_object_get_int(tid);
+        vcpu.vcpu = json_object_get_int(idx);
+        nm_vect_insert(&nm_qmp_data.vcpus, &vcpu, sizeof(vcpu), NULL);
+    }
+    pthread_mutex_unlock(&nm_qmp_data.mtx);
+}
+
+#if defined (NM_OS_LINUX)
+static void nm_mon_metrics_task_close(nm_metrics_task_t *task)
+{
+    close(task->fd);
+    if (task->sched_fd != -1) {
+        close(task->sched_fd);
+    }
+}
+
+static void nm_mon_metrics_tasks_close(nm_metrics_proc_t *proc)
+{
+    for (size_t n = 0; n < proc->n_tasks; n++) {
+        nm_mon_metrics_task_close(&proc->tasks[n]);
+    }
+    free(proc->tasks);
+    proc->tasks = NULL;
+    proc->n_tasks = 0;
+}
+
+static int nm_mon_metrics_task_open(const nm_metrics_proc_t *proc,
+        pid_t tid, nm_metrics_task_t *task)
+{
+    char path[NM_METRICS_PATH_LEN];
+    ssize_t nread;
+    int fd;
+
+    memset(task, 0, sizeof(*task));
+    task->tid = tid;
+    task->vcpu = -1;
+
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/status", proc->pid, tid);
+    if ((task->fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+        return NM_ERR;
+    }
+
+    /* not available without CONFIG_SCHED_INFO */
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/schedstat",
+            proc->pid, tid);
+    task->sched_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    /* thread name does not change often, read it once */
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/comm", proc->pid, tid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) != -1) {
+        if ((nread = nm_procfs_pread(fd, task->name,
+                        sizeof(task->name))) > 0 &&
+                task->name[nread - 1] == '\n') {
+            task->name[nread - 1] = '\0';
+        }
+        close(fd);
+    }
+
+    return NM_OK;
+}
+
+/*
+ * Threads were created or exited. Keep descriptors and counters
+ * of remaining threads, open files of the new ones.
+ */
+static void nm_mon_metrics_tasks_open(nm_metrics_proc_t *proc,
+        size_t threads)
+{
+    char path[NM_METRICS_PATH_LEN];
+    size_t size = nm_max(threads, (size_t) 1);
+    nm_metrics_task_t *tasks;
+    struct dirent *entry;
+    size_t n_tasks = 0;
+    DIR *dir;
+
+    snprintf(path, sizeof(path), "/proc/%d/task", proc->pid);
+    if ((dir = opendir(path)) == NULL) {
+        nm_mon_metrics_tasks_close(proc);
+        return;
+    }
+
+    tasks = nm_calloc(size, sizeof(nm_metrics_task_t));
+
+    while ((entry = readdir(dir)) != NULL) {
+        pid_t tid;
+        size_t old;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        if (n_tasks == size) {
+            size *= 2;
+            tasks = nm_realloc(tasks, size * sizeof(nm_metrics_task_t));
+        }
+
+        tid = atoi(entry->d_name);
+        for (old = 0; old < proc->n_tasks; old++) {
+            if (proc->tasks[old].tid == tid) {
+                break;
+            }
+        }
+
+        if (old < proc->n_tasks) {
+            tasks[n_tasks++] = proc->tasks[old];
+            proc->tasks[old] = proc->tasks[--proc->n_tasks];
+        } else if (nm_mon_metrics_task_open(proc, tid,
+                    &tasks[n_tasks]) == NM_OK) {
+            n_tasks++;
+        }
+    }
+
+    closedir(dir);
+
+    /* threads that have gone */
+    nm_mon_metrics_tasks_close(proc);
+    proc->tasks = tasks;
+    proc->n_tasks = n_tasks;
+    proc->vcpu_gen = 0;
+}
+
+/* label threads with vCPU indexes received from QEMU */
+static void nm_mon_metrics_tasks_vcpus(nm_metrics_proc_t *proc)
+{
+    pthread_mutex_lock(&nm_qmp_data.mtx);
+    if (proc->vcpu_gen != nm_qmp_data.vcpu_gen) {
+        for (size_t n = 0; n < proc->n_tasks; n++) {
+            nm_metrics_task_t *task = &proc->tasks[n];
+
+            task->vcpu = -1;
+            for (size_t v = 0; v < nm_qmp_data.vcpus.n_memb; v++) {
+                const nm_metrics_vcpu_t *vcpu = nm_vect_at(&nm_qmp_data.vcpus, v);
+
+                /* without MTTCG all vCPUs share one thread */
+                if (vcpu->pid == proc->pid && vcpu->tid == task->tid &&
+                        (task->vcpu == -1 || vcpu->vcpu < task->vcpu)) {
+                    task->vcpu = vcpu->vcpu;
+                }
+            }
+        }
+        proc->vcpu_gen = nm_qmp_data.vcpu_gen;
+    }
+    pthread_mutex_unlock(&nm_qmp_data.mtx);
+}
+
+static void nm_mon_metrics_task_sched(nm_metrics_task_t *task, uint64_t ts)
+{
+    char buf[NM_METRICS_BUF_LEN];
+    const char *p = buf;
+    uint64_t run, wait;
+
+    if (task->sched_fd == -1 ||
+            nm_procfs_pread(task->sched_fd, buf, sizeof(buf)) <= 0) {
+        task->valid = false;
+        return;
+    }
+
+    run = nm_procfs_u64(&p);
+    wait = nm_procfs_u64(&p);
+
+    task->valid = (task->ts && ts > task->ts &&
+            run >= task->run && wait >= task->wait);
+    if (task->valid) {
+        /* ns per ms of the interval, in percent */
+        task->cpu = (float) (run - task->run) / (ts - task->ts) / 1e4;
+        task->delay = (float) (wait - task->wait) / (ts - task->ts) / 1e4;
+    }
+
+    task->run = run;
+    task->wait = wait;
+    task->ts = ts;
+}
+
+static int nm_mon_metrics_stat(nm_metrics_proc_t *proc,
+        nm_metrics_sample_t *s, size_t *threads)
+{
+    char buf[NM_METRICS_BUF_LEN];
+    const char *p;
+
+    if (nm_procfs_pread(proc->stat_fd, buf, sizeof(buf)) <= 0 ||
+            (p = nm_procfs_stat_fields(buf)) == NULL) {
+        return NM_ERR;
+    }
+
+    p = nm_procfs_skip(p, NM_METRICS_STAT_MAJFLT);
+    s->majflt = nm_procfs_u64(&p);
+    p = nm_procfs_skip(p, NM_METRICS_STAT_UTIME -
+            NM_METRICS_STAT_MAJFLT - 1);
+    s->cpu = nm_procfs_u64(&p);
+    s->cpu += nm_procfs_u64(&p);
+    p = nm_procfs_skip(p, NM_METRICS_STAT_THREADS -
+            NM_METRICS_STAT_STIME - 1);
+    *threads = nm_procfs_u64(&p);
+    p = nm_procfs_skip(p, NM_METRICS_STAT_RSS -
+            NM_METRICS_STAT_THREADS - 1);
+    if (!*p) {
+        return NM_ERR;
+    }
+    s->rss = nm_procfs_u64(&p) * sysconf(_SC_PAGESIZE);
+
+    return NM_OK;
+}
+
+/* per thread counters: context switches, CPU time, run-queue delay */
+static void nm_mon_metrics_tasks(nm_metrics_proc_t *proc,
+        nm_metrics_sample_t *s, size_t threads)
+{
+    char buf[NM_METRICS_BUF_LEN];
+
+    /* second pass if a thread was replaced by another one */
+    for (int pass = 0; pass < 2; pass++) {
+        uint64_t ctxsw = 0;
+        size_t n;
+
+        if (pass || threads != proc->n_tasks) {
+            nm_mon_metrics_tasks_open(proc, threads);
+        }
+
+        for (n = 0; n < proc->n_tasks; n++) {
+            if (nm_procfs_pread(proc->tasks[n].fd, buf, sizeof(buf)) <= 0) {
+                break;
+            }
+
+            ctxsw += nm_procfs_key(buf, "\nvoluntary_ctxt_switches:") +
+                nm_procfs_key(buf, "\nnonvoluntary_ctxt_switches:");
+            nm_mon_metrics_task_sched(&proc->tasks[n], s->ts);
+        }
+
+        if (n == proc->n_tasks) {
+            s->ctxsw = ctxsw;
+            return;
+        }
+    }
+}
+
+static int nm_mon_metrics_thread_cmp(const void *a, const void *b)
+{
+    const nm_metrics_thread_t *t1 = a, *t2 = b;
+
+    /* vCPUs by index, then the main loop, then the busiest threads */
+    if ((t1->vcpu == -1) != (t2->vcpu == -1)) {
+        return (t1->vcpu == -1) ? 1 : -1;
+    }
+    if (t1->vcpu != -1) {
+        return t1->vcpu - t2->vcpu;
+    }
+    if (t1->main != t2->main) {
+        return t2->main - t1->main;
+    }
+
+    return (t1->cpu < t2->cpu) - (t1->cpu > t2->cpu);
+}
+
+static void nm_mon_metrics_io(nm_metrics_proc_t *proc,
+        nm_metrics_sample_t *s)
+{
+    char buf[NM_METRICS_BUF_LEN];
+
+    if (proc->io_fd == -1 ||
+            nm_procfs_pread(proc->io_fd, buf, sizeof(buf)) <= 0) {
+        return;
+    }
+
+    s->rd_bytes = nm_procfs_key(buf, "\nread_bytes:");
+    s->wr_bytes = nm_procfs_key(buf, "\nwrite_bytes:");
+}
+#endif /* NM_OS_LINUX */
+
+nm_metrics_proc_t *nm_mon_metrics_open(pid_t pid)
+{
+#if defined (NM_OS_LINUX)
+    char path[NM_METRICS_PATH_LEN];
+    nm_metrics_proc_t *proc;
+    int fd;
+
+    if (pid <= 0) {
+        return NULL;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+        nm_debug("%s: cannot open %s: %s\n", __func__, path, strerror(errno));
+        return NULL;
+    }
+
+    proc = nm_calloc(1, sizeof(nm_metrics_proc_t));
+    proc->pid = pid;
+    proc->stat_fd = fd;
+
+    snprintf(path, sizeof(path), "/proc/%d/io", pid);
+    proc->io_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    return proc;
+#else
+    (void) pid;
+    return NULL;
+#endif
+}
+
+void nm_mon_metrics_close(nm_metrics_proc_t *proc)
+{
+    if (!proc) {
+        return;
+    }
+
+    pthread_mutex_lock(&nm_qmp_data.mtx);
+    nm_mon_metrics_vcpus_forget(proc->pid);
+    nm_mon_metrics_blk_forget(proc->pid);
+    pthread_mutex_unlock(&nm_qmp_data.mtx);
+
+#if defined (NM_OS_LINUX)
+    nm_mon_metrics_tasks_close(proc);
+#endif
+    close(proc->stat_fd);
+    if (proc->io_fd != -1) {
+        close(proc->io_fd);
+    }
+    free(proc);
+}
+
+int nm_mon_metrics_sample(nm_metrics_proc_t *proc, nm_metrics_sample_t *s)
+{
+    memset(s, 0, sizeof(*s));
+
+    if (!proc) {
+        return NM_ERR;
+    }
+
+#if defined (NM_OS_LINUX)
+    size_t threads;
+
+    s->ts = nm_mono_ms();
+
+    /* descriptors refer to the process, not to a reused pid */
+    if (nm_mon_metrics_stat(proc, s, &threads) != NM_OK) {
+        return NM_ERR;
+    }
+
+    nm_mon_metrics_tasks(proc, s, threads);
+    nm_mon_metrics_io(proc, s);
+    proc->last = *s;
+
+    return NM_OK;
+#else
+    return NM_ERR;
+#endif
+}
+
+static void nm_mon_metrics_query(const nm_str_t *name, pid_t pid,
+        const char *cmd, nm_qmp_done_cb_t cb)
+{
+    nm_qmp_sess_t *sess;
+
+    if (pid <= 0 || (sess = nm_qmp_sess_get(name)) == NULL) {
+        return;
+    }
+
+    /* the reply is handled by the reactor thread */
+    if (nm_qmp_sess_pooled(sess)) {
+        nm_qmp_submit(sess, cmd, -1, NM_METRICS_INTERVAL,
+                cb, (void *) (intptr_t) pid);
+    }
+    nm_qmp_sess_put(sess);
+}
+
+void nm_mon_metrics_vcpus(const nm_str_t *name, pid_t pid)
+{
+    nm_mon_metrics_query(name, pid, NM_METRICS_CMD_CPUS,
+            nm_mon_metrics_vcpus_cb);
+}
+
+void nm_mon_metrics_blockstats(const nm_str_t *name,
+        const nm_metrics_proc_t *proc)
+{
+    if (proc) {
+        nm_mon_metrics_query(name, proc->pid, NM_METRICS_CMD_BLK,
+                nm_mon_metrics_blk_cb);
+    }
+}
+
+static void nm_mon_metrics_blk_rate(const nm_metrics_blk_t *prev,
+        const nm_metrics_blk_t *cur, nm_metrics_drive_t *drive)
+{
+    const nm_metrics_blk_cnt_t *p = &prev->cnt, *c = &cur->cnt;
+    double sec = (double) (cur->ts - prev->ts) / 1000.0;
+    uint64_t rd_ops = c->rd_ops - p->rd_ops;
+    uint64_t wr_ops = c->wr_ops - p->wr_ops;
+
+    memset(drive, 0, sizeof(*drive));
+    memcpy(drive->name, c->name, sizeof(drive->name));
+    drive->rd_iops = rd_ops / sec;
+    drive->wr_iops = wr_ops / sec;
+    drive->rd_bps = (c->rd_bytes - p->rd_bytes) / sec;
+    drive->wr_bps = (c->wr_bytes - p->wr_bytes) / sec;
+    if (rd_ops) {
+        drive->rd_lat = (double) (c->rd_time - p->rd_time) / rd_ops / 1e6;
+    }
+    if (wr_ops) {
+        drive->wr_lat = (double) (c->wr_time - p->wr_time) / wr_ops / 1e6;
+    }
+}
+
+size_t nm_mon_metrics_drives(nm_metrics_proc_t *proc,
+        nm_metrics_drive_t *buf, size_t len)
+{
+    nm_metrics_blk_t cur[NM_METRICS_DRIVES];
+    size_t n_cur = 0;
+
+    if (!proc) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&nm_qmp_data.mtx);
+    for (size_t n = 0; n < nm_qmp_data.blk.n_memb &&
+            n_cur < NM_METRICS_DRIVES; n++) {
+        const nm_metrics_blk_t *blk = nm_vect_at(&nm_qmp_data.blk, n);
+
+        if (blk->pid == proc->pid) {
+            cur[n_cur++] = *blk;
+        }
+    }
+    pthread_mutex_unlock(&nm_qmp_data.mtx);
+
+    /* new reply, rates are computed against the previous one */
+    if (n_cur && cur[0].ts != proc->blk_ts) {
+        proc->n_drives = 0;
+        for (size_t n = 0; n < n_cur; n++) {
+            for (size_t old = 0; old < proc->n_blk; old++) {
+                const nm_metrics_blk_t *prev = &proc->blk[old];
+
+                if (strcmp(prev->cnt.name, cur[n].cnt.name) == 0 &&
+                        cur[n].ts > prev->ts &&
+                        cur[n].cnt.rd_ops >= prev->cnt.rd_ops &&
+                        cur[n].cnt.wr_ops >= prev->cnt.wr_ops) {
+                    nm_mon_metrics_blk_rate(prev, &cur[n],
+                            &proc->drives[proc->n_drives++]);
+                    break;
+                }
+            }
+        }
+        memcpy(proc->blk, cur, n_cur * sizeof(nm_metrics_blk_t));
+        proc->n_blk = n_cur;
+        proc->blk_ts = cur[0].ts;
+    }
+
+    len = nm_min(len, proc->n_drives);
+    memcpy(buf, proc->drives, len * sizeof(nm_metrics_drive_t));
+
+    return len;
+}
+
+void nm_mon_metrics_set_ifaces(nm_metrics_proc_t *proc, const nm_vect_t *names)
+{
+    if (!proc) {
+        return;
+    }
+
+    proc->n_ifaces = nm_min(names->n_memb, (size_t) NM_METRICS_IFACES);
+    for (size_t n = 0; n < proc->n_ifaces; n++) {
+        nm_strlcpy(proc->ifaces[n], nm_vect_str_ctx(names, n),
+                NM_METRICS_NAME_LEN);
+    }
+}
+
+void nm_mon_metrics_links(void)
+{
+    nm_vect_free(&nm_links.prev, NULL);
+    nm_links.prev = nm_links.cur;
+    nm_links.prev_ts = nm_links.cur_ts;
+
+    nm_links.cur = (nm_vect_t) NM_INIT_VECT;
+    nm_links.cur_ts = nm_mono_ms();
+    if (nm_net_link_stats(&nm_links.cur) != NM_OK) {
+        nm_vect_free(&nm_links.cur, NULL);
+    }
+}
+
+void nm_mon_metrics_links_free(void)
+{
+    nm_vect_free(&nm_links.prev, NULL);
+    nm_vect_free(&nm_links.cur, NULL);
+    nm_links.prev_ts = nm_links.cur_ts = 0;
+}
+
+int nm_mon_metrics_link(const char *name, nm_metrics_iface_t *iface)
+{
+    uint64_t ms = nm_links.cur_ts - nm_links.prev_ts;
+    const nm_net_link_stats_t *prev, *cur;
+
+    /* previous dump was taken before the sampling pause */
+    if (!nm_links.prev_ts || ms > 2 * NM_METRICS_INTERVAL) {
+        return NM_ERR;
+    }
+
+    if ((prev = nm_net_link_find(&nm_links.prev, name)) == NULL ||
+            (cur = nm_net_link_find(&nm_links.cur, name)) == NULL) {
+        return NM_ERR;
+    }
+
+    return nm_mon_metrics_link_rate(prev, cur, ms, iface);
+}
+
+size_t nm_mon_metrics_ifaces(const nm_metrics_proc_t *proc,
+        nm_metrics_iface_t *buf, size_t len)
+{
+    size_t count = 0;
+
+    if (!proc) {
+        return 0;
+    }
+
+    for (size_t n = 0; n < proc->n_ifaces && count < len; n++) {
+        if (nm_mon_metrics_link(proc->ifaces[n], &buf[count]) == NM_OK) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+const nm_metrics_sample_t *nm_mon_metrics_counters(
+        const nm_metrics_proc_t *proc)
+{
+    return (proc && proc->last.ts) ? &proc->last : NULL;
+}
+
+size_t nm_mon_metrics_blk_counters(const nm_metrics_proc_t *proc,
+        nm_metrics_blk_cnt_t *buf, size_t len)
+{
+    if (!proc) {
+        return 0;
+    }
+
+    len = nm_min(len, proc->n_blk);
+    for (size_t n = 0; n < len; n++) {
+        buf[n] = proc->blk[n].cnt;
+    }
+
+    return len;
+}
+
+size_t nm_mon_metrics_link_counters(const nm_metrics_proc_t *proc,
+        nm_net_link_stats_t *buf, size_t len)
+{
+    size_t count = 0;
+
+    if (!proc) {
+        return 0;
+    }
+
+    for (size_t n = 0; n < proc->n_ifaces && count < len; n++) {
+        const nm_net_link_stats_t *cur;
+
+        if ((cur = nm_net_link_find(&nm_links.cur, proc->ifaces[n])) != NULL) {
+            buf[count++] = *cur;
+        }
+    }
+
+    return count;
+}
+
+size_t nm_mon_metrics_threads(nm_metrics_proc_t *proc,
+        nm_metrics_thread_t *buf, size_t len)
+{
+#if defined (NM_OS_LINUX)
+    const char *main_name = "";
+    size_t count = 0;
+
+    if (!proc) {
+        return 0;
+    }
+
+    nm_mon_metrics_tasks_vcpus(proc);
+
+    for (size_t n = 0; n < proc->n_tasks; n++) {
+        if (proc->tasks[n].tid == proc->pid) {
+            main_name = proc->tasks[n].name;
+            break;
+        }
+    }
+
+    for (size_t n = 0; n < proc->n_tasks && count < len; n++) {
+        const nm_metrics_task_t *task = &proc->tasks[n];
+        nm_metrics_thread_t *thr = &buf[count];
+
+        if (!task->valid) {
+            continue;
+        }
+
+        memset(thr, 0, sizeof(*thr));
+        thr->tid = task->tid;
+        thr->vcpu = task->vcpu;
+        thr->main = (task->tid == proc->pid);
+        thr->cpu = task->cpu;
+        thr->delay = task->delay;
+        /* threads are named only with -name debug-threads=on */
+        if (thr->main || strcmp(task->name, main_name) != 0) {
+            memcpy(thr->name, task->name, sizeof(thr->name));
+        }
+        count++;
+    }
+
+    qsort(buf, count, sizeof(nm_metrics_thread_t), nm_mon_metrics_thread_cmp);
+
+    return count;
+#else
+    (void) proc;
+    (void) buf;
+    (void) len;
+    return 0;
+#endif
+}
+
+size_t nm_mon_metrics_get(const nm_str_t *name,
+        nm_metrics_sample_t *buf, size_t len)
+{
+    return nm_mon_shm_history(name, buf, len);
+}
+
+size_t nm_mon_metrics_get_threads(const nm_str_t *name,
+        nm_metrics_thread_t *buf, size_t len)
+{
+    return nm_mon_shm_threads(name, buf, len);
+}
+
+size_t nm_mon_metrics_get_drives(const nm_str_t *name,
+        nm_metrics_drive_t *buf, size_t len)
+{
+    return nm_mon_shm_drives(name, buf, len);
+}
+
+int nm_mon_metrics_drive(const nm_metrics_drive_t *drives, size_t count,
+        const char *name, nm_metrics_drive_t *drive)
+{
+    for (size_t n = 0; n < count; n++) {
+        if (strncmp(drives[n].name, name, NM_METRICS_NAME_LEN) == 0) {
+            *drive = drives[n];
+            return NM_OK;
+        }
+    }
+
+    return NM_ERR;
+}
+
+size_t nm_mon_metrics_get_ifaces(const nm_str_t *name,
+        nm_metrics_iface_t *buf, size_t len)
+{
+    return nm_mon_shm_ifaces(name, buf, len);
+}
+
+int nm_mon_metrics_iface(const nm_metrics_iface_t *ifaces, size_t count,
+        const char *name, nm_metrics_iface_t *iface)
+{
+    for (size_t n = 0; n < count; n++) {
+        if (strncmp(ifaces[n].name, name, NM_METRICS_NAME_LEN) == 0) {
+            *iface = ifaces[n];
+            return NM_OK;
+        }
+    }
+
+    return NM_ERR;
+}
+
+int nm_mon_metrics_link_rate(const nm_net_link_stats_t *prev,
+        const nm_net_link_stats_t *cur, uint64_t ms,
+        nm_metrics_iface_t *iface)
+{
+    double sec = (double) ms / 1000.0;
+
+    /* link was re-created */
+    if (!ms || cur->rx_packets < prev->rx_packets ||
+            cur->tx_packets < prev->tx_packets) {
+        return NM_ERR;
+    }
+
+    memset(iface, 0, sizeof(*iface));
+    nm_strlcpy(iface->name, cur->name, sizeof(iface->name));
+    iface->rx_pps = (cur->rx_packets - prev->rx_packets) / sec;
+    iface->tx_pps = (cur->tx_packets - prev->tx_packets) / sec;
+    iface->rx_bps = (cur->rx_bytes - prev->rx_bytes) / sec;
+    iface->tx_bps = (cur->tx_bytes - prev->tx_bytes) / sec;
+
+    return NM_OK;
+}
+
+void nm_mon_metrics_label(const nm_metrics_thread_t *thr,
+        char *buf, size_t len)
+{
+    if (thr->vcpu != -1) {
+        snprintf(buf, len, "vcpu%d:", thr->vcpu);
+    } else if (thr->main) {
+        snprintf(buf, len, "main:");
+    } else if (thr->name[0]) {
+        snprintf(buf, len, "%.*s:", NM_METRICS_NAME_LEN - 1, thr->name);
+    } else {
+        snprintf(buf, len, "tid %d:", thr->tid);
+    }
+}
+
+int nm_mon_metrics_rate(const nm_metrics_sample_t *prev,
+        const nm_metrics_sample_t *cur, nm_metrics_rate_t *rate)
+{
+    double sec;
+
+    if (cur->ts <= prev->ts || cur->cpu < prev->cpu ||
+            cur->majflt < prev->majflt || cur->ctxsw < prev->ctxsw ||
+            cur->rd_bytes < prev->rd_bytes || cur->wr_bytes < prev->wr_bytes) {
+        return NM_ERR;
+    }
+
+    sec = (double) (cur->ts - prev->ts) / 1000.0;
+
+    rate->cpu = (double) (cur->cpu - prev->cpu) /
+        (double) sysconf(_SC_CLK_TCK) / sec * 100.0;
+    rate->rss = cur->rss;
+    rate->majflt = (double) (cur->majflt - prev->majflt) / sec;
+    rate->ctxsw = (double) (cur->ctxsw - prev->ctxsw) / sec;
+    rate->rd_bytes = (double) (cur->rd_bytes - prev->rd_bytes) / sec;
+    rate->wr_bytes = (double) (cur->wr_bytes - prev->wr_bytes) / sec;
+
+    return NM_OK;
+}
+
+int nm_mon_metrics_last(const nm_str_t *name, nm_metrics_rate_t *rate)
+{
+    nm_metrics_sample_t samples[2];
+
+    if (nm_mon_metrics_get(name, samples, 2) != 2) {
+        return NM_ERR;
+    }
+
+    return nm_mon_metrics_rate(&samples[0], &samples[1], rate);
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,176 @@
+#ifndef NM_MON_METRICS_H_
+#define NM_MON_METRICS_H_
+
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_network.h>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * Resource usage of running QEMU processes. The monitoring daemon
+ * samples every running VM each NM_METRICS_INTERVAL milliseconds and
+ * keeps the last NM_METRICS_RING samples per VM in the status table,
+ * see nm_mon_shm.h. Samples hold raw counters, rates are computed
+ * by readers from two samples.
+ */
+
+#define NM_METRICS_RING     60   /* samples kept per VM */
+#define NM_METRICS_INTERVAL 1000 /* ms */
+#define NM_METRICS_THREADS  32   /* threads reported per VM */
+#define NM_METRICS_DRIVES   16   /* drives reported per VM */
+#define NM_METRICS_IFACES   16   /* network interfaces reported per VM */
+#define NM_METRICS_NAME_LEN 16
+
+typedef struct nm_metrics_sample {
+    uint64_t ts;        /* CLOCK_MONOTONIC ms */
+    uint64_t cpu;       /* utime + stime, clock ticks */
+    uint64_t rss;       /* bytes */
+    uint64_t majflt;    /* major page faults */
+    uint64_t ctxsw;     /* voluntary + involuntary context switches */
+    uint64_t rd_bytes;  /* bytes read from storage */
+    uint64_t wr_bytes;  /* bytes written to storage */
+} nm_metrics_sample_t;
+
+typedef struct nm_metrics_rate {
+    double cpu;         /* percent of one host CPU */
+    uint64_t rss;       /* bytes, from the newest sample */
+    double majflt;      /* per second */
+    double ctxsw;       /* per second */
+    double rd_bytes;    /* bytes per second */
+    double wr_bytes;    /* bytes per second */
+} nm_metrics_rate_t;
+
+/*
+ * QEMU thread usage over the last sampling interval. vCPU threads are
+ * identified by query-cpus-fast. Run-queue delay is the time thread
+ * was ready to run but waited for a host CPU, for vCPU threads it is
+ * the steal time seen by the guest.
+ */
+typedef struct nm_metrics_thread {
+    int32_t tid;
+    int32_t vcpu;       /* vCPU index, -1 for other threads */
+    char name[NM_METRICS_NAME_LEN];
+    float cpu;          /* percent of one host CPU */
+    float delay;        /* run-queue delay, percent of the interval */
+    uint8_t main;       /* QEMU main loop thread */
+    uint8_t pad[7];
+} nm_metrics_thread_t;
+
+/* block device usage from QMP query-blockstats */
+typedef struct nm_metrics_drive {
+    char name[NM_METRICS_NAME_LEN]; /* hdN */
+    float rd_iops;
+    float wr_iops;
+    float rd_lat;       /* average request latency, ms */
+    float wr_lat;
+    double rd_bps;      /* bytes per second */
+    double wr_bps;
+} nm_metrics_drive_t;
+
+/*
+ * Network interface usage from RTM_GETLINK link counters. Counted on
+ * the host side of tap or macvtap: rx is sent by the guest.
+ */
+typedef struct nm_metrics_iface {
+    char name[NM_METRICS_NAME_LEN]; /* host interface name */
+    float rx_pps;
+    float tx_pps;
+    double rx_bps;      /* bytes per second */
+    double tx_bps;
+} nm_metrics_iface_t;
+
+/* cumulative counters from query-blockstats */
+typedef struct nm_metrics_blk_cnt {
+    char name[NM_METRICS_NAME_LEN]; /* hdN */
+    uint64_t rd_bytes;
+    uint64_t wr_bytes;
+    uint64_t rd_ops;
+    uint64_t wr_ops;
+    uint64_t rd_time;   /* ns */
+    uint64_t wr_time;   /* ns */
+} nm_metrics_blk_cnt_t;
+
+/*
+ * Daemon side. procfs files of the process are opened once and
+ * re-read with pread(2) on every sample.
+ */
+typedef struct nm_metrics_proc nm_metrics_proc_t;
+
+/* returns NULL if the process is gone or sampling is not supported */
+nm_metrics_proc_t *nm_mon_metrics_open(pid_t pid);
+void nm_mon_metrics_close(nm_metrics_proc_t *proc);
+int nm_mon_metrics_sample(nm_metrics_proc_t *proc, nm_metrics_sample_t *s);
+/* per thread usage since the previous sample, sorted for display */
+size_t nm_mon_metrics_threads(nm_metrics_proc_t *proc,
+        nm_metrics_thread_t *buf, size_t len);
+/* ask QEMU for vCPU thread ids, the answer is applied asynchronously */
+void nm_mon_metrics_vcpus(const nm_str_t *name, pid_t pid);
+/* ask QEMU for block device counters, see nm_mon_metrics_drives() */
+void nm_mon_metrics_blockstats(const nm_str_t *name,
+        const nm_metrics_proc_t *proc);
+/* drive rates between two latest query-blockstats replies */
+size_t nm_mon_metrics_drives(nm_metrics_proc_t *proc,
+        nm_metrics_drive_t *buf, size_t len);
+/* host interfaces of VM, names are copied */
+void nm_mon_metrics_set_ifaces(nm_metrics_proc_t *proc, const nm_vect_t *names);
+/*
+ * Take counters of all tap, macvtap and veth links, once per sampling
+ * interval. Also used by the LAN view for veth links.
+ */
+void nm_mon_metrics_links(void);
+void nm_mon_metrics_links_free(void);
+/* link rates between two latest nm_mon_metrics_links() calls */
+int nm_mon_metrics_link(const char *name, nm_metrics_iface_t *iface);
+size_t nm_mon_metrics_ifaces(const nm_metrics_proc_t *proc,
+        nm_metrics_iface_t *buf, size_t len);
+/*
+ * Raw counters for the exporter: the newest sample (NULL if there
+ * is none), the latest query-blockstats reply and the latest link dump.
+ */
+const nm_metrics_sample_t *nm_mon_metrics_counters(
+        const nm_metrics_proc_t *proc);
+size_t nm_mon_metrics_blk_counters(const nm_metrics_proc_t *proc,
+        nm_metrics_blk_cnt_t *buf, size_t len);
+size_t nm_mon_metrics_link_counters(const nm_metrics_proc_t *proc,
+        nm_net_link_stats_t *buf, size_t len);
+
+/*
+ * Reader side.
+ * Copy up to len recent samples of VM into buf, oldest first.
+ * Returns number of samples, 0 if the daemon is not running or VM
+ * is stopped.
+ */
+size_t nm_mon_metrics_get(const nm_str_t *name,
+        nm_metrics_sample_t *buf, size_t len);
+/* threads of VM from the newest sample */
+size_t nm_mon_metrics_get_threads(const nm_str_t *name,
+        nm_metrics_thread_t *buf, size_t len);
+/* drives of VM from the newest sample */
+size_t nm_mon_metrics_get_drives(const nm_str_t *name,
+        nm_metrics_drive_t *buf, size_t len);
+/* drive by name (hdN), NM_ERR if there is no data */
+int nm_mon_metrics_drive(const nm_metrics_drive_t *drives, size_t count,
+        const char *name, nm_metrics_drive_t *drive);
+/* interfaces of VM from the newest sample */
+size_t nm_mon_metrics_get_ifaces(const nm_str_t *name,
+        nm_metrics_iface_t *buf, size_t len);
+/* interface by host name, NM_ERR if there is no data */
+int nm_mon_metrics_iface(const nm_metrics_iface_t *ifaces, size_t count,
+        const char *name, nm_metrics_iface_t *iface);
+/* rates between two link counters, NM_ERR if counters were reset */
+int nm_mon_metrics_link_rate(const nm_net_link_stats_t *prev,
+        const nm_net_link_stats_t *cur, uint64_t ms,
+        nm_metrics_iface_t *iface);
+/* display label of the thread: vcpuN, main, name or tid */
+void nm_mon_metrics_label(const nm_metrics_thread_t *thr,
+        char *buf, size_t len);
+/* rates between two samples, NM_ERR if they are not comparable */
+int nm_mon_metrics_rate(const nm_metrics_sample_t *prev,
+        const nm_metrics_sample_t *cur, nm_metrics_rate_t *rate);
+/* rates between two newest samples of VM */
+int nm_mon_metrics_last(const nm_str_t *name, nm_metrics_rate_t *rate);
+
+#endif /* NM_MON_METRICS_H_ */
+/* vim:set ts=4 sw=4: */
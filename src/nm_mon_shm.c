@@ -0,0 +1,521 @@
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_mon_shm.h>
+#include <nm_cfg_file.h>
+#include <nm_mon_daemon.h>
+#include <nm_qmp_control.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/* status is considered outdated if the daemon missed several checks */
+static const uint64_t NM_SHM_STALE_CHECKS = 3;
+static const uint64_t NM_SHM_STALE_MIN = 3000;
+/* writer sections are short, longer odd seq is checked against heartbeat */
+static const unsigned NM_SHM_SPIN = 1000;
+
+static nm_shm_hdr_t *shm_w;
+static size_t shm_w_size;
+
+static const nm_shm_hdr_t *shm_r;
+static size_t shm_r_size;
+
+static inline size_t nm_mon_shm_size(size_t count)
+{
+    return sizeof(nm_shm_hdr_t) +
+        count * (sizeof(nm_shm_vm_t) + sizeof(nm_shm_ring_t));
+}
+
+static inline nm_shm_ring_t *nm_mon_shm_rings(const nm_shm_hdr_t *hdr)
+{
+    return (nm_shm_ring_t *) &hdr->vms[hdr->capacity];
+}
+
+static inline void nm_mon_shm_seq_begin(uint32_t *seq)
+{
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void nm_mon_shm_seq_end(uint32_t *seq)
+{
+    __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline void nm_mon_shm_write_begin(nm_shm_hdr_t *hdr)
+{
+    nm_mon_shm_seq_begin(&hdr->seq);
+}
+
+static inline void nm_mon_shm_write_end(nm_shm_hdr_t *hdr)
+{
+    hdr->generation++;
+    nm_mon_shm_seq_end(&hdr->seq);
+}
+
+static void nm_mon_shm_retire(nm_shm_hdr_t *hdr, size_t size)
+{
+    nm_mon_shm_write_begin(hdr);
+    __atomic_store_n(&hdr->retired, 1, __ATOMIC_RELAXED);
+    nm_mon_shm_write_end(hdr);
+    munmap(hdr, size);
+}
+
+int nm_mon_shm_create(const nm_svect_t *mon_list)
+{
+    const nm_str_t *path = &nm_cfg_get()->daemon_shm;
+    nm_str_t tmp = NM_INIT_STR;
+    nm_shm_hdr_t *hdr;
+    size_t size;
+    int fd, rc = NM_ERR;
+
+    size = nm_mon_shm_size(mon_list->n_memb);
+
+    /*
+     * Build new table aside and replace the old one with rename(2),
+     * so readers never see a partially filled table.
+     */
+    nm_str_format(&tmp, "%s.%d", path->data, getpid());
+
+    if ((fd = open(tmp.data, O_RDWR | O_CREAT | O_TRUNC, 0600)) == -1) {
+        nm_debug("%s: cannot create %s: %s\n",
+                __func__, tmp.data, strerror(errno));
+        goto out;
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        nm_debug("%s: ftruncate error: %s\n", __func__, strerror(errno));
+        close(fd);
+        unlink(tmp.data);
+        goto out;
+    }
+
+    hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        nm_debug("%s: mmap error: %s\n", __func__, strerror(errno));
+        unlink(tmp.data);
+        goto out;
+    }
+
+    hdr->magic = NM_SHM_MAGIC;
+    hdr->version = NM_SHM_VERSION;
+    hdr->heartbeat = nm_mono_ms();
+    hdr->count = hdr->capacity = mon_list->n_memb;
+
+    /* both tables are sorted, entries of remaining VMs are kept */
+    for (size_t n = 0, old = 0; n < mon_list->n_memb; n++) {
+        int cmp = 1;
+
+        hdr->vms[n] = NM_INIT_SHM_VM;
+        nm_strlcpy(hdr->vms[n].name,
+                nm_mon_item_get_name_cstr(mon_list, n), NM_SHM_NAME_MAX);
+
+        while (shm_w && old < shm_w->count &&
+                (cmp = strncmp(shm_w->vms[old].name, hdr->vms[n].name,
+                               NM_SHM_NAME_MAX)) < 0) {
+            old++;
+        }
+        if (shm_w && old < shm_w->count && !cmp) {
+            nm_mon_shm_rings(hdr)[n] = nm_mon_shm_rings(shm_w)[old];
+            nm_mon_shm_rings(hdr)[n].seq = 0;
+            hdr->vms[n] = shm_w->vms[old++];
+        }
+    }
+
+    if (rename(tmp.data, path->data) != 0) {
+        nm_debug("%s: rename error: %s\n", __func__, strerror(errno));
+        munmap(hdr, size);
+        unlink(tmp.data);
+        goto out;
+    }
+
+    if (shm_w) {
+        nm_mon_shm_retire(shm_w, shm_w_size);
+    }
+
+    shm_w = hdr;
+    shm_w_size = size;
+    rc = NM_OK;
+
+out:
+    nm_str_free(&tmp);
+    return rc;
+}
+
+void nm_mon_shm_update(size_t idx, int8_t state, pid_t pid)
+{
+    struct timespec ts;
+
+    if (!shm_w || idx >= shm_w->count) {
+        return;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    /* counters of the new process are not comparable with old ones */
+    if (shm_w->vms[idx].pid != pid) {
+        nm_shm_ring_t *ring = &nm_mon_shm_rings(shm_w)[idx];
+
+        nm_mon_shm_seq_begin(&ring->seq);
+        ring->head = ring->count = 0;
+        ring->n_threads = ring->n_drives = ring->n_ifaces = 0;
+        nm_mon_shm_seq_end(&ring->seq);
+    }
+
+    nm_mon_shm_write_begin(shm_w);
+    shm_w->vms[idx].state = state;
+    shm_w->vms[idx].paused = 0;
+    shm_w->vms[idx].pid = pid;
+    shm_w->vms[idx].changed = (uint64_t) ts.tv_sec * 1000 +
+        ts.tv_nsec / 1000000;
+    nm_mon_shm_write_end(shm_w);
+}
+
+void nm_mon_shm_set_paused(size_t idx, bool paused)
+{
+    if (!shm_w || idx >= shm_w->count ||
+            shm_w->vms[idx].paused == paused) {
+        return;
+    }
+
+    nm_mon_shm_write_begin(shm_w);
+    shm_w->vms[idx].paused = paused;
+    nm_mon_shm_write_end(shm_w);
+}
+
+void nm_mon_shm_push_sample(size_t idx, const nm_metrics_sample_t *s,
+        const nm_metrics_thread_t *threads, size_t n_threads)
+{
+    nm_shm_ring_t *ring;
+
+    if (!shm_w || idx >= shm_w->count) {
+        return;
+    }
+
+    ring = &nm_mon_shm_rings(shm_w)[idx];
+
+    nm_mon_shm_seq_begin(&ring->seq);
+    ring->samples[ring->head] = *s;
+    ring->head = (ring->head + 1) % NM_METRICS_RING;
+    if (ring->count < NM_METRICS_RING) {
+        ring->count++;
+    }
+    ring->n_threads = nm_min(n_threads, (size_t) NM_METRICS_THREADS);
+    memcpy(ring->threads, threads,
+            ring->n_threads * sizeof(nm_metrics_thread_t));
+    nm_mon_shm_seq_end(&ring->seq);
+}
+
+void nm_mon_shm_set_drives(size_t idx,
+        const nm_metrics_drive_t *drives, size_t n_drives)
+{
+    nm_shm_ring_t *ring;
+
+    if (!shm_w || idx >= shm_w->count) {
+        return;
+    }
+
+    ring = &nm_mon_shm_rings(shm_w)[idx];
+
+    nm_mon_shm_seq_begin(&ring->seq);
+    ring->n_drives = nm_min(n_drives, (size_t) NM_METRICS_DRIVES);
+    memcpy(ring->drives, drives,
+            ring->n_drives * sizeof(nm_metrics_drive_t));
+    nm_mon_shm_seq_end(&ring->seq);
+}
+
+void nm_mon_shm_set_ifaces(size_t idx,
+        const nm_metrics_iface_t *ifaces, size_t n_ifaces)
+{
+    nm_shm_ring_t *ring;
+
+    if (!shm_w || idx >= shm_w->count) {
+        return;
+    }
+
+    ring = &nm_mon_shm_rings(shm_w)[idx];
+
+    nm_mon_shm_seq_begin(&ring->seq);
+    ring->n_ifaces = nm_min(n_ifaces, (size_t) NM_METRICS_IFACES);
+    memcpy(ring->ifaces, ifaces,
+            ring->n_ifaces * sizeof(nm_metrics_iface_t));
+    nm_mon_shm_seq_end(&ring->seq);
+}
+
+void nm_mon_shm_heartbeat(void)
+{
+    if (shm_w) {
+        __atomic_store_n(&shm_w->heartbeat, nm_mono_ms(), __ATOMIC_RELEASE);
+    }
+}
+
+void nm_mon_shm_destroy(void)
+{
+    if (!shm_w) {
+        return;
+    }
+
+    nm_mon_shm_retire(shm_w, shm_w_size);
+    unlink(nm_cfg_get()->daemon_shm.data);
+    shm_w = NULL;
+}
+
+static int nm_mon_shm_attach(void)
+{
+    const char *path = nm_cfg_get()->daemon_shm.data;
+    const nm_shm_hdr_t *hdr;
+    struct stat info;
+    int fd;
+
+    if (shm_r && !__atomic_load_n(&shm_r->retired, __ATOMIC_ACQUIRE)) {
+        return NM_OK;
+    }
+
+    nm_mon_shm_close();
+
+    if ((fd = open(path, O_RDONLY)) == -1) {
+        return NM_ERR;
+    }
+
+    if (fstat(fd, &info) != 0 ||
+            (size_t) info.st_size < sizeof(nm_shm_hdr_t)) {
+        close(fd);
+        return NM_ERR;
+    }
+
+    hdr = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (hdr == MAP_FAILED) {
+        return NM_ERR;
+    }
+
+    if (hdr->magic != NM_SHM_MAGIC || hdr->version != NM_SHM_VERSION ||
+            hdr->count > hdr->capacity ||
+            nm_mon_shm_size(hdr->capacity) > (size_t) info.st_size) {
+        nm_debug("%s: incompatible status table\n", __func__);
+        munmap((void *) hdr, info.st_size);
+        return NM_ERR;
+    }
+
+    shm_r = hdr;
+    shm_r_size = info.st_size;
+
+    return NM_OK;
+}
+
+static int nm_mon_shm_cmp_cb(const void *s1, const void *s2)
+{
+    const nm_shm_vm_t *vm = s2;
+
+    return strcmp(s1, vm->name);
+}
+
+/* daemon was killed or hangs */
+static bool nm_mon_shm_stale(void)
+{
+    uint64_t stale = nm_cfg_get()->daemon_sleep * NM_SHM_STALE_CHECKS;
+
+    if (stale < NM_SHM_STALE_MIN) {
+        stale = NM_SHM_STALE_MIN;
+    }
+
+    return nm_mono_ms() - __atomic_load_n(&shm_r->heartbeat,
+            __ATOMIC_ACQUIRE) > stale;
+}
+
+/*
+ * Wait until seq is even. Returns NM_ERR if the daemon died
+ * in the middle of the update and seq will stay odd forever.
+ */
+static int nm_mon_shm_read_begin(const uint32_t *seq_p, uint32_t *seq)
+{
+    struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+
+    for (unsigned n = 0;
+            (*seq = __atomic_load_n(seq_p, __ATOMIC_ACQUIRE)) & 1; n++) {
+        if (n < NM_SHM_SPIN) {
+            continue;
+        }
+        if (nm_mon_shm_stale()) {
+            return NM_ERR;
+        }
+        nanosleep(&ts, NULL);
+    }
+
+    return NM_OK;
+}
+
+static const nm_shm_vm_t *nm_mon_shm_find(const nm_str_t *name)
+{
+    if (nm_mon_shm_attach() != NM_OK) {
+        return NULL;
+    }
+
+    if (nm_mon_shm_stale()) {
+        return NULL;
+    }
+
+    /* names and their order are immutable during the table lifetime */
+    return bsearch(name->data, shm_r->vms, shm_r->count,
+            sizeof(nm_shm_vm_t), nm_mon_shm_cmp_cb);
+}
+
+int nm_mon_shm_get(const nm_str_t *name, nm_shm_vm_t *vm)
+{
+    const nm_shm_vm_t *found;
+    uint32_t seq;
+
+    if ((found = nm_mon_shm_find(name)) == NULL) {
+        return NM_ERR;
+    }
+
+    do {
+        if (nm_mon_shm_read_begin(&shm_r->seq, &seq) != NM_OK) {
+            return NM_ERR;
+        }
+        *vm = *found;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&shm_r->seq, __ATOMIC_RELAXED) != seq);
+
+    return (vm->state == -1) ? NM_ERR : NM_OK;
+}
+
+size_t nm_mon_shm_history(const nm_str_t *name,
+        nm_metrics_sample_t *buf, size_t len)
+{
+    const nm_shm_vm_t *found;
+    const nm_shm_ring_t *ring;
+    uint32_t seq, head, count;
+    size_t n;
+
+    if ((found = nm_mon_shm_find(name)) == NULL) {
+        return 0;
+    }
+
+    ring = &nm_mon_shm_rings(shm_r)[found - shm_r->vms];
+
+    do {
+        if (nm_mon_shm_read_begin(&ring->seq, &seq) != NM_OK) {
+            return 0;
+        }
+        head = ring->head;
+        count = ring->count;
+        if (head >= NM_METRICS_RING || count > NM_METRICS_RING) {
+            return 0;
+        }
+        n = (count < len) ? count : len;
+        /* the newest n samples end right before head */
+        for (size_t i = 0; i < n; i++) {
+            buf[i] = ring->samples[(head + NM_METRICS_RING - n + i) %
+                NM_METRICS_RING];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&ring->seq, __ATOMIC_RELAXED) != seq);
+
+    return n;
+}
+
+size_t nm_mon_shm_threads(const nm_str_t *name,
+        nm_metrics_thread_t *buf, size_t len)
+{
+    const nm_shm_vm_t *found;
+    const nm_shm_ring_t *ring;
+    uint32_t seq;
+    size_t n;
+
+    if ((found = nm_mon_shm_find(name)) == NULL) {
+        return 0;
+    }
+
+    ring = &nm_mon_shm_rings(shm_r)[found - shm_r->vms];
+
+    do {
+        if (nm_mon_shm_read_begin(&ring->seq, &seq) != NM_OK) {
+            return 0;
+        }
+        n = nm_min((size_t) ring->n_threads, len);
+        n = nm_min(n, (size_t) NM_METRICS_THREADS);
+        memcpy(buf, ring->threads, n * sizeof(nm_metrics_thread_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&ring->seq, __ATOMIC_RELAXED) != seq);
+
+    return n;
+}
+
+size_t nm_mon_shm_drives(const nm_str_t *name,
+        nm_metrics_drive_t *buf, size_t len)
+{
+    const nm_shm_vm_t *found;
+    const nm_shm_ring_t *ring;
+    uint32_t seq;
+    size_t n;
+
+    if ((found = nm_mon_shm_find(name)) == NULL) {
+        return 0;
+    }
+
+    ring = &nm_mon_shm_rings(shm_r)[found - shm_r->vms];
+
+    do {
+        if (nm_mon_shm_read_begin(&ring->seq, &seq) != NM_OK) {
+            return 0;
+        }
+        n = nm_min((size_t) ring->n_drives, len);
+        n = nm_min(n, (size_t) NM_METRICS_DRIVES);
+        memcpy(buf, ring->drives, n * sizeof(nm_metrics_drive_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&ring->seq, __ATOMIC_RELAXED) != seq);
+
+    return n;
+}
+
+size_t nm_mon_shm_ifaces(const nm_str_t *name,
+        nm_metrics_iface_t *buf, size_t len)
+{
+    const nm_shm_vm_t *found;
+    const nm_shm_ring_t *ring;
+    uint32_t seq;
+    size_t n;
+
+    if ((found = nm_mon_shm_find(name)) == NULL) {
+        return 0;
+    }
+
+    ring = &nm_mon_shm_rings(shm_r)[found - shm_r->vms];
+
+    do {
+        if (nm_mon_shm_read_begin(&ring->seq, &seq) != NM_OK) {
+            return 0;
+        }
+        n = nm_min((size_t) ring->n_ifaces, len);
+        n = nm_min(n, (size_t) NM_METRICS_IFACES);
+        memcpy(buf, ring->ifaces, n * sizeof(nm_metrics_iface_t));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&ring->seq, __ATOMIC_RELAXED) != seq);
+
+    return n;
+}
+
+void nm_mon_shm_close(void)
+{
+    if (shm_r) {
+        munmap((void *) shm_r, shm_r_size);
+        shm_r = NULL;
+    }
+}
+
+int nm_mon_vm_status(const nm_str_t *name)
+{
+    nm_shm_vm_t vm;
+
+    if (nm_mon_shm_get(name, &vm) == NM_OK) {
+        return (vm.state == NM_TRUE) ? NM_OK : NM_ERR;
+    }
+
+    return nm_qmp_test_socket(name);
+}
+/* vim:set ts=4 sw=4: */
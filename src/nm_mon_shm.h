@@ -0,0 +1,99 @@
+#ifndef NM_MON_SHM_H_
+#define NM_MON_SHM_H_
+
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_mon_metrics.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * VM status table published by the monitoring daemon.
+ * The table is a file mapped with MAP_SHARED, the daemon is the only
+ * writer. Readers use seqlock protocol and do not make syscalls
+ * unless the daemon replaced the table (VM list was changed).
+ * Metrics history of VMs is stored after the entries, ring n belongs
+ * to entry n and has its own sequence counter, so sampling does not
+ * disturb status readers.
+ */
+
+#define NM_SHM_MAGIC    0x4e454d55 /* NEMU */
+#define NM_SHM_VERSION  6
+#define NM_SHM_NAME_MAX 64
+
+typedef struct nm_shm_vm {
+    char name[NM_SHM_NAME_MAX];
+    int32_t pid;
+    int8_t state;       /* -1: unknown, 0: stopped, 1: running */
+    uint8_t paused;     /* VM is stopped by QMP "stop" command */
+    uint8_t pad[2];
+    uint64_t changed;   /* last state change, ms since epoch */
+} nm_shm_vm_t;
+
+typedef struct nm_shm_hdr {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;       /* odd while the writer updates the table */
+    uint32_t retired;   /* table was replaced, readers must reopen */
+    uint64_t generation;/* incremented on every change */
+    uint64_t heartbeat; /* CLOCK_MONOTONIC ms of the last daemon check */
+    uint32_t count;     /* entries are sorted by name */
+    uint32_t capacity;
+    nm_shm_vm_t vms[];
+} nm_shm_hdr_t;
+
+typedef struct nm_shm_ring {
+    uint32_t seq;       /* odd while the writer adds a sample */
+    uint32_t head;      /* slot of the next sample */
+    uint32_t count;
+    uint32_t n_threads;
+    uint32_t n_drives;
+    uint32_t n_ifaces;
+    nm_metrics_sample_t samples[NM_METRICS_RING];
+    nm_metrics_thread_t threads[NM_METRICS_THREADS]; /* newest sample */
+    nm_metrics_drive_t drives[NM_METRICS_DRIVES];    /* newest sample */
+    nm_metrics_iface_t ifaces[NM_METRICS_IFACES];    /* newest sample */
+} nm_shm_ring_t;
+
+#define NM_INIT_SHM_VM (nm_shm_vm_t) { {0}, 0, -1, 0, {0}, 0 }
+
+/* writer side, used by the monitoring daemon only */
+int nm_mon_shm_create(const nm_svect_t *mon_list);
+void nm_mon_shm_update(size_t idx, int8_t state, pid_t pid);
+void nm_mon_shm_set_paused(size_t idx, bool paused);
+void nm_mon_shm_push_sample(size_t idx, const nm_metrics_sample_t *s,
+        const nm_metrics_thread_t *threads, size_t n_threads);
+void nm_mon_shm_set_drives(size_t idx,
+        const nm_metrics_drive_t *drives, size_t n_drives);
+void nm_mon_shm_set_ifaces(size_t idx,
+        const nm_metrics_iface_t *ifaces, size_t n_ifaces);
+void nm_mon_shm_heartbeat(void);
+void nm_mon_shm_destroy(void);
+
+/*
+ * Reader side. Not thread safe: the mapping is cached per process.
+ * Get VM status from the table.
+ * Returns NM_ERR if the daemon is not running or VM is unknown.
+ */
+int nm_mon_shm_get(const nm_str_t *name, nm_shm_vm_t *vm);
+/* copy up to len recent samples of VM, oldest first */
+size_t nm_mon_shm_history(const nm_str_t *name,
+        nm_metrics_sample_t *buf, size_t len);
+size_t nm_mon_shm_threads(const nm_str_t *name,
+        nm_metrics_thread_t *buf, size_t len);
+size_t nm_mon_shm_drives(const nm_str_t *name,
+        nm_metrics_drive_t *buf, size_t len);
+size_t nm_mon_shm_ifaces(const nm_str_t *name,
+        nm_metrics_iface_t *buf, size_t len);
+void nm_mon_shm_close(void);
+
+/*
+ * Returns NM_OK if VM is running. Uses the status table and
+ * falls back to QMP socket probing if it is not available.
+ */
+int nm_mon_vm_status(const nm_str_t *name);
+
+#endif /* NM_MON_SHM_H_ */
+/* vim:set ts=4 sw=4: */
@@ -72,6 +72,7 @@ static int nm_net_add_attr(struct nlmsghdr *n, size_t mlen,
 static struct rtattr *nm_net_add_attr_nest(struct nlmsghdr *n, size_t mlen,
                                            int type);
 static int nm_net_add_attr_nest_end(struct nlmsghdr *n, struct rtattr *nest);
+static void nm_net_link_parse(struct nlmsghdr *nh, nm_vect_t *links);
 
 static struct rtattr *NLMSG_TAIL(struct nlmsghdr *n)
 {
@@ -96,6 +97,7 @@ static size_t nm_net_mac_s2a(const nm_str_t *addr, char *res, size_t len);
 static void nm_net_manage_tap(const nm_str_t *name, int on_off);
 static void nm_net_addr_change(const nm_str_t *name, const nm_str_t *net,
                                int action);
+static int nm_net_link_cmp(const void *a, const void *b);
 
 int nm_net_iface_exists(const nm_str_t *name)
 {
@@ -715,6 +717,146 @@ int nm_net_link_status(const nm_str_t *name)
     return NM_OK;
 }
 
+/* link kinds of VM interfaces: tap, macvtap and veth */
+static bool nm_net_link_kind(struct rtattr *linkinfo)
+{
+    static const char *kinds[] = { "tun", "macvtap", "veth" };
+    int len = RTA_PAYLOAD(linkinfo);
+
+    for (struct rtattr *rta = RTA_DATA(linkinfo); RTA_OK(rta, len);
+            rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type != IFLA_INFO_KIND) {
+            continue;
+        }
+        for (size_t n = 0; n < nm_arr_len(kinds); n++) {
+            if (strncmp(RTA_DATA(rta), kinds[n], RTA_PAYLOAD(rta)) == 0) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void nm_net_link_parse(struct nlmsghdr *nh, nm_vect_t *links)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nh);
+    struct rtattr *name = NULL, *stats = NULL, *linkinfo = NULL;
+    int len = nh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+    struct rtnl_link_stats64 st;
+    nm_net_link_stats_t link;
+
+    for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len);
+            rta = RTA_NEXT(rta, len)) {
+        switch (rta->rta_type) {
+        case IFLA_IFNAME:
+            name = rta;
+            break;
+        case IFLA_STATS64:
+            stats = rta;
+            break;
+        case IFLA_LINKINFO:
+            linkinfo = rta;
+            break;
+        }
+    }
+
+    if (!name || !stats || !linkinfo || !nm_net_link_kind(linkinfo)) {
+        return;
+    }
+
+    memset(&st, 0, sizeof(st));
+    memcpy(&st, RTA_DATA(stats), nm_min(sizeof(st), RTA_PAYLOAD(stats)));
+
+    memset(&link, 0, sizeof(link));
+    nm_strlcpy(link.name, RTA_DATA(name),
+            nm_min(sizeof(link.name), RTA_PAYLOAD(name)));
+    link.rx_packets = st.rx_packets;
+    link.tx_packets = st.tx_packets;
+    link.rx_bytes = st.rx_bytes;
+    link.tx_bytes = st.tx_bytes;
+
+    nm_vect_insert(links, &link, sizeof(link), NULL);
+}
+
+/*
+ * Counters of all links are taken with a single dump request,
+ * the cost does not depend on the number of VMs.
+ */
+int nm_net_link_stats(nm_vect_t *links)
+{
+    struct {
+        struct nlmsghdr n;
+        struct ifinfomsg i;
+    } req;
+    struct sockaddr_nl sa;
+    char buf[32768];
+    int rc = NM_ERR;
+    int sd;
+
+    if ((sd = socket(AF_NETLINK,
+                    SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) == -1) {
+        nm_debug("%s: cannot open netlink socket: %s\n",
+                __func__, strerror(errno));
+        return NM_ERR;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req.n.nlmsg_type = RTM_GETLINK;
+    req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.n.nlmsg_seq = time(NULL);
+    req.i.ifi_family = AF_UNSPEC;
+
+    if (sendto(sd, &req, req.n.nlmsg_len, 0,
+                (struct sockaddr *) &sa, sizeof(sa)) < 0) {
+        nm_debug("%s: cannot talk to rtnetlink: %s\n",
+                __func__, strerror(errno));
+        goto out;
+    }
+
+    /* dump is split into several datagrams */
+    for (;;) {
+        ssize_t len = recv(sd, buf, sizeof(buf), 0);
+
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            nm_debug("%s: recv: %s\n", __func__, strerror(errno));
+            goto out;
+        }
+
+        for (struct nlmsghdr *nh = (struct nlmsghdr *) buf;
+                NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_seq != req.n.nlmsg_seq) {
+                continue;
+            }
+            if (nh->nlmsg_type == NLMSG_DONE) {
+                rc = NM_OK;
+                goto out;
+            }
+            if (nh->nlmsg_type == NLMSG_ERROR) {
+                goto out;
+            }
+            if (nh->nlmsg_type == RTM_NEWLINK) {
+                nm_net_link_parse(nh, links);
+            }
+        }
+    }
+
+out:
+    close(sd);
+    if (links->n_memb) {
+        qsort(links->data, links->n_memb, sizeof(void *), nm_net_link_cmp);
+    }
+
+    return rc;
+}
+
 static void nm_net_set_link_status(const nm_str_t *name, int action)
 {
     struct iplink_req req;
@@ -811,6 +953,41 @@ static void nm_net_addr_change(const nm_str_t *name, const nm_str_t *src,
 #endif /* NM_OS_LINUX */
 }
 
+#if !defined (NM_OS_LINUX)
+int nm_net_link_stats(nm_vect_t *links)
+{
+    (void) links;
+
+    return NM_ERR;
+}
+#endif /* NM_OS_LINUX */
+
+static int nm_net_link_cmp(const void *a, const void *b)
+{
+    const nm_net_link_stats_t *la = *(const nm_net_link_stats_t **) a;
+    const nm_net_link_stats_t *lb = *(const nm_net_link_stats_t **) b;
+
+    return strcmp(la->name, lb->name);
+}
+
+const nm_net_link_stats_t *nm_net_link_find(const nm_vect_t *links,
+                                            const char *name)
+{
+    nm_net_link_stats_t key;
+    const nm_net_link_stats_t *kp = &key;
+    void **found;
+
+    if (!links->n_memb) {
+        return NULL;
+    }
+
+    nm_strlcpy(key.name, name, sizeof(key.name));
+    found = bsearch(&kp, links->data, links->n_memb, sizeof(void *),
+            nm_net_link_cmp);
+
+    return (found) ? *found : NULL;
+}
+
 int
 nm_net_check_port(const uint16_t port, const int type, const uint32_t inaddr)
 {
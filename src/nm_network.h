@@ -23,6 +23,17 @@ enum {
 
 #define NM_INIT_NETADDR (nm_net_addr_t) { {0}, 0 }
 
+#define NM_NET_IFNAME_LEN 16
+
+/* link counters as seen by the host */
+typedef struct {
+    char name[NM_NET_IFNAME_LEN];
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+} nm_net_link_stats_t;
+
 int nm_net_iface_exists(const nm_str_t *name);
 uint32_t nm_net_iface_idx(const nm_str_t *name);
 #if defined (NM_OS_LINUX)
@@ -44,6 +55,13 @@ uint64_t nm_net_mac_s2n(const nm_str_t *addr);
 int nm_net_verify_mac(const nm_str_t *mac);
 int nm_net_verify_ipaddr4(const nm_str_t *src, nm_net_addr_t *net,
                           nm_str_t *err);
+/*
+ * Counters of tap, macvtap and veth links, sorted by name.
+ * Free with nm_vect_free(links, NULL).
+ */
+int nm_net_link_stats(nm_vect_t *links);
+const nm_net_link_stats_t *nm_net_link_find(const nm_vect_t *links,
+                                            const char *name);
 int nm_net_check_port(const uint16_t port, const int type,
         const uint32_t inaddr);
 
@@ -784,7 +784,7 @@ static void nm_ovf_convert_drives(const nm_vect_t *drives, const nm_str_t *name,
 {
     nm_str_t vm_dir = NM_INIT_STR;
     nm_str_t buf = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
 
     nm_str_format(&vm_dir, "%s/%s", nm_cfg_get()->vm_dir.data, name->data);
 
@@ -795,30 +795,29 @@ static void nm_ovf_convert_drives(const nm_vect_t *drives, const nm_str_t *name,
 
     for (size_t n = 0; n < drives->n_memb; n++) {
         nm_str_format(&buf, "%s/qemu-img", nm_cfg_get()->qemu_bin_path.data);
-        nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(&argv, buf.data);
 
-        nm_vect_insert_cstr(&argv, "convert");
-        nm_vect_insert_cstr(&argv, "-O");
-        nm_vect_insert_cstr(&argv, format->data);
+        nm_argv_add(&argv, "convert");
+        nm_argv_add(&argv, "-O");
+        nm_argv_add(&argv, format->data);
 
         nm_str_format(&buf, "%s/%s",
             templ_path, (nm_drive_file(drives->data[n]))->data);
-        nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(&argv, buf.data);
 
         nm_str_format(&buf, "%s/%s",
             vm_dir.data, (nm_drive_file(drives->data[n]))->data);
-        nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(&argv, buf.data);
 
         nm_cmd_str(&buf, &argv);
         nm_debug("ova: exec: %s\n", buf.data);
 
-        nm_vect_end_zero(&argv);
         if (nm_spawn_process(&argv, NULL) != NM_OK) {
             rmdir(vm_dir.data);
             nm_bug(_("%s: cannot create image file"), __func__);
         }
 
-        nm_vect_free(&argv, NULL);
+        nm_argv_free(&argv);
     }
 
     nm_str_free(&vm_dir);
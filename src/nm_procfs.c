@@ -0,0 +1,76 @@
+#include <nm_core.h>
+#include <nm_procfs.h>
+
+ssize_t nm_procfs_pread(int fd, char *buf, size_t len)
+{
+    ssize_t nread;
+
+    /* procfs generates the whole file on the first read at offset 0 */
+    if ((nread = pread(fd, buf, len - 1, 0)) < 0) {
+        buf[0] = '\0';
+        return nread;
+    }
+
+    buf[nread] = '\0';
+
+    return nread;
+}
+
+const char *nm_procfs_skip(const char *p, size_t n)
+{
+    while (*p == ' ') {
+        p++;
+    }
+
+    while (n-- && *p) {
+        while (*p && *p != ' ' && *p != '\n') {
+            p++;
+        }
+        while (*p == ' ') {
+            p++;
+        }
+    }
+
+    return p;
+}
+
+uint64_t nm_procfs_u64(const char **p)
+{
+    const char *s = *p;
+    uint64_t val = 0;
+
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+
+    while (*s >= '0' && *s <= '9') {
+        val = val * 10 + (uint64_t) (*s - '0');
+        s++;
+    }
+
+    *p = s;
+
+    return val;
+}
+
+uint64_t nm_procfs_key(const char *buf, const char *key)
+{
+    const char *p = strstr(buf, key);
+
+    if (!p) {
+        return 0;
+    }
+
+    p += strlen(key);
+
+    return nm_procfs_u64(&p);
+}
+
+const char *nm_procfs_stat_fields(const char *buf)
+{
+    /* process name may contain spaces and brackets */
+    const char *p = strrchr(buf, ')');
+
+    return (p) ? p + 1 : NULL;
+}
+/* vim:set ts=4 sw=4: */
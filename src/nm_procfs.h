@@ -0,0 +1,30 @@
+#ifndef NM_PROCFS_H_
+#define NM_PROCFS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * Helpers for procfs files that are kept open and re-read.
+ * Parsing works in place on the caller buffer and never allocates.
+ */
+
+/* read file from the start with single pread(2), buf is NUL terminated */
+ssize_t nm_procfs_pread(int fd, char *buf, size_t len);
+
+/* skip n space separated fields, returns pointer to the next one */
+const char *nm_procfs_skip(const char *p, size_t n);
+/* parse unsigned decimal field and move p past it */
+uint64_t nm_procfs_u64(const char **p);
+/*
+ * Value of "key: value" line. key must start with a newline unless
+ * it is on the first line.
+ */
+uint64_t nm_procfs_key(const char *buf, const char *key);
+
+/* fields of /proc/<pid>/stat, p points right after the process name */
+const char *nm_procfs_stat_fields(const char *buf);
+
+#endif /* NM_PROCFS_H_ */
+/* vim:set ts=4 sw=4: */
@@ -5,28 +5,19 @@
 #include <nm_window.h>
 #include <nm_cfg_file.h>
 #include <nm_usb_devices.h>
+#include <nm_mon_ctl.h>
 #include <nm_qmp_control.h>
+#include <nm_qmp_reactor.h>
 
 #include <sys/socket.h>
 #include <sys/un.h>
-#if defined(NM_OS_DARWIN)
-#include <nm_sysv_queue.h>
-#else
-#include <mqueue.h>
-#endif
 #include <time.h>
 
 #include <json.h>
 
-enum {
-    NM_QMP_STATE_DONE = 0,
-    NM_QMP_STATE_MORE,
-    NM_QMP_STATE_NEXT,
-    NM_QMP_STATE_REPEAT,
-    NM_QMP_STATE_UNDEF
-};
+enum {NM_QMP_JOB_TIMEOUT = 300}; /* seconds */
+enum {NM_QMP_SEND_TIMEOUT = 5}; /* seconds */
 
-static const char NM_QMP_CMD_INIT[]     = "{\"execute\":\"qmp_capabilities\"}";
 static const char NM_QMP_CMD_VM_SHUT[]  = "{\"execute\":\"system_powerdown\"}";
 static const char NM_QMP_CMD_VM_QUIT[]  = "{\"execute\":\"quit\"}";
 static const char NM_QMP_CMD_VM_RESET[] = "{\"execute\":\"system_reset\"}";
@@ -97,8 +88,6 @@ static const char NM_QMP_GETFD[] =
     "{'execute':'getfd','arguments':{'fdname':'fd-%s'}}";
 #endif
 
-enum {NM_QMP_READLEN = 1024};
-
 typedef struct {
     int sd;
     struct sockaddr_un sock;
@@ -107,68 +96,56 @@ typedef struct {
 #define NM_INIT_QMP (nm_qmp_handle_t) { .sd = -1 }
 
 static int nm_qmp_vm_exec(const nm_str_t *name, const char *cmd,
-                          struct timeval *tv);
-static int nm_qmp_init_cmd(nm_qmp_handle_t *h);
+        uint64_t timeout);
+static nm_qmp_sess_t *nm_qmp_open(const nm_str_t *name);
+static int nm_qmp_talk(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, struct json_object **reply);
+static void nm_qmp_warn(const nm_qmp_sess_t *sess, const char *msg);
+static bool nm_qmp_job_match(struct json_object *data, const void *ctx);
+static bool nm_qmp_dev_match(struct json_object *data, const void *ctx);
 static void nm_qmp_sock_path(const nm_str_t *name, nm_str_t *path);
-static int nm_qmp_talk(int sd, const char *cmd,
-                       size_t len, const struct timeval *tvp);
-static void nm_qmp_talk_async(int sd, const char *cmd,
-        size_t len, const char *jobid);
 static int nm_qmp_send(const nm_str_t *cmd);
-static int nm_qmp_check_answer(const nm_str_t *answer);
-static int nm_qmp_parse(const char *jobid, const nm_str_t *answer);
-static int nm_qmp_check_job(const char *jobid, const nm_str_t *answer);
+static int nm_qmp_check_job(const char *jobid, struct json_object *answer);
 int nm_qmp_add_macvtap(const nm_str_t *name,
         const nm_str_t *id, const nm_iface_t *nic);
 
 void nm_qmp_vm_shut(const nm_str_t *name)
 {
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 }; /* 0.1s */
-
-    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_SHUT, &tv);
+    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_SHUT, 100);
 }
 
 void nm_qmp_vm_stop(const nm_str_t *name)
 {
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 }; /* 0.1s */
-
-    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_QUIT, &tv);
+    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_QUIT, 100);
 }
 
 void nm_qmp_vm_reset(const nm_str_t *name)
 {
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 100000 }; /* 0.1s */
-
-    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_RESET, &tv);
+    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_RESET, 100);
 }
 
 void nm_qmp_vm_pause(const nm_str_t *name)
 {
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 1000000 }; /* 1s */
-
-    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_STOP, &tv);
+    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_STOP, 1000);
 }
 
 void nm_qmp_vm_resume(const nm_str_t *name)
 {
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 1000000 }; /* 1s */
-
-    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_CONT, &tv);
+    nm_qmp_vm_exec(name, NM_QMP_CMD_VM_CONT, 1000);
 }
 
 void nm_qmp_take_screenshot(const nm_str_t *name, const nm_str_t *path)
 {
     nm_str_t qmp_query = NM_INIT_STR;
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 1000000 }; /* 1s */
 
     nm_str_format(&qmp_query, NM_QMP_TAKE_SCREENSHOT, path->data);
-    nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    nm_qmp_vm_exec(name, qmp_query.data, 1000);
     nm_str_free(&qmp_query);
 }
 
 int nm_qmp_savevm(const nm_str_t *name, const nm_str_t *snap)
 {
-    nm_vect_t drives = NM_INIT_VECT;
+    nm_db_res_t drives = NM_INIT_DB_RES;
     nm_str_t query = NM_INIT_STR;
     nm_str_t devs = NM_INIT_STR;
     nm_str_t uid = NM_INIT_STR;
@@ -177,8 +154,8 @@ int nm_qmp_savevm(const nm_str_t *name, const nm_str_t *snap)
     int rc;
 
     nm_str_format(&query, NM_SQL_DRIVES_SELECT, name->data);
-    nm_db_select(query.data, &drives);
-    drives_count = drives.n_memb / NM_DRV_IDX_COUNT;
+    nm_db_fetch(query.data, &drives);
+    drives_count = nm_db_rows(&drives);
 
     for (size_t n = 0; n < drives_count; n++) {
         nm_str_append_format(&devs, "%s\"hd%zu\"", (!n) ? "" : ", ", n);
@@ -190,7 +167,7 @@ int nm_qmp_savevm(const nm_str_t *name, const nm_str_t *snap)
             "hd0", devs.data);
     rc = nm_qmp_send(&cmd);
 
-    nm_vect_free(&drives, nm_str_vect_free_cb);
+    nm_db_res_free(&drives);
     nm_str_free(&devs);
     nm_str_free(&cmd);
     nm_str_free(&query);
@@ -201,7 +178,7 @@ int nm_qmp_savevm(const nm_str_t *name, const nm_str_t *snap)
 
 int nm_qmp_loadvm(const nm_str_t *name, const nm_str_t *snap)
 {
-    nm_vect_t drives = NM_INIT_VECT;
+    nm_db_res_t drives = NM_INIT_DB_RES;
     nm_str_t query = NM_INIT_STR;
     nm_str_t devs = NM_INIT_STR;
     nm_str_t uid = NM_INIT_STR;
@@ -210,8 +187,8 @@ int nm_qmp_loadvm(const nm_str_t *name, const nm_str_t *snap)
     int rc;
 
     nm_str_format(&query, NM_SQL_DRIVES_SELECT, name->data);
-    nm_db_select(query.data, &drives);
-    drives_count = drives.n_memb / NM_DRV_IDX_COUNT;
+    nm_db_fetch(query.data, &drives);
+    drives_count = nm_db_rows(&drives);
 
     for (size_t n = 0; n < drives_count; n++) {
         nm_str_append_format(&devs, "%s\"hd%zu\"", (!n) ? "" : ", ", n);
@@ -223,7 +200,7 @@ int nm_qmp_loadvm(const nm_str_t *name, const nm_str_t *snap)
             "hd0", devs.data);
     rc = nm_qmp_send(&cmd);
 
-    nm_vect_free(&drives, nm_str_vect_free_cb);
+    nm_db_res_free(&drives);
     nm_str_free(&devs);
     nm_str_free(&cmd);
     nm_str_free(&query);
@@ -234,7 +211,7 @@ int nm_qmp_loadvm(const nm_str_t *name, const nm_str_t *snap)
 
 int nm_qmp_delvm(const nm_str_t *name, const nm_str_t *snap)
 {
-    nm_vect_t drives = NM_INIT_VECT;
+    nm_db_res_t drives = NM_INIT_DB_RES;
     nm_str_t query = NM_INIT_STR;
     nm_str_t devs = NM_INIT_STR;
     nm_str_t uid = NM_INIT_STR;
@@ -243,8 +220,8 @@ int nm_qmp_delvm(const nm_str_t *name, const nm_str_t *snap)
     int rc;
 
     nm_str_format(&query, NM_SQL_DRIVES_SELECT, name->data);
-    nm_db_select(query.data, &drives);
-    drives_count = drives.n_memb / NM_DRV_IDX_COUNT;
+    nm_db_fetch(query.data, &drives);
+    drives_count = nm_db_rows(&drives);
 
     for (size_t n = 0; n < drives_count; n++) {
         nm_str_append_format(&devs, "%s\"hd%zu\"", (!n) ? "" : ", ", n);
@@ -256,7 +233,7 @@ int nm_qmp_delvm(const nm_str_t *name, const nm_str_t *snap)
             snap->data, devs.data);
     rc = nm_qmp_send(&cmd);
 
-    nm_vect_free(&drives, nm_str_vect_free_cb);
+    nm_db_res_free(&drives);
     nm_str_free(&devs);
     nm_str_free(&cmd);
     nm_str_free(&query);
@@ -270,15 +247,13 @@ int nm_qmp_usb_attach(const nm_str_t *name, const nm_usb_data_t *usb)
     nm_str_t qmp_query = NM_INIT_STR;
     int rc;
 
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 5000000 }; /* 5s */
-
     nm_str_format(&qmp_query, NM_QMP_CMD_USB_ADD,
                   usb->dev->bus_num, usb->dev->dev_addr,
                   usb->dev->vendor_id.data, usb->dev->product_id.data,
                   (usb->serial.len) ? usb->serial.data : "NULL");
 
     nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    rc = nm_qmp_vm_exec(name, qmp_query.data, 5000);
 
     nm_str_free(&qmp_query);
 
@@ -290,15 +265,13 @@ int nm_qmp_usb_detach(const nm_str_t *name, const nm_usb_data_t *usb)
     nm_str_t qmp_query = NM_INIT_STR;
     int rc;
 
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 1000000 }; /* 1s */
-
     nm_str_format(&qmp_query, NM_QMP_CMD_USB_DEL,
                   usb->dev->vendor_id.data,
                   usb->dev->product_id.data,
                   (usb->serial.len) ? usb->serial.data : "NULL");
 
     nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    rc = nm_qmp_vm_exec(name, qmp_query.data, 1000);
 
     nm_str_free(&qmp_query);
 
@@ -309,13 +282,12 @@ int nm_qmp_nic_attach(const nm_str_t *name, const nm_iface_t *nic)
 {
     nm_str_t qmp_query = NM_INIT_STR;
     nm_str_t id = NM_INIT_STR;
-    int rc;
+    nm_qmp_sess_t *sess = NULL;
+    int rc = NM_ERR;
 
     nm_str_copy(&id, &nic->maddr);
     nm_str_remove_char(&id, ':');
 
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 5000000 }; /* 5s */
-
     if (nm_str_cmp_st(&nic->netuser, "yes") == NM_OK) {
         if (nic->hostfwd.len && nic->smb.len) {
             nm_str_format(&qmp_query, NM_QMP_NET_USER_FWD_SMB_ADD,
@@ -346,8 +318,12 @@ int nm_qmp_nic_attach(const nm_str_t *name, const nm_iface_t *nic)
 #endif /* NM_OS_LINUX */
     }
 
-    nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    /* netdev and device are added within one session */
+    if ((sess = nm_qmp_open(name)) == NULL) {
+        goto out;
+    }
+
+    rc = nm_qmp_talk(sess, qmp_query.data, -1, 5000, NULL);
     if (rc != NM_OK) {
         goto out;
     }
@@ -355,10 +331,10 @@ int nm_qmp_nic_attach(const nm_str_t *name, const nm_iface_t *nic)
     nm_str_format(&qmp_query, NM_QMP_DEV_NET_ADD,
             nic->drv.data, id.data, id.data, nic->maddr.data);
 
-    nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    rc = nm_qmp_talk(sess, qmp_query.data, -1, 5000, NULL);
 
 out:
+    nm_qmp_sess_put(sess);
     nm_str_free(&qmp_query);
     nm_str_free(&id);
 
@@ -369,26 +345,36 @@ int nm_qmp_nic_detach(const nm_str_t *name, const nm_iface_t *nic)
 {
     nm_str_t qmp_query = NM_INIT_STR;
     nm_str_t id = NM_INIT_STR;
-    int rc;
+    nm_str_t dev = NM_INIT_STR;
+    nm_qmp_sess_t *sess;
+    int rc = NM_ERR;
 
     nm_str_copy(&id, &nic->maddr);
     nm_str_remove_char(&id, ':');
 
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 5000000 }; /* 5s */
+    if ((sess = nm_qmp_open(name)) == NULL) {
+        goto out;
+    }
 
     nm_str_format(&qmp_query, NM_QMP_DEV_DEL, id.data);
-
-    nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
-    if (rc != NM_OK) {
+    nm_str_format(&dev, "dev-%s", id.data);
+
+    /* device_del returns before the guest releases the device */
+    rc = nm_qmp_exec_wait(sess, qmp_query.data, 5000, "DEVICE_DELETED",
+            nm_qmp_dev_match, dev.data, 5000);
+    if (rc == NM_QMP_NO_EVENT) {
+        nm_debug("%s: no DEVICE_DELETED for %s\n", __func__, dev.data);
+    } else if (rc != NM_OK) {
+        nm_qmp_warn(sess, _(NM_MSG_Q_EXEC_E));
         goto out;
     }
 
     nm_str_format(&qmp_query, NM_QMP_NET_DEL, id.data);
-    nm_debug("exec qmp: %s\n", qmp_query.data);
-    rc = nm_qmp_vm_exec(name, qmp_query.data, &tv);
+    rc = nm_qmp_talk(sess, qmp_query.data, -1, 5000, NULL);
 out:
+    nm_qmp_sess_put(sess);
     nm_str_free(&qmp_query);
+    nm_str_free(&dev);
     nm_str_free(&id);
     return rc;
 }
@@ -428,27 +414,32 @@ out:
     return rc;
 }
 
+/* pass snapshot job to the monitoring daemon */
 static int nm_qmp_send(const nm_str_t *cmd)
 {
-#if defined(NM_OS_DARWIN)
-    if (!nm_sysv_queue_send(cmd)) {
+    struct json_object *args, *parsed, *reply = NULL;
+    int rc;
+
+    if ((parsed = json_tokener_parse(cmd->data)) == NULL) {
+        nm_debug("%s: cannot parse json\n", __func__);
         return NM_ERR;
     }
-#else
-    mqd_t mq;
 
-    if ((mq = mq_open(NM_MQ_PATH, O_WRONLY | O_CREAT | O_NONBLOCK,
-                    0600, NULL)) == (mqd_t) -1) {
-        return NM_ERR;
+    args = json_object_new_object();
+    json_object_object_add(args, "command", parsed);
+
+    /* the daemon answers when the job is queued */
+    rc = nm_mon_ctl_call("job", args, NM_QMP_SEND_TIMEOUT * 1000, &reply);
+    if (rc != NM_OK) {
+        nm_debug("%s: job is not queued: %s\n", __func__,
+                reply ? json_object_to_json_string(reply) : "no answer");
     }
 
-    if (mq_send(mq, cmd->data, cmd->len, 0) == EAGAIN) {
-        return NM_ERR;
+    if (reply) {
+        json_object_put(reply);
     }
 
-    mq_close(mq);
-#endif /* NM_OS_DARWIN */
-    return NM_OK;
+    return rc;
 }
 
 #if defined (NM_OS_LINUX)
@@ -461,60 +452,19 @@ int nm_qmp_add_macvtap(const nm_str_t *name,
         const nm_str_t *id, const nm_iface_t *nic)
 {
     int rc = NM_ERR;
-    struct msghdr msg;
-    struct iovec iov[1];
-    char control[CMSG_SPACE(sizeof(int))];
-    struct cmsghdr *cmsg;
-    nm_str_t sock_path = NM_INIT_STR;
     nm_str_t qmp_cmd = NM_INIT_STR;
-    nm_qmp_handle_t qmp = NM_INIT_QMP;
-    struct timeval tv = { .tv_sec = 0, .tv_usec = 5000000 }; /* 5s */
+    nm_qmp_sess_t *sess;
     struct timespec ts;
 
-    nm_qmp_sock_path(name, &sock_path);
-    qmp.sock.sun_family = AF_UNIX;
-    nm_strlcpy(qmp.sock.sun_path, sock_path.data, sizeof(qmp.sock.sun_path));
-
-    if ((qmp.sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
-        nm_warn(_(NM_MSG_Q_CR_ERR));
+    if ((sess = nm_qmp_open(name)) == NULL) {
+        close(nic->tap_fd);
         goto out;
     }
 
-    if (connect(qmp.sd, (struct sockaddr *) &qmp.sock,
-                sizeof(qmp.sock)) == -1) {
-        close(qmp.sd);
-        nm_warn(_(NM_MSG_Q_CN_ERR));
-        goto out;
-    }
-
-    memset(&msg, 0, sizeof(msg));
-    memset(control, 0, sizeof(control));
-
-    nm_str_format(&qmp_cmd, "%s", NM_QMP_CMD_INIT);
-    iov[0].iov_base = qmp_cmd.data;
-    iov[0].iov_len = qmp_cmd.len;
-
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-
-    msg.msg_control = control;
-    msg.msg_controllen = sizeof(control);
-
-    cmsg = CMSG_FIRSTHDR(&msg);
-    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
-    cmsg->cmsg_level = SOL_SOCKET;
-    cmsg->cmsg_type = SCM_RIGHTS;
-    memcpy(CMSG_DATA(cmsg), &nic->tap_fd, sizeof(int));
-
-    do {
-        rc = sendmsg(qmp.sd, &msg, 0);
-    } while (rc < 0 && errno == EINTR);
-
-    close(nic->tap_fd);
-
+    /* fd is passed along with getfd command itself */
     nm_str_format(&qmp_cmd, NM_QMP_GETFD, id->data);
-    nm_debug("exec qmp: %s\n", qmp_cmd.data);
-    rc = nm_qmp_talk(qmp.sd, qmp_cmd.data, qmp_cmd.len, &tv);
+    rc = nm_qmp_talk(sess, qmp_cmd.data, nic->tap_fd, 5000, NULL);
+    close(nic->tap_fd);
     if (rc != NM_OK) {
         goto out;
     }
@@ -523,29 +473,28 @@ int nm_qmp_add_macvtap(const nm_str_t *name,
             id->data,
             (nm_str_cmp_st(&nic->vhost, "yes") == NM_OK) ?
             "true" : "false", id->data);
-    nm_debug("exec qmp: %s\n", qmp_cmd.data);
-    rc = nm_qmp_talk(qmp.sd, qmp_cmd.data, qmp_cmd.len, &tv);
+    rc = nm_qmp_talk(sess, qmp_cmd.data, -1, 5000, NULL);
     if (rc != NM_OK) {
         goto out;
     }
 
     nm_str_format(&qmp_cmd, NM_QMP_DEV_NET_ADD,
             nic->drv.data, id->data, id->data, nic->maddr.data);
-    nm_debug("exec qmp: %s\n", qmp_cmd.data);
-    rc = nm_qmp_talk(qmp.sd, qmp_cmd.data, qmp_cmd.len, &tv);
+    rc = nm_qmp_talk(sess, qmp_cmd.data, -1, 5000, NULL);
 
     /* FIXME We cannot immediately close the socket after network device add.
      * Fore some reason it does not work, so we need to sleep a little bit.
      * Solution: wait for the QMP `query-netdev` command (missing in <= 7.1.0)
      * to appear and use it to check that the device has been created.
      */
-    memset(&ts, 0, sizeof(ts));
-    ts.tv_nsec = 1e+8; /* 0.1sec */
-    nanosleep(&ts, NULL);
+    if (!nm_qmp_sess_pooled(sess)) {
+        memset(&ts, 0, sizeof(ts));
+        ts.tv_nsec = 1e+8; /* 0.1sec */
+        nanosleep(&ts, NULL);
+    }
 
 out:
-    close(qmp.sd);
-    nm_str_free(&sock_path);
+    nm_qmp_sess_put(sess);
     nm_str_free(&qmp_cmd);
 
     return rc;
@@ -553,176 +502,144 @@ out:
 #endif /* defined NM_OS_LINUX */
 
 static int nm_qmp_vm_exec(const nm_str_t *name, const char *cmd,
-                          struct timeval *tv)
+        uint64_t timeout)
 {
-    nm_str_t sock_path = NM_INIT_STR;
-    nm_qmp_handle_t qmp = NM_INIT_QMP;
-    int rc = NM_ERR;
-
-    nm_qmp_sock_path(name, &sock_path);
-
-    qmp.sock.sun_family = AF_UNIX;
-    nm_strlcpy(qmp.sock.sun_path, sock_path.data, sizeof(qmp.sock.sun_path));
+    nm_qmp_sess_t *sess;
+    int rc;
 
-    if (nm_qmp_init_cmd(&qmp) == NM_ERR) {
-        goto out;
+    if ((sess = nm_qmp_open(name)) == NULL) {
+        return NM_ERR;
     }
 
-    rc = nm_qmp_talk(qmp.sd, cmd, strlen(cmd), tv);
-    close(qmp.sd);
+    rc = nm_qmp_talk(sess, cmd, -1, timeout, NULL);
+    nm_qmp_sess_put(sess);
 
-out:
-    nm_str_free(&sock_path);
     return rc;
 }
 
-void nm_qmp_vm_exec_async(const nm_str_t *name, const char *cmd,
+/*
+ * Run block job and wait for its completion. Job status changes are
+ * delivered by QEMU as JOB_STATUS_CHANGE events, the result is queried
+ * once the job is concluded.
+ */
+int nm_qmp_vm_exec_async(const nm_str_t *name, const char *cmd,
         const char *jobid)
 {
-    nm_str_t sock_path = NM_INIT_STR;
-    nm_qmp_handle_t qmp = NM_INIT_QMP;
-
-    nm_qmp_sock_path(name, &sock_path);
+    struct json_object *reply = NULL;
+    nm_qmp_sess_t *sess;
+    int rc;
 
-    qmp.sock.sun_family = AF_UNIX;
-    nm_strlcpy(qmp.sock.sun_path, sock_path.data, sizeof(qmp.sock.sun_path));
+    if ((sess = nm_qmp_open(name)) == NULL) {
+        return NM_ERR;
+    }
 
-    if (nm_qmp_init_cmd(&qmp) == NM_ERR) {
+    rc = nm_qmp_exec_wait(sess, cmd, 1000, "JOB_STATUS_CHANGE",
+            nm_qmp_job_match, jobid, NM_QMP_JOB_TIMEOUT * 1000);
+    if (rc != NM_OK) {
+        nm_debug("%s: job %s was not concluded\n", __func__, jobid);
+        rc = NM_ERR;
         goto out;
     }
 
-    nm_qmp_talk_async(qmp.sd, cmd, strlen(cmd), jobid);
-    close(qmp.sd);
+    if ((rc = nm_qmp_talk(sess, NM_QMP_CMD_JOBS, -1, 1000, &reply)) == NM_OK) {
+        rc = nm_qmp_check_job(jobid, reply);
+    }
 
 out:
-    nm_str_free(&sock_path);
+    nm_qmp_sess_put(sess);
+    if (reply) {
+        json_object_put(reply);
+    }
+
+    return rc;
 }
 
-static int nm_qmp_init_cmd(nm_qmp_handle_t *h)
+static nm_qmp_sess_t *nm_qmp_open(const nm_str_t *name)
 {
-    socklen_t len = sizeof(h->sock);
-    struct timeval tv;
+    nm_qmp_sess_t *sess = nm_qmp_sess_get(name);
 
-    tv.tv_sec = 0;
-    tv.tv_usec = 100000; /* 0.1 s */
-
-    if ((h->sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
-        nm_warn(_(NM_MSG_Q_CR_ERR));
-        return NM_ERR;
-    }
-
-    if (fcntl(h->sd, F_SETFL, O_NONBLOCK) == -1) {
-        close(h->sd);
-        nm_warn(_(NM_MSG_Q_FL_ERR));
-        return NM_ERR;
-    }
-
-    if (connect(h->sd, (struct sockaddr *) &h->sock, len) == -1) {
-        close(h->sd);
+    /* the daemon has no screen to show warnings */
+    if (!sess && !nm_qmp_reactor_threaded()) {
         nm_warn(_(NM_MSG_Q_CN_ERR));
-        return NM_ERR;
     }
 
-    return nm_qmp_talk(h->sd, NM_QMP_CMD_INIT, strlen(NM_QMP_CMD_INIT), &tv);
+    return sess;
 }
 
-static int nm_qmp_check_answer(const nm_str_t *answer)
+/*
+ * Execute command. If reply is not NULL it gets the reply
+ * object on success, the caller must release it.
+ */
+static int nm_qmp_talk(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, struct json_object **reply)
 {
-    /* {"return": {}} from answer means OK
-     * TODO: use JSON parser instead, e.g: json-c
-     */
-    const char *regex = ".*\\{\"return\":[[:space:]]\\{\\}\\}.*";
-    regex_t reg;
-    int rc = NM_OK;
+    struct json_object *msg;
+    int rc;
 
-    if (regcomp(&reg, regex, REG_NOSUB | REG_EXTENDED) != 0) {
-        nm_bug("%s: regcomp failed", __func__);
+    rc = nm_qmp_exec(sess, cmd, fd, timeout, &msg);
+    if (rc != NM_OK) {
+        nm_qmp_warn(sess, msg ? _(NM_MSG_Q_EXEC_E) : _(NM_MSG_Q_NO_ANS));
     }
 
-    if (regexec(&reg, answer->data, 0, NULL, 0) != 0) {
-        rc = NM_ERR;
+    if (rc == NM_OK && reply) {
+        *reply = msg;
+    } else if (msg) {
+        json_object_put(msg);
     }
 
-    regfree(&reg);
-
     return rc;
 }
 
-static int nm_qmp_parse(const char *jobid, const nm_str_t *answer)
+static void nm_qmp_warn(const nm_qmp_sess_t *sess, const char *msg)
 {
-    int state = NM_QMP_STATE_UNDEF;
-    nm_vect_t json = NM_INIT_VECT;
-    char *saveptr;
-    char *token;
-
-    saveptr = answer->data;
-
-    while ((token = strtok_r(saveptr, "\n", &saveptr))) {
-        nm_str_t js = NM_INIT_STR;
-
-        nm_str_format(&js, "%s", token);
-        nm_vect_insert(&json, &js, sizeof(nm_str_t), nm_str_vect_ins_cb);
-        nm_str_free(&js);
+    /* non-pooled fallback sessions of the daemon must not reach ncurses */
+    if (nm_qmp_sess_pooled(sess) || nm_qmp_reactor_threaded()) {
+        nm_debug("%s: %s\n", __func__, msg);
+    } else {
+        nm_warn(msg);
     }
+}
 
-    if (json.n_memb == 1) {
-        nm_debug("%s: single json\n", __func__);
-        state = nm_qmp_check_job(jobid, nm_vect_at(&json, 0));
-        goto out;
-    }
+static bool nm_qmp_job_match(struct json_object *data, const void *ctx)
+{
+    struct json_object *id, *status;
 
-    nm_debug("%s: multiple json: %zu\n", __func__, json.n_memb);
-    for (size_t n = 0; n < json.n_memb; n++) {
-        if ((state = nm_qmp_check_job(jobid, nm_vect_at(&json, n)))
-                == NM_QMP_STATE_DONE) {
-            break;
-        }
-    }
+    return json_object_object_get_ex(data, "id", &id) &&
+        json_object_object_get_ex(data, "status", &status) &&
+        nm_str_cmp_tt(json_object_get_string(id), ctx) == NM_OK &&
+        nm_str_cmp_tt(json_object_get_string(status), "concluded") == NM_OK;
+}
 
-out:
-    nm_vect_free(&json, nm_str_vect_free_cb);
+static bool nm_qmp_dev_match(struct json_object *data, const void *ctx)
+{
+    struct json_object *dev;
 
-    return state;
+    return json_object_object_get_ex(data, "device", &dev) &&
+        nm_str_cmp_tt(json_object_get_string(dev), ctx) == NM_OK;
 }
 
-static int nm_qmp_check_job(const char *jobid, const nm_str_t *answer)
+/*
+ * Check query-jobs reply of the concluded job.
+ * Returns NM_OK if the job finished without error.
+ */
+static int nm_qmp_check_job(const char *jobid, struct json_object *answer)
 {
-    struct json_object *parsed, *ret, *job, *id, *err, *status;
-    int state = NM_QMP_STATE_DONE;
+    struct json_object *ret, *job, *id, *err, *status;
     nm_str_t body = NM_INIT_STR;
-    int jobs = 0;
+    bool found = false;
+    int rc = NM_ERR;
+    int jobs;
 
     nm_debug("%s: checking job: %s\n", __func__, jobid);
-    nm_debug("%s: answer: %s\n", __func__, answer->data);
-
-    parsed = json_tokener_parse(answer->data);
-    if (!parsed) {
-        nm_debug("%s: [more] need more data\n", __func__);
-        state = NM_QMP_STATE_MORE;
-        goto out;
-    }
-
-    json_object_object_get_ex(parsed, "return", &ret);
-    if (ret == NULL) {
-        nm_debug("%s: [next] need more data\n", __func__);
-        state = NM_QMP_STATE_NEXT;
-        goto out;
-    }
 
-    /* skip {"return": {}} */
-    if (json_object_get_type(ret) != json_type_array) {
-        nm_debug("%s: [ret next] need more data\n", __func__);
-        state = NM_QMP_STATE_NEXT;
-        goto out;
+    if (!json_object_object_get_ex(answer, "return", &ret) ||
+            json_object_get_type(ret) != json_type_array) {
+        nm_debug("%s: unexpected query-jobs reply: %s\n", __func__,
+                json_object_to_json_string(answer));
+        return NM_ERR;
     }
 
     jobs = json_object_array_length(ret);
-    if (!jobs) {
-        nm_debug("%s: [ret next] need more data\n", __func__);
-        state = NM_QMP_STATE_REPEAT;
-        goto out;
-    }
-
     nm_debug("%s: got %d jobs\n", __func__, jobs);
     for (int i = 0; i < jobs; i++) {
         const char *id_str;
@@ -735,12 +652,14 @@ static int nm_qmp_check_job(const char *jobid, const nm_str_t *answer)
             const char *status_str;
 
             nm_debug("%s: job found: %s, checking status\n", __func__, id_str);
+            found = true;
 
             json_object_object_get_ex(job, "status", &status);
             status_str = json_object_get_string(status);
+            /* JOB_STATUS_CHANGE has already reported it as concluded */
             if (nm_str_cmp_tt(status_str, "concluded") != NM_OK) {
-                nm_debug("%s: job %s is not finished yet\n", __func__, id_str);
-                state = NM_QMP_STATE_REPEAT;
+                nm_debug("%s: job %s has unexpected status: %s\n",
+                        __func__, id_str, status_str);
                 break;
             }
 
@@ -760,6 +679,7 @@ static int nm_qmp_check_job(const char *jobid, const nm_str_t *answer)
 
             /*job finished successfully */
             nm_debug("%s: job %s executed successfully\n", __func__, id_str);
+            rc = NM_OK;
 #if defined (NM_WITH_DBUS)
             nm_str_format(&body, "%s", id_str);
             nm_dbus_send_notify("Job finished successfully:", body.data);
@@ -767,152 +687,17 @@ static int nm_qmp_check_job(const char *jobid, const nm_str_t *answer)
             break;
         }
     }
-out:
-    json_object_put(parsed);
-    nm_str_free(&body);
 
-    return state;
-}
-
-static int nm_qmp_talk(int sd, const char *cmd,
-                       size_t len, const struct timeval *tvp)
-{
-    nm_str_t answer = NM_INIT_STR;
-    char buf[NM_QMP_READLEN];
-    ssize_t nread;
-    fd_set readset;
-    int ret, read_done = 0;
-    int rc = NM_OK;
-    struct timeval tv;
-
-    if (write(sd, cmd, len) == -1) {
-        close(sd);
-        nm_warn(_(NM_MSG_Q_SE_ERR));
-        return NM_ERR;
-    }
-
-    while (!read_done) {
-        FD_ZERO(&readset);
-        FD_SET(sd, &readset);
-        memcpy(&tv, tvp, sizeof(struct timeval));
-
-        ret = select(sd + 1, &readset, NULL, NULL, &tv);
-        if (ret == -1) {
-            nm_bug("%s: select error: %s", __func__, strerror(errno));
-        } else if (ret && FD_ISSET(sd, &readset)) { /* data is available */
-            memset(buf, 0, NM_QMP_READLEN);
-            nread = read(sd, buf, NM_QMP_READLEN);
-            if (nread > 1) {
-                buf[nread - 2] = '\0';
-                nm_str_add_text(&answer, buf);
-                /* check for command successfully executed here
-                 * and return if it done
-                 */
-                if ((rc = nm_qmp_check_answer(&answer)) == NM_OK) {
-                    goto out;
-                }
-            } else if (nread == 0) { /* socket closed */
-                read_done = 1;
-            }
-        } else { /* timeout, nothing happens */
-            read_done = 1;
-        }
-    }
-
-    if (answer.len == 0) {
-        nm_warn(_(NM_MSG_Q_NO_ANS));
-        rc = NM_ERR;
-        goto err;
+    if (!found) {
+        nm_debug("%s: job %s is missing in query-jobs reply\n",
+                __func__, jobid);
     }
 
-out:
-    nm_debug("QMP: %s\n", answer.data);
-    if (rc != NM_OK) {
-        nm_warn(_(NM_MSG_Q_EXEC_E));
-    }
-err:
-    nm_str_free(&answer);
+    nm_str_free(&body);
 
     return rc;
 }
 
-static void nm_qmp_talk_async(int sd, const char *cmd,
-                       size_t len, const char *jobid)
-{
-    char buf[NM_QMP_READLEN + 1] = {0};
-    nm_str_t answer = NM_INIT_STR;
-    int ret, read_done = 0;
-    struct timeval tv;
-    int state = NM_QMP_STATE_UNDEF;
-    fd_set readset;
-    ssize_t nread;
-
-    if (write(sd, cmd, len) == -1) {
-        close(sd);
-        //nm_warn(_(NM_MSG_Q_SE_ERR));
-        return;
-    }
-
-    if (write(sd, NM_QMP_CMD_JOBS, sizeof(NM_QMP_CMD_JOBS) - 1) == -1) {
-        close(sd);
-        //nm_warn(_(NM_MSG_Q_SE_ERR));
-        return;
-    }
-
-    while (!read_done) {
-        FD_ZERO(&readset);
-        FD_SET(sd, &readset);
-        tv.tv_sec = 300;
-        tv.tv_usec = 0;
-
-        /* query jobs */
-        if (state == NM_QMP_STATE_REPEAT) {
-            if (write(sd, NM_QMP_CMD_JOBS, sizeof(NM_QMP_CMD_JOBS) - 1) == -1) {
-                close(sd);
-                //nm_warn(_(NM_MSG_Q_SE_ERR));
-                return;
-            }
-            state = NM_QMP_STATE_UNDEF;
-        }
-
-        ret = select(sd + 1, &readset, NULL, NULL, &tv);
-        if (ret == -1) {
-            nm_bug("%s: select error: %s", __func__, strerror(errno));
-        } else if (ret && FD_ISSET(sd, &readset)) { /* data is available */
-            memset(buf, 0, NM_QMP_READLEN);
-            nread = read(sd, buf, NM_QMP_READLEN);
-            if (nread > 1) {
-                if (buf[nread - 2] == '\r') {
-                    buf[nread - 2] = '\0';
-                }
-                if (state == NM_QMP_STATE_MORE) {
-                    nm_str_add_text(&answer, buf);
-                } else {
-                    nm_str_format(&answer, "%s", buf);
-                }
-                /* check for job successfully finished
-                 * and return if it done
-                 */
-                if ((state = nm_qmp_parse(jobid,
-                                &answer)) == NM_QMP_STATE_DONE) {
-                    goto out;
-                }
-            } else if (nread == 0) { /* socket closed */
-                read_done = 1;
-            }
-        } else { /* timeout, nothing happens */
-            read_done = 1;
-        }
-    }
-
-    if (answer.len == 0) {
-        //nm_warn(_(NM_MSG_Q_NO_ANS));
-    }
-
-out:
-    nm_str_free(&answer);
-}
-
 static void nm_qmp_sock_path(const nm_str_t *name, nm_str_t *path)
 {
     nm_str_format(path, "%s/%s/qmp.sock",
@@ -19,8 +19,9 @@ int nm_qmp_usb_detach(const nm_str_t *name, const nm_usb_data_t *usb);
 int nm_qmp_nic_attach(const nm_str_t *name, const nm_iface_t *nic);
 int nm_qmp_nic_detach(const nm_str_t *name, const nm_iface_t *nic);
 int nm_qmp_test_socket(const nm_str_t *name);
-void nm_qmp_vm_exec_async(const nm_str_t *name, const char *cmd,
+int nm_qmp_vm_exec_async(const nm_str_t *name, const char *cmd,
         const char *jobid);
 
+
 #endif /* NM_QMP_CONTROL_H_ */
 /* vim:set ts=4 sw=4: */
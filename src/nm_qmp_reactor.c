@@ -0,0 +1,1279 @@
+#if defined (NM_OS_LINUX)
+# define _GNU_SOURCE
+#endif
+
+#include <nm_core.h>
+#include <nm_utils.h>
+#include <nm_string.h>
+#include <nm_vector.h>
+#include <nm_cfg_file.h>
+#include <nm_qmp_reactor.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <poll.h>
+#if defined (NM_OS_LINUX)
+#include <sys/epoll.h>
+#endif
+
+/* json_tokener_get_parse_end() appeared in json-c 0.15 */
+#if JSON_C_VERSION_NUM < ((0 << 16) | (15 << 8))
+# define json_tokener_get_parse_end(tok) ((size_t) (tok)->char_offset)
+#endif
+
+enum {NM_QMP_READLEN = 4096};
+enum {NM_QMP_INIT_TIMEOUT = 1000}; /* ms */
+enum {NM_QMP_MAX_READY = 64};      /* descriptors handled per wakeup */
+
+static const char NM_QMP_CMD_INIT[]   = "{\"execute\":\"qmp_capabilities\"}";
+static const char NM_QMP_CMD_STATUS[] = "{\"execute\":\"query-status\"}";
+static const char NM_QMP_EXECUTE[]    = "\"execute\":\"";
+
+const uint64_t nm_qmp_lat_bounds[NM_QMP_LAT_BUCKETS] = {
+    1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000
+};
+
+/* pending command (id != 0) or event watcher */
+typedef struct {
+    int64_t id;
+    const char *event;
+    nm_qmp_match_cb_t match;
+    const void *match_ctx;
+    uint64_t deadline;      /* nm_mono_ms() */
+    uint64_t start;         /* nm_mono_us() of submission */
+    int stat;               /* index in reactor stats, -1 if none */
+    nm_qmp_done_cb_t cb;
+    void *ctx;
+} nm_qmp_req_t;
+
+struct nm_qmp_sess {
+    nm_str_t name;
+    int sd;
+    struct json_tokener *tok; /* keeps incomplete message between reads */
+    nm_str_t wbuf;            /* data not accepted by the socket yet */
+    int64_t seq;              /* id of the last command */
+    nm_vect_t reqs;           /* nm_qmp_req_t, each holds a reference */
+    int refs;
+    bool pooled;
+};
+
+/* completion collected under the lock, callback runs without it */
+typedef struct {
+    nm_qmp_sess_t *sess;
+    nm_qmp_done_cb_t cb;
+    void *ctx;
+    struct json_object *msg;
+    int rc;
+} nm_qmp_done_t;
+
+/* synchronous caller waiting for completion */
+typedef struct {
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    struct json_object *msg;
+    int rc;
+    bool done;
+} nm_qmp_wait_t;
+
+#define NM_INIT_QMP_WAIT (nm_qmp_wait_t) { PTHREAD_MUTEX_INITIALIZER, \
+    PTHREAD_COND_INITIALIZER, NULL, NM_ERR, false }
+
+typedef struct {
+    pthread_mutex_t mtx;    /* protects sessions and events */
+    pthread_mutex_t run;    /* held by the thread driving the reactor */
+    nm_vect_t sess;         /* nm_qmp_sess_t */
+    nm_vect_t events;       /* nm_qmp_event_t for the daemon main loop */
+    nm_vect_t failed;       /* nm_qmp_done_t of closed sessions */
+    nm_qmp_stat_t stats[NM_QMP_MAX_STATS];
+    size_t n_stats;
+    int wake[2];            /* interrupts the reactor wait */
+    int ev_wake[2];         /* wakes up the daemon main loop */
+#if defined (NM_OS_LINUX)
+    int epfd;
+#endif
+    pid_t pid;              /* descriptors are not shared with children */
+    pthread_t thr;
+    bool threaded;
+    bool stop;
+} nm_qmp_reactor_t;
+
+static nm_qmp_reactor_t reactor = {
+    .mtx = PTHREAD_MUTEX_INITIALIZER,
+    .run = PTHREAD_MUTEX_INITIALIZER,
+    .sess = NM_INIT_VECT,
+    .events = NM_INIT_VECT,
+    .failed = NM_INIT_VECT,
+    .wake = { -1, -1 },
+    .ev_wake = { -1, -1 },
+#if defined (NM_OS_LINUX)
+    .epfd = -1,
+#endif
+};
+
+static void nm_qmp_reactor_init(void);
+static void *nm_qmp_reactor_thread(void *ctx);
+static void nm_qmp_reactor_run(void);
+static int nm_qmp_reactor_timeout(void);
+static void nm_qmp_reactor_io(int fd, bool in, bool out, nm_vect_t *done);
+static void nm_qmp_reactor_wake(void);
+static void nm_qmp_pipe_open(int *fds);
+static void nm_qmp_pipe_close(int *fds);
+static void nm_qmp_io_add(int sd);
+static void nm_qmp_io_out(int sd, bool enable);
+static void nm_qmp_io_del(int sd);
+static nm_qmp_sess_t *nm_qmp_sess_new(const nm_str_t *name, bool pooled);
+static nm_qmp_sess_t *nm_qmp_sess_find(const nm_str_t *name, int sd);
+static int nm_qmp_sess_open(nm_qmp_sess_t *sess);
+static void nm_qmp_sess_close(nm_qmp_sess_t *sess);
+static void nm_qmp_sess_lost(nm_qmp_sess_t *sess, nm_vect_t *done, bool gone);
+static void nm_qmp_sess_unref(nm_qmp_sess_t *sess);
+static void nm_qmp_sess_free_cb(void *unit_p);
+static int nm_qmp_sess_write(nm_qmp_sess_t *sess, const nm_str_t *buf, int fd);
+static void nm_qmp_sess_flush(nm_qmp_sess_t *sess, nm_vect_t *done);
+static void nm_qmp_sess_read(nm_qmp_sess_t *sess, nm_vect_t *done);
+static void nm_qmp_sess_dispatch(nm_qmp_sess_t *sess,
+        struct json_object *msg, nm_vect_t *done);
+static int nm_qmp_submit_locked(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx);
+static void nm_qmp_done_add(nm_vect_t *done, nm_qmp_sess_t *sess,
+        size_t idx, int rc, struct json_object *msg);
+static void nm_qmp_done_run(nm_vect_t *done);
+static void nm_qmp_status_cb(int rc, struct json_object *msg, void *ctx);
+static void nm_qmp_wait_cb(int rc, struct json_object *msg, void *ctx);
+static int nm_qmp_wait_done(nm_qmp_wait_t *w);
+static void nm_qmp_wait_free(nm_qmp_wait_t *w);
+static void nm_qmp_event_push(const nm_str_t *name, int id);
+static int nm_qmp_stat_find(const char *cmd);
+static void nm_qmp_stat_add(const nm_qmp_req_t *req, int rc);
+static void nm_qmp_event_free_cb(void *unit_p);
+
+void nm_qmp_reactor_start(void)
+{
+    pthread_mutex_lock(&reactor.mtx);
+    nm_qmp_reactor_init();
+    nm_qmp_pipe_open(reactor.ev_wake);
+    reactor.stop = false;
+    reactor.threaded = true;
+    pthread_mutex_unlock(&reactor.mtx);
+
+    if (pthread_create(&reactor.thr, NULL, nm_qmp_reactor_thread, NULL) != 0) {
+        nm_bug("%s: cannot create reactor thread", __func__);
+    }
+#if defined (NM_OS_LINUX)
+    pthread_setname_np(reactor.thr, "nemu-qmp-io");
+#endif
+}
+
+void nm_qmp_reactor_stop(void)
+{
+    nm_vect_t done = NM_INIT_VECT;
+
+    if (!reactor.threaded) {
+        return;
+    }
+
+    __atomic_store_n(&reactor.stop, true, __ATOMIC_RELEASE);
+    nm_qmp_reactor_wake();
+    pthread_join(reactor.thr, NULL);
+
+    pthread_mutex_lock(&reactor.mtx);
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        nm_qmp_sess_lost(nm_vect_at(&reactor.sess, n), &reactor.failed, false);
+    }
+    done = reactor.failed;
+    reactor.failed = (nm_vect_t) NM_INIT_VECT;
+    pthread_mutex_unlock(&reactor.mtx);
+    nm_qmp_done_run(&done);
+
+    pthread_mutex_lock(&reactor.mtx);
+    reactor.threaded = false;
+    /* sessions still held by workers are freed by nm_qmp_sess_put() */
+    for (size_t n = reactor.sess.n_memb; n > 0; n--) {
+        nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n - 1);
+
+        sess->pooled = false;
+        if (!sess->refs) {
+            nm_vect_delete(&reactor.sess, n - 1, nm_qmp_sess_free_cb);
+        }
+    }
+    nm_vect_free(&reactor.events, nm_qmp_event_free_cb);
+    nm_qmp_pipe_close(reactor.ev_wake);
+    pthread_mutex_unlock(&reactor.mtx);
+}
+
+bool nm_qmp_reactor_threaded(void)
+{
+    return reactor.threaded;
+}
+
+nm_qmp_sess_t *nm_qmp_sess_get(const nm_str_t *name)
+{
+    nm_qmp_sess_t *sess = NULL;
+
+    pthread_mutex_lock(&reactor.mtx);
+    nm_qmp_reactor_init();
+
+    if (reactor.threaded) {
+        if ((sess = nm_qmp_sess_find(name, -1)) == NULL) {
+            sess = nm_qmp_sess_new(name, true);
+        }
+        if (sess->sd == -1 && nm_qmp_sess_open(sess) != NM_OK) {
+            sess = NULL;
+        }
+    }
+
+    /* VM was started without daemon monitor, use the main one */
+    if (!sess) {
+        sess = nm_qmp_sess_new(name, false);
+        if (nm_qmp_sess_open(sess) != NM_OK) {
+            nm_qmp_sess_unref(sess);
+            sess = NULL;
+        }
+    }
+
+    if (sess) {
+        sess->refs++;
+    }
+    pthread_mutex_unlock(&reactor.mtx);
+
+    return sess;
+}
+
+void nm_qmp_sess_put(nm_qmp_sess_t *sess)
+{
+    if (!sess) {
+        return;
+    }
+
+    pthread_mutex_lock(&reactor.mtx);
+    nm_qmp_sess_unref(sess);
+    pthread_mutex_unlock(&reactor.mtx);
+}
+
+bool nm_qmp_sess_pooled(const nm_qmp_sess_t *sess)
+{
+    return sess->pooled;
+}
+
+void nm_qmp_sess_drop(const nm_str_t *name)
+{
+    nm_qmp_sess_t *sess;
+
+    pthread_mutex_lock(&reactor.mtx);
+    if ((sess = nm_qmp_sess_find(name, -1)) != NULL && sess->sd != -1) {
+        nm_qmp_sess_lost(sess, &reactor.failed, false);
+        nm_qmp_reactor_wake();
+    }
+    pthread_mutex_unlock(&reactor.mtx);
+}
+
+int nm_qmp_submit(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx)
+{
+    int rc;
+
+    pthread_mutex_lock(&reactor.mtx);
+    rc = nm_qmp_submit_locked(sess, cmd, fd, timeout, cb, ctx);
+    pthread_mutex_unlock(&reactor.mtx);
+
+    return rc;
+}
+
+int nm_qmp_watch(nm_qmp_sess_t *sess, const char *event,
+        nm_qmp_match_cb_t match, const void *match_ctx,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx)
+{
+    nm_qmp_req_t req = {
+        .event = event,
+        .match = match,
+        .match_ctx = match_ctx,
+        .deadline = nm_mono_ms() + timeout,
+        .cb = cb,
+        .ctx = ctx
+    };
+    int rc = NM_ERR;
+
+    pthread_mutex_lock(&reactor.mtx);
+    if (sess->sd != -1) {
+        nm_vect_insert(&sess->reqs, &req, sizeof(req), NULL);
+        sess->refs++;
+        nm_qmp_reactor_wake();
+        rc = NM_OK;
+    }
+    pthread_mutex_unlock(&reactor.mtx);
+
+    return rc;
+}
+
+int nm_qmp_exec(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, struct json_object **reply)
+{
+    nm_qmp_wait_t w = NM_INIT_QMP_WAIT;
+    int rc;
+
+    if (reply) {
+        *reply = NULL;
+    }
+
+    if (nm_qmp_submit(sess, cmd, fd, timeout, nm_qmp_wait_cb, &w) != NM_OK) {
+        return NM_ERR;
+    }
+
+    rc = nm_qmp_wait_done(&w);
+    if (reply) {
+        *reply = w.msg;
+        w.msg = NULL;
+    }
+    nm_qmp_wait_free(&w);
+
+    return rc;
+}
+
+int nm_qmp_exec_wait(nm_qmp_sess_t *sess, const char *cmd, uint64_t timeout,
+        const char *event, nm_qmp_match_cb_t match, const void *match_ctx,
+        uint64_t ev_timeout)
+{
+    nm_qmp_wait_t w = NM_INIT_QMP_WAIT;
+    int rc;
+
+    /* watch before the command, the event may precede the reply */
+    if (nm_qmp_watch(sess, event, match, match_ctx,
+                timeout + ev_timeout, nm_qmp_wait_cb, &w) != NM_OK) {
+        return NM_ERR;
+    }
+
+    rc = nm_qmp_exec(sess, cmd, -1, timeout, NULL);
+
+    if (rc != NM_OK) {
+        /* do not wait for the event that will not come */
+        pthread_mutex_lock(&reactor.mtx);
+        for (size_t n = 0; n < sess->reqs.n_memb; n++) {
+            nm_qmp_req_t *req = nm_vect_at(&sess->reqs, n);
+
+            if (req->ctx == &w) {
+                nm_vect_delete(&sess->reqs, n, NULL);
+                nm_qmp_sess_unref(sess);
+                w.done = true;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&reactor.mtx);
+    }
+
+    if (nm_qmp_wait_done(&w) != NM_OK && rc == NM_OK) {
+        rc = NM_QMP_NO_EVENT;
+    }
+    nm_qmp_wait_free(&w);
+
+    return rc;
+}
+
+int nm_qmp_subscribe(const nm_str_t *name)
+{
+    nm_qmp_sess_t *sess;
+    int rc = NM_ERR;
+
+    if (!reactor.threaded || (sess = nm_qmp_sess_get(name)) == NULL) {
+        return NM_ERR;
+    }
+
+    /* session is kept by the reactor, the reply is handled there */
+    if (sess->pooled) {
+        rc = nm_qmp_submit(sess, NM_QMP_CMD_STATUS, -1,
+                NM_QMP_INIT_TIMEOUT, nm_qmp_status_cb, sess);
+    }
+    nm_qmp_sess_put(sess);
+
+    return rc;
+}
+
+size_t nm_qmp_stats(nm_qmp_stat_t *buf, size_t len)
+{
+    pthread_mutex_lock(&reactor.mtx);
+    len = nm_min(len, reactor.n_stats);
+    memcpy(buf, reactor.stats, len * sizeof(nm_qmp_stat_t));
+    pthread_mutex_unlock(&reactor.mtx);
+
+    return len;
+}
+
+int nm_qmp_event_fd(void)
+{
+    return reactor.ev_wake[0];
+}
+
+int nm_qmp_event_next(nm_qmp_event_t *ev)
+{
+    int rc = NM_ERR;
+
+    pthread_mutex_lock(&reactor.mtx);
+    if (reactor.events.n_memb) {
+        const nm_qmp_event_t *cur = nm_vect_at(&reactor.events, 0);
+
+        nm_str_copy(&ev->name, &cur->name);
+        ev->id = cur->id;
+        nm_vect_delete(&reactor.events, 0, nm_qmp_event_free_cb);
+        rc = NM_OK;
+    } else if (reactor.ev_wake[0] != -1) {
+        char buf[64];
+
+        /* queue is empty, next push will write again */
+        while (read(reactor.ev_wake[0], buf, sizeof(buf)) > 0) {
+            ;
+        }
+    }
+    pthread_mutex_unlock(&reactor.mtx);
+
+    return rc;
+}
+
+/* called with reactor mutex held */
+static void nm_qmp_reactor_init(void)
+{
+    if (reactor.pid == getpid()) {
+        return;
+    }
+
+    /* forked process must not touch parent's sessions */
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n);
+
+        if (sess->sd != -1) {
+            close(sess->sd);
+            sess->sd = -1;
+        }
+    }
+    nm_vect_free(&reactor.sess, nm_qmp_sess_free_cb);
+    nm_qmp_pipe_close(reactor.wake);
+    nm_qmp_pipe_close(reactor.ev_wake);
+
+    nm_qmp_pipe_open(reactor.wake);
+#if defined (NM_OS_LINUX)
+    if (reactor.epfd != -1) {
+        close(reactor.epfd);
+    }
+    if ((reactor.epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        nm_bug("%s: epoll_create1 error: %s", __func__, strerror(errno));
+    }
+    nm_qmp_io_add(reactor.wake[0]);
+#endif
+    reactor.pid = getpid();
+}
+
+static void *nm_qmp_reactor_thread(void *ctx)
+{
+    (void) ctx;
+
+    while (!__atomic_load_n(&reactor.stop, __ATOMIC_ACQUIRE)) {
+        nm_qmp_reactor_run();
+    }
+
+    return NULL;
+}
+
+/*
+ * Wait for I/O or the nearest deadline, dispatch received messages
+ * and expire outdated requests. Completion callbacks are called
+ * after the reactor mutex is released.
+ */
+static void nm_qmp_reactor_run(void)
+{
+    nm_vect_t done = NM_INIT_VECT;
+    int timeout, nready;
+    uint64_t now;
+#if defined (NM_OS_LINUX)
+    struct epoll_event ready[NM_QMP_MAX_READY];
+#else
+    struct pollfd *ready;
+    nfds_t nfds = 0;
+#endif
+
+    pthread_mutex_lock(&reactor.run);
+    pthread_mutex_lock(&reactor.mtx);
+    timeout = nm_qmp_reactor_timeout();
+
+#if defined (NM_OS_LINUX)
+    pthread_mutex_unlock(&reactor.mtx);
+    nready = epoll_wait(reactor.epfd, ready, NM_QMP_MAX_READY, timeout);
+    if (nready == -1 && errno != EINTR) {
+        nm_bug("%s: epoll_wait error: %s", __func__, strerror(errno));
+    }
+
+    pthread_mutex_lock(&reactor.mtx);
+    for (int n = 0; n < nready; n++) {
+        nm_qmp_reactor_io(ready[n].data.fd,
+                ready[n].events & (EPOLLIN | EPOLLHUP | EPOLLERR),
+                ready[n].events & EPOLLOUT, &done);
+    }
+#else
+    /* no epoll: descriptor set is rebuilt on every wakeup */
+    ready = nm_calloc(reactor.sess.n_memb + 1, sizeof(struct pollfd));
+
+    ready[nfds].fd = reactor.wake[0];
+    ready[nfds].events = POLLIN;
+    nfds++;
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        const nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n);
+
+        if (sess->sd == -1) {
+            continue;
+        }
+        ready[nfds].fd = sess->sd;
+        ready[nfds].events = POLLIN | (sess->wbuf.len ? POLLOUT : 0);
+        nfds++;
+    }
+
+    pthread_mutex_unlock(&reactor.mtx);
+    nready = poll(ready, nfds, timeout);
+    if (nready == -1 && errno != EINTR) {
+        nm_bug("%s: poll error: %s", __func__, strerror(errno));
+    }
+
+    pthread_mutex_lock(&reactor.mtx);
+    for (nfds_t n = 0; nready > 0 && n < nfds; n++) {
+        if (ready[n].revents & POLLNVAL) {
+            continue;
+        }
+        if (ready[n].revents) {
+            nm_qmp_reactor_io(ready[n].fd,
+                    ready[n].revents & (POLLIN | POLLHUP | POLLERR),
+                    ready[n].revents & POLLOUT, &done);
+        }
+    }
+    free(ready);
+#endif /* NM_OS_LINUX */
+
+    /* requests of sessions closed by other threads */
+    for (size_t n = 0; n < reactor.failed.n_memb; n++) {
+        nm_vect_insert(&done, nm_vect_at(&reactor.failed, n),
+                sizeof(nm_qmp_done_t), NULL);
+    }
+    nm_vect_free(&reactor.failed, NULL);
+
+    now = nm_mono_ms();
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n);
+
+        for (size_t i = 0; i < sess->reqs.n_memb; i++) {
+            nm_qmp_req_t *req = nm_vect_at(&sess->reqs, i);
+
+            if (req->deadline <= now) {
+                nm_debug("%s: %s: %s timed out\n", __func__, sess->name.data,
+                        req->event ? req->event : "command");
+                nm_qmp_done_add(&done, sess, i--, NM_ERR, NULL);
+            }
+        }
+    }
+    pthread_mutex_unlock(&reactor.mtx);
+    pthread_mutex_unlock(&reactor.run);
+
+    nm_qmp_done_run(&done);
+}
+
+/* time until the nearest deadline in ms, -1 if there is none */
+static int nm_qmp_reactor_timeout(void)
+{
+    uint64_t now = nm_mono_ms(), min = UINT64_MAX;
+
+    if (reactor.failed.n_memb) {
+        return 0;
+    }
+
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        const nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n);
+
+        for (size_t i = 0; i < sess->reqs.n_memb; i++) {
+            const nm_qmp_req_t *req = nm_vect_at(&sess->reqs, i);
+
+            if (req->deadline < min) {
+                min = req->deadline;
+            }
+        }
+    }
+
+    if (min == UINT64_MAX) {
+        return -1;
+    }
+
+    return (min > now) ? (int) (min - now) : 0;
+}
+
+static void nm_qmp_reactor_io(int fd, bool in, bool out, nm_vect_t *done)
+{
+    nm_qmp_sess_t *sess;
+
+    if (fd == reactor.wake[0]) {
+        char buf[64];
+
+        while (read(fd, buf, sizeof(buf)) > 0) {
+            ;
+        }
+        return;
+    }
+
+    /* session may be closed after the wait */
+    if ((sess = nm_qmp_sess_find(NULL, fd)) == NULL) {
+        return;
+    }
+
+    if (out) {
+        nm_qmp_sess_flush(sess, done);
+    }
+    if (in && sess->sd != -1) {
+        nm_qmp_sess_read(sess, done);
+    }
+}
+
+static void nm_qmp_reactor_wake(void)
+{
+    char ch = 0;
+
+    /* pipe is full means the reactor is already woken up */
+    if (reactor.wake[1] != -1 &&
+            write(reactor.wake[1], &ch, sizeof(ch)) == -1 &&
+            errno != EAGAIN) {
+        nm_debug("%s: write error: %s\n", __func__, strerror(errno));
+    }
+}
+
+static void nm_qmp_pipe_open(int *fds)
+{
+    if (pipe(fds) != 0) {
+        nm_bug("%s: pipe error: %s", __func__, strerror(errno));
+    }
+
+    for (size_t n = 0; n < 2; n++) {
+        if (fcntl(fds[n], F_SETFL, O_NONBLOCK) == -1 ||
+                fcntl(fds[n], F_SETFD, FD_CLOEXEC) == -1) {
+            nm_bug("%s: fcntl error: %s", __func__, strerror(errno));
+        }
+    }
+}
+
+static void nm_qmp_pipe_close(int *fds)
+{
+    for (size_t n = 0; n < 2; n++) {
+        if (fds[n] != -1) {
+            close(fds[n]);
+            fds[n] = -1;
+        }
+    }
+}
+
+#if defined (NM_OS_LINUX)
+static void nm_qmp_io_add(int sd)
+{
+    struct epoll_event ev = { .events = EPOLLIN, .data.fd = sd };
+
+    if (epoll_ctl(reactor.epfd, EPOLL_CTL_ADD, sd, &ev) == -1) {
+        nm_bug("%s: epoll_ctl error: %s", __func__, strerror(errno));
+    }
+}
+
+static void nm_qmp_io_out(int sd, bool enable)
+{
+    struct epoll_event ev = {
+        .events = EPOLLIN | (enable ? EPOLLOUT : 0),
+        .data.fd = sd
+    };
+
+    if (epoll_ctl(reactor.epfd, EPOLL_CTL_MOD, sd, &ev) == -1) {
+        nm_bug("%s: epoll_ctl error: %s", __func__, strerror(errno));
+    }
+}
+
+static void nm_qmp_io_del(int sd)
+{
+    epoll_ctl(reactor.epfd, EPOLL_CTL_DEL, sd, NULL);
+}
+#else
+/* poll(2) set is built from sessions, reactor only needs a wakeup */
+static void nm_qmp_io_add(int sd)
+{
+    (void) sd;
+    nm_qmp_reactor_wake();
+}
+
+static void nm_qmp_io_out(int sd, bool enable)
+{
+    (void) sd;
+    if (enable) {
+        nm_qmp_reactor_wake();
+    }
+}
+
+static void nm_qmp_io_del(int sd)
+{
+    (void) sd;
+}
+#endif /* NM_OS_LINUX */
+
+static nm_qmp_sess_t *nm_qmp_sess_new(const nm_str_t *name, bool pooled)
+{
+    nm_qmp_sess_t new_sess, *sess;
+
+    memset(&new_sess, 0, sizeof(new_sess));
+    nm_vect_insert(&reactor.sess, &new_sess, sizeof(new_sess), NULL);
+
+    sess = nm_vect_at(&reactor.sess, reactor.sess.n_memb - 1);
+    nm_str_copy(&sess->name, name);
+    sess->sd = -1;
+    sess->pooled = pooled;
+
+    return sess;
+}
+
+/* find kept session by VM name or by descriptor */
+static nm_qmp_sess_t *nm_qmp_sess_find(const nm_str_t *name, int sd)
+{
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        nm_qmp_sess_t *sess = nm_vect_at(&reactor.sess, n);
+
+        if (name && sess->pooled &&
+                nm_str_cmp_ss(&sess->name, name) == NM_OK) {
+            return sess;
+        }
+        if (!name && sess->sd != -1 && sess->sd == sd) {
+            return sess;
+        }
+    }
+
+    return NULL;
+}
+
+static int nm_qmp_sess_open(nm_qmp_sess_t *sess)
+{
+    struct sockaddr_un sock;
+    nm_str_t path = NM_INIT_STR;
+
+    nm_str_format(&path, "%s/%s/%s", nm_cfg_get()->vm_dir.data,
+            sess->name.data,
+            sess->pooled ? NM_VM_QMP_MON_FILE : NM_VM_QMP_FILE);
+
+    memset(&sock, 0, sizeof(sock));
+    sock.sun_family = AF_UNIX;
+    nm_strlcpy(sock.sun_path, path.data, sizeof(sock.sun_path));
+    nm_str_free(&path);
+
+    if ((sess->sd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+        nm_debug("%s: socket error: %s\n", __func__, strerror(errno));
+        return NM_ERR;
+    }
+
+    if (fcntl(sess->sd, F_SETFL, O_NONBLOCK) == -1 ||
+            fcntl(sess->sd, F_SETFD, FD_CLOEXEC) == -1 ||
+            connect(sess->sd, (struct sockaddr *) &sock, sizeof(sock)) == -1) {
+        close(sess->sd);
+        sess->sd = -1;
+        return NM_ERR;
+    }
+
+    if ((sess->tok = json_tokener_new()) == NULL) {
+        nm_bug("%s: json_tokener_new failed", __func__);
+    }
+    nm_qmp_io_add(sess->sd);
+
+    /* capabilities negotiation is pipelined with the first command */
+    if (nm_qmp_submit_locked(sess, NM_QMP_CMD_INIT, -1,
+                NM_QMP_INIT_TIMEOUT, NULL, NULL) != NM_OK) {
+        nm_qmp_sess_close(sess);
+        return NM_ERR;
+    }
+
+    return NM_OK;
+}
+
+static void nm_qmp_sess_close(nm_qmp_sess_t *sess)
+{
+    if (sess->sd != -1) {
+        nm_qmp_io_del(sess->sd);
+        close(sess->sd);
+        sess->sd = -1;
+    }
+    if (sess->tok) {
+        json_tokener_free(sess->tok);
+        sess->tok = NULL;
+    }
+    nm_str_free(&sess->wbuf);
+}
+
+/*
+ * Close session, pending requests fail. If QEMU has gone,
+ * the daemon is notified about VM exit.
+ */
+static void nm_qmp_sess_lost(nm_qmp_sess_t *sess, nm_vect_t *done, bool gone)
+{
+    bool notify = gone && sess->pooled && sess->sd != -1;
+
+    nm_qmp_sess_close(sess);
+
+    while (sess->reqs.n_memb) {
+        nm_qmp_done_add(done, sess, 0, NM_ERR, NULL);
+    }
+
+    if (notify) {
+        nm_qmp_event_push(&sess->name, NM_QMP_EV_CLOSED);
+    }
+}
+
+static void nm_qmp_sess_unref(nm_qmp_sess_t *sess)
+{
+    if (--sess->refs > 0 || sess->pooled) {
+        return;
+    }
+
+    nm_qmp_sess_close(sess);
+    for (size_t n = 0; n < reactor.sess.n_memb; n++) {
+        if (nm_vect_at(&reactor.sess, n) == sess) {
+            nm_vect_delete(&reactor.sess, n, nm_qmp_sess_free_cb);
+            break;
+        }
+    }
+}
+
+static void nm_qmp_sess_free_cb(void *unit_p)
+{
+    nm_qmp_sess_t *sess = unit_p;
+
+    nm_qmp_sess_close(sess);
+    nm_str_free(&sess->name);
+    nm_vect_free(&sess->reqs, NULL);
+}
+
+/*
+ * Write command or queue it until the socket is writable.
+ * Descriptor goes along with the first byte of the command,
+ * so it cannot be queued behind unsent data.
+ */
+static int nm_qmp_sess_write(nm_qmp_sess_t *sess, const nm_str_t *buf, int fd)
+{
+    ssize_t nwrite = 0;
+
+    if (sess->wbuf.len) {
+        if (fd != -1) {
+            nm_debug("%s: %s: session is busy\n", __func__, sess->name.data);
+            return NM_ERR;
+        }
+        nm_str_add_str(&sess->wbuf, buf);
+        return NM_OK;
+    }
+
+    if (fd != -1) {
+        char control[CMSG_SPACE(sizeof(int))];
+        struct iovec iov = { buf->data, buf->len };
+        struct cmsghdr *cmsg;
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        memset(control, 0, sizeof(control));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+        do {
+            nwrite = sendmsg(sess->sd, &msg, 0);
+        } while (nwrite < 0 && errno == EINTR);
+
+        /* nothing is queued, so full buffer means QEMU hangs */
+        if (nwrite <= 0) {
+            return NM_ERR;
+        }
+    } else {
+        do {
+            nwrite = write(sess->sd, buf->data, buf->len);
+        } while (nwrite < 0 && errno == EINTR);
+
+        if (nwrite < 0) {
+            if (errno != EAGAIN) {
+                return NM_ERR;
+            }
+            nwrite = 0;
+        }
+    }
+
+    if ((size_t) nwrite < buf->len) {
+        nm_str_add_text_part(&sess->wbuf, buf->data + nwrite,
+                buf->len - nwrite);
+        nm_qmp_io_out(sess->sd, true);
+    }
+
+    return NM_OK;
+}
+
+static void nm_qmp_sess_flush(nm_qmp_sess_t *sess, nm_vect_t *done)
+{
+    nm_str_t rest = NM_INIT_STR;
+    ssize_t nwrite;
+
+    if (sess->sd == -1 || !sess->wbuf.len) {
+        return;
+    }
+
+    do {
+        nwrite = write(sess->sd, sess->wbuf.data, sess->wbuf.len);
+    } while (nwrite < 0 && errno == EINTR);
+
+    if (nwrite < 0) {
+        if (errno != EAGAIN) {
+            nm_qmp_sess_lost(sess, done, true);
+        }
+        return;
+    }
+
+    if ((size_t) nwrite < sess->wbuf.len) {
+        nm_str_add_text_part(&rest, sess->wbuf.data + nwrite,
+                sess->wbuf.len - nwrite);
+    }
+    nm_str_free(&sess->wbuf);
+    sess->wbuf = rest;
+
+    if (!sess->wbuf.len) {
+        nm_qmp_io_out(sess->sd, false);
+    }
+}
+
+/*
+ * Read available data. It is fed to the session tokener as it
+ * arrives, message split between reads is completed by the next read.
+ */
+static void nm_qmp_sess_read(nm_qmp_sess_t *sess, nm_vect_t *done)
+{
+    char buf[NM_QMP_READLEN];
+    size_t pos = 0;
+    ssize_t nread;
+
+    do {
+        nread = read(sess->sd, buf, sizeof(buf));
+    } while (nread < 0 && errno == EINTR);
+
+    if (nread < 0 && errno == EAGAIN) {
+        return;
+    }
+
+    if (nread <= 0) {
+        nm_qmp_sess_lost(sess, done, true);
+        return;
+    }
+
+    while (pos < (size_t) nread) {
+        struct json_object *msg;
+        enum json_tokener_error jerr;
+
+        msg = json_tokener_parse_ex(sess->tok, buf + pos, nread - pos);
+        jerr = json_tokener_get_error(sess->tok);
+
+        if (!msg) {
+            if (jerr != json_tokener_continue) {
+                nm_debug("%s: %s: %s\n", __func__, sess->name.data,
+                        json_tokener_error_desc(jerr));
+                json_tokener_reset(sess->tok);
+            }
+            break;
+        }
+
+        pos += json_tokener_get_parse_end(sess->tok);
+        if (nm_cfg_get()->debug) {
+            nm_debug("QMP: %s\n", json_object_to_json_string(msg));
+        }
+        nm_qmp_sess_dispatch(sess, msg, done);
+        json_object_put(msg);
+    }
+}
+
+/*
+ * Route received message. Replies complete commands with the same id,
+ * replies to timed out commands are dropped. Events complete matching
+ * watchers, VM state changes are queued for the daemon main loop.
+ */
+static void nm_qmp_sess_dispatch(nm_qmp_sess_t *sess,
+        struct json_object *msg, nm_vect_t *done)
+{
+    struct json_object *event, *data = NULL, *id, *err;
+    bool has_id;
+
+    if (json_object_object_get_ex(msg, "event", &event)) {
+        const char *name = json_object_get_string(event);
+
+        nm_debug("%s: %s: %s\n", __func__, sess->name.data, name);
+        json_object_object_get_ex(msg, "data", &data);
+
+        for (size_t n = 0; n < sess->reqs.n_memb; n++) {
+            const nm_qmp_req_t *req = nm_vect_at(&sess->reqs, n);
+
+            if (req->event && nm_str_cmp_tt(req->event, name) == NM_OK &&
+                    (!req->match || req->match(data, req->match_ctx))) {
+                nm_qmp_done_add(done, sess, n--, NM_OK, msg);
+            }
+        }
+
+        if (!sess->pooled) {
+            return;
+        }
+
+        if (nm_str_cmp_tt(name, "SHUTDOWN") == NM_OK) {
+            nm_qmp_event_push(&sess->name, NM_QMP_EV_SHUTDOWN);
+        } else if (nm_str_cmp_tt(name, "STOP") == NM_OK) {
+            nm_qmp_event_push(&sess->name, NM_QMP_EV_STOP);
+        } else if (nm_str_cmp_tt(name, "RESUME") == NM_OK) {
+            nm_qmp_event_push(&sess->name, NM_QMP_EV_RESUME);
+        }
+        return;
+    }
+
+    /* greeting */
+    if (json_object_object_get_ex(msg, "QMP", NULL)) {
+        return;
+    }
+
+    /* QEMU cannot get id from malformed command, the oldest one is ours */
+    has_id = json_object_object_get_ex(msg, "id", &id);
+
+    for (size_t n = 0; n < sess->reqs.n_memb; n++) {
+        const nm_qmp_req_t *req = nm_vect_at(&sess->reqs, n);
+
+        if (!req->id || (has_id && json_object_get_int64(id) != req->id)) {
+            continue;
+        }
+
+        if (json_object_object_get_ex(msg, "error", &err)) {
+            nm_debug("%s: %s: %s\n", __func__, sess->name.data,
+                    json_object_get_string(err));
+            nm_qmp_done_add(done, sess, n, NM_ERR, msg);
+        } else {
+            nm_qmp_done_add(done, sess, n, NM_OK, msg);
+        }
+        return;
+    }
+
+    nm_debug("%s: %s: drop stale reply\n", __func__, sess->name.data);
+}
+
+static int nm_qmp_submit_locked(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx)
+{
+    nm_str_t buf = NM_INIT_STR;
+    nm_qmp_req_t req = {
+        .deadline = nm_mono_ms() + timeout,
+        .start = nm_mono_us(),
+        .stat = nm_qmp_stat_find(cmd),
+        .cb = cb,
+        .ctx = ctx
+    };
+
+    if (sess->sd == -1) {
+        return NM_ERR;
+    }
+
+    /* tag command with id, so its reply is not confused with a stale one */
+    req.id = ++sess->seq;
+    nm_str_format(&buf, "{\"id\":%" PRId64 ",%s", req.id, cmd + 1);
+    nm_debug("exec qmp: %s\n", buf.data);
+
+    if (nm_qmp_sess_write(sess, &buf, fd) != NM_OK) {
+        nm_debug("%s: %s: write error: %s\n", __func__, sess->name.data,
+                strerror(errno));
+        nm_str_free(&buf);
+        nm_qmp_sess_lost(sess, &reactor.failed, true);
+        nm_qmp_reactor_wake();
+        return NM_ERR;
+    }
+    nm_str_free(&buf);
+
+    nm_vect_insert(&sess->reqs, &req, sizeof(req), NULL);
+    sess->refs++;
+    /* reactor recalculates its timeout */
+    nm_qmp_reactor_wake();
+
+    return NM_OK;
+}
+
+/* move request to the completion list, its reference goes along */
+static void nm_qmp_done_add(nm_vect_t *done, nm_qmp_sess_t *sess,
+        size_t idx, int rc, struct json_object *msg)
+{
+    const nm_qmp_req_t *req = nm_vect_at(&sess->reqs, idx);
+    nm_qmp_done_t item = {
+        .sess = sess,
+        .cb = req->cb,
+        .ctx = req->ctx,
+        .msg = msg ? json_object_get(msg) : NULL,
+        .rc = rc
+    };
+
+    if (req->id) {
+        nm_qmp_stat_add(req, rc);
+    }
+
+    nm_vect_insert(done, &item, sizeof(item), NULL);
+    nm_vect_delete(&sess->reqs, idx, NULL);
+}
+
+/* called with reactor mutex held */
+static int nm_qmp_stat_find(const char *cmd)
+{
+    const char *name = strstr(cmd, NM_QMP_EXECUTE);
+    size_t len;
+
+    if (!name) {
+        return -1;
+    }
+    name += sizeof(NM_QMP_EXECUTE) - 1;
+    len = strcspn(name, "\"");
+    if (!len || len >= NM_QMP_CMD_LEN) {
+        return -1;
+    }
+
+    for (size_t n = 0; n < reactor.n_stats; n++) {
+        if (strncmp(reactor.stats[n].cmd, name, len) == 0 &&
+                reactor.stats[n].cmd[len] == '\0') {
+            return n;
+        }
+    }
+
+    if (reactor.n_stats == NM_QMP_MAX_STATS) {
+        return -1;
+    }
+
+    memset(&reactor.stats[reactor.n_stats], 0, sizeof(nm_qmp_stat_t));
+    memcpy(reactor.stats[reactor.n_stats].cmd, name, len);
+
+    return reactor.n_stats++;
+}
+
+/* called with reactor mutex held */
+static void nm_qmp_stat_add(const nm_qmp_req_t *req, int rc)
+{
+    nm_qmp_stat_t *st;
+    uint64_t lat;
+    size_t b = 0;
+
+    if (req->stat < 0) {
+        return;
+    }
+
+    st = &reactor.stats[req->stat];
+    lat = nm_mono_us() - req->start;
+    while (b < NM_QMP_LAT_BUCKETS && lat > nm_qmp_lat_bounds[b]) {
+        b++;
+    }
+
+    st->count++;
+    st->sum_us += lat;
+    st->buckets[b]++;
+    if (rc != NM_OK) {
+        st->failed++;
+    }
+}
+
+static void nm_qmp_done_run(nm_vect_t *done)
+{
+    for (size_t n = 0; n < done->n_memb; n++) {
+        nm_qmp_done_t *item = nm_vect_at(done, n);
+
+        if (item->cb) {
+            item->cb(item->rc, item->msg, item->ctx);
+        }
+        if (item->msg) {
+            json_object_put(item->msg);
+        }
+
+        pthread_mutex_lock(&reactor.mtx);
+        nm_qmp_sess_unref(item->sess);
+        pthread_mutex_unlock(&reactor.mtx);
+    }
+
+    nm_vect_free(done, NULL);
+}
+
+static void nm_qmp_status_cb(int rc, struct json_object *msg, void *ctx)
+{
+    const nm_qmp_sess_t *sess = ctx;
+    struct json_object *ret, *running;
+
+    if (rc == NM_OK &&
+            json_object_object_get_ex(msg, "return", &ret) &&
+            json_object_object_get_ex(ret, "running", &running) &&
+            !json_object_get_boolean(running)) {
+        pthread_mutex_lock(&reactor.mtx);
+        nm_qmp_event_push(&sess->name, NM_QMP_EV_STOP);
+        pthread_mutex_unlock(&reactor.mtx);
+    }
+}
+
+static void nm_qmp_wait_cb(int rc, struct json_object *msg, void *ctx)
+{
+    nm_qmp_wait_t *w = ctx;
+
+    pthread_mutex_lock(&w->mtx);
+    w->rc = rc;
+    w->msg = msg ? json_object_get(msg) : NULL;
+    w->done = true;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->mtx);
+}
+
+/*
+ * With the reactor thread running just wait for it,
+ * otherwise drive the reactor until completion.
+ */
+static int nm_qmp_wait_done(nm_qmp_wait_t *w)
+{
+    pthread_mutex_lock(&w->mtx);
+    if (reactor.threaded) {
+        while (!w->done) {
+            pthread_cond_wait(&w->cond, &w->mtx);
+        }
+    } else {
+        while (!w->done) {
+            pthread_mutex_unlock(&w->mtx);
+            nm_qmp_reactor_run();
+            pthread_mutex_lock(&w->mtx);
+        }
+    }
+    pthread_mutex_unlock(&w->mtx);
+
+    return w->rc;
+}
+
+static void nm_qmp_wait_free(nm_qmp_wait_t *w)
+{
+    if (w->msg) {
+        json_object_put(w->msg);
+    }
+    pthread_mutex_destroy(&w->mtx);
+    pthread_cond_destroy(&w->cond);
+}
+
+/* called with reactor mutex held */
+static void nm_qmp_event_push(const nm_str_t *name, int id)
+{
+    nm_qmp_event_t ev = NM_INIT_QMP_EVENT;
+    char ch = 0;
+
+    /* only the daemon consumes VM events */
+    if (!reactor.threaded) {
+        return;
+    }
+
+    nm_str_copy(&ev.name, name);
+    ev.id = id;
+    nm_vect_insert(&reactor.events, &ev, sizeof(ev), NULL);
+
+    if (write(reactor.ev_wake[1], &ch, sizeof(ch)) == -1 && errno != EAGAIN) {
+        nm_debug("%s: write error: %s\n", __func__, strerror(errno));
+    }
+}
+
+static void nm_qmp_event_free_cb(void *unit_p)
+{
+    nm_str_free(&((nm_qmp_event_t *) unit_p)->name);
+}
+/* vim:set ts=4 sw=4: */
@@ -0,0 +1,125 @@
+#ifndef NM_QMP_REACTOR_H_
+#define NM_QMP_REACTOR_H_
+
+#include <nm_string.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <json.h>
+
+/*
+ * QMP sessions are owned by the reactor: commands are queued with
+ * a deadline and a completion callback, replies and events are
+ * dispatched as they arrive. The monitoring daemon runs the reactor
+ * in a dedicated thread, in other processes it is driven by
+ * synchronous callers while they wait.
+ */
+
+typedef struct nm_qmp_sess nm_qmp_sess_t;
+
+/*
+ * Completion callback. msg is the reply (or the event for watchers),
+ * it is NULL if the deadline has passed or the session was closed.
+ * msg is released after return. Callbacks run in the reactor thread,
+ * they must not block or call synchronous functions below.
+ */
+typedef void (*nm_qmp_done_cb_t)(int rc, struct json_object *msg, void *ctx);
+
+/* event filter, data is "data" member of the event or NULL */
+typedef bool (*nm_qmp_match_cb_t)(struct json_object *data, const void *ctx);
+
+void nm_qmp_reactor_start(void);
+void nm_qmp_reactor_stop(void);
+bool nm_qmp_reactor_threaded(void);
+
+/*
+ * Get session with VM. With the reactor thread running sessions
+ * are kept on the NM_VM_QMP_MON_FILE monitor, otherwise the main
+ * monitor is used and the session is closed when it is not needed.
+ */
+nm_qmp_sess_t *nm_qmp_sess_get(const nm_str_t *name);
+void nm_qmp_sess_put(nm_qmp_sess_t *sess);
+bool nm_qmp_sess_pooled(const nm_qmp_sess_t *sess);
+/* close kept session, its pending commands fail */
+void nm_qmp_sess_drop(const nm_str_t *name);
+
+/*
+ * Queue command. fd != -1 is passed to QEMU along with the command.
+ * timeout is in milliseconds. cb may be NULL, it is not called
+ * if NM_ERR is returned.
+ */
+int nm_qmp_submit(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx);
+/* wait for the event accepted by match (NULL accepts any) */
+int nm_qmp_watch(nm_qmp_sess_t *sess, const char *event,
+        nm_qmp_match_cb_t match, const void *match_ctx,
+        uint64_t timeout, nm_qmp_done_cb_t cb, void *ctx);
+
+/*
+ * Execute command and wait for completion. If reply is not NULL
+ * it gets the reply: QMP error on NM_ERR or NULL if there was no
+ * answer. The caller must release it.
+ */
+int nm_qmp_exec(nm_qmp_sess_t *sess, const char *cmd, int fd,
+        uint64_t timeout, struct json_object **reply);
+
+enum { NM_QMP_NO_EVENT = 1 };
+
+/*
+ * Execute command and wait for the event caused by it.
+ * Returns NM_QMP_NO_EVENT if the command succeeded,
+ * but the event did not come within ev_timeout.
+ */
+int nm_qmp_exec_wait(nm_qmp_sess_t *sess, const char *cmd, uint64_t timeout,
+        const char *event, nm_qmp_match_cb_t match, const void *match_ctx,
+        uint64_t ev_timeout);
+
+/*
+ * Latency of QMP commands by "execute" name, measured from submission
+ * to the reply. Commands without reply (timeout, closed session) and
+ * QMP errors are counted as failed, their latency is included.
+ */
+#define NM_QMP_LAT_BUCKETS 8    /* and +Inf */
+#define NM_QMP_MAX_STATS   32   /* commands with own statistics */
+#define NM_QMP_CMD_LEN     32
+
+/* upper bounds of latency buckets, microseconds */
+extern const uint64_t nm_qmp_lat_bounds[NM_QMP_LAT_BUCKETS];
+
+typedef struct {
+    char cmd[NM_QMP_CMD_LEN];
+    uint64_t count;
+    uint64_t failed;
+    uint64_t sum_us;
+    uint64_t buckets[NM_QMP_LAT_BUCKETS + 1]; /* not cumulative */
+} nm_qmp_stat_t;
+
+/* copy statistics of up to len commands, returns number of entries */
+size_t nm_qmp_stats(nm_qmp_stat_t *buf, size_t len);
+
+/*
+ * VM events received on kept sessions. The daemon main loop polls
+ * nm_qmp_event_fd() and takes queued events when it is readable.
+ */
+enum {
+    NM_QMP_EV_SHUTDOWN = 0,
+    NM_QMP_EV_STOP,
+    NM_QMP_EV_RESUME,
+    NM_QMP_EV_CLOSED    /* QEMU closed the session */
+};
+
+typedef struct {
+    nm_str_t name;
+    int id;
+} nm_qmp_event_t;
+
+#define NM_INIT_QMP_EVENT (nm_qmp_event_t) { NM_INIT_STR, 0 }
+
+/* open session to receive VM events, paused VM is reported as STOP */
+int nm_qmp_subscribe(const nm_str_t *name);
+int nm_qmp_event_fd(void);
+int nm_qmp_event_next(nm_qmp_event_t *ev);
+
+#endif /* NM_QMP_REACTOR_H_ */
+/* vim:set ts=4 sw=4: */
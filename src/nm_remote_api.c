@@ -3,6 +3,8 @@
 #if defined (NM_WITH_REMOTE)
 #include <nm_qmp_control.h>
 #include <nm_remote_api.h>
+#include <nm_mon_shm.h>
+#include <nm_mon_metrics.h>
 #include <nm_mon_daemon.h>
 #include <nm_vm_control.h>
 #include <nm_database.h>
@@ -16,6 +18,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <pthread.h>
+#include <inttypes.h>
 #include <poll.h>
 
 #include <openssl/ssl.h>
@@ -46,6 +49,12 @@ static void
 nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply);
 static void
 nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply);
+static void
+nm_api_md_teamsetsettings(struct json_object *request, nm_str_t *reply);
+static void
+nm_api_md_vmgetmetrics(struct json_object *request, nm_str_t *reply);
+static void
+nm_api_md_vmgetblockstats(struct json_object *request, nm_str_t *reply);
 
 static nm_api_ops_t nm_api[] = {
     { .method = "nemu_version",        .run = nm_api_md_nemu_version     },
@@ -57,7 +66,10 @@ static nm_api_ops_t nm_api[] = {
     { .method = "vm_force_stop",       .run = nm_api_md_vmforcestop      },
     { .method = "vm_get_connect_port", .run = nm_api_md_vmgetconnectport },
     { .method = "vm_get_settings",     .run = nm_api_md_vmgetsettings    },
-    { .method = "vm_set_settings",     .run = nm_api_md_vmsetsettings    }
+    { .method = "vm_set_settings",     .run = nm_api_md_vmsetsettings    },
+    { .method = "team_set_settings",   .run = nm_api_md_teamsetsettings  },
+    { .method = "vm_get_metrics",      .run = nm_api_md_vmgetmetrics     },
+    { .method = "vm_get_blockstats",   .run = nm_api_md_vmgetblockstats  }
 };
 
 void *nm_api_server(void *ctx)
@@ -82,7 +94,7 @@ void *nm_api_server(void *ctx)
     fds[0].events = POLLIN;
     timeout = 1000; /* 1 second */
 
-    nm_db_init();
+    nm_db_init(NM_DB_RW);
 
     while (!mon_data->ctrl->stop) {
         struct sockaddr_in cl_addr;
@@ -490,7 +502,7 @@ static void nm_api_md_vmstart(struct json_object *request, nm_str_t *reply)
     }
 
     nm_str_format(&vmname, "%s", name_str);
-    if (nm_qmp_test_socket(&vmname) != NM_OK) {
+    if (nm_mon_vm_status(&vmname) != NM_OK) {
         nm_vmctl_start(&vmname, 0);
         nm_str_format(reply, "%s", NM_API_RET_OK);
     } else {
@@ -588,8 +600,8 @@ nm_api_md_vmgetconnectport(struct json_object *request, nm_str_t *reply)
 {
     int rc = nm_api_check_auth(request, reply);
     nm_mon_vms_t *vms = mon_data->vms;
-    nm_str_t query = NM_INIT_STR;
     nm_vect_t res = NM_INIT_VECT;
+    nm_sqlite_stmt_t *stmt;
     struct json_object *name;
     bool vm_exist = false;
     const char *name_str;
@@ -619,12 +631,12 @@ nm_api_md_vmgetconnectport(struct json_object *request, nm_str_t *reply)
         goto out;
     }
 
-    nm_str_format(&query, NM_SQL_VMS_SELECT_VNC, name_str);
-    nm_db_select(query.data, &res);
+    stmt = nm_db_stmt(NM_STMT_VMS_SELECT_VNC);
+    nm_db_bind_text(stmt, 1, name_str);
+    nm_db_stmt_select(stmt, &res);
     port = nm_str_stoui(nm_vect_str(&res, 0), 10) + NM_STARTING_VNC_PORT;
     nm_str_format(reply, NM_API_RET_VAL_UINT, port);
 out:
-    nm_str_free(&query);
     nm_vect_free(&res, nm_str_vect_free_cb);
     json_object_put(request);
 }
@@ -759,7 +771,7 @@ nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply)
 
     /* CPU count */
     if ((kv = nm_api_json_kv_str("value",
-                    nm_vect_str_ctx(&vm.main, NM_SQL_SMP))) == NULL) {
+                    nm_db_text(&vm.main, 0, NM_SQL_SMP))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
@@ -767,7 +779,7 @@ nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply)
 
     /* the amount of RAM */
     if ((kv = nm_api_json_kv_int("value", nm_str_stoui(
-                        nm_vect_str(&vm.main, NM_SQL_MEM), 10))) == NULL) {
+                        nm_db_str(&vm.main, 0, NM_SQL_MEM), 10))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
@@ -775,9 +787,7 @@ nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply)
 
     /* KVM status */
     if ((kv = nm_api_json_kv_bool("value",
-                    (nm_str_cmp_st(nm_vect_str(&vm.main,
-                                               NM_SQL_KVM), NM_ENABLE)
-                     == NM_OK) ? TRUE : FALSE)) == NULL) {
+                    nm_db_bool(&vm.main, 0, NM_SQL_KVM))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
@@ -785,9 +795,7 @@ nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply)
 
     /* host CPU status */
     if ((kv = nm_api_json_kv_bool("value",
-                    (nm_str_cmp_st(nm_vect_str(&vm.main,
-                                               NM_SQL_HCPU), NM_ENABLE)
-                     == NM_OK) ? TRUE : FALSE)) == NULL) {
+                    nm_db_bool(&vm.main, 0, NM_SQL_HCPU))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
@@ -795,15 +803,15 @@ nm_api_md_vmgetsettings(struct json_object *request, nm_str_t *reply)
 
     /* network interface count */
     if ((kv = nm_api_json_kv_int("value",
-                    vm.ifs.n_memb / NM_IFS_IDX_COUNT)) == NULL) {
+                    nm_db_rows(&vm.ifs))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
     json_object_object_add(jrep, "netifs", kv);
 
     /* disk interface driver */
-    if ((kv = nm_api_json_kv_str("value", nm_vect_str_ctx(&vm.drives,
-                        NM_SQL_DRV_TYPE))) == NULL) {
+    if ((kv = nm_api_json_kv_str("value", nm_db_text(&vm.drives,
+                        0, NM_SQL_DRV_TYPE))) == NULL) {
         nm_str_format(reply, NM_API_RET_ERR, "Internal error");
         goto out;
     }
@@ -836,6 +844,8 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
     struct json_object *jreq;
     nm_vm_t vm_new = NM_INIT_VM;
     nm_vmctl_data_t vm_cur = NM_VMCTL_INIT_DATA;
+    nm_sqlite_stmt_t *stmt;
+    uint64_t last_mac = 0;
     int rc = nm_api_check_auth(request, reply);
 
     memset(&reg, 0, sizeof(regex_t));
@@ -865,6 +875,13 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
     }
 
     nm_vmctl_get_data(&name_str, &vm_cur);
+    /* no selects are allowed in the transaction */
+    if (json_object_object_get_ex(request, "netifs", NULL)) {
+        last_mac = nm_form_get_last_mac();
+    }
+
+    /* all settings are applied or none */
+    nm_db_begin_transaction();
 
     json_object_object_get_ex(request, "smp", &jreq);
     if (jreq) {
@@ -885,11 +902,12 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
             goto out;
         }
 
-        if (nm_str_cmp_ss(nm_vect_str(&vm_cur.main, NM_SQL_SMP),
+        if (nm_str_cmp_ss(nm_db_str(&vm_cur.main, 0, NM_SQL_SMP),
                     &vm_new.cpus) != NM_OK) {
-            nm_str_format(&query, NM_SQL_VMS_UPDATE_SMP,
-                    vm_new.cpus.data, name_str.data);
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_SMP);
+            nm_db_bind_text(stmt, 1, vm_new.cpus.data);
+            nm_db_bind_text(stmt, 2, name_str.data);
+            nm_db_exec(stmt);
         }
     }
 
@@ -900,11 +918,12 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
             goto out;
         }
         nm_str_format(&vm_new.memo, "%d", json_object_get_int(jreq));
-        if (nm_str_cmp_ss(nm_vect_str(&vm_cur.main, NM_SQL_MEM),
+        if (nm_str_cmp_ss(nm_db_str(&vm_cur.main, 0, NM_SQL_MEM),
                     &vm_new.memo) != NM_OK) {
-            nm_str_format(&query, NM_SQL_VMS_UPDATE_MEM,
-                    vm_new.memo.data, name_str.data);
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_MEM);
+            nm_db_bind_int(stmt, 1, json_object_get_int(jreq));
+            nm_db_bind_text(stmt, 2, name_str.data);
+            nm_db_exec(stmt);
         }
     }
 
@@ -918,15 +937,15 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
         }
 
         vm_new.kvm.enable = json_object_get_boolean(jreq);
-        if (nm_str_cmp_st(nm_vect_str(&vm_cur.main, NM_SQL_KVM),
-                    NM_ENABLE) == NM_OK) {
+        if (nm_db_bool(&vm_cur.main, 0, NM_SQL_KVM)) {
             cur_value = true;
         }
 
         if (cur_value != vm_new.kvm.enable) {
-            nm_str_format(&query, NM_SQL_VMS_UPDATE_KVM,
-                    vm_new.kvm.enable ? NM_ENABLE : NM_DISABLE, name_str.data);
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_KVM);
+            nm_db_bind_int(stmt, 1, vm_new.kvm.enable);
+            nm_db_bind_text(stmt, 2, name_str.data);
+            nm_db_exec(stmt);
         }
     }
 
@@ -940,16 +959,15 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
         }
 
         vm_new.kvm.hostcpu_enable = json_object_get_boolean(jreq);
-        if (nm_str_cmp_st(nm_vect_str(&vm_cur.main, NM_SQL_HCPU),
-                    NM_ENABLE) == NM_OK) {
+        if (nm_db_bool(&vm_cur.main, 0, NM_SQL_HCPU)) {
             cur_value = true;
         }
 
         if (cur_value != vm_new.kvm.hostcpu_enable) {
-            nm_str_format(&query, NM_SQL_VMS_UPDATE_HCPU,
-                    vm_new.kvm.hostcpu_enable ? NM_ENABLE : NM_DISABLE,
-                    name_str.data);
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_HCPU);
+            nm_db_bind_int(stmt, 1, vm_new.kvm.hostcpu_enable);
+            nm_db_bind_text(stmt, 2, name_str.data);
+            nm_db_exec(stmt);
         }
     }
 
@@ -960,9 +978,8 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
             goto out;
         }
         vm_new.ifs.count = json_object_get_int(jreq);
-        if ((vm_cur.ifs.n_memb / NM_IFS_IDX_COUNT) != vm_new.ifs.count) {
-            nm_edit_update_ifs(&query,
-                    &vm_cur, &vm_new, nm_form_get_last_mac());
+        if ((nm_db_rows(&vm_cur.ifs)) != vm_new.ifs.count) {
+            nm_edit_update_ifs(&query, &vm_cur, &vm_new, last_mac);
         }
     }
 
@@ -990,17 +1007,22 @@ nm_api_md_vmsetsettings(struct json_object *request, nm_str_t *reply)
             goto out;
         }
 
-        if (nm_str_cmp_ss(nm_vect_str(&vm_cur.drives, NM_SQL_DRV_TYPE),
+        if (nm_str_cmp_ss(nm_db_str(&vm_cur.drives, 0, NM_SQL_DRV_TYPE),
                     &vm_new.drive.driver) != NM_OK) {
-            nm_str_format(&query, NM_SQL_DRIVES_UPDATE_DRV,
-                    vm_new.drive.driver.data, name_str.data);
-            nm_db_edit(query.data);
+            stmt = nm_db_stmt(NM_STMT_DRIVES_UPDATE_DRV);
+            nm_db_bind_text(stmt, 1, vm_new.drive.driver.data);
+            nm_db_bind_text(stmt, 2, name_str.data);
+            nm_db_exec(stmt);
         }
     }
 
+    nm_db_commit();
     nm_str_format(reply, "%s", NM_API_RET_OK);
 
 out:
+    if (nm_db_in_transaction()) {
+        nm_db_rollback();
+    }
     regfree(&reg);
     nm_str_free(&query);
     nm_str_free(&name_str);
@@ -1009,5 +1031,241 @@ out:
     json_object_put(request);
 }
 
+/*
+ * Changes settings of all VMs of the group in one transaction,
+ * so hundreds of VMs cost a single commit.
+ */
+static void
+nm_api_md_teamsetsettings(struct json_object *request, nm_str_t *reply)
+{
+    regex_t reg;
+    nm_sqlite_stmt_t *stmt;
+    struct json_object *jreq;
+    struct json_object *jsmp, *jmem, *jkvm, *jhcpu;
+    const char *team;
+    int changed = 0;
+    int rc = nm_api_check_auth(request, reply);
+
+    memset(&reg, 0, sizeof(regex_t));
+
+    if (rc != NM_OK) {
+        goto out;
+    }
+
+    json_object_object_get_ex(request, "team", &jreq);
+    if (!jreq) {
+        nm_str_format(reply, NM_API_RET_ERR, "team param is missing");
+        goto out;
+    }
+    team = json_object_get_string(jreq);
+
+    /* check all params before the first change */
+    json_object_object_get_ex(request, "smp", &jsmp);
+    if (jsmp) {
+        const char *regex = "^[0-9]+(:[0-9]+)?(:[0-9]+)?$";
+
+        if (regcomp(&reg, regex, REG_EXTENDED) != 0) {
+            nm_bug("%s: regcomp failed", __func__);
+        }
+
+        if (json_object_get_type(jsmp) != json_type_string) {
+            nm_str_format(reply, NM_API_RET_ERR, "Wrong `smp` type");
+            goto out;
+        }
+
+        if (regexec(&reg, json_object_get_string(jsmp), 0, NULL, 0) != 0) {
+            nm_str_format(reply, NM_API_RET_ERR, "Incorrect `smp` value");
+            goto out;
+        }
+    }
+
+    json_object_object_get_ex(request, "mem", &jmem);
+    if (jmem && json_object_get_type(jmem) != json_type_int) {
+        nm_str_format(reply, NM_API_RET_ERR, "Wrong `mem` type");
+        goto out;
+    }
+
+    json_object_object_get_ex(request, "kvm", &jkvm);
+    if (jkvm && json_object_get_type(jkvm) != json_type_boolean) {
+        nm_str_format(reply, NM_API_RET_ERR, "Wrong `kvm` type");
+        goto out;
+    }
+
+    json_object_object_get_ex(request, "hcpu", &jhcpu);
+    if (jhcpu && json_object_get_type(jhcpu) != json_type_boolean) {
+        nm_str_format(reply, NM_API_RET_ERR, "Wrong `hcpu` type");
+        goto out;
+    }
+
+    if (!jsmp && !jmem && !jkvm && !jhcpu) {
+        nm_str_format(reply, NM_API_RET_ERR, "no settings to change");
+        goto out;
+    }
+
+    nm_db_begin_transaction();
+
+    if (jsmp) {
+        stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_SMP_BY_TEAM);
+        nm_db_bind_text(stmt, 1, json_object_get_string(jsmp));
+        nm_db_bind_text(stmt, 2, team);
+        changed = nm_db_exec(stmt);
+    }
+
+    if (jmem) {
+        stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_MEM_BY_TEAM);
+        nm_db_bind_int(stmt, 1, json_object_get_int(jmem));
+        nm_db_bind_text(stmt, 2, team);
+        changed = nm_db_exec(stmt);
+    }
+
+    if (jkvm) {
+        stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_KVM_BY_TEAM);
+        nm_db_bind_int(stmt, 1, json_object_get_boolean(jkvm));
+        nm_db_bind_text(stmt, 2, team);
+        changed = nm_db_exec(stmt);
+    }
+
+    if (jhcpu) {
+        stmt = nm_db_stmt(NM_STMT_VMS_UPDATE_HCPU_BY_TEAM);
+        nm_db_bind_int(stmt, 1, json_object_get_boolean(jhcpu));
+        nm_db_bind_text(stmt, 2, team);
+        changed = nm_db_exec(stmt);
+    }
+
+    if (!changed) {
+        nm_db_rollback();
+        nm_str_format(reply, NM_API_RET_ERR, "team does not exists");
+        goto out;
+    }
+
+    nm_db_commit();
+    nm_str_format(reply, NM_API_RET_VAL_UINT, (unsigned) changed);
+
+out:
+    regfree(&reg);
+    json_object_put(request);
+}
+
+static void
+nm_api_md_vmgetmetrics(struct json_object *request, nm_str_t *reply)
+{
+    int rc = nm_api_check_auth(request, reply);
+    nm_metrics_sample_t samples[NM_METRICS_RING];
+    nm_mon_vms_t *vms = mon_data->vms;
+    nm_str_t vmname = NM_INIT_STR;
+    nm_str_t list = NM_INIT_STR;
+    struct json_object *name;
+    bool vm_exist = false;
+    uint64_t now;
+    size_t count;
+
+    if (rc != NM_OK) {
+        goto out;
+    }
+
+    json_object_object_get_ex(request, "name", &name);
+    if (!name) {
+        nm_str_format(reply, NM_API_RET_ERR, "name param is missing");
+        goto out;
+    }
+
+    nm_str_format(&vmname, "%s", json_object_get_string(name));
+    pthread_mutex_lock(&vms->mtx);
+    for (size_t n = 0; n < vms->list->n_memb; n++) {
+        if (nm_str_cmp_ss(nm_mon_item_get_name(vms->list, n),
+                    &vmname) ==  NM_OK) {
+            vm_exist = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&vms->mtx);
+
+    if (!vm_exist) {
+        nm_str_format(reply, NM_API_RET_ERR, "VM does not exists");
+        goto out;
+    }
+
+    /* one entry per sampling interval, oldest first */
+    count = nm_mon_metrics_get(&vmname, samples, NM_METRICS_RING);
+    now = nm_mono_ms();
+    for (size_t n = 1; n < count; n++) {
+        nm_metrics_rate_t rate;
+
+        if (nm_mon_metrics_rate(&samples[n - 1], &samples[n], &rate) != NM_OK) {
+            continue;
+        }
+
+        nm_str_append_format(&list, "%s{\"age\":%" PRIu64 ",\"cpu\":%.1f,"
+                "\"rss\":%" PRIu64 ",\"majflt\":%.1f,\"ctxsw\":%.1f,"
+                "\"rd_bytes\":%.0f,\"wr_bytes\":%.0f}",
+                (list.len) ? "," : "", now - samples[n].ts, rate.cpu,
+                rate.rss, rate.majflt, rate.ctxsw,
+                rate.rd_bytes, rate.wr_bytes);
+    }
+    nm_str_format(reply, NM_API_RET_ARRAY, (list.len) ? list.data : "");
+
+out:
+    nm_str_free(&vmname);
+    nm_str_free(&list);
+    json_object_put(request);
+}
+
+static void
+nm_api_md_vmgetblockstats(struct json_object *request, nm_str_t *reply)
+{
+    int rc = nm_api_check_auth(request, reply);
+    nm_metrics_drive_t drives[NM_METRICS_DRIVES];
+    nm_mon_vms_t *vms = mon_data->vms;
+    nm_str_t vmname = NM_INIT_STR;
+    nm_str_t list = NM_INIT_STR;
+    struct json_object *name;
+    bool vm_exist = false;
+    size_t count;
+
+    if (rc != NM_OK) {
+        goto out;
+    }
+
+    json_object_object_get_ex(request, "name", &name);
+    if (!name) {
+        nm_str_format(reply, NM_API_RET_ERR, "name param is missing");
+        goto out;
+    }
+
+    nm_str_format(&vmname, "%s", json_object_get_string(name));
+    pthread_mutex_lock(&vms->mtx);
+    for (size_t n = 0; n < vms->list->n_memb; n++) {
+        if (nm_str_cmp_ss(nm_mon_item_get_name(vms->list, n),
+                    &vmname) ==  NM_OK) {
+            vm_exist = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&vms->mtx);
+
+    if (!vm_exist) {
+        nm_str_format(reply, NM_API_RET_ERR, "VM does not exists");
+        goto out;
+    }
+
+    count = nm_mon_metrics_get_drives(&vmname, drives, NM_METRICS_DRIVES);
+    for (size_t n = 0; n < count; n++) {
+        nm_str_append_format(&list, "%s{\"name\":\"%s\","
+                "\"rd_iops\":%.1f,\"wr_iops\":%.1f,"
+                "\"rd_bps\":%.0f,\"wr_bps\":%.0f,"
+                "\"rd_latency\":%.3f,\"wr_latency\":%.3f}",
+                (list.len) ? "," : "", drives[n].name,
+                drives[n].rd_iops, drives[n].wr_iops,
+                drives[n].rd_bps, drives[n].wr_bps,
+                drives[n].rd_lat, drives[n].wr_lat);
+    }
+    nm_str_format(reply, NM_API_RET_ARRAY, (list.len) ? list.data : "");
+
+out:
+    nm_str_free(&vmname);
+    nm_str_free(&list);
+    json_object_put(request);
+}
+
 #endif /* NM_WITH_REMOTE */
 /* vim:set ts=4 sw=4: */
@@ -109,7 +109,7 @@ void nm_rename_vm(const nm_str_t *name)
     nm_vmctl_clear_tap(name);
 
     nm_str_format(&query, NM_SQL_VMS_SELECT_ID,
-            nm_vect_str_ctx(&vm.main, NM_SQL_NAME));
+            nm_db_text(&vm.main, 0, NM_SQL_NAME));
     nm_db_select_value(query.data, &buf);
     nm_db_begin_transaction();
     nm_rename_vm_in_db(&vm, &new_name, &buf);
@@ -140,16 +140,15 @@ nm_rename_vm_in_db(const nm_vmctl_data_t *vm,
     nm_str_t query = NM_INIT_STR;
     nm_str_t buf_1 = NM_INIT_STR;
     nm_str_t buf_2 = NM_INIT_STR;
-    nm_str_t *old_name = nm_vect_str(&vm->main, NM_SQL_NAME);
+    const nm_str_t *old_name = nm_db_str(&vm->main, 0, NM_SQL_NAME);
 
     size_t count = 0;
 
     // Update drives
-    count = vm->drives.n_memb / NM_DRV_IDX_COUNT;
+    count = nm_db_rows(&vm->drives);
     for (size_t i = 0; i < count; i++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * i;
-        nm_str_t *old_drive_name = nm_vect_str(&vm->drives,
-                NM_SQL_DRV_NAME + idx_shift);
+        const nm_str_t *old_drive_name =
+            nm_db_str(&vm->drives, i, NM_SQL_DRV_NAME);
 
         nm_str_copy(&buf_1, old_drive_name);
         nm_str_replace_text(&buf_1, old_name->data, new_name->data);
@@ -160,18 +159,15 @@ nm_rename_vm_in_db(const nm_vmctl_data_t *vm,
     }
 
     // Update ifaces
-    count = vm->ifs.n_memb / NM_IFS_IDX_COUNT;
+    count = nm_db_rows(&vm->ifs);
     for (size_t i = 0; i < count; i++) {
         int altname;
         nm_str_t maddr = NM_INIT_STR;
-        size_t idx_shift = NM_IFS_IDX_COUNT * i;
-        nm_str_t *old_iface_name = nm_vect_str(&vm->ifs,
-                NM_SQL_IF_NAME + idx_shift);
-        nm_str_t *old_iface_altname = nm_vect_str(&vm->ifs,
-                NM_SQL_IF_ALT + idx_shift);
-
-        nm_str_format(&maddr, "%s", nm_vect_str_ctx(&vm->ifs,
-                    NM_SQL_IF_MAC + idx_shift));
+        const nm_str_t *old_iface_name = nm_db_str(&vm->ifs, i, NM_SQL_IF_NAME);
+        const nm_str_t *old_iface_altname =
+            nm_db_str(&vm->ifs, i, NM_SQL_IF_ALT);
+
+        nm_str_format(&maddr, "%s", nm_db_text(&vm->ifs, i, NM_SQL_IF_MAC));
         nm_str_format(&buf_1, "%s_eth%zu", new_name->data, i);
         nm_str_copy(&buf_2, old_iface_altname);
         nm_str_replace_text(&buf_2, old_name->data, new_name->data);
@@ -210,7 +206,7 @@ nm_rename_vm_in_fs(const nm_vmctl_data_t *vm, const nm_str_t *new_name)
     size_t drives_count;
     struct stat stats;
 
-    const nm_str_t *old_name = nm_vect_str(&vm->main, NM_SQL_NAME);
+    const nm_str_t *old_name = nm_db_str(&vm->main, 0, NM_SQL_NAME);
 
     nm_str_format(&old_vm_dir, "%s/%s",
         nm_cfg_get()->vm_dir.data, old_name->data);
@@ -227,11 +223,10 @@ nm_rename_vm_in_fs(const nm_vmctl_data_t *vm, const nm_str_t *new_name)
         nm_bug(_("%s: rename error: %s"), __func__, strerror(errno));
     }
 
-    drives_count = vm->drives.n_memb / NM_DRV_IDX_COUNT;
+    drives_count = nm_db_rows(&vm->drives);
     for (size_t i = 0; i < drives_count; i++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * i;
-        nm_str_t *old_drive_name = nm_vect_str(&vm->drives,
-                NM_SQL_DRV_NAME + idx_shift);
+        const nm_str_t *old_drive_name =
+            nm_db_str(&vm->drives, i, NM_SQL_DRV_NAME);
 
         nm_str_format(&old_path, "%s/%s", new_vm_dir.data,
                 old_drive_name->data);
@@ -1,11 +1,14 @@
 #include <nm_core.h>
 #include <nm_string.h>
+#include <nm_procfs.h>
 #include <nm_stat_usage.h>
 
 
 enum {
     NM_STAT_BUF_LEN = 512,
-    NM_STAT_RES_LEN = 12,
+    NM_STAT_PATH_LEN = 64,
+    NM_STAT_CPU_FIELDS = 4,
+    NM_STAT_UTIME = 11, /* field of /proc/<pid>/stat after the name */
 };
 
 static const char NM_STAT_PATH[] = "/proc/stat";
@@ -19,44 +22,20 @@ double   nm_cpu_usage;
 
 static void nm_stat_cpu_total_time(void)
 {
-    int fd, space_num = 0;
-    char buf[NM_STAT_BUF_LEN] = {0};
-    char buf_time[NM_STAT_RES_LEN] = {0};
-    size_t nread = 0;
-    char ch;
-    char *token_b = NULL, *token_e = NULL;
+    char buf[NM_STAT_BUF_LEN];
+    const char *p = buf;
     uint64_t res = 0;
+    int fd;
 
     if ((fd = open(NM_STAT_PATH, O_RDONLY)) == -1) {
         return;
     }
 
-    while ((read(fd, &ch, 1) > 0) && ch != '\n') {
-        buf[nread] = ch;
-        nread++;
-    }
-
-    for (size_t n = 0; n < nread; n++) {
-        if (buf[n] == 0x20) {
-            space_num++;
-        } else {
-            continue;
-        }
-
-        if (space_num == 2) {
-            token_b = buf + n + 1;
-        }
-
-        if (space_num > 2) {
-            token_e = buf + n;
-            memcpy(buf_time, token_b, token_e - token_b);
-            res += nm_str_ttoul(buf_time, 10);
-            token_b = token_e + 1;
-            memset(buf_time, 0, sizeof(buf_time));
-        }
-
-        if (space_num == 6) {
-            break;
+    /* first line: cpu user nice system idle ... */
+    if (nm_procfs_pread(fd, buf, sizeof(buf)) > 0) {
+        p = nm_procfs_skip(p, 1);
+        for (size_t n = 0; n < NM_STAT_CPU_FIELDS; n++) {
+            res += nm_procfs_u64(&p);
         }
     }
 
@@ -71,63 +50,34 @@ static void nm_stat_cpu_total_time(void)
 
 static void nm_stat_cpu_proc_time(int pid)
 {
-    int fd, space_num = 0;
-    ssize_t nread;
-    char buf[NM_STAT_BUF_LEN] = {0};
-    char buf_time[NM_STAT_RES_LEN] = {0};
-    char *token_b = NULL, *token_e = NULL;
-    uint64_t utime = 0, stime = 0;
-    nm_str_t path = NM_INIT_STR;
-
-    nm_str_format(&path, "/proc/%d/stat", pid);
-
-    if ((fd = open(path.data, O_RDONLY)) == -1) {
-        goto out;
-    }
+    char path[NM_STAT_PATH_LEN];
+    char buf[NM_STAT_BUF_LEN];
+    const char *p;
+    uint64_t utime, stime;
+    int fd;
 
-    if ((nread = read(fd, buf, sizeof(buf))) <= 0) {
-        goto out;
-    }
-
-    buf[nread - 1] = '\0';
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
 
-    for (ssize_t n = 0; n < nread; n++) {
-        if (buf[n] == 0x20) {
-            space_num++;
-        } else {
-            continue;
-        }
-
-        if (space_num == 13) {
-            token_b = buf + n + 1;
-        }
-
-        if (space_num == 14) {
-            token_e = buf + n;
-            memcpy(buf_time, token_b, token_e - token_b);
-            utime = nm_str_ttoul(buf_time, 10);
-            token_b = token_e + 1;
-            memset(buf_time, 0, sizeof(buf_time));
-        }
-
-        if (space_num == 15) {
-            token_e = buf + n;
-            memcpy(buf_time, token_b, token_e - token_b);
-            stime = nm_str_ttoul(buf_time, 10);
-            break;
-        }
+    if ((fd = open(path, O_RDONLY)) == -1) {
+        return;
     }
 
+    if (nm_procfs_pread(fd, buf, sizeof(buf)) <= 0 ||
+            (p = nm_procfs_stat_fields(buf)) == NULL) {
+        close(fd);
+        return;
+    }
     close(fd);
 
+    p = nm_procfs_skip(p, NM_STAT_UTIME);
+    utime = nm_procfs_u64(&p);
+    stime = nm_procfs_u64(&p);
+
     if (nm_cpu_iter) {
         nm_proc_cpu_after = utime + stime;
     } else {
         nm_proc_cpu_before = utime + stime;
     }
-
-out:
-    nm_str_free(&path);
 }
 
 double nm_stat_get_usage(int pid)
@@ -17,7 +17,8 @@ static void nm_usb_detach_init_windows(nm_form_t *form);
 static void nm_usb_plug_list(nm_vect_t *devs, nm_vect_t *names);
 static int nm_usb_plug_get_data(const nm_str_t *name, nm_usb_data_t *usb,
         const nm_vect_t *usb_list);
-static int nm_usb_unplug_get_data(nm_usb_data_t *usb, const nm_vect_t *db_list);
+static int nm_usb_unplug_get_data(nm_usb_data_t *usb,
+        const nm_db_res_t *db_list);
 static void nm_usb_plug_update_db(const nm_str_t *name,
         const nm_usb_data_t *usb);
 
@@ -157,16 +158,18 @@ void nm_usb_unplug(const nm_str_t *name, int vm_status)
     nm_usb_data_t usb_data = NM_INIT_USB_DATA;
     nm_usb_dev_t usb_dev = NM_INIT_USB;
     nm_vect_t usb_names = NM_INIT_VECT;
-    nm_vect_t db_result = NM_INIT_VECT;
+    nm_db_res_t db_result = NM_INIT_DB_RES;
+    nm_sqlite_stmt_t *stmt;
     size_t msg_len = mbstowcs(NULL,
             _(NM_LC_USB_FORM_MSG), strlen(_(NM_LC_USB_FORM_MSG)));
 
     usb_data.dev = &usb_dev;
 
-    nm_str_format(&buf, NM_SQL_USB_SELECT_ALL_BY_NAME, name->data);
-    nm_db_select(buf.data, &db_result);
+    stmt = nm_db_stmt(NM_STMT_USB_SELECT_BY_NAME);
+    nm_db_bind_text(stmt, 1, name->data);
+    nm_db_stmt_fetch(stmt, &db_result);
 
-    if (!db_result.n_memb) {
+    if (!nm_db_rows(&db_result)) {
         nm_warn(_(NM_MSG_USB_NONE));
         goto out;
     }
@@ -220,7 +223,7 @@ out:
     nm_form_data_free(form_data);
     nm_fields_free(fields);
     nm_vect_free(&usb_names, NULL);
-    nm_vect_free(&db_result, nm_str_vect_free_cb);
+    nm_db_res_free(&db_result);
     nm_usb_data_free(&usb_data);
     nm_str_free(&buf);
 }
@@ -244,22 +247,20 @@ int nm_usb_check_plugged(const nm_str_t *name)
     return rc;
 }
 
-void nm_usb_unplug_list(const nm_vect_t *db_list, nm_vect_t *names, bool num)
+void nm_usb_unplug_list(const nm_db_res_t *db_list, nm_vect_t *names, bool num)
 {
-    size_t dev_count = db_list->n_memb / NM_USB_IDX_COUNT;
+    size_t dev_count = nm_db_rows(db_list);
     nm_str_t buf = NM_INIT_STR;
 
     for (size_t n = 0; n < dev_count; n++) {
-        size_t idx_shift = NM_USB_IDX_COUNT * n;
-
         if (num) {
             nm_str_format(&buf, "%zu:%s [serial:%s]", n + 1,
-                    nm_vect_str_ctx(db_list, NM_SQL_USB_NAME + idx_shift),
-                    nm_vect_str_ctx(db_list, NM_SQL_USB_SERIAL + idx_shift));
+                    nm_db_text(db_list, n, NM_SQL_USB_NAME),
+                    nm_db_text(db_list, n, NM_SQL_USB_SERIAL));
         } else {
             nm_str_format(&buf, "%s [serial:%s]",
-                    nm_vect_str_ctx(db_list, NM_SQL_USB_NAME + idx_shift),
-                    nm_vect_str_ctx(db_list, NM_SQL_USB_SERIAL + idx_shift));
+                    nm_db_text(db_list, n, NM_SQL_USB_NAME),
+                    nm_db_text(db_list, n, NM_SQL_USB_SERIAL));
         }
         nm_vect_insert(names, buf.data, buf.len + 1, NULL);
     }
@@ -344,12 +345,13 @@ out:
     return rc;
 }
 
-static int nm_usb_unplug_get_data(nm_usb_data_t *usb, const nm_vect_t *db_list)
+static int nm_usb_unplug_get_data(nm_usb_data_t *usb,
+        const nm_db_res_t *db_list)
 {
     int rc = NM_ERR;
     nm_str_t buf = NM_INIT_STR;
     nm_str_t input = NM_INIT_STR;
-    uint32_t idx, idx_shift;
+    uint32_t idx;
     char *fo;
 
     nm_get_field_buf(fields[1], &input);
@@ -367,17 +369,14 @@ static int nm_usb_unplug_get_data(nm_usb_data_t *usb, const nm_vect_t *db_list)
 
     *fo = '\0';
     idx = nm_str_stoui(&buf, 10);
-    idx_shift = --idx * NM_USB_IDX_COUNT;
+    --idx;
     nm_debug("s:%s, idx=%u\n", buf.data, idx);
 
-    nm_str_copy(&usb->dev->name,
-            nm_vect_str(db_list, NM_SQL_USB_NAME + idx_shift));
-    nm_str_copy(&usb->dev->vendor_id,
-            nm_vect_str(db_list, NM_SQL_USB_VID + idx_shift));
+    nm_str_copy(&usb->dev->name, nm_db_str(db_list, idx, NM_SQL_USB_NAME));
+    nm_str_copy(&usb->dev->vendor_id, nm_db_str(db_list, idx, NM_SQL_USB_VID));
     nm_str_copy(&usb->dev->product_id,
-            nm_vect_str(db_list, NM_SQL_USB_PID + idx_shift));
-    nm_str_copy(&usb->serial,
-            nm_vect_str(db_list, NM_SQL_USB_SERIAL + idx_shift));
+            nm_db_str(db_list, idx, NM_SQL_USB_PID));
+    nm_str_copy(&usb->serial, nm_db_str(db_list, idx, NM_SQL_USB_SERIAL));
 
     rc = NM_OK;
 out:
@@ -207,11 +207,12 @@ static void nm_copy_file_default(int in_fd, int out_fd)
 }
 #endif
 
-int nm_spawn_process(const nm_vect_t *argv, nm_str_t *answer)
+int nm_spawn_process(const nm_argv_t *argv, nm_str_t *answer)
 {
     int rc = NM_OK;
     int fd[2];
     pid_t child_pid = 0;
+    char **args = nm_argv_ptrs(argv);
 
     if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
         nm_bug("%s: error create socketpair: %s", __func__, strerror(errno));
@@ -227,7 +228,7 @@ int nm_spawn_process(const nm_vect_t *argv, nm_str_t *answer)
         dup2(fd[1], STDOUT_FILENO);
         dup2(fd[1], STDERR_FILENO);
 
-        execvp(((char *const *) argv->data)[0], (char *const *) argv->data);
+        execvp(args[0], args);
         nm_bug("%s: unreachable reached", __func__);
         break;
 
@@ -263,6 +264,8 @@ int nm_spawn_process(const nm_vect_t *argv, nm_str_t *answer)
         }
     }
 
+    free(args);
+
     return rc;
 }
 
@@ -288,14 +291,14 @@ void nm_debug(const char *fmt, ...)
     fclose(fp);
 }
 
-void nm_cmd_str(nm_str_t *str, const nm_vect_t *argv)
+void nm_cmd_str(nm_str_t *str, const nm_argv_t *argv)
 {
     if (str->len > 0) {
         nm_str_trunc(str, 0);
     }
 
-    for (size_t m = 0; m < argv->n_memb; m++) {
-        nm_str_append_format(str, "%s ", (char *)nm_vect_at(argv, m));
+    for (size_t m = 0; m < nm_argv_count(argv); m++) {
+        nm_str_append_format(str, "%s ", nm_argv_at(argv, m));
     }
 }
 
@@ -515,6 +518,24 @@ void nm_gen_rand_str(nm_str_t *res, size_t len)
     }
 }
 
+uint64_t nm_mono_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+uint64_t nm_mono_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void nm_gen_uid(nm_str_t *res)
 {
     const char fmt[] = "%Y-%m-%d-%H-%M-%S";
@@ -542,7 +563,7 @@ void
 nm_get_drive_size(const nm_str_t *path, off_t *virtual_size, off_t *actual_size)
 {
     struct json_object *js, *jso;
-    nm_vect_t cmdv = NM_INIT_VECT;
+    nm_argv_t cmdv = NM_INIT_ARGV;
     nm_str_t buf = NM_INIT_STR;
     nm_str_t out = NM_INIT_STR;
     const char *res;
@@ -552,12 +573,11 @@ nm_get_drive_size(const nm_str_t *path, off_t *virtual_size, off_t *actual_size)
     }
 
     nm_str_format(&buf, "%s/qemu-img", nm_cfg_get()->qemu_bin_path.data);
-    nm_vect_insert(&cmdv, buf.data, buf.len + 1, NULL);
-    nm_vect_insert_cstr(&cmdv, "info");
-    nm_vect_insert_cstr(&cmdv, "--output");
-    nm_vect_insert_cstr(&cmdv, "json");
-    nm_vect_insert_cstr(&cmdv, path->data);
-    nm_vect_end_zero(&cmdv);
+    nm_argv_add(&cmdv, buf.data);
+    nm_argv_add(&cmdv, "info");
+    nm_argv_add(&cmdv, "--output");
+    nm_argv_add(&cmdv, "json");
+    nm_argv_add(&cmdv, path->data);
 
     if (nm_spawn_process(&cmdv, &out) != NM_OK) {
         nm_bug(_("%s: cannot get drive info"), __func__);
@@ -584,7 +604,7 @@ nm_get_drive_size(const nm_str_t *path, off_t *virtual_size, off_t *actual_size)
 
     nm_str_free(&buf);
     nm_str_free(&out);
-    nm_vect_free(&cmdv, NULL);
+    nm_argv_free(&cmdv);
     json_object_put(js);
 }
 
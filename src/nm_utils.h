@@ -28,7 +28,7 @@ void nm_map_file(nm_file_map_t *file);
 void nm_copy_file(const nm_str_t *src, const nm_str_t *dst);
 void nm_unmap_file(const nm_file_map_t *file);
 /* Execute process. Read stdout if answer is not NULL */
-int nm_spawn_process(const nm_vect_t *argv, nm_str_t *answer);
+int nm_spawn_process(const nm_argv_t *argv, nm_str_t *answer);
 
 void nm_bug(const char *fmt, ...)
     __attribute__ ((format(printf, 1, 2)))
@@ -37,7 +37,7 @@ void nm_bug(const char *fmt, ...)
 void nm_debug(const char *fmt, ...)
     __attribute__ ((format(printf, 1, 2)));
 
-void nm_cmd_str(nm_str_t *str, const nm_vect_t *argv);
+void nm_cmd_str(nm_str_t *str, const nm_argv_t *argv);
 void nm_parse_smp(nm_cpu_t *cpu, const char *src);
 
 void nm_exit(int status)
@@ -66,6 +66,11 @@ void nm_get_time(nm_str_t *res, const char *fmt);
 void nm_gen_rand_str(nm_str_t *res, size_t len);
 void nm_gen_uid(nm_str_t *res);
 
+/* monotonic clock value in milliseconds */
+uint64_t nm_mono_ms(void);
+/* monotonic clock value in microseconds */
+uint64_t nm_mono_us(void);
+
 /* Caller must free the return value. */
 char *nm_64_encode(const nm_str_t *src);
 
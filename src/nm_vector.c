@@ -100,4 +100,143 @@ void nm_vect_free(nm_vect_t *v, nm_vect_free_cb_pt cb)
     v->n_alloc = 0;
 }
 
+void nm_svect_reserve(nm_svect_t *v, size_t n_memb)
+{
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (n_memb <= v->n_alloc) {
+        return;
+    }
+
+    v->data = nm_realloc(v->data, v->stride * n_memb);
+    v->n_alloc = n_memb;
+}
+
+void *nm_svect_emplace(nm_svect_t *v)
+{
+    void *unit;
+
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (v->n_memb == v->n_alloc) {
+        nm_svect_reserve(v, (v->n_alloc) ?
+                v->n_alloc * 2 : NM_VECT_INIT_NMEMB);
+    }
+
+    unit = (char *) v->data + v->stride * v->n_memb++;
+    memset(unit, 0, v->stride);
+
+    return unit;
+}
+
+void nm_svect_append(nm_svect_t *v, const void *data, size_t n_memb)
+{
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (v->n_memb + n_memb > v->n_alloc) {
+        nm_svect_reserve(v, nm_max(v->n_memb + n_memb, v->n_alloc * 2));
+    }
+
+    if (n_memb) {
+        memcpy((char *) v->data + v->stride * v->n_memb, data,
+                v->stride * n_memb);
+        v->n_memb += n_memb;
+    }
+}
+
+void nm_svect_pop(nm_svect_t *v, nm_vect_free_cb_pt cb)
+{
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (!v->n_memb) {
+        nm_bug(_("%s: vector is empty"), __func__);
+    }
+
+    v->n_memb--;
+    if (cb != NULL) {
+        cb((char *) v->data + v->stride * v->n_memb);
+    }
+}
+
+void *nm_svect_at(const nm_svect_t *v, size_t index)
+{
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (index >= v->n_memb) {
+        nm_bug(_("%s: invalid index"), __func__);
+    }
+
+    return (char *) v->data + v->stride * index;
+}
+
+void nm_svect_sort(nm_svect_t *v, nm_svect_cmp_cb_pt cmp)
+{
+    if (v == NULL) {
+        nm_bug(_("%s: NULL vector pointer value"), __func__);
+    }
+
+    if (v->n_memb > 1) {
+        qsort(v->data, v->n_memb, v->stride, cmp);
+    }
+}
+
+void nm_svect_free(nm_svect_t *v, nm_vect_free_cb_pt cb)
+{
+    if (v == NULL) {
+        return;
+    }
+
+    for (size_t n = 0; cb != NULL && n < v->n_memb; n++) {
+        cb((char *) v->data + v->stride * n);
+    }
+
+    free(v->data);
+
+    v->data = NULL;
+    v->n_memb = 0;
+    v->n_alloc = 0;
+}
+
+void nm_argv_add(nm_argv_t *argv, const char *arg)
+{
+    size_t off = argv->text.n_memb;
+
+    nm_svect_append(&argv->off, &off, 1);
+    nm_svect_append(&argv->text, arg, strlen(arg) + 1);
+}
+
+const char *nm_argv_at(const nm_argv_t *argv, size_t index)
+{
+    return nm_svect_at(&argv->text,
+            *(size_t *) nm_svect_at(&argv->off, index));
+}
+
+char **nm_argv_ptrs(const nm_argv_t *argv)
+{
+    size_t count = nm_argv_count(argv);
+    char **ptrs = nm_calloc(count + 1, sizeof(char *));
+
+    for (size_t n = 0; n < count; n++) {
+        ptrs[n] = (char *) nm_argv_at(argv, n);
+    }
+
+    return ptrs;
+}
+
+void nm_argv_free(nm_argv_t *argv)
+{
+    nm_svect_free(&argv->text, NULL);
+    nm_svect_free(&argv->off, NULL);
+}
+
 /* vim:set ts=4 sw=4: */
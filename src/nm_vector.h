@@ -28,5 +28,52 @@ static inline void nm_vect_insert_cstr(nm_vect_t *v, const char *data)
     nm_vect_insert(v, data, strlen(data) + 1, NULL);
 }
 
+/*
+ * Contiguous vector: units of stride bytes are kept in one array
+ * instead of an allocation per unit. Pointers to units are valid
+ * until the next insert.
+ */
+typedef struct {
+    size_t n_memb;  /* unit count */
+    size_t n_alloc; /* count of allocated memory in units */
+    size_t stride;  /* unit size */
+    void *data;
+} nm_svect_t;
+
+#define NM_INIT_SVECT(type) { 0, 0, sizeof(type), NULL }
+
+typedef int (*nm_svect_cmp_cb_pt)(const void *a, const void *b);
+
+void nm_svect_reserve(nm_svect_t *v, size_t n_memb);
+/* returns zeroed unit added to the end */
+void *nm_svect_emplace(nm_svect_t *v);
+void nm_svect_append(nm_svect_t *v, const void *data, size_t n_memb);
+void nm_svect_pop(nm_svect_t *v, nm_vect_free_cb_pt cb);
+void *nm_svect_at(const nm_svect_t *v, size_t index);
+void nm_svect_sort(nm_svect_t *v, nm_svect_cmp_cb_pt cmp);
+void nm_svect_free(nm_svect_t *v, nm_vect_free_cb_pt cb);
+
+/*
+ * Argument list for exec(3): text of all arguments is kept in one
+ * buffer, the NULL terminated array is made by nm_argv_ptrs().
+ */
+typedef struct {
+    nm_svect_t text;    /* char, \0 terminated arguments */
+    nm_svect_t off;     /* size_t, start of each argument in text */
+} nm_argv_t;
+
+#define NM_INIT_ARGV { NM_INIT_SVECT(char), NM_INIT_SVECT(size_t) }
+
+void nm_argv_add(nm_argv_t *argv, const char *arg);
+const char *nm_argv_at(const nm_argv_t *argv, size_t index);
+/* the caller must free(3) the array, not the arguments */
+char **nm_argv_ptrs(const nm_argv_t *argv);
+void nm_argv_free(nm_argv_t *argv);
+
+static inline size_t nm_argv_count(const nm_argv_t *argv)
+{
+    return argv->off.n_memb;
+}
+
 #endif /* NM_VECTOR_H_ */
 /* vim:set ts=4 sw=4: */
@@ -152,10 +152,9 @@ out:
 
 static void nm_viewer_fields_setup(const nm_vmctl_data_t *vm)
 {
-    uint32_t vnc_port;
+    nm_str_t vnc_port = NM_INIT_STR;
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_SPICE),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm->main, 0, NM_SQL_SPICE)) {
         set_field_buffer(fields[NM_FLD_SPICE], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_SPICE], 0, nm_form_yes_no[1]);
@@ -164,31 +163,29 @@ static void nm_viewer_fields_setup(const nm_vmctl_data_t *vm)
     field_opts_off(fields[NM_FLD_TTYP], O_STATIC);
     field_opts_off(fields[NM_FLD_SOCK], O_STATIC);
 
-    vnc_port = nm_str_stoui(nm_vect_str(&vm->main, NM_SQL_VNC), 10) +
-        NM_STARTING_VNC_PORT;
-    nm_str_format(nm_vect_str(&vm->main, NM_SQL_VNC), "%u", vnc_port);
-    set_field_buffer(fields[NM_FLD_PORT], 0,
-            nm_vect_str_ctx(&vm->main, NM_SQL_VNC));
+    nm_str_format(&vnc_port, "%" PRId64,
+            nm_db_int(&vm->main, 0, NM_SQL_VNC) + NM_STARTING_VNC_PORT);
+    set_field_buffer(fields[NM_FLD_PORT], 0, vnc_port.data);
     set_field_buffer(fields[NM_FLD_TTYP], 0,
-            nm_vect_str_ctx(&vm->main, NM_SQL_TTY));
+            nm_db_text(&vm->main, 0, NM_SQL_TTY));
     set_field_buffer(fields[NM_FLD_SOCK], 0,
-            nm_vect_str_ctx(&vm->main, NM_SQL_SOCK));
+            nm_db_text(&vm->main, 0, NM_SQL_SOCK));
     set_field_buffer(fields[NM_FLD_DSP], 0,
-            nm_vect_str_ctx(&vm->main, NM_SQL_DISPLAY));
+            nm_db_text(&vm->main, 0, NM_SQL_DISPLAY));
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_OVER),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm->main, 0, NM_SQL_OVER)) {
         set_field_buffer(fields[NM_FLD_SYNC], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_SYNC], 0, nm_form_yes_no[1]);
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_AGENT),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm->main, 0, NM_SQL_AGENT)) {
         set_field_buffer(fields[NM_FLD_AGENT], 0, nm_form_yes_no[0]);
     } else {
         set_field_buffer(fields[NM_FLD_AGENT], 0, nm_form_yes_no[1]);
     }
+
+    nm_str_free(&vnc_port);
 }
 
 static size_t nm_viewer_labels_setup(void)
@@ -289,6 +286,8 @@ static void nm_viewer_update_db(const nm_str_t *name, nm_view_data_t *vm)
 {
     nm_str_t query = NM_INIT_STR;
 
+    nm_db_begin_transaction();
+
     if (field_status(fields[NM_FLD_SPICE])) {
         int spice_on = 0;
 
@@ -297,25 +296,25 @@ static void nm_viewer_update_db(const nm_str_t *name, nm_view_data_t *vm)
         }
         nm_str_format(&query, NM_SQL_VMS_UPDATE_SPICE,
                 spice_on ? NM_ENABLE : NM_DISABLE, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_PORT])) {
         uint32_t vnc_port = nm_str_stoui(&vm->port, 10) - NM_STARTING_VNC_PORT;
 
         nm_str_format(&query, NM_SQL_VMS_UPDATE_VNC, vnc_port, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_TTYP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_TTY, vm->tty.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_SOCK])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_SOCKET,
                 vm->sock.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_SYNC])) {
@@ -326,7 +325,7 @@ static void nm_viewer_update_db(const nm_str_t *name, nm_view_data_t *vm)
         }
         nm_str_format(&query, NM_SQL_VMS_UPDATE_MOUSE,
                 sync_on ? NM_ENABLE : NM_DISABLE, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_AGENT])) {
@@ -337,15 +336,17 @@ static void nm_viewer_update_db(const nm_str_t *name, nm_view_data_t *vm)
         }
         nm_str_format(&query, NM_SQL_VMS_UPDATE_AGENT,
                 agent_on ? NM_ENABLE : NM_DISABLE, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
     if (field_status(fields[NM_FLD_DSP])) {
         nm_str_format(&query, NM_SQL_VMS_UPDATE_DISPLAY,
                 vm->display.data, name->data);
-        nm_db_edit(query.data);
+        nm_db_atomic(query.data);
     }
 
+    nm_db_commit();
+
     nm_str_free(&query);
 }
 /* vim:set ts=4 sw=4: */
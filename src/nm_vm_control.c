@@ -6,10 +6,12 @@
 #include <nm_network.h>
 #include <nm_database.h>
 #include <nm_cfg_file.h>
+#include <nm_mon_shm.h>
 #include <nm_vm_control.h>
 #include <nm_usb_devices.h>
 #include <nm_qmp_control.h>
 #include <nm_stat_usage.h>
+#include <nm_mon_metrics.h>
 
 #include <time.h>
 
@@ -24,67 +26,75 @@ static int nm_vmctl_clear_tap_vect(const nm_vect_t *vms);
 
 void nm_vmctl_get_data(const nm_str_t *name, nm_vmctl_data_t *vm)
 {
-    nm_str_t query = NM_INIT_STR;
+    nm_sqlite_stmt_t *stmt;
+    int64_t id;
 
-    nm_str_format(&query, NM_SQL_VMS_SELECT_ALL, name->data);
-    nm_db_select(query.data, &vm->main);
+    /* ifaces, drives and usb must belong to the same VM row */
+    nm_db_read_begin();
 
-    nm_str_format(&query, NM_SQL_VMS_SELECT_PROPS_BY_ID,
-            nm_vect_str_ctx(&vm->main, NM_SQL_ID));
-    nm_db_select(query.data, &vm->ifs);
+    stmt = nm_db_stmt(NM_STMT_VMS_SELECT_ALL);
+    nm_db_bind_text(stmt, 1, name->data);
+    nm_db_stmt_fetch(stmt, &vm->main);
 
-    nm_str_format(&query, NM_SQL_DRIVES_SELECT_BY_ID,
-            nm_vect_str_ctx(&vm->main, NM_SQL_ID));
-    nm_db_select(query.data, &vm->drives);
+    id = nm_db_int(&vm->main, 0, NM_SQL_ID);
 
-    nm_str_format(&query, NM_SQL_USB_SELECT_ALL_BY_ID,
-            nm_vect_str_ctx(&vm->main, NM_SQL_ID));
-    nm_db_select(query.data, &vm->usb);
+    stmt = nm_db_stmt(NM_STMT_IFACES_SELECT_BY_ID);
+    nm_db_bind_int(stmt, 1, id);
+    nm_db_stmt_fetch(stmt, &vm->ifs);
 
-    nm_str_free(&query);
+    stmt = nm_db_stmt(NM_STMT_DRIVES_SELECT_BY_ID);
+    nm_db_bind_int(stmt, 1, id);
+    nm_db_stmt_fetch(stmt, &vm->drives);
+
+    stmt = nm_db_stmt(NM_STMT_USB_SELECT_BY_ID);
+    nm_db_bind_int(stmt, 1, id);
+    nm_db_stmt_fetch(stmt, &vm->usb);
+
+    nm_db_read_end();
 }
 
 void nm_vmctl_start(const nm_str_t *name, int flags)
 {
     nm_str_t buf = NM_INIT_STR;
     nm_str_t snap = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
     nm_vmctl_data_t vm = NM_VMCTL_INIT_DATA;
     nm_vect_t tfds = NM_INIT_VECT;
 
     nm_vmctl_get_data(name, &vm);
 
     /* check if VM is already installed */
-    if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_INST), NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm.main, 0, NM_SQL_INST)) {
         int ch = nm_notify(_(NM_MSG_INST_CONF));
 
         if (ch == 'y') {
             flags &= ~NM_VMCTL_TEMP;
             nm_str_t query = NM_INIT_STR;
 
-            nm_str_trunc(nm_vect_str(&vm.main, NM_SQL_INST), 0);
-            nm_str_add_text(nm_vect_str(&vm.main, NM_SQL_INST), NM_DISABLE);
-
             nm_str_format(&query, NM_SQL_VMS_UPDATE_INSTALL,
                     NM_DISABLE, name->data);
             nm_db_edit(query.data);
+            nm_vmctl_get_data(name, &vm);
 
             nm_str_free(&query);
         }
     }
 
     nm_vmctl_gen_cmd(&argv, &vm, name, &flags, &tfds, &snap);
-    if (argv.n_memb > 0) {
+    if (nm_argv_count(&argv) > 0) {
         if (nm_spawn_process(&argv, NULL) != NM_OK) {
             nm_str_t qmp_path = NM_INIT_STR;
             struct stat qmp_info;
+            const char *qmp_files[] = { NM_VM_QMP_FILE, NM_VM_QMP_MON_FILE };
 
-            nm_str_format(&qmp_path, "%s/%s/%s",
-                nm_cfg_get()->vm_dir.data, name->data, NM_VM_QMP_FILE);
+            /* must delete qmp sock files if exists */
+            for (size_t n = 0; n < nm_arr_len(qmp_files); n++) {
+                nm_str_format(&qmp_path, "%s/%s/%s",
+                    nm_cfg_get()->vm_dir.data, name->data, qmp_files[n]);
 
-            /* must delete qmp sock file if exists */
-            if (stat(qmp_path.data, &qmp_info) != -1) {
-                unlink(qmp_path.data);
+                if (stat(qmp_path.data, &qmp_info) != -1) {
+                    unlink(qmp_path.data);
+                }
             }
 
             nm_str_free(&qmp_path);
@@ -110,7 +120,7 @@ void nm_vmctl_start(const nm_str_t *name, int flags)
 
     nm_str_free(&buf);
     nm_str_free(&snap);
-    nm_vect_free(&argv, NULL);
+    nm_argv_free(&argv);
     nm_vect_free(&tfds, NULL);
     nm_vmctl_free_data(&vm);
 }
@@ -156,6 +166,12 @@ void nm_vmctl_delete(const nm_str_t *name)
             delete_ok = NM_FALSE;
         }
 
+        nm_str_trunc(&path, vmdir.len);
+        nm_str_add_text(&path, NM_VM_QMP_MON_FILE);
+        if (unlink(path.data) == -1 && errno != ENOENT) {
+            delete_ok = NM_FALSE;
+        }
+
         nm_str_free(&path);
     }
 
@@ -232,13 +248,13 @@ void nm_vmctl_connect(const nm_str_t *name)
     nm_str_free(&cmd);
 }
 
-void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
+void nm_vmctl_gen_cmd(nm_argv_t *argv, const nm_vmctl_data_t *vm,
     const nm_str_t *name, int *flags, nm_vect_t *tfds, nm_str_t *snap)
 {
     nm_str_t vmdir = NM_INIT_STR;
     const nm_cfg_t *cfg = nm_cfg_get();
-    size_t drives_count = vm->drives.n_memb / NM_DRV_IDX_COUNT;
-    size_t ifs_count = vm->ifs.n_memb / NM_IFS_IDX_COUNT;
+    size_t drives_count = nm_db_rows(&vm->drives);
+    size_t ifs_count = nm_db_rows(&vm->ifs);
     int scsi_added = NM_FALSE;
     nm_cpu_t cpu = NM_INIT_CPU;
     nm_str_t buf = NM_INIT_STR;
@@ -247,29 +263,28 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
 
     nm_str_format(&buf, "%s/%s%s",
         cfg->qemu_bin_path.data, "qemu-system-",
-        nm_vect_str(&vm->main, NM_SQL_ARCH)->data);
-    nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_db_str(&vm->main, 0, NM_SQL_ARCH)->data);
+    nm_argv_add(argv, buf.data);
 
-    nm_vect_insert_cstr(argv, "-daemonize");
+    nm_argv_add(argv, "-daemonize");
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_USBF),
-                NM_ENABLE) == NM_OK) {
-        size_t usb_count = vm->usb.n_memb / NM_USB_IDX_COUNT;
+    if (nm_db_bool(&vm->main, 0, NM_SQL_USBF)) {
+        size_t usb_count = nm_db_rows(&vm->usb);
         nm_vect_t usb_list = NM_INIT_VECT;
         nm_vect_t serial_cache = NM_INIT_VECT;
         nm_str_t serial = NM_INIT_STR;
 
-        nm_vect_insert_cstr(argv, "-usb");
-        nm_vect_insert_cstr(argv, "-device");
+        nm_argv_add(argv, "-usb");
+        nm_argv_add(argv, "-device");
 
-        if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_USBT),
+        if (nm_str_cmp_st(nm_db_str(&vm->main, 0, NM_SQL_USBT),
                     NM_DEFAULT_USBVER) == NM_OK) {
-            nm_vect_insert_cstr(argv, "qemu-xhci,id=usbbus");
-        } else if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_USBT),
+            nm_argv_add(argv, "qemu-xhci,id=usbbus");
+        } else if (nm_str_cmp_st(nm_db_str(&vm->main, 0, NM_SQL_USBT),
                     *nm_form_usbtype) == NM_OK) {
-            nm_vect_insert_cstr(argv, "usb-ehci,id=usbbus");
+            nm_argv_add(argv, "usb-ehci,id=usbbus");
         } else {
-            nm_vect_insert_cstr(argv, "nec-usb-xhci,id=usbbus");
+            nm_argv_add(argv, "nec-usb-xhci,id=usbbus");
         }
 
         if (usb_count > 0) {
@@ -279,15 +294,11 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
         for (size_t n = 0; n < usb_count; n++) {
             int found_in_cache = 0;
             int found_in_devs = 0;
-            size_t idx_shift = NM_USB_IDX_COUNT * n;
             nm_usb_dev_t *usb = NULL;
 
-            const char *vid = nm_vect_str_ctx(&vm->usb,
-                    NM_SQL_USB_VID + idx_shift);
-            const char *pid = nm_vect_str_ctx(&vm->usb,
-                    NM_SQL_USB_PID + idx_shift);
-            const char *ser = nm_vect_str_ctx(&vm->usb,
-                    NM_SQL_USB_SERIAL + idx_shift);
+            const char *vid = nm_db_text(&vm->usb, n, NM_SQL_USB_VID);
+            const char *pid = nm_db_text(&vm->usb, n, NM_SQL_USB_PID);
+            const char *ser = nm_db_text(&vm->usb, n, NM_SQL_USB_SERIAL);
 
             /* look for cached data first, libusb_open() is very expensive */
             for (size_t m = 0; m < serial_cache.n_memb; m++) {
@@ -303,13 +314,13 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
             }
 
             if (found_in_cache && usb) {
-                nm_vect_insert_cstr(argv, "-device");
+                nm_argv_add(argv, "-device");
                 nm_str_format(&buf, "usb-host,hostbus=%d,hostaddr=%d,"
                         "id=usb-%s-%s-%s,bus=usbbus.0",
                         *nm_usb_bus_num(usb), *nm_usb_dev_addr(usb),
                         nm_usb_vendor_id(usb)->data,
                         nm_usb_product_id(usb)->data, ser);
-                nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+                nm_argv_add(argv, buf.data);
 
                 continue;
             }
@@ -340,14 +351,14 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
             }
 
             if (found_in_devs && usb) {
-                nm_vect_insert_cstr(argv, "-device");
+                nm_argv_add(argv, "-device");
                 nm_str_format(&buf,
                         "usb-host,hostbus=%d,hostaddr=%d,"
                         "id=usb-%s-%s-%s,bus=usbbus.0",
                         *nm_usb_bus_num(usb), *nm_usb_dev_addr(usb),
                         nm_usb_vendor_id(usb)->data,
                         nm_usb_product_id(usb)->data, ser);
-                nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+                nm_argv_add(argv, buf.data);
 
                 continue;
             }
@@ -359,33 +370,32 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
     }
 
     /* setup install source */
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_INST),
-                NM_ENABLE) == NM_OK) {
-        const char *iso = nm_vect_str_ctx(&vm->main, NM_SQL_ISO);
+    if (nm_db_bool(&vm->main, 0, NM_SQL_INST)) {
+        const char *iso = nm_db_text(&vm->main, 0, NM_SQL_ISO);
         size_t srcp_len = strlen(iso);
 
         if ((srcp_len == 0) && (!(*flags & NM_VMCTL_INFO))) {
             nm_warn(_(NM_MSG_ISO_MISS));
-            nm_vect_free(argv, NULL);
+            nm_argv_free(argv);
             goto out;
         }
         if ((srcp_len > 4) &&
             (nm_str_case_cmp_tt(iso + (srcp_len - 4), ".iso") == NM_OK)) {
-            nm_vect_insert_cstr(argv, "-boot");
-            nm_vect_insert_cstr(argv, "d");
-            nm_vect_insert_cstr(argv, "-cdrom");
-            nm_vect_insert_cstr(argv, iso);
+            nm_argv_add(argv, "-boot");
+            nm_argv_add(argv, "d");
+            nm_argv_add(argv, "-cdrom");
+            nm_argv_add(argv, iso);
         } else {
-            nm_vect_insert_cstr(argv, "-drive");
+            nm_argv_add(argv, "-drive");
             nm_str_format(&buf, "id=usb0,if=none,file=%s", iso);
-            nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_argv_add(argv, buf.data);
 
-            nm_vect_insert_cstr(argv, "-device");
-            nm_vect_insert_cstr(argv,
+            nm_argv_add(argv, "-device");
+            nm_argv_add(argv,
                     "usb-storage,drive=usb0,bus=usbbus.0,bootindex=1");
         }
     } else { /* just mount cdrom */
-        const char *iso = nm_vect_str_ctx(&vm->main, NM_SQL_ISO);
+        const char *iso = nm_db_text(&vm->main, 0, NM_SQL_ISO);
         size_t srcp_len = strlen(iso);
         struct stat info;
         int rc = -1;
@@ -396,12 +406,12 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
 
             if ((rc == -1) && (!(*flags & NM_VMCTL_INFO))) {
                 nm_warn(_(NM_MSG_ISO_NF));
-                nm_vect_free(argv, NULL);
+                nm_argv_free(argv);
                 goto out;
             }
             if (rc != -1) {
-                nm_vect_insert_cstr(argv, "-cdrom");
-                nm_vect_insert_cstr(argv, iso);
+                nm_argv_add(argv, "-cdrom");
+                nm_argv_add(argv, iso);
             }
         }
     }
@@ -409,13 +419,9 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
     for (size_t n = 0; n < drives_count; n++) {
         int nvme_drv = NM_FALSE;
         int scsi_drv = NM_FALSE;
-        size_t idx_shift = NM_DRV_IDX_COUNT * n;
-        const nm_str_t *drive_img = nm_vect_str(&vm->drives,
-                NM_SQL_DRV_NAME + idx_shift);
-        const nm_str_t *blk_drv = nm_vect_str(&vm->drives,
-                NM_SQL_DRV_TYPE + idx_shift);
-        const nm_str_t *discard = nm_vect_str(&vm->drives,
-                NM_SQL_DRV_DISC + idx_shift);
+        const nm_str_t *drive_img = nm_db_str(&vm->drives, n, NM_SQL_DRV_NAME);
+        const nm_str_t *blk_drv = nm_db_str(&vm->drives, n, NM_SQL_DRV_TYPE);
+        const nm_str_t *discard = nm_db_str(&vm->drives, n, NM_SQL_DRV_DISC);
         const char *blk_drv_type = blk_drv->data;
 
         if (nm_str_cmp_st(blk_drv, "nvme") == NM_OK) {
@@ -425,13 +431,13 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
             scsi_drv = NM_TRUE;
             blk_drv_type = "none";
             if (!scsi_added) {
-                nm_vect_insert_cstr(argv, "-device");
-                nm_vect_insert_cstr(argv, "virtio-scsi-pci,id=scsi");
+                nm_argv_add(argv, "-device");
+                nm_argv_add(argv, "virtio-scsi-pci,id=scsi");
                 scsi_added = NM_TRUE;
             }
         }
 
-        nm_vect_insert_cstr(argv, "-drive");
+        nm_argv_add(argv, "-drive");
 
         nm_str_format(&buf, "%s=hd%zu,media=disk,if=%s,file=%s%s",
                 (*flags & NM_VMCTL_TEMP) ? "id" : "node-name",
@@ -441,19 +447,19 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                     ",discard=unmap,detect-zeroes=unmap");
         }
 
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
 
         if (nvme_drv) {
             long host_id = labs(gethostid());
 
-            nm_vect_insert_cstr(argv, "-device");
+            nm_argv_add(argv, "-device");
             nm_str_format(&buf, "nvme,drive=hd%zu,serial=%lX%zX",
                     n, host_id, n);
-            nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_argv_add(argv, buf.data);
         } else if (scsi_drv) {
-            nm_vect_insert_cstr(argv, "-device");
+            nm_argv_add(argv, "-device");
             nm_str_format(&buf, "scsi-hd,drive=hd%zu", n);
-            nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_argv_add(argv, buf.data);
         }
     }
 
@@ -466,7 +472,7 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
         nm_db_select(query.data, &snap_res);
 
         if (snap_res.n_memb > 0) {
-            nm_vect_insert_cstr(argv, "-S");
+            nm_argv_add(argv, "-S");
             nm_str_format(snap, "%s", nm_vect_str_ctx(&snap_res, 0));
 
             /* reset load flag */
@@ -483,15 +489,13 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
         nm_vect_free(&snap_res, nm_str_vect_free_cb);
     }
 
-    nm_vect_insert_cstr(argv, "-m");
-    nm_vect_insert(argv,
-        nm_vect_str(&vm->main, NM_SQL_MEM)->data,
-        nm_vect_str(&vm->main, NM_SQL_MEM)->len + 1, NULL);
+    nm_argv_add(argv, "-m");
+    nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_MEM));
 
-    nm_parse_smp(&cpu, nm_vect_str_ctx(&vm->main, NM_SQL_SMP));
+    nm_parse_smp(&cpu, nm_db_text(&vm->main, 0, NM_SQL_SMP));
     if (cpu.smp > 1) {
         nm_str_trunc(&buf, 0);
-        nm_vect_insert_cstr(argv, "-smp");
+        nm_argv_add(argv, "-smp");
 
         if (!cpu.sockets) {
             nm_str_format(&buf, "%zu", cpu.smp);
@@ -502,7 +506,7 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
             nm_str_format(&buf, "%zu,sockets=%zu,cores=%zu",
                     cpu.smp, cpu.sockets, cpu.cores);
         }
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
     }
 
     /* 9p sharing.
@@ -510,30 +514,28 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
      * guest mount example:
      * mount -t 9p -o trans=virtio,version=9p2000.L hostshare /mnt/host
      */
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_9FLG),
-                NM_ENABLE) == NM_OK) {
-        nm_vect_insert_cstr(argv, "-fsdev");
+    if (nm_db_bool(&vm->main, 0, NM_SQL_9FLG)) {
+        nm_argv_add(argv, "-fsdev");
         nm_str_format(&buf, "local,security_model=none,id=fsdev0,path=%s",
-            nm_vect_str(&vm->main, NM_SQL_9PTH)->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_db_str(&vm->main, 0, NM_SQL_9PTH)->data);
+        nm_argv_add(argv, buf.data);
 
-        nm_vect_insert_cstr(argv, "-device");
+        nm_argv_add(argv, "-device");
         nm_str_format(&buf, "virtio-9p-pci,fsdev=fsdev0,mount_tag=%s",
-            nm_vect_str(&vm->main, NM_SQL_9ID)->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_db_str(&vm->main, 0, NM_SQL_9ID)->data);
+        nm_argv_add(argv, buf.data);
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_KVM), NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm->main, 0, NM_SQL_KVM)) {
 #if defined(NM_OS_DARWIN)
-        nm_vect_insert_cstr(argv, "-accel");
-        nm_vect_insert_cstr(argv, "hvf");
+        nm_argv_add(argv, "-accel");
+        nm_argv_add(argv, "hvf");
 #else
-        nm_vect_insert_cstr(argv, "-enable-kvm");
+        nm_argv_add(argv, "-enable-kvm");
 #endif
-        if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_HCPU),
-                    NM_ENABLE) == NM_OK) {
-            nm_vect_insert_cstr(argv, "-cpu");
-            nm_vect_insert_cstr(argv, "host");
+        if (nm_db_bool(&vm->main, 0, NM_SQL_HCPU)) {
+            nm_argv_add(argv, "-cpu");
+            nm_argv_add(argv, "host");
         }
     }
 
@@ -546,150 +548,134 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
 
         nm_str_format(&query,
                       NM_SQL_VMS_UPDATE_USB_STATUS,
-                      nm_vect_str_ctx(&vm->main, NM_SQL_USBF),
+                      nm_db_text(&vm->main, 0, NM_SQL_USBF),
                       name->data);
         nm_db_edit(query.data);
         nm_str_free(&query);
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_BIOS)) {
-        nm_vect_insert_cstr(argv, "-bios");
-        nm_vect_insert(argv,
-            nm_vect_str(&vm->main, NM_SQL_BIOS)->data,
-            nm_vect_str(&vm->main, NM_SQL_BIOS)->len + 1, NULL);
+    if (nm_db_str(&vm->main, 0, NM_SQL_BIOS)->len) {
+        nm_argv_add(argv, "-bios");
+        nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_BIOS));
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_FLASH)) {
-        nm_vect_insert_cstr(argv, "-pflash");
-        nm_vect_insert(argv,
-            nm_vect_str(&vm->main, NM_SQL_FLASH)->data,
-            nm_vect_str(&vm->main, NM_SQL_FLASH)->len + 1, NULL);
+    if (nm_db_str(&vm->main, 0, NM_SQL_FLASH)->len) {
+        nm_argv_add(argv, "-pflash");
+        nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_FLASH));
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_MACH)) {
-        nm_vect_insert_cstr(argv, "-M");
-        nm_vect_insert(argv,
-            nm_vect_str(&vm->main, NM_SQL_MACH)->data,
-            nm_vect_str(&vm->main, NM_SQL_MACH)->len + 1, NULL);
+    if (nm_db_str(&vm->main, 0, NM_SQL_MACH)->len) {
+        nm_argv_add(argv, "-M");
+        nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_MACH));
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_KERN)) {
-        nm_vect_insert_cstr(argv, "-kernel");
-        nm_vect_insert(argv,
-            nm_vect_str(&vm->main, NM_SQL_KERN)->data,
-            nm_vect_str(&vm->main, NM_SQL_KERN)->len + 1, NULL);
-
-        if (nm_vect_str_len(&vm->main, NM_SQL_KAPP)) {
-            nm_vect_insert_cstr(argv, "-append");
-            nm_vect_insert(argv,
-                nm_vect_str(&vm->main, NM_SQL_KAPP)->data,
-                nm_vect_str(&vm->main, NM_SQL_KAPP)->len + 1, NULL);
+    if (nm_db_str(&vm->main, 0, NM_SQL_KERN)->len) {
+        nm_argv_add(argv, "-kernel");
+        nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_KERN));
+
+        if (nm_db_str(&vm->main, 0, NM_SQL_KAPP)->len) {
+            nm_argv_add(argv, "-append");
+            nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_KAPP));
         }
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_INIT)) {
-        nm_vect_insert_cstr(argv, "-initrd");
-        nm_vect_insert(argv,
-            nm_vect_str(&vm->main, NM_SQL_INIT)->data,
-            nm_vect_str(&vm->main, NM_SQL_INIT)->len + 1, NULL);
+    if (nm_db_str(&vm->main, 0, NM_SQL_INIT)->len) {
+        nm_argv_add(argv, "-initrd");
+        nm_argv_add(argv, nm_db_text(&vm->main, 0, NM_SQL_INIT));
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_OVER),
-                NM_ENABLE) == NM_OK) {
-        nm_vect_insert_cstr(argv, "-device");
-        nm_vect_insert_cstr(argv, "usb-tablet,bus=usbbus.0");
+    if (nm_db_bool(&vm->main, 0, NM_SQL_OVER)) {
+        nm_argv_add(argv, "-device");
+        nm_argv_add(argv, "usb-tablet,bus=usbbus.0");
     }
 
     /* setup serial socket */
-    if (nm_vect_str_len(&vm->main, NM_SQL_SOCK)) {
+    if (nm_db_str(&vm->main, 0, NM_SQL_SOCK)->len) {
         if (!(*flags & NM_VMCTL_INFO)) {
             struct stat info;
 
-            if (stat(nm_vect_str_ctx(&vm->main, NM_SQL_SOCK), &info) != -1) {
+            if (stat(nm_db_text(&vm->main, 0, NM_SQL_SOCK), &info) != -1) {
                 nm_warn(_(NM_MSG_SOCK_USED));
-                nm_vect_free(argv, NULL);
+                nm_argv_free(argv);
                 goto out;
             }
         }
 
-        nm_vect_insert_cstr(argv, "-chardev");
+        nm_argv_add(argv, "-chardev");
         nm_str_format(&buf, "socket,path=%s,server,nowait,id=socket_%s",
-            nm_vect_str(&vm->main, NM_SQL_SOCK)->data, name->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_db_str(&vm->main, 0, NM_SQL_SOCK)->data, name->data);
+        nm_argv_add(argv, buf.data);
 
-        nm_vect_insert_cstr(argv, "-device");
+        nm_argv_add(argv, "-device");
         nm_str_format(&buf, "isa-serial,chardev=socket_%s", name->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
     }
 
     /* setup debug port for GDB */
-    if (nm_vect_str_len(&vm->main, NM_SQL_DEBP)) {
-        nm_vect_insert_cstr(argv, "-gdb");
+    if (nm_db_str(&vm->main, 0, NM_SQL_DEBP)->len) {
+        nm_argv_add(argv, "-gdb");
         nm_str_format(&buf, "tcp::%s",
-            nm_vect_str(&vm->main, NM_SQL_DEBP)->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+            nm_db_str(&vm->main, 0, NM_SQL_DEBP)->data);
+        nm_argv_add(argv, buf.data);
     }
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_DEBF),
-                NM_ENABLE) == NM_OK) {
-        nm_vect_insert_cstr(argv, "-S");
+    if (nm_db_bool(&vm->main, 0, NM_SQL_DEBF)) {
+        nm_argv_add(argv, "-S");
     }
 
     /* setup serial TTY */
-    if (nm_vect_str_len(&vm->main, NM_SQL_TTY)) {
+    if (nm_db_str(&vm->main, 0, NM_SQL_TTY)->len) {
         if (!(*flags & NM_VMCTL_INFO)) {
             int fd;
 
-            if ((fd = open(nm_vect_str_ctx(&vm->main, NM_SQL_TTY),
+            if ((fd = open(nm_db_text(&vm->main, 0, NM_SQL_TTY),
                             O_RDONLY)) == -1) {
                 nm_warn(_(NM_MSG_TTY_MISS));
-                nm_vect_free(argv, NULL);
+                nm_argv_free(argv);
                 goto out;
             }
 
             if (!isatty(fd)) {
                 close(fd);
                 nm_warn(_(NM_MSG_TTY_INVAL));
-                nm_vect_free(argv, NULL);
+                nm_argv_free(argv);
                 goto out;
             }
         }
 
-        nm_vect_insert_cstr(argv, "-chardev");
+        nm_argv_add(argv, "-chardev");
         nm_str_format(&buf, "serial,path=%s,id=tty_%s",
-            nm_vect_str(&vm->main, NM_SQL_TTY)->data,
+            nm_db_str(&vm->main, 0, NM_SQL_TTY)->data,
             name->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
 
-        nm_vect_insert_cstr(argv, "-device");
+        nm_argv_add(argv, "-device");
         nm_str_format(&buf, "isa-serial,chardev=tty_%s",
             name->data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
     }
 
     /* setup network interfaces */
     for (size_t n = 0; n < ifs_count; n++) {
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
+        const nm_str_t *if_name = nm_db_str(&vm->ifs, n, NM_SQL_IF_NAME);
         nm_str_t id = NM_INIT_STR;
 
-        nm_str_copy(&id, nm_vect_str(&vm->ifs, NM_SQL_IF_MAC + idx_shift));
+        nm_str_copy(&id, nm_db_str(&vm->ifs, n, NM_SQL_IF_MAC));
         nm_str_remove_char(&id, ':');
 
-        nm_vect_insert_cstr(argv, "-device");
+        nm_argv_add(argv, "-device");
         nm_str_format(&buf, "%s,mac=%s,id=dev-%s,netdev=net-%s",
-            nm_vect_str(&vm->ifs, NM_SQL_IF_DRV + idx_shift)->data,
-            nm_vect_str(&vm->ifs, NM_SQL_IF_MAC + idx_shift)->data,
+            nm_db_text(&vm->ifs, n, NM_SQL_IF_DRV),
+            nm_db_text(&vm->ifs, n, NM_SQL_IF_MAC),
             id.data, id.data);
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
 
-        if (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift),
-            NM_ENABLE) == NM_OK) {
+        if (nm_db_bool(&vm->ifs, n, NM_SQL_IF_USR)) {
 #if defined (NM_OS_LINUX)
             if (!(*flags & NM_VMCTL_INFO)) {
                 /* Delete iface if exists, we are in user mode */
                 uint32_t tap_idx = 0;
 
-                tap_idx = nm_net_iface_idx(nm_vect_str(&vm->ifs,
-                            NM_SQL_IF_NAME + idx_shift));
+                tap_idx = nm_net_iface_idx(if_name);
 
                 if (tap_idx != 0) { /* iface exist */
                     /* detect iface type */
@@ -699,37 +685,34 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                     nm_str_format(&tap_path, "/dev/tap%u", tap_idx);
                     if (stat(tap_path.data, &tap_info) == 0) {
                         /* iface is macvtap, delete it */
-                        nm_net_del_iface(nm_vect_str(&vm->ifs,
-                                    NM_SQL_IF_NAME + idx_shift));
+                        nm_net_del_iface(if_name);
                     } else {
                         /* iface is simple tap, delete it */
-                        nm_net_del_tap(nm_vect_str(&vm->ifs,
-                                    NM_SQL_IF_NAME + idx_shift));
+                        nm_net_del_tap(if_name);
                     }
                     nm_str_free(&tap_path);
                 }
             }
 #endif /* NM_OS_LINUX */
 
-            nm_vect_insert_cstr(argv, "-netdev");
+            nm_argv_add(argv, "-netdev");
             nm_str_format(&buf, "user,id=net-%s", id.data);
 
-            if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_FWD + idx_shift) != 0) {
+            if (nm_db_str(&vm->ifs, n, NM_SQL_IF_FWD)->len != 0) {
                 nm_str_append_format(&buf, ",hostfwd=%s",
-                        nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_FWD + idx_shift));
+                        nm_db_text(&vm->ifs, n, NM_SQL_IF_FWD));
             }
-            if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_SMB + idx_shift) != 0) {
+            if (nm_db_str(&vm->ifs, n, NM_SQL_IF_SMB)->len != 0) {
                 nm_str_append_format(&buf, ",smb=%s",
-                        nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_SMB + idx_shift));
+                        nm_db_text(&vm->ifs, n, NM_SQL_IF_SMB));
             }
 
-        } else if (nm_str_cmp_st(nm_vect_str(&vm->ifs,
-                        NM_SQL_IF_MVT + idx_shift),
+        } else if (nm_str_cmp_st(nm_db_str(&vm->ifs, n, NM_SQL_IF_MVT),
                     NM_DISABLE) == NM_OK) {
-            nm_vect_insert_cstr(argv, "-netdev");
+            nm_argv_add(argv, "-netdev");
             nm_str_format(&buf,
                     "tap,ifname=%s,script=no,downscript=no,id=net-%s",
-                    nm_vect_str(&vm->ifs, NM_SQL_IF_NAME + idx_shift)->data,
+                    if_name->data,
                     id.data);
 
 #if defined(NM_OS_LINUX)
@@ -741,8 +724,7 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
             if (!(*flags & NM_VMCTL_INFO)) {
                 uint32_t tap_idx = 0;
 
-                tap_idx = nm_net_iface_idx(nm_vect_str(&vm->ifs,
-                    NM_SQL_IF_NAME + idx_shift));
+                tap_idx = nm_net_iface_idx(if_name);
 
                 if (tap_idx != 0) {
                     /* is this iface macvtap? */
@@ -752,8 +734,7 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                     nm_str_format(&tap_path, "/dev/tap%u", tap_idx);
                     if (stat(tap_path.data, &tap_info) == 0) {
                         /* iface is macvtap, delete it */
-                        nm_net_del_iface(nm_vect_str(&vm->ifs,
-                            NM_SQL_IF_NAME + idx_shift));
+                        nm_net_del_iface(if_name);
                     }
                     nm_str_free(&tap_path);
                 }
@@ -771,55 +752,42 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                  * Delete simple tap iface if exists,
                  * we using macvtap iface now
                  */
-                if ((tap_idx = nm_net_iface_idx(nm_vect_str(&vm->ifs,
-                        NM_SQL_IF_NAME + idx_shift))) != 0) {
+                if ((tap_idx = nm_net_iface_idx(if_name)) != 0) {
                     /* is this iface simple tap? */
                     struct stat tap_info;
 
                     nm_str_format(&tap_path, "/dev/tap%u", tap_idx);
                     if (stat(tap_path.data, &tap_info) != 0) {
                         /* iface is simple tap, delete it */
-                        nm_net_del_tap(nm_vect_str(&vm->ifs,
-                                                   NM_SQL_IF_NAME + idx_shift));
+                        nm_net_del_tap(if_name);
                     }
 
                     tap_idx = 0;
                 }
 
-                if (nm_net_iface_exists(nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_NAME + idx_shift)) != NM_OK) {
+                if (nm_net_iface_exists(if_name) != NM_OK) {
                     wait_perm = 1;
-                    int macvtap_type = nm_str_stoui(nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_MVT +
-                                idx_shift), 10);
+                    int macvtap_type = nm_db_int(&vm->ifs, n, NM_SQL_IF_MVT);
 
                     /* check for lower iface (parent) exists */
-                    if (nm_vect_str_len(&vm->ifs,
-                                NM_SQL_IF_PET + idx_shift) == 0) {
+                    if (nm_db_str(&vm->ifs, n, NM_SQL_IF_PET)->len == 0) {
                         nm_warn(_(NM_MSG_MTAP_NSET));
-                        nm_vect_free(argv, NULL);
+                        nm_argv_free(argv);
                         goto out;
                     }
 
-                    nm_net_add_macvtap(nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_NAME + idx_shift),
-                            nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_PET + idx_shift),
-                            nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_MAC + idx_shift),
+                    nm_net_add_macvtap(if_name,
+                            nm_db_str(&vm->ifs, n, NM_SQL_IF_PET),
+                            nm_db_str(&vm->ifs, n, NM_SQL_IF_MAC),
                             macvtap_type);
 
-                    if (nm_vect_str_len(&vm->ifs,
-                                NM_SQL_IF_ALT + idx_shift) != 0) {
-                        nm_net_set_altname(nm_vect_str(&vm->ifs,
-                                    NM_SQL_IF_NAME + idx_shift),
-                                nm_vect_str(&vm->ifs,
-                                    NM_SQL_IF_ALT + idx_shift));
+                    if (nm_db_str(&vm->ifs, n, NM_SQL_IF_ALT)->len != 0) {
+                        nm_net_set_altname(if_name,
+                                nm_db_str(&vm->ifs, n, NM_SQL_IF_ALT));
                     }
                 }
 
-                tap_idx = nm_net_iface_idx(nm_vect_str(&vm->ifs,
-                    NM_SQL_IF_NAME + idx_shift));
+                tap_idx = nm_net_iface_idx(if_name);
                 if (tap_idx == 0) {
                     nm_bug("%s: MacVTap interface not found", __func__);
                 }
@@ -843,7 +811,7 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                     }
                     if (!tap_rw_ok) {
                         nm_warn(_(NM_MSG_TAP_EACC));
-                        nm_vect_free(argv, NULL);
+                        nm_argv_free(argv);
                         goto out;
                     }
                 }
@@ -859,17 +827,15 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                 nm_str_free(&tap_path);
             }
 
-            nm_vect_insert_cstr(argv, "-netdev");
+            nm_argv_add(argv, "-netdev");
             nm_str_format(&buf, "tap,id=net-%s,fd=%d",
                 id.data, (*flags & NM_VMCTL_INFO) ? -1 : tap_fd);
 #endif /* NM_OS_LINUX */
         }
-        if ((nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_VHO + idx_shift),
-                        NM_ENABLE) == NM_OK) &&
-            (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift),
-                           NM_DISABLE) == NM_OK))
+        if (nm_db_bool(&vm->ifs, n, NM_SQL_IF_VHO) &&
+            (!nm_db_bool(&vm->ifs, n, NM_SQL_IF_USR)))
             nm_str_add_text(&buf, ",vhost=on");
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(argv, buf.data);
 
 #if defined(NM_OS_LINUX)
         /*
@@ -877,34 +843,26 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
          * If we need to setup IPv4 address or altname we must create
          * the tap interface yourself.
          */
-        if ((nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift),
-                        NM_DISABLE) == NM_OK)) {
+        if (!nm_db_bool(&vm->ifs, n, NM_SQL_IF_USR)) {
             if ((!(*flags & NM_VMCTL_INFO)) &&
-                    (nm_net_iface_exists(nm_vect_str(&vm->ifs,
-                                                     NM_SQL_IF_NAME +
-                                                     idx_shift)) != NM_OK) &&
-                    (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_MVT +
-                                               idx_shift),
+                    (nm_net_iface_exists(if_name) != NM_OK) &&
+                    (nm_str_cmp_st(nm_db_str(&vm->ifs, n, NM_SQL_IF_MVT),
                                    NM_DISABLE) == NM_OK)) {
-                nm_net_add_tap(nm_vect_str(&vm->ifs,
-                            NM_SQL_IF_NAME + idx_shift));
+                nm_net_add_tap(if_name);
 
-                if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_IP4 + idx_shift) != 0) {
-                    nm_net_set_ipaddr(nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_NAME + idx_shift),
-                            nm_vect_str(&vm->ifs, NM_SQL_IF_IP4 + idx_shift));
+                if (nm_db_str(&vm->ifs, n, NM_SQL_IF_IP4)->len != 0) {
+                    nm_net_set_ipaddr(if_name,
+                            nm_db_str(&vm->ifs, n, NM_SQL_IF_IP4));
                 }
-                if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_ALT + idx_shift) != 0) {
-                    nm_net_set_altname(nm_vect_str(&vm->ifs,
-                                NM_SQL_IF_NAME + idx_shift),
-                            nm_vect_str(&vm->ifs, NM_SQL_IF_ALT + idx_shift));
+                if (nm_db_str(&vm->ifs, n, NM_SQL_IF_ALT)->len != 0) {
+                    nm_net_set_altname(if_name,
+                            nm_db_str(&vm->ifs, n, NM_SQL_IF_ALT));
                 }
             }
         }
 #elif defined(NM_OS_FREEBSD)
-        if (nm_net_iface_exists(nm_vect_str(&vm->ifs,
-                        NM_SQL_IF_NAME + idx_shift)) == NM_OK) {
-            nm_net_del_tap(nm_vect_str(&vm->ifs, NM_SQL_IF_NAME + idx_shift));
+        if (nm_net_iface_exists(if_name) == NM_OK) {
+            nm_net_del_tap(if_name);
         }
         (void) tfds;
 #elif defined(NM_OS_DARWIN)
@@ -914,24 +872,30 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
     }
 
     if (*flags & NM_VMCTL_TEMP) {
-        nm_vect_insert_cstr(argv, "-snapshot");
+        nm_argv_add(argv, "-snapshot");
     }
 
-    nm_vect_insert_cstr(argv, "-pidfile");
+    nm_argv_add(argv, "-pidfile");
     nm_str_format(&buf, "%s%s",
         vmdir.data, NM_VM_PID_FILE);
-    nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(argv, buf.data);
 
-    nm_vect_insert_cstr(argv, "-qmp");
+    nm_argv_add(argv, "-qmp");
     nm_str_format(&buf, "unix:%s%s,server,nowait",
         vmdir.data, NM_VM_QMP_FILE);
-    nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+    nm_argv_add(argv, buf.data);
+
+    /* separate monitor for the daemon, so it does not lock out the main one */
+    nm_argv_add(argv, "-qmp");
+    nm_str_format(&buf, "unix:%s%s,server,nowait",
+        vmdir.data, NM_VM_QMP_MON_FILE);
+    nm_argv_add(argv, buf.data);
 
     /* Check if vnc/spice port is available, generate new one if not */
+    uint32_t vnc_port = nm_db_int(&vm->main, 0, NM_SQL_VNC);
     if (!(*flags & NM_VMCTL_INFO)) {
         uint32_t in_addr = cfg->listen_any ? INADDR_ANY : INADDR_LOOPBACK;
-        uint32_t curr_port = nm_str_stoui(nm_vect_str(&vm->main,
-                    NM_SQL_VNC), 10) + NM_STARTING_VNC_PORT;
+        uint32_t curr_port = vnc_port + NM_STARTING_VNC_PORT;
         if (curr_port > 0xffff) {
             nm_bug("%s: port number overflow", __func__);
         }
@@ -968,13 +932,11 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
                 }
             }
 
-            nm_str_format(nm_vect_str(&vm->main, NM_SQL_VNC), "%u",
-                    curr_port - NM_STARTING_VNC_PORT);
+            vnc_port = curr_port - NM_STARTING_VNC_PORT;
             nm_str_t query = NM_INIT_STR;
 
-            nm_str_format(&query, NM_SQL_VMS_UPDATE_VNC,
-                curr_port - NM_STARTING_VNC_PORT,
-                nm_vect_str_ctx(&vm->main, NM_SQL_NAME));
+            nm_str_format(&query, NM_SQL_VMS_UPDATE_VNC, vnc_port,
+                nm_db_text(&vm->main, 0, NM_SQL_NAME));
             nm_db_edit(query.data);
 
             if (occupied_ports) {
@@ -985,56 +947,51 @@ void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
         }
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_SPICE),
-                NM_ENABLE) == NM_OK) {
-        nm_vect_insert_cstr(argv, "-vga");
-        nm_vect_insert_cstr(argv,
-                (nm_vect_str(&vm->main, NM_SQL_DISPLAY))->data);
-        nm_vect_insert_cstr(argv, "-spice");
+    if (nm_db_bool(&vm->main, 0, NM_SQL_SPICE)) {
+        nm_argv_add(argv, "-vga");
+        nm_argv_add(argv,
+                (nm_db_str(&vm->main, 0, NM_SQL_DISPLAY))->data);
+        nm_argv_add(argv, "-spice");
         nm_str_format(&buf, "port=%u,disable-ticketing=on",
-            nm_str_stoui(nm_vect_str(&vm->main, NM_SQL_VNC), 10) +
-            NM_STARTING_VNC_PORT);
+            vnc_port + NM_STARTING_VNC_PORT);
         if (!cfg->listen_any) {
             nm_str_append_format(&buf, ",addr=127.0.0.1");
         }
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
-
-        if (nm_str_cmp_st(nm_vect_str(&vm->main, NM_SQL_AGENT),
-                    NM_ENABLE) == NM_OK) {
-            nm_vect_insert_cstr(argv, "-device");
-            nm_vect_insert_cstr(argv, "virtio-serial");
-            nm_vect_insert_cstr(argv, "-chardev");
-            nm_vect_insert_cstr(argv,
+        nm_argv_add(argv, buf.data);
+
+        if (nm_db_bool(&vm->main, 0, NM_SQL_AGENT)) {
+            nm_argv_add(argv, "-device");
+            nm_argv_add(argv, "virtio-serial");
+            nm_argv_add(argv, "-chardev");
+            nm_argv_add(argv,
                     "spicevmc,id=vdagent,debug=0,name=vdagent");
-            nm_vect_insert_cstr(argv, "-device");
-            nm_vect_insert_cstr(argv,
+            nm_argv_add(argv, "-device");
+            nm_argv_add(argv,
                     "virtserialport,chardev=vdagent,name=com.redhat.spice.0");
         }
     } else {
-        nm_vect_insert_cstr(argv, "-vnc");
+        nm_argv_add(argv, "-vnc");
         if (cfg->listen_any) {
             nm_str_format(&buf, ":");
         } else {
             nm_str_format(&buf, "127.0.0.1:");
         }
-        nm_str_add_str(&buf, nm_vect_str(&vm->main, NM_SQL_VNC));
-        nm_vect_insert(argv, buf.data, buf.len + 1, NULL);
+        nm_str_append_format(&buf, "%u", vnc_port);
+        nm_argv_add(argv, buf.data);
     }
 
-    if (nm_vect_str_len(&vm->main, NM_SQL_ARGS)) {
+    if (nm_db_str(&vm->main, 0, NM_SQL_ARGS)->len) {
         nm_vect_t args = NM_INIT_VECT;
 
-        nm_str_append_to_vect(nm_vect_str(&vm->main, NM_SQL_ARGS), &args, " ");
+        nm_str_append_to_vect(nm_db_str(&vm->main, 0, NM_SQL_ARGS), &args, " ");
 
         for (size_t n = 0; n < args.n_memb; n++) {
-            nm_vect_insert_cstr(argv, args.data[n]);
+            nm_argv_add(argv, args.data[n]);
         }
 
         nm_vect_free(&args, NULL);
     }
 
-    nm_vect_end_zero(argv);
-
     nm_cmd_str(&buf, argv);
     nm_debug("cmd=%s\n", buf.data);
 
@@ -1048,26 +1005,27 @@ nm_str_t nm_vmctl_info(const nm_str_t *name)
     nm_str_t info = NM_INIT_STR;
     nm_vmctl_data_t vm = NM_VMCTL_INIT_DATA;
     int status;
-    size_t ifs_count, drives_count;
+    size_t ifs_count, drives_count, blk_count, net_count;
+    nm_metrics_drive_t blk[NM_METRICS_DRIVES];
+    nm_metrics_iface_t net[NM_METRICS_IFACES];
 
     nm_vmctl_get_data(name, &vm);
 
     nm_str_format(&info, "%-12s%s\n", "name: ", name->data);
 
-    status = nm_qmp_test_socket(name);
+    status = nm_mon_vm_status(name);
     nm_str_append_format(&info, "%-12s%s\n", "status: ",
         status == NM_OK ? "running" : "stopped");
 
     nm_str_append_format(&info, "%-12s%s\n", "arch: ",
-        nm_vect_str_ctx(&vm.main, NM_SQL_ARCH));
+        nm_db_text(&vm.main, 0, NM_SQL_ARCH));
     nm_str_append_format(&info, "%-12s%s\n", "cores: ",
-        nm_vect_str_ctx(&vm.main, NM_SQL_SMP));
+        nm_db_text(&vm.main, 0, NM_SQL_SMP));
     nm_str_append_format(&info, "%-12s%s Mb\n", "memory: ",
-        nm_vect_str_ctx(&vm.main, NM_SQL_MEM));
+        nm_db_text(&vm.main, 0, NM_SQL_MEM));
 
-    if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_KVM), NM_ENABLE) == NM_OK) {
-        if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_HCPU),
-                    NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm.main, 0, NM_SQL_KVM)) {
+        if (nm_db_bool(&vm.main, 0, NM_SQL_HCPU)) {
             nm_str_append_format(&info, "%-12s%s\n", "kvm: ",
                     "enabled [+hostcpu]");
         } else {
@@ -1077,132 +1035,150 @@ nm_str_t nm_vmctl_info(const nm_str_t *name)
         nm_str_append_format(&info, "%-12s%s\n", "kvm: ", "disabled");
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_USBF), "1") == NM_OK) {
+    if (nm_db_bool(&vm.main, 0, NM_SQL_USBF)) {
         nm_str_append_format(&info, "%-12s%s [%s]\n", "usb: ", "enabled",
-            nm_vect_str_ctx(&vm.main, NM_SQL_USBT));
+            nm_db_text(&vm.main, 0, NM_SQL_USBT));
     } else {
         nm_str_append_format(&info, "%-12s%s\n", "usb: ", "disabled");
     }
 
     nm_str_append_format(&info, "%-12s%s [%u]\n", "vnc port: ",
-        nm_vect_str_ctx(&vm.main, NM_SQL_VNC),
-        nm_str_stoui(nm_vect_str(&vm.main, NM_SQL_VNC), 10) +
+        nm_db_text(&vm.main, 0, NM_SQL_VNC),
+        nm_str_stoui(nm_db_str(&vm.main, 0, NM_SQL_VNC), 10) +
         NM_STARTING_VNC_PORT);
 
-    ifs_count = vm.ifs.n_memb / NM_IFS_IDX_COUNT;
+    ifs_count = nm_db_rows(&vm.ifs);
+    net_count = (status == NM_OK) ?
+        nm_mon_metrics_get_ifaces(name, net, NM_METRICS_IFACES) : 0;
     for (size_t n = 0; n < ifs_count; n++) {
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
+        nm_metrics_iface_t iface;
 
         nm_str_append_format(&info, "eth%zu%-8s%s [%s %s%s]\n",
             n, ":",
-            nm_vect_str_ctx(&vm.ifs, NM_SQL_IF_NAME + idx_shift),
-            nm_vect_str_ctx(&vm.ifs, NM_SQL_IF_MAC + idx_shift),
-            nm_vect_str_ctx(&vm.ifs, NM_SQL_IF_DRV + idx_shift),
-            (nm_str_cmp_st(nm_vect_str(&vm.ifs, NM_SQL_IF_VHO + idx_shift),
-                NM_ENABLE) == NM_OK) ? "+vhost" : "");
+            nm_db_text(&vm.ifs, n, NM_SQL_IF_NAME),
+            nm_db_text(&vm.ifs, n, NM_SQL_IF_MAC),
+            nm_db_text(&vm.ifs, n, NM_SQL_IF_DRV),
+            nm_db_bool(&vm.ifs, n, NM_SQL_IF_VHO) ? "+vhost" : "");
+
+        if (nm_mon_metrics_iface(net, net_count,
+                    nm_db_text(&vm.ifs, n, NM_SQL_IF_NAME),
+                    &iface) == NM_OK) {
+            nm_str_append_format(&info, "%-12s%.0f/%.0f pps, "
+                    "%.2f/%.2f Mbit/s rx/tx\n", "",
+                    iface.rx_pps, iface.tx_pps,
+                    iface.rx_bps * 8 / 1e6, iface.tx_bps * 8 / 1e6);
+        }
     }
 
-    drives_count = vm.drives.n_memb / NM_DRV_IDX_COUNT;
+    drives_count = nm_db_rows(&vm.drives);
+    blk_count = (status == NM_OK) ?
+        nm_mon_metrics_get_drives(name, blk, NM_METRICS_DRIVES) : 0;
     for (size_t n = 0; n < drives_count; n++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * n;
         nm_str_t drive_path = NM_INIT_STR;
+        nm_metrics_drive_t drive;
         struct stat img_info;
+        char node[32];
         int boot = 0;
 
-        if (nm_str_cmp_st(nm_vect_str(&vm.drives, NM_SQL_DRV_BOOT + idx_shift),
-                NM_ENABLE) == NM_OK)
+        if (nm_db_bool(&vm.drives, n, NM_SQL_DRV_BOOT))
             boot = 1;
 
         nm_str_format(&drive_path, "%s/%s/%s",
                 nm_cfg_get()->vm_dir.data,
                 name->data,
-                nm_vect_str_ctx(&vm.drives, NM_SQL_DRV_NAME + idx_shift));
+                nm_db_text(&vm.drives, n, NM_SQL_DRV_NAME));
 
         memset(&img_info, 0, sizeof(img_info));
         stat(drive_path.data, &img_info);
 
         nm_str_append_format(&info, "disk%zu%-7s%s [%.3gGb/%sGb real/virt, %s, "
                 "%s] %s\n", n, ":",
-                nm_vect_str_ctx(&vm.drives, NM_SQL_DRV_NAME + idx_shift),
+                nm_db_text(&vm.drives, n, NM_SQL_DRV_NAME),
                 (double) img_info.st_blocks * S_BLKSIZE / 1073741824,
-                nm_vect_str_ctx(&vm.drives, NM_SQL_DRV_SIZE + idx_shift),
-                nm_vect_str_ctx(&vm.drives, NM_SQL_DRV_TYPE + idx_shift),
-                nm_vect_str_ctx(&vm.drives, NM_SQL_DRV_FMT + idx_shift),
+                nm_db_text(&vm.drives, n, NM_SQL_DRV_SIZE),
+                nm_db_text(&vm.drives, n, NM_SQL_DRV_TYPE),
+                nm_db_text(&vm.drives, n, NM_SQL_DRV_FMT),
                 boot ? "*" : "");
 
+        snprintf(node, sizeof(node), "hd%zu", n);
+        if (nm_mon_metrics_drive(blk, blk_count, node, &drive) == NM_OK) {
+            nm_str_append_format(&info, "%-12s%.0f/%.0f iops, %.1f/%.1f Mb/s, "
+                    "%.2f/%.2f ms r/w\n", "", drive.rd_iops, drive.wr_iops,
+                    drive.rd_bps / 1048576, drive.wr_bps / 1048576,
+                    drive.rd_lat, drive.wr_lat);
+        }
+
         nm_str_free(&drive_path);
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_9FLG), "1") == NM_OK) {
+    if (nm_db_bool(&vm.main, 0, NM_SQL_9FLG)) {
         nm_str_append_format(&info, "%-12s%s [%s]\n", "9pfs: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_9PTH),
-            nm_vect_str_ctx(&vm.main, NM_SQL_9ID));
+            nm_db_text(&vm.main, 0, NM_SQL_9PTH),
+            nm_db_text(&vm.main, 0, NM_SQL_9ID));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_MACH)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_MACH)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "machine: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_MACH));
+            nm_db_text(&vm.main, 0, NM_SQL_MACH));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_BIOS)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_BIOS)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "bios: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_BIOS));
+            nm_db_text(&vm.main, 0, NM_SQL_BIOS));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_FLASH)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_FLASH)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "flash: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_FLASH));
+            nm_db_text(&vm.main, 0, NM_SQL_FLASH));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_KERN)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_KERN)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "kernel: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_KERN));
+            nm_db_text(&vm.main, 0, NM_SQL_KERN));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_KAPP)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_KAPP)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "cmdline: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_KAPP));
+            nm_db_text(&vm.main, 0, NM_SQL_KAPP));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_INIT)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_INIT)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "initrd: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_INIT));
+            nm_db_text(&vm.main, 0, NM_SQL_INIT));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_TTY)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_TTY)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "tty: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_TTY));
+            nm_db_text(&vm.main, 0, NM_SQL_TTY));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_SOCK)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_SOCK)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "socket: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_SOCK));
+            nm_db_text(&vm.main, 0, NM_SQL_SOCK));
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_DEBP)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_DEBP)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "gdb port: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_DEBP));
+            nm_db_text(&vm.main, 0, NM_SQL_DEBP));
     }
 
-    if (nm_str_cmp_st(nm_vect_str(&vm.main, NM_SQL_DEBF), NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm.main, 0, NM_SQL_DEBF)) {
         nm_str_append_format(&info, "%-12s\n", "freeze cpu: yes");
     }
 
-    if (nm_vect_str_len(&vm.main, NM_SQL_ARGS)) {
+    if (nm_db_str(&vm.main, 0, NM_SQL_ARGS)->len) {
         nm_str_append_format(&info, "%-12s%s\n", "extra args: ",
-            nm_vect_str_ctx(&vm.main, NM_SQL_ARGS));
+            nm_db_text(&vm.main, 0, NM_SQL_ARGS));
     }
 
     for (size_t n = 0; n < ifs_count; n++) {
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
-
-        if (!nm_vect_str_len(&vm.ifs, NM_SQL_IF_IP4 + idx_shift)) {
+        if (!nm_db_str(&vm.ifs, n, NM_SQL_IF_IP4)->len) {
             continue;
         }
 
         nm_str_append_format(&info, "%-12s%s [%s]\n", "host IP: ",
-            nm_vect_str_ctx(&vm.ifs, NM_SQL_IF_NAME + idx_shift),
-            nm_vect_str_ctx(&vm.ifs, NM_SQL_IF_IP4 + idx_shift));
+            nm_db_text(&vm.ifs, n, NM_SQL_IF_NAME),
+            nm_db_text(&vm.ifs, n, NM_SQL_IF_IP4));
     }
 
     if (status == NM_OK) {
@@ -1222,17 +1198,46 @@ nm_str_t nm_vmctl_info(const nm_str_t *name)
 
                 nm_str_append_format(&info, "%-12s%d\n", "pid: ", pid_num);
 #if defined (NM_OS_LINUX)
-                struct timespec ts;
+                nm_metrics_rate_t rate;
+
+                /* the monitoring daemon samples all running VMs */
+                if (nm_mon_metrics_last(name, &rate) == NM_OK) {
+                    nm_str_append_format(&info, "%-12s%0.1f%%\n",
+                            "cpu usage: ", rate.cpu);
+                    nm_str_append_format(&info, "%-12s%.1f Mb\n",
+                            "rss: ", (double) rate.rss / 1048576);
+                    nm_str_append_format(&info,
+                            "%-12s%.1f/%.1f Mb/s read/write\n", "disk io: ",
+                            rate.rd_bytes / 1048576, rate.wr_bytes / 1048576);
+                    nm_str_append_format(&info, "%-12s%.0f/s\n",
+                            "majflt: ", rate.majflt);
+                    nm_str_append_format(&info, "%-12s%.0f/s\n",
+                            "ctxsw: ", rate.ctxsw);
+                    nm_metrics_thread_t thr[NM_METRICS_THREADS];
+                    size_t n_thr = nm_mon_metrics_get_threads(name,
+                            thr, NM_METRICS_THREADS);
+
+                    for (size_t n = 0; n < n_thr; n++) {
+                        char label[13];
+
+                        nm_mon_metrics_label(&thr[n], label, sizeof(label));
+                        nm_str_append_format(&info,
+                                "%-12s%.1f%% cpu, %.1f%% rq delay\n",
+                                label, thr[n].cpu, thr[n].delay);
+                    }
+                } else {
+                    struct timespec ts;
 
-                memset(&ts, 0, sizeof(ts));
-                ts.tv_nsec = 1e+8; // 0.1 s
+                    memset(&ts, 0, sizeof(ts));
+                    ts.tv_nsec = 1e+8; // 0.1 s
 
-                nm_stat_get_usage(pid_num);
-                nanosleep(&ts, NULL);
-                double usage = nm_stat_get_usage(pid_num);
+                    nm_stat_get_usage(pid_num);
+                    nanosleep(&ts, NULL);
+                    double usage = nm_stat_get_usage(pid_num);
 
-                nm_str_append_format(&info, "%-12s%0.1f%%\n",
-                        "cpu usage: ", usage);
+                    nm_str_append_format(&info, "%-12s%0.1f%%\n",
+                            "cpu usage: ", usage);
+                }
 #endif
             }
             close(fd);
@@ -1247,10 +1252,10 @@ nm_str_t nm_vmctl_info(const nm_str_t *name)
 
 void nm_vmctl_free_data(nm_vmctl_data_t *vm)
 {
-    nm_vect_free(&vm->main, nm_str_vect_free_cb);
-    nm_vect_free(&vm->ifs, nm_str_vect_free_cb);
-    nm_vect_free(&vm->drives, nm_str_vect_free_cb);
-    nm_vect_free(&vm->usb, nm_str_vect_free_cb);
+    nm_db_res_free(&vm->main);
+    nm_db_res_free(&vm->ifs);
+    nm_db_res_free(&vm->drives);
+    nm_db_res_free(&vm->usb);
 }
 
 void nm_vmctl_log_last(const nm_str_t *msg)
@@ -1305,7 +1310,7 @@ static int nm_vmctl_clear_tap_vect(const nm_vect_t *vms)
     for (size_t n = 0; n < vms->n_memb; n++) {
         struct stat file_info;
         size_t ifs_count;
-        nm_vect_t ifaces = NM_INIT_VECT;
+        nm_db_res_t ifaces = NM_INIT_DB_RES;
 
         nm_str_format(&lock_path, "%s/%s/%s",
             nm_cfg_get()->vm_dir.data,
@@ -1317,20 +1322,17 @@ static int nm_vmctl_clear_tap_vect(const nm_vect_t *vms)
         }
 
         nm_str_format(&query, NM_SQL_VMS_SELECT_PROPS, nm_vect_str_ctx(vms, n));
-        nm_db_select(query.data, &ifaces);
-        ifs_count = ifaces.n_memb / NM_IFS_IDX_COUNT;
+        nm_db_fetch(query.data, &ifaces);
+        ifs_count = nm_db_rows(&ifaces);
 
         for (size_t ifn = 0; ifn < ifs_count; ifn++) {
-            size_t idx_shift = NM_IFS_IDX_COUNT * ifn;
+            const nm_str_t *if_name = nm_db_str(&ifaces, ifn, NM_SQL_IF_NAME);
 
-            if (nm_net_iface_exists(nm_vect_str(&ifaces,
-                            NM_SQL_IF_NAME + idx_shift)) == NM_OK) {
+            if (nm_net_iface_exists(if_name) == NM_OK) {
 #if defined (NM_OS_LINUX)
-                nm_net_del_iface(nm_vect_str(&ifaces,
-                            NM_SQL_IF_NAME + idx_shift));
+                nm_net_del_iface(if_name);
 #else
-                nm_net_del_tap(nm_vect_str(&ifaces,
-                            NM_SQL_IF_NAME + idx_shift));
+                nm_net_del_tap(if_name);
 #endif
                 clear_done = 1;
             }
@@ -1338,7 +1340,7 @@ static int nm_vmctl_clear_tap_vect(const nm_vect_t *vms)
 
         nm_str_trunc(&lock_path, 0);
         nm_str_trunc(&query, 0);
-        nm_vect_free(&ifaces, nm_str_vect_free_cb);
+        nm_db_res_free(&ifaces);
     }
 
     nm_str_free(&query);
@@ -3,6 +3,7 @@
 
 #include <nm_string.h>
 #include <nm_vector.h>
+#include <nm_database.h>
 
 static const uint32_t NM_STARTING_VNC_PORT = 5900;
 
@@ -13,15 +14,15 @@ enum vmctl_flags {
 };
 
 typedef struct {
-    nm_vect_t main;
-    nm_vect_t ifs;
-    nm_vect_t drives;
-    nm_vect_t usb;
+    nm_db_res_t main;
+    nm_db_res_t ifs;
+    nm_db_res_t drives;
+    nm_db_res_t usb;
 } nm_vmctl_data_t;
 
 #define NM_VMCTL_INIT_DATA (nm_vmctl_data_t) { \
-                            NM_INIT_VECT, NM_INIT_VECT, \
-                            NM_INIT_VECT, NM_INIT_VECT }
+                            NM_INIT_DB_RES, NM_INIT_DB_RES, \
+                            NM_INIT_DB_RES, NM_INIT_DB_RES }
 
 void nm_vmctl_start(const nm_str_t *name, int flags);
 void nm_vmctl_delete(const nm_str_t *name);
@@ -30,7 +31,7 @@ void nm_vmctl_get_data(const nm_str_t *name, nm_vmctl_data_t *vm);
 void nm_vmctl_free_data(nm_vmctl_data_t *vm);
 void nm_vmctl_clear_tap(const nm_str_t *name);
 void nm_vmctl_clear_all_tap(void);
-void nm_vmctl_gen_cmd(nm_vect_t *argv, const nm_vmctl_data_t *vm,
+void nm_vmctl_gen_cmd(nm_argv_t *argv, const nm_vmctl_data_t *vm,
     const nm_str_t *name, int *flags, nm_vect_t *tfds, nm_str_t *snap);
 nm_str_t nm_vmctl_info(const nm_str_t *name);
 void nm_vmctl_log_last(const nm_str_t *msg);
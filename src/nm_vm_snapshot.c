@@ -41,7 +41,7 @@ enum {
 };
 
 static nm_field_t *fields[NM_FLD_COUNT + 1];
-static nm_vect_t snaps = NM_INIT_VECT;
+static nm_db_res_t snaps = NM_INIT_DB_RES;
 
 static void nm_vm_snapshot_init_windows(nm_form_t *form)
 {
@@ -215,20 +215,18 @@ void nm_vm_snapshot_delete(const nm_str_t *name, int vm_status)
     size_t msg_len;
 
     nm_str_format(&query, NM_SQL_SNAPS_SELECT_ALL, name->data);
-    nm_db_select(query.data, &snaps);
+    nm_db_fetch(query.data, &snaps);
 
-    if (snaps.n_memb == 0) {
+    if (nm_db_rows(&snaps) == 0) {
         nm_warn(_(NM_MSG_NO_SNAPS));
         goto out;
     }
 
-    snaps_count = snaps.n_memb / NM_SQL_VMSNAP_COUNT;
+    snaps_count = nm_db_rows(&snaps);
     for (size_t n = 0; n < snaps_count; n++) {
-        size_t idx_shift = NM_SQL_VMSNAP_COUNT * n;
-
         nm_vect_insert(&choices,
-            nm_vect_str_ctx(&snaps, NM_SQL_VMSNAP_NAME + idx_shift),
-            nm_vect_str_len(&snaps, NM_SQL_VMSNAP_NAME + idx_shift) + 1,
+            nm_db_text(&snaps, n, NM_SQL_VMSNAP_NAME),
+            nm_db_str(&snaps, n, NM_SQL_VMSNAP_NAME)->len + 1,
             NULL);
     }
     nm_vect_end_zero(&choices);
@@ -287,7 +285,7 @@ void nm_vm_snapshot_delete(const nm_str_t *name, int vm_status)
 
 out:
     NM_FORM_EXIT();
-    nm_vect_free(&snaps, nm_str_vect_free_cb);
+    nm_db_res_free(&snaps);
     nm_vect_free(&choices, NULL);
     nm_form_free(form);
     nm_form_data_free(form_data);
@@ -423,23 +421,21 @@ void nm_vm_cli_snapshot_list(const nm_str_t *vm_name)
     size_t count;
 
     nm_str_format(&query, NM_SQL_SNAPS_SELECT_ALL, vm_name->data);
-    nm_db_select(query.data, &snaps);
+    nm_db_fetch(query.data, &snaps);
 
-    if (!snaps.n_memb) {
+    if (!nm_db_rows(&snaps)) {
         goto out;
     }
 
-    count = snaps.n_memb / NM_SQL_VMSNAP_COUNT;
+    count = nm_db_rows(&snaps);
     for (size_t n = 0; n < count; n++) {
-        size_t idx_shift = NM_SQL_VMSNAP_COUNT * n;
-
         printf("%-15s [%s]\n",
-                nm_vect_str_ctx(&snaps, NM_SQL_VMSNAP_NAME + idx_shift),
-                nm_vect_str_ctx(&snaps, NM_SQL_VMSNAP_TIME + idx_shift));
+                nm_db_text(&snaps, n, NM_SQL_VMSNAP_NAME),
+                nm_db_text(&snaps, n, NM_SQL_VMSNAP_TIME));
     }
 
 out:
-    nm_vect_free(&snaps, nm_str_vect_free_cb);
+    nm_db_res_free(&snaps);
     nm_str_free(&query);
 }
 
@@ -458,20 +454,18 @@ void nm_vm_snapshot_load(const nm_str_t *name, int vm_status)
     size_t msg_len;
 
     nm_str_format(&query, NM_SQL_SNAPS_SELECT_ALL, name->data);
-    nm_db_select(query.data, &snaps);
+    nm_db_fetch(query.data, &snaps);
 
-    if (snaps.n_memb == 0) {
+    if (nm_db_rows(&snaps) == 0) {
         nm_warn(_(NM_MSG_NO_SNAPS));
         goto out;
     }
 
-    snaps_count = snaps.n_memb / NM_SQL_VMSNAP_COUNT;
+    snaps_count = nm_db_rows(&snaps);
     for (size_t n = 0; n < snaps_count; n++) {
-        size_t idx_shift = NM_SQL_VMSNAP_COUNT * n;
-
         nm_vect_insert(&choices,
-            nm_vect_str_ctx(&snaps, NM_SQL_VMSNAP_NAME + idx_shift),
-            nm_vect_str_len(&snaps, NM_SQL_VMSNAP_NAME + idx_shift) + 1,
+            nm_db_text(&snaps, n, NM_SQL_VMSNAP_NAME),
+            nm_db_str(&snaps, n, NM_SQL_VMSNAP_NAME)->len + 1,
             NULL);
     }
     nm_vect_end_zero(&choices);
@@ -533,7 +527,7 @@ out:
     nm_form_free(form);
     nm_form_data_free(form_data);
     nm_fields_free(fields);
-    nm_vect_free(&snaps, nm_str_vect_free_cb);
+    nm_db_res_free(&snaps);
     nm_vect_free(&choices, NULL);
     nm_str_free(&query);
     nm_str_free(&buf);
@@ -574,7 +568,7 @@ static void __nm_vm_snapshot_delete(const nm_str_t *name, const nm_str_t *snap,
          * qemu-img snapshot -d snapshot_name path_to_drive system command
          */
         nm_str_t buf = NM_INIT_STR;
-        nm_vect_t argv = NM_INIT_VECT;
+        nm_argv_t argv = NM_INIT_ARGV;
         nm_str_t query = NM_INIT_STR;
         nm_vect_t drives = NM_INIT_VECT;
 
@@ -587,26 +581,25 @@ static void __nm_vm_snapshot_delete(const nm_str_t *name, const nm_str_t *snap,
         }
 
         nm_str_format(&buf, "%s/qemu-img", nm_cfg_get()->qemu_bin_path.data);
-        nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(&argv, buf.data);
 
-        nm_vect_insert_cstr(&argv, "snapshot");
-        nm_vect_insert_cstr(&argv, "-d");
+        nm_argv_add(&argv, "snapshot");
+        nm_argv_add(&argv, "-d");
 
-        nm_vect_insert(&argv, snap->data, snap->len + 1, NULL);
+        nm_argv_add(&argv, snap->data);
 
         nm_str_format(&buf, "%s/%s/%s",
                 nm_cfg_get()->vm_dir.data, name->data,
                 nm_vect_str_ctx(&drives, 0));
-        nm_vect_insert(&argv, buf.data, buf.len + 1, NULL);
+        nm_argv_add(&argv, buf.data);
 
-        nm_vect_end_zero(&argv);
         if (nm_spawn_process(&argv, NULL) != NM_OK) {
             nm_bug(_("%s: cannot delete snapshot"), __func__);
         }
 
         rc = NM_OK;
         nm_str_free(&buf);
-        nm_vect_free(&argv, NULL);
+        nm_argv_free(&argv);
         nm_vect_free(&drives, nm_str_vect_free_cb);
         nm_str_free(&query);
     } else {
@@ -6,8 +6,10 @@
 #include <nm_ncurses.h>
 #include <nm_database.h>
 #include <nm_cfg_file.h>
+#include <nm_mon_shm.h>
 #include <nm_usb_plug.h>
 #include <nm_stat_usage.h>
+#include <nm_mon_metrics.h>
 #include <nm_qmp_control.h>
 
 static float nm_window_scale = 0.7;
@@ -53,7 +55,8 @@ static void nm_print_help__(const char **keys, const char **values,
     X(iface, "q:Back", "a:Add", "r:Remove", "enter:Edit") \
     X(clone, "esc:Cancel", "enter:Clone")                 \
     X(export, "esc:Cancel", "enter:Export")               \
-    X(delete, "q:Back", "enter:Delete")
+    X(delete, "q:Back", "enter:Delete")                   \
+    X(dashboard, "q:Back", "1-5:Sort column")
 
 #define X(name, ...)                                         \
     void nm_init_help_ ## name(void)                         \
@@ -141,7 +144,8 @@ void nm_init_side(void)
         nm_init_window__(side_window, _("VM list"));
     }
 
-    wtimeout(side_window, nm_cfg_get()->refresh_timeout);
+    /* main loop waits for input in poll(2) */
+    wtimeout(side_window, 0);
 }
 
 void nm_init_side_lan(void)
@@ -201,7 +205,7 @@ void nm_destroy_windows(void)
 void nm_print_cmd(const nm_str_t *name)
 {
     nm_str_t buf = NM_INIT_STR;
-    nm_vect_t argv = NM_INIT_VECT;
+    nm_argv_t argv = NM_INIT_ARGV;
     nm_vect_t res = NM_INIT_VECT;
     nm_vmctl_data_t vm = NM_VMCTL_INIT_DATA;
     int off, start = 3, flags = 0;
@@ -214,8 +218,8 @@ void nm_print_cmd(const nm_str_t *name)
     nm_vmctl_gen_cmd(&argv, &vm, name, &flags, NULL, NULL);
 
     /* pre checking */
-    for (size_t n = 0; n < argv.n_memb; n++) {
-        off = strlen((char *) nm_vect_at(&argv, n));
+    for (size_t n = 0; n < nm_argv_count(&argv); n++) {
+        off = strlen(nm_argv_at(&argv, n));
         off += 2; /* count ' \' */
 
         if (off >= col) {
@@ -227,8 +231,8 @@ void nm_print_cmd(const nm_str_t *name)
         }
     }
 
-    for (size_t n = 0; n < argv.n_memb; n++) {
-        const char *arg = nm_vect_at(&argv, n);
+    for (size_t n = 0; n < nm_argv_count(&argv); n++) {
+        const char *arg = nm_argv_at(&argv, n);
 
         off = buf.len;
         off += strlen(arg);
@@ -240,13 +244,13 @@ void nm_print_cmd(const nm_str_t *name)
             nm_str_append_format(&tmp, "%s\\", buf.data);
             nm_vect_insert_cstr(&res, tmp.data);
             nm_str_trunc(&buf, 0);
-            if (n + 1 != argv.n_memb) {
+            if (n + 1 != nm_argv_count(&argv)) {
                 nm_str_append_format(&buf, "%s ", arg);
             } else {
                 nm_vect_insert_cstr(&res, arg);
             }
             nm_str_free(&tmp);
-        } else if (off <= col && n + 1 < argv.n_memb) {
+        } else if (off <= col && n + 1 < nm_argv_count(&argv)) {
             nm_str_append_format(&buf, "%s ", arg);
         } else {
             nm_str_append_format(&buf, "%s ", arg);
@@ -263,7 +267,7 @@ void nm_print_cmd(const nm_str_t *name)
 
 out:
     nm_str_free(&buf);
-    nm_vect_free(&argv, NULL);
+    nm_argv_free(&argv);
     nm_vect_free(&res, NULL);
     nm_vmctl_free_data(&vm);
 
@@ -271,10 +275,10 @@ out:
     getch();
 }
 
-void nm_print_snapshots(const nm_vect_t *v)
+void nm_print_snapshots(const nm_db_res_t *v)
 {
     nm_str_t buf = NM_INIT_STR;
-    size_t count = v->n_memb / NM_SQL_VMSNAP_COUNT;
+    size_t count = nm_db_rows(v);
     size_t y = 7, x = 2;
     size_t cols, rows;
     chtype ch1, ch2;
@@ -283,16 +287,14 @@ void nm_print_snapshots(const nm_vect_t *v)
     getmaxyx(action_window, rows, cols);
 
     for (size_t n = 0; n < count; n++) {
-        size_t idx_shift = NM_SQL_VMSNAP_COUNT * n;
-
         if (n && n < count) {
             ch1 = (n != (count - 1)) ? ACS_LTEE : ACS_LLCORNER;
             ch2 = ACS_HLINE;
         }
 
         nm_str_format(&buf, "%s (%s)",
-                nm_vect_str_ctx(v, NM_SQL_VMSNAP_NAME + idx_shift),
-                nm_vect_str_ctx(v, NM_SQL_VMSNAP_TIME + idx_shift));
+                nm_db_text(v, n, NM_SQL_VMSNAP_NAME),
+                nm_db_text(v, n, NM_SQL_VMSNAP_TIME));
         NM_PR_VM_INFO();
     }
 
@@ -331,28 +333,27 @@ void nm_print_iface_info(const nm_vmctl_data_t *vm, size_t idx)
     nm_str_t buf = NM_INIT_STR;
     size_t y = 3, x = 2;
     size_t cols, rows;
-    size_t idx_shift, mvtap_idx = 0;
+    size_t row, mvtap_idx = 0;
     chtype ch1, ch2;
 
     ch1 = ch2 = 0;
 
-    idx_shift = NM_IFS_IDX_COUNT * (--idx);
+    row = --idx;
 
     getmaxyx(action_window, rows, cols);
 
-    if (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_USR + idx_shift),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm->ifs, row, NM_SQL_IF_USR)) {
         nm_str_format(&buf, "%-12s%s", "User mode: ", "enabled");
         NM_PR_VM_INFO();
 
-        if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_FWD + idx_shift) != 0) {
+        if (nm_db_str(&vm->ifs, row, NM_SQL_IF_FWD)->len != 0) {
             nm_str_format(&buf, "%-12s%s", "hostfwd: ",
-                    nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_FWD + idx_shift));
+                    nm_db_text(&vm->ifs, row, NM_SQL_IF_FWD));
             NM_PR_VM_INFO();
         }
-        if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_SMB + idx_shift) != 0) {
+        if (nm_db_str(&vm->ifs, row, NM_SQL_IF_SMB)->len != 0) {
             nm_str_format(&buf, "%-12s%s", "smb: ",
-                    nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_SMB + idx_shift));
+                    nm_db_text(&vm->ifs, row, NM_SQL_IF_SMB));
             NM_PR_VM_INFO();
         }
 
@@ -360,32 +361,30 @@ void nm_print_iface_info(const nm_vmctl_data_t *vm, size_t idx)
     }
 
     nm_str_format(&buf, "%-12s%s", "hwaddr: ",
-            nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_MAC + idx_shift));
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_MAC));
     NM_PR_VM_INFO();
 
     nm_str_format(&buf, "%-12s%s", "driver: ",
-            nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_DRV + idx_shift));
+            nm_db_text(&vm->ifs, row, NM_SQL_IF_DRV));
     NM_PR_VM_INFO();
 
-    if (nm_vect_str_len(&vm->ifs, NM_SQL_IF_IP4 + idx_shift) > 0) {
+    if (nm_db_str(&vm->ifs, row, NM_SQL_IF_IP4)->len > 0) {
         nm_str_format(&buf, "%-12s%s", "host addr: ",
-                nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_IP4 + idx_shift));
+                nm_db_text(&vm->ifs, row, NM_SQL_IF_IP4));
         NM_PR_VM_INFO();
     }
 
     nm_str_format(&buf, "%-12s%s", "vhost: ",
-            (nm_str_cmp_st(nm_vect_str(&vm->ifs, NM_SQL_IF_VHO + idx_shift),
-                           NM_ENABLE) == NM_OK) ? "yes" : "no");
+            nm_db_bool(&vm->ifs, row, NM_SQL_IF_VHO) ? "yes" : "no");
     NM_PR_VM_INFO();
 
-    mvtap_idx = nm_str_stoui(nm_vect_str(&vm->ifs,
-                NM_SQL_IF_MVT + idx_shift), 10);
+    mvtap_idx = nm_str_stoui(nm_db_str(&vm->ifs, row, NM_SQL_IF_MVT), 10);
     if (!mvtap_idx) {
         nm_str_format(&buf, "%-12s%s", "MacVTap: ", nm_form_macvtap[mvtap_idx]);
     } else {
         nm_str_format(&buf, "%-12s%s [iface: %s]", "MacVTap: ",
                 nm_form_macvtap[mvtap_idx],
-                nm_vect_str_ctx(&vm->ifs, NM_SQL_IF_PET + idx_shift));
+                nm_db_text(&vm->ifs, row, NM_SQL_IF_PET));
     }
     NM_PR_VM_INFO();
 out:
@@ -398,7 +397,9 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
     nm_str_t buf = NM_INIT_STR;
     size_t y = 3, x = 2;
     size_t cols, rows;
-    size_t ifs_count, drives_count;
+    size_t ifs_count, drives_count, blk_count, net_count;
+    nm_metrics_drive_t blk[NM_METRICS_DRIVES];
+    nm_metrics_iface_t net[NM_METRICS_IFACES];
     chtype ch1, ch2;
     nm_cpu_t cpu = NM_INIT_CPU;
 
@@ -421,10 +422,10 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
     getmaxyx(action_window, rows, cols);
 
     nm_str_format(&buf, "%-12s%s", "arch: ",
-        nm_vect_str_ctx(&vm_->main, NM_SQL_ARCH));
+        nm_db_text(&vm_->main, 0, NM_SQL_ARCH));
     NM_PR_VM_INFO();
 
-    nm_parse_smp(&cpu, nm_vect_str_ctx(&vm_->main, NM_SQL_SMP));
+    nm_parse_smp(&cpu, nm_db_text(&vm_->main, 0, NM_SQL_SMP));
     nm_str_format(&buf, "%-12s%zu %s (%zu %s), threads %zu", "cpu: ",
             (cpu.sockets) ? cpu.sockets : cpu.smp,
             (cpu.sockets > 1) ? "cpus" : "cpu",
@@ -434,13 +435,11 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
     NM_PR_VM_INFO();
 
     nm_str_format(&buf, "%-12s%s %s", "memory: ",
-        nm_vect_str_ctx(&vm_->main, NM_SQL_MEM), "Mb");
+        nm_db_text(&vm_->main, 0, NM_SQL_MEM), "Mb");
     NM_PR_VM_INFO();
 
-    if (nm_str_cmp_st(nm_vect_str(&vm_->main, NM_SQL_KVM),
-                NM_ENABLE) == NM_OK) {
-        if (nm_str_cmp_st(nm_vect_str(&vm_->main, NM_SQL_HCPU), NM_ENABLE) ==
-                NM_OK) {
+    if (nm_db_bool(&vm_->main, 0, NM_SQL_KVM)) {
+        if (nm_db_bool(&vm_->main, 0, NM_SQL_HCPU)) {
             nm_str_format(&buf, "%-12s%s", "kvm: ", "enabled [+hostcpu]");
         } else {
             nm_str_format(&buf, "%-12s%s", "kvm: ", "enabled");
@@ -450,9 +449,9 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
     }
     NM_PR_VM_INFO();
 
-    if (nm_str_cmp_st(nm_vect_str(&vm_->main, NM_SQL_USBF), "1") == NM_OK) {
+    if (nm_db_bool(&vm_->main, 0, NM_SQL_USBF)) {
         nm_str_format(&buf, "%-12s%s [%s]", "usb: ", "enabled",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_USBT));
+                nm_db_text(&vm_->main, 0, NM_SQL_USBT));
     } else {
         nm_str_format(&buf, "%-12s%s", "usb: ", "disabled");
     }
@@ -475,54 +474,65 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
     }
 
     nm_str_format(&buf, "%-12s%s [%u]", "vnc port: ",
-            nm_vect_str_ctx(&vm_->main, NM_SQL_VNC),
-            nm_str_stoui(nm_vect_str(&vm_->main, NM_SQL_VNC), 10) +
+            nm_db_text(&vm_->main, 0, NM_SQL_VNC),
+            nm_str_stoui(nm_db_str(&vm_->main, 0, NM_SQL_VNC), 10) +
             NM_STARTING_VNC_PORT);
     NM_PR_VM_INFO();
 
     /* print network interfaces info */
-    ifs_count = vm_->ifs.n_memb / NM_IFS_IDX_COUNT;
+    ifs_count = nm_db_rows(&vm_->ifs);
+    net_count = (status_) ?
+        nm_mon_metrics_get_ifaces(name_, net, NM_METRICS_IFACES) : 0;
 
     for (size_t n = 0; n < ifs_count; n++) {
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
+        nm_metrics_iface_t iface;
 
-        if (nm_str_cmp_st(nm_vect_str(&vm_->ifs, NM_SQL_IF_USR + idx_shift),
-                    NM_ENABLE) == NM_OK) {
+        if (nm_db_bool(&vm_->ifs, n, NM_SQL_IF_USR)) {
             nm_str_format(&buf, "eth%zu%-8s%s [user mode]",
                     n, ":",
-                    nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_NAME + idx_shift));
+                    nm_db_text(&vm_->ifs, n, NM_SQL_IF_NAME));
         } else {
             nm_str_format(&buf, "eth%zu%-8s%s [%s %s%s]",
                     n, ":",
-                    nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_NAME + idx_shift),
-                    nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_MAC + idx_shift),
-                    nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_DRV + idx_shift),
-                    (nm_str_cmp_st(nm_vect_str(&vm_->ifs,
-                                               NM_SQL_IF_VHO + idx_shift),
-                                   NM_ENABLE) == NM_OK) ? "+vhost" : "");
+                    nm_db_text(&vm_->ifs, n, NM_SQL_IF_NAME),
+                    nm_db_text(&vm_->ifs, n, NM_SQL_IF_MAC),
+                    nm_db_text(&vm_->ifs, n, NM_SQL_IF_DRV),
+                    nm_db_bool(&vm_->ifs, n, NM_SQL_IF_VHO) ? "+vhost" : "");
         }
 
         NM_PR_VM_INFO();
+
+        if (nm_mon_metrics_iface(net, net_count,
+                    nm_db_text(&vm_->ifs, n, NM_SQL_IF_NAME),
+                    &iface) == NM_OK) {
+            nm_str_format(&buf, "%-12s%.0f/%.0f pps, %.2f/%.2f Mbit/s rx/tx",
+                    "", iface.rx_pps, iface.tx_pps,
+                    iface.rx_bps * 8 / 1e6, iface.tx_bps * 8 / 1e6);
+            mvwhline(action_window, y, 1, ' ', cols - 4);
+            NM_PR_VM_INFO();
+        }
     }
 
     /* print drives info */
-    drives_count = vm_->drives.n_memb / NM_DRV_IDX_COUNT;
+    drives_count = nm_db_rows(&vm_->drives);
+    blk_count = (status_) ?
+        nm_mon_metrics_get_drives(name_, blk, NM_METRICS_DRIVES) : 0;
 
     for (size_t n = 0; n < drives_count; n++) {
-        size_t idx_shift = NM_DRV_IDX_COUNT * n;
         nm_str_t drive_path = NM_INIT_STR;
+        nm_metrics_drive_t drive;
         struct stat img_info;
+        char node[32];
         int boot = 0;
 
-        if (nm_str_cmp_st(nm_vect_str(&vm_->drives,
-                        NM_SQL_DRV_BOOT + idx_shift), NM_ENABLE) == NM_OK) {
+        if (nm_db_bool(&vm_->drives, n, NM_SQL_DRV_BOOT)) {
             boot = 1;
         }
 
         nm_str_format(&drive_path, "%s/%s/%s",
                 nm_cfg_get()->vm_dir.data,
                 name_->data,
-                nm_vect_str_ctx(&vm_->drives, NM_SQL_DRV_NAME + idx_shift));
+                nm_db_text(&vm_->drives, n, NM_SQL_DRV_NAME));
 
         memset(&img_info, 0, sizeof(img_info));
         stat(drive_path.data, &img_info);
@@ -530,130 +540,182 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
         nm_str_format(&buf,
                  "disk%zu%-7s%s [%.3gGb/%sGb real/virt, %s, %s, discard=%s] %s",
                  n, ":",
-                 nm_vect_str_ctx(&vm_->drives, NM_SQL_DRV_NAME + idx_shift),
+                 nm_db_text(&vm_->drives, n, NM_SQL_DRV_NAME),
                  (double) img_info.st_blocks * S_BLKSIZE / 1073741824,
-                 nm_vect_str_ctx(&vm_->drives, NM_SQL_DRV_SIZE + idx_shift),
-                 nm_vect_str_ctx(&vm_->drives, NM_SQL_DRV_TYPE + idx_shift),
-                 nm_vect_str_ctx(&vm_->drives, NM_SQL_DRV_FMT + idx_shift),
-                 (nm_str_cmp_st(nm_vect_str(&vm_->drives,
-                                            NM_SQL_DRV_DISC + idx_shift),
-                                NM_ENABLE) == NM_OK) ? "on" : "off",
+                 nm_db_text(&vm_->drives, n, NM_SQL_DRV_SIZE),
+                 nm_db_text(&vm_->drives, n, NM_SQL_DRV_TYPE),
+                 nm_db_text(&vm_->drives, n, NM_SQL_DRV_FMT),
+                 nm_db_bool(&vm_->drives, n, NM_SQL_DRV_DISC) ? "on" : "off",
                  boot ? "*" : "");
         mvwhline(action_window, y, 1, ' ', cols - 4);
         NM_PR_VM_INFO();
 
+        /* drives are attached as hdN, see nm_vmctl_gen_cmd() */
+        snprintf(node, sizeof(node), "hd%zu", n);
+        if (nm_mon_metrics_drive(blk, blk_count, node, &drive) == NM_OK) {
+            nm_str_format(&buf, "%-12s%.0f/%.0f iops, %.1f/%.1f Mb/s, "
+                    "%.2f/%.2f ms r/w", "", drive.rd_iops, drive.wr_iops,
+                    drive.rd_bps / 1048576, drive.wr_bps / 1048576,
+                    drive.rd_lat, drive.wr_lat);
+            mvwhline(action_window, y, 1, ' ', cols - 4);
+            NM_PR_VM_INFO();
+        }
+
         nm_str_free(&drive_path);
     }
 
     /* print 9pfs info */
-    if (nm_str_cmp_st(nm_vect_str(&vm_->main, NM_SQL_9FLG), "1") == NM_OK) {
+    if (nm_db_bool(&vm_->main, 0, NM_SQL_9FLG)) {
         nm_str_format(&buf, "%-12s%s [%s]", "9pfs: ",
-                 nm_vect_str_ctx(&vm_->main, NM_SQL_9PTH),
-                 nm_vect_str_ctx(&vm_->main, NM_SQL_9ID));
+                 nm_db_text(&vm_->main, 0, NM_SQL_9PTH),
+                 nm_db_text(&vm_->main, 0, NM_SQL_9ID));
         NM_PR_VM_INFO();
     }
 
     /* generate guest boot settings info */
-    if (nm_vect_str_len(&vm_->main, NM_SQL_MACH)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_MACH)->len) {
         nm_str_format(&buf, "%-12s%s", "machine: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_MACH));
+                nm_db_text(&vm_->main, 0, NM_SQL_MACH));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_BIOS)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_BIOS)->len) {
         nm_str_format(&buf, "%-12s%s", "bios: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_BIOS));
+                nm_db_text(&vm_->main, 0, NM_SQL_BIOS));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_FLASH)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_FLASH)->len) {
         nm_str_format(&buf, "%-12s%s", "flash: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_FLASH));
+                nm_db_text(&vm_->main, 0, NM_SQL_FLASH));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_KERN)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_KERN)->len) {
         nm_str_format(&buf, "%-12s%s", "kernel: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_KERN));
+                nm_db_text(&vm_->main, 0, NM_SQL_KERN));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_KAPP)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_KAPP)->len) {
         nm_str_format(&buf, "%-12s%s", "cmdline: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_KAPP));
+                nm_db_text(&vm_->main, 0, NM_SQL_KAPP));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_INIT)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_INIT)->len) {
         nm_str_format(&buf, "%-12s%s", "initrd: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_INIT));
+                nm_db_text(&vm_->main, 0, NM_SQL_INIT));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_TTY)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_TTY)->len) {
         nm_str_format(&buf, "%-12s%s", "tty: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_TTY));
+                nm_db_text(&vm_->main, 0, NM_SQL_TTY));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_SOCK)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_SOCK)->len) {
         nm_str_format(&buf, "%-12s%s", "socket: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_SOCK));
+                nm_db_text(&vm_->main, 0, NM_SQL_SOCK));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_DEBP)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_DEBP)->len) {
         nm_str_format(&buf, "%-12s%s", "gdb port: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_DEBP));
+                nm_db_text(&vm_->main, 0, NM_SQL_DEBP));
         NM_PR_VM_INFO();
     }
-    if (nm_str_cmp_st(nm_vect_str(&vm_->main, NM_SQL_DEBF),
-                NM_ENABLE) == NM_OK) {
+    if (nm_db_bool(&vm_->main, 0, NM_SQL_DEBF)) {
         nm_str_format(&buf, "%-12s", "freeze cpu: yes");
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_ARGS)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_ARGS)->len) {
         nm_str_format(&buf, "%-12s%s", "extra args: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_ARGS));
+                nm_db_text(&vm_->main, 0, NM_SQL_ARGS));
         NM_PR_VM_INFO();
     }
-    if (nm_vect_str_len(&vm_->main, NM_SQL_GROUP)) {
+    if (nm_db_str(&vm_->main, 0, NM_SQL_GROUP)->len) {
         nm_str_format(&buf, "%-12s%s", "group: ",
-                nm_vect_str_ctx(&vm_->main, NM_SQL_GROUP));
+                nm_db_text(&vm_->main, 0, NM_SQL_GROUP));
         NM_PR_VM_INFO();
     }
 
     /* print host IP addresses for TAP ints */
     for (size_t n = 0; n < ifs_count; n++) {
-        size_t idx_shift = NM_IFS_IDX_COUNT * n;
-
-        if (!nm_vect_str_len(&vm_->ifs, NM_SQL_IF_IP4 + idx_shift)) {
+        if (!nm_db_str(&vm_->ifs, n, NM_SQL_IF_IP4)->len) {
             continue;
         }
 
         nm_str_format(&buf, "%-12s%s [%s]", "host IP: ",
-            nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_NAME + idx_shift),
-            nm_vect_str_ctx(&vm_->ifs, NM_SQL_IF_IP4 + idx_shift));
+            nm_db_text(&vm_->ifs, n, NM_SQL_IF_NAME),
+            nm_db_text(&vm_->ifs, n, NM_SQL_IF_IP4));
         NM_PR_VM_INFO();
 
     }
 
     /* print runtime statistics and screen preview if enabled */
     {
-        int fd;
+        int fd = -1;
+        int pid_num = 0;
+        nm_shm_vm_t shm_vm;
         nm_str_t pid_path = NM_INIT_STR;
 
+        /* pid is published by the monitoring daemon */
+        if (status_ && nm_mon_shm_get(name_, &shm_vm) == NM_OK) {
+            pid_num = shm_vm.pid;
+        }
+
         nm_str_format(&pid_path, "%s/%s/%s",
             nm_cfg_get()->vm_dir.data, name_->data, NM_VM_PID_FILE);
 
-        if ((status_ && (fd = open(pid_path.data, O_RDONLY)) != -1)) {
-            char pid[10];
-            ssize_t nread;
-            int pid_num = 0;
+        if (status_ &&
+                (pid_num || (fd = open(pid_path.data, O_RDONLY)) != -1)) {
+            if (fd != -1) {
+                char pid[10];
+                ssize_t nread;
 
-            if ((nread = read(fd, pid, sizeof(pid))) > 0) {
-                pid[nread - 1] = '\0';
-                pid_num = atoi(pid);
+                if ((nread = read(fd, pid, sizeof(pid))) > 0) {
+                    pid[nread - 1] = '\0';
+                    pid_num = atoi(pid);
+                }
+                close(fd);
+            }
 
+            if (pid_num) {
                 nm_str_format(&buf, "%-12s%d", "pid: ", pid_num);
                 NM_PR_VM_INFO();
             }
-            close(fd);
 
 #if defined (NM_OS_LINUX)
-            if (pid_num) {
+            nm_metrics_thread_t thr[NM_METRICS_THREADS];
+            nm_metrics_rate_t rate;
+            size_t n_thr;
+
+            /* rates of all running VMs are kept by the daemon */
+            if (pid_num && nm_mon_metrics_last(name_, &rate) == NM_OK) {
+                nm_str_format(&buf, "%-12s%0.1f%%", "cpu usage: ", rate.cpu);
+                mvwhline(action_window, y, 1, ' ', cols - 4);
+                NM_PR_VM_INFO();
+                nm_str_format(&buf, "%-12s%.1f Mb", "rss: ",
+                        (double) rate.rss / 1048576);
+                mvwhline(action_window, y, 1, ' ', cols - 4);
+                NM_PR_VM_INFO();
+                nm_str_format(&buf, "%-12s%.1f/%.1f Mb/s read/write",
+                        "disk io: ", rate.rd_bytes / 1048576,
+                        rate.wr_bytes / 1048576);
+                mvwhline(action_window, y, 1, ' ', cols - 4);
+                NM_PR_VM_INFO();
+                nm_str_format(&buf, "%-12s%.0f/s majflt, %.0f/s ctxsw",
+                        "faults: ", rate.majflt, rate.ctxsw);
+                mvwhline(action_window, y, 1, ' ', cols - 4);
+                NM_PR_VM_INFO();
+
+                /* vCPUs first, the list is cut at the window bottom */
+                n_thr = nm_mon_metrics_get_threads(name_,
+                        thr, NM_METRICS_THREADS);
+                for (size_t n = 0; n < n_thr; n++) {
+                    char label[13];
+
+                    nm_mon_metrics_label(&thr[n], label, sizeof(label));
+                    nm_str_format(&buf, "%-12s%.1f%% cpu, %.1f%% rq delay",
+                            label, thr[n].cpu, thr[n].delay);
+                    mvwhline(action_window, y, 1, ' ', cols - 4);
+                    NM_PR_VM_INFO();
+                }
+            } else if (pid_num) {
                 double usage = nm_stat_get_usage(pid_num);
 
                 nm_str_format(&buf, "%-12s%0.1f%%", "cpu usage: ", usage);
@@ -686,10 +748,9 @@ nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm, int status)
                 printf("%s", buf.data);
                 fflush(stdout);
             }
-        } else { /* clear PID file info and cpu usage data */
-            if (y < (rows - 2)) {
-                mvwhline(action_window, y, 1, ' ', cols - 4);
-                mvwhline(action_window, y + 1, 1, ' ', cols - 4);
+        } else { /* clear PID file info and resource usage data */
+            for (size_t line = y; line < rows - 1; line++) {
+                mvwhline(action_window, line, 1, ' ', cols - 4);
             }
             NM_STAT_CLEAN();
             if (nm_cfg_get()->preview.enabled) {
@@ -735,7 +796,7 @@ void nm_print_help(void)
 #if defined (NM_WITH_USB)
         "+", "-",
 #endif
-        "K", "/", "[", "]"
+        "K", "/", "[", "]", "T"
 };
 
     const char *values[] = {
@@ -770,6 +831,7 @@ void nm_print_help(void)
         "search vm, filters",
         "previous group",
         "next group",
+        "resource usage of running VMs",
         NULL
     };
 
@@ -12,7 +12,7 @@ void nm_print_vm_info(const nm_str_t *name, const nm_vmctl_data_t *vm,
         int status);
 void nm_print_iface_info(const nm_vmctl_data_t *vm, size_t idx);
 void nm_print_drive_info(const nm_vect_t *v, size_t idx);
-void nm_print_snapshots(const nm_vect_t *v);
+void nm_print_snapshots(const nm_db_res_t *v);
 void nm_print_cmd(const nm_str_t *name);
 void nm_print_help(void);
 void nm_lan_help(void);
@@ -29,6 +29,7 @@ void nm_init_help_install(void);
 void nm_init_help_clone(void);
 void nm_init_help_export(void);
 void nm_init_help_delete(void);
+void nm_init_help_dashboard(void);
 void nm_init_side(void);
 void nm_init_side_group(const nm_str_t *name);
 void nm_init_side_lan(void);
@@ -212,6 +213,7 @@ enum nm_key_upper {
     NM_KEY_P_UP = 80,
     NM_KEY_R_UP = 82,
     NM_KEY_S_UP = 83,
+    NM_KEY_T_UP = 84,
     NM_KEY_V_UP = 86,
     NM_KEY_Z_UP = 90
 };
@@ -0,0 +1,229 @@
+#!/usr/bin/env python3
+#
+# Concurrent database access stress test. The TUI edits VM memory with
+# the edit dialog, remote API clients change other VMs with
+# vm_set_settings and read them back with vm_get_settings, a writer
+# holds long transactions like VM clone does. nemu and the monitoring
+# daemon must survive, every API call must succeed and every last
+# write must be in the database.
+#
+# Needs nemu built with remote API support and openssl binary.
+# Run from test directory:
+#   NEMU_BIN_DIR=../build python3 db_stress.py [seconds] [api clients]
+
+import os
+import sys
+import ssl
+import json
+import time
+import socket
+import signal
+import sqlite3
+import hashlib
+import threading
+import subprocess
+from utils import Nemu
+from utils import Tmux
+from utils import fill_db
+
+SECONDS = int(sys.argv[1]) if len(sys.argv) > 1 else 30
+CLIENTS = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+VMS_PER_CLIENT = 3
+PASS = "stress"
+SALT = "salt"
+
+def free_port():
+    with socket.socket() as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+def setup_cfg(nemu, port):
+    key = nemu.test_dir + "/api.key"
+    cert = nemu.test_dir + "/api.crt"
+    subprocess.run(["openssl", "req", "-x509", "-newkey", "rsa:2048",
+        "-nodes", "-keyout", key, "-out", cert, "-days", "1",
+        "-subj", "/CN=localhost"], capture_output=True, check=True)
+    remote = "\n".join(["remote_control = 1",
+        "remote_interface = lo",
+        "remote_port = %d" % port,
+        "remote_tls_cert = " + cert,
+        "remote_tls_key = " + key,
+        "remote_salt = " + SALT,
+        "remote_hash = " + hashlib.sha256((PASS + SALT).encode()).hexdigest()])
+    path = nemu.test_dir + "/nemu.cfg"
+    with open(path) as cfg:
+        text = cfg.read()
+    text = text.replace("remote_control = 0", remote)
+    with open(path, "w") as cfg:
+        cfg.write(text)
+
+def api_call(port, request):
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    request["auth"] = PASS
+    with socket.create_connection(("127.0.0.1", port), timeout=30) as sock:
+        with ctx.wrap_socket(sock) as tls:
+            tls.sendall(json.dumps(request).encode())
+            reply = b""
+            while True:
+                data = tls.recv(4096)
+                if not data:
+                    break
+                reply += data
+    return json.loads(reply)
+
+def alive(pidfile):
+    try:
+        with open(pidfile) as pid:
+            os.kill(int(pid.readline()), 0)
+        return True
+    except (OSError, ValueError):
+        return False
+
+class Stress():
+    def __init__(self, port, db_path):
+        self.port = port
+        self.db_path = db_path
+        self.stop = threading.Event()
+        self.lock = threading.Lock()
+        self.errors = []
+        self.calls = 0
+        self.last_mem = {}
+
+    def error(self, msg):
+        with self.lock:
+            self.errors.append(msg)
+
+    def api_client(self, idx):
+        names = ["stress%03d" % (1 + idx * VMS_PER_CLIENT + n)
+                for n in range(VMS_PER_CLIENT)]
+        step = 0
+        while not self.stop.is_set():
+            name = names[step % len(names)]
+            mem = 300 + (step * 7 + idx) % 700
+            try:
+                reply = api_call(self.port, {"exec": "vm_set_settings",
+                    "name": name, "mem": mem})
+                if reply.get("return") != "ok":
+                    self.error("%s: set: %s" % (name, reply))
+                    return
+                self.last_mem[name] = mem
+                reply = api_call(self.port, {"exec": "vm_get_settings",
+                    "name": name})
+                if reply.get("mem", {}).get("value") != mem:
+                    self.error("%s: get: %s" % (name, reply))
+                    return
+            except (OSError, ValueError, AttributeError) as err:
+                self.error("%s: %s" % (name, err))
+                return
+            with self.lock:
+                self.calls += 2
+            step += 1
+
+    def writer(self):
+        # hold the write lock for a while like multi-row TUI edits do
+        db = sqlite3.connect(self.db_path, timeout=30,
+                isolation_level=None)
+        while not self.stop.is_set():
+            try:
+                db.execute("BEGIN IMMEDIATE")
+                db.execute("UPDATE drives SET capacity=capacity+1")
+                time.sleep(0.02)
+                db.execute("COMMIT")
+            except sqlite3.Error as err:
+                self.error("writer: %s" % err)
+                return
+            time.sleep(0.01)
+        db.close()
+
+def main():
+    nemu = Nemu()
+    port = free_port()
+    setup_cfg(nemu, port)
+    db_path = nemu.test_dir + "/.nemu.db"
+    # first start creates the database
+    subprocess.run([os.getenv("NEMU_BIN_DIR") + "/nemu",
+        "--cfg", nemu.test_dir + "/nemu.cfg", "--list"], capture_output=True)
+    fill_db(db_path, 1 + CLIENTS * VMS_PER_CLIENT, 1, "stress")
+
+    # the daemon runs the API server
+    subprocess.run([os.getenv("NEMU_BIN_DIR") + "/nemu",
+        "--cfg", nemu.test_dir + "/nemu.cfg", "--daemon"])
+    daemon_pid = nemu.test_dir + "/nemu-monitor.pid"
+    tmux = Tmux()
+    tmux.setup(nemu.test_dir)
+    for _ in range(100):
+        try:
+            api_call(port, {"exec": "api_version"})
+            break
+        except OSError:
+            time.sleep(0.1)
+
+    stress = Stress(port, db_path)
+    threads = [threading.Thread(target=stress.api_client, args=(n,))
+            for n in range(CLIENTS)]
+    threads.append(threading.Thread(target=stress.writer))
+    for thread in threads:
+        thread.start()
+
+    # TUI edits memory of the first VM, values have 3 digits like 256
+    edits = 0
+    tui_mem = None
+    deadline = time.monotonic() + SECONDS
+    while time.monotonic() < deadline and not stress.errors:
+        tui_mem = 100 + edits % 900
+        for key in ["e", "Down", "BSpace", "BSpace", "BSpace",
+                str(tui_mem), "Enter"]:
+            tmux.send(key)
+            time.sleep(0.1)
+        edits += 1
+        if not alive(nemu.pidfile) or not alive(daemon_pid):
+            break
+
+    stress.stop.set()
+    for thread in threads:
+        thread.join()
+
+    tui_ok = alive(nemu.pidfile)
+    daemon_ok = alive(daemon_pid)
+    db = sqlite3.connect(db_path, timeout=30)
+    # the last TUI edit may still wait for the write lock
+    deadline = time.monotonic() + 5
+    while tui_ok and time.monotonic() < deadline:
+        row = db.execute("SELECT mem FROM vms WHERE name='stress000'")
+        if row.fetchone()[0] == tui_mem:
+            break
+        time.sleep(0.1)
+    integrity = db.execute("PRAGMA integrity_check").fetchone()[0]
+    journal = db.execute("PRAGMA journal_mode").fetchone()[0]
+    mem = dict(db.execute("SELECT name, mem FROM vms").fetchall())
+    db.close()
+
+    if tui_ok and mem["stress000"] != tui_mem:
+        stress.error("stress000: mem %s, TUI set %s"
+                % (mem["stress000"], tui_mem))
+    for name, value in stress.last_mem.items():
+        if mem[name] != value:
+            stress.error("%s: mem %s, API set %s" % (name, mem[name], value))
+
+    print("%d s, %d TUI edits, %d API calls, journal mode %s"
+            % (SECONDS, edits, stress.calls, journal))
+    print("nemu alive: %s, daemon alive: %s, integrity: %s"
+            % (tui_ok, daemon_ok, integrity))
+    for err in stress.errors:
+        print("error: " + err)
+
+    tmux.send("q")
+    tmux.cleanup()
+    if daemon_ok:
+        with open(daemon_pid) as pid:
+            os.kill(int(pid.readline()), signal.SIGTERM)
+        time.sleep(1)
+    nemu.cleanup()
+
+    if not tui_ok or not daemon_ok or integrity != "ok" or stress.errors:
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()
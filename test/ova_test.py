@@ -23,7 +23,8 @@ class TestOVA(unittest.TestCase):
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/dsl/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/dsl/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/dsl/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/dsl/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("dsl"), expected)
         nemu.cleanup()
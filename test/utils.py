@@ -2,8 +2,35 @@ import os
 import uuid
 import time
 import shutil
+import sqlite3
 import subprocess
 
+def fill_db(path, count, items, prefix="vm"):
+    # VMs prefix000..., each with items drives and interfaces,
+    # interface names are short to fit IFNAMSIZ
+    db = sqlite3.connect(path)
+    for n in range(count):
+        cur = db.execute("INSERT INTO vms(name, mem, smp, kvm, hcpu, vnc, "
+                "arch, install, machine, mouse_override, usb, usb_type, "
+                "usb_status, fs9p_enable, spice, debug_freeze, display_type, "
+                "spice_agent) VALUES(?, 256, '1', 1, 1, ?, 'x86_64', 0, "
+                "'pc', 0, 0, 'XHCI', 0, 0, 1, 0, 'qxl', 0)",
+                ("%s%03d" % (prefix, n), n))
+        vm_id = cur.lastrowid
+        db.executemany("INSERT INTO drives(drive_name, drive_drv, capacity, "
+                "boot, discard, vm_id, format) "
+                "VALUES(?, 'virtio', 10, ?, 0, ?, 'qcow2')",
+                [("%s%03d_%d.img" % (prefix, n, d), int(d == 0), vm_id)
+                    for d in range(items)])
+        db.executemany("INSERT INTO ifaces(if_name, mac_addr, if_drv, "
+                "vhost, macvtap, netuser, vm_id) "
+                "VALUES(?, ?, 'virtio-net-pci', 0, 0, 0, ?)",
+                [("%s%03d_eth%d" % (prefix[0], n, i),
+                    "de:ad:be:ef:%02x:%02x" % (n, i), vm_id)
+                    for i in range(items)])
+    db.commit()
+    db.close()
+
 class Nemu():
     def __init__(self):
         self.uuid = uuid.uuid4().hex
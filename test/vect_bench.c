@@ -0,0 +1,266 @@
+/*
+ * Micro-benchmark of nm_vect_t (array of pointers to units) against
+ * nm_svect_t (contiguous units) and of QEMU argv building.
+ * Build and run:
+ *   make vect_bench && ./test/vect_bench [scale]
+ */
+#include <nm_vector.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* same layout as nm_mon_item_t */
+typedef struct {
+    char *name;
+    int8_t state;
+    void *proc;
+} bench_item_t;
+
+static const size_t bench_sizes[] = { 16, 256, 4096 };
+enum { BENCH_ARGS = 100, BENCH_UNITS = 1 << 20 };
+
+static volatile size_t bench_sink;
+
+/* nm_vector.c dependencies, the rest of nemu is not linked */
+void nm_bug(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    putc('\n', stderr);
+    exit(EXIT_FAILURE);
+}
+
+void *nm_alloc(size_t size)
+{
+    void *p;
+
+    if ((p = malloc(size)) == NULL) {
+        nm_bug("malloc failed");
+    }
+
+    return p;
+}
+
+void *nm_calloc(size_t nmemb, size_t size)
+{
+    void *p;
+
+    if ((p = calloc(nmemb, size)) == NULL) {
+        nm_bug("calloc failed");
+    }
+
+    return p;
+}
+
+void *nm_realloc(void *p, size_t size)
+{
+    if ((p = realloc(p, size)) == NULL) {
+        nm_bug("realloc failed");
+    }
+
+    return p;
+}
+
+#define nm_bench_min(a, b) (((a) < (b)) ? (a) : (b))
+
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, size_t size,
+        uint64_t v_ns, uint64_t sv_ns, size_t ops)
+{
+    printf("%-10s %6zu %12.2f %12.2f %8.2fx\n", name, size,
+            (double) v_ns / ops, (double) sv_ns / ops,
+            (sv_ns) ? (double) v_ns / sv_ns : 0.0);
+}
+
+/* item names are allocated between units like nm_str_t of VM names */
+static void bench_fill_vect(nm_vect_t *v, size_t size)
+{
+    for (size_t n = 0; n < size; n++) {
+        bench_item_t item = { NULL, 0, NULL };
+
+        item.name = nm_alloc(16);
+        snprintf(item.name, 16, "vm%05u", (unsigned) ((n * 104729) % size));
+        item.state = n & 1;
+        nm_vect_insert(v, &item, sizeof(item), NULL);
+    }
+}
+
+static void bench_fill_svect(nm_svect_t *v, size_t size)
+{
+    nm_svect_reserve(v, size);
+
+    for (size_t n = 0; n < size; n++) {
+        bench_item_t *item = nm_svect_emplace(v);
+
+        item->name = nm_alloc(16);
+        snprintf(item->name, 16, "vm%05u", (unsigned) ((n * 104729) % size));
+        item->state = n & 1;
+    }
+}
+
+static void bench_item_free_cb(void *unit_p)
+{
+    free(((bench_item_t *) unit_p)->name);
+}
+
+static int bench_ptr_cmp(const void *a, const void *b)
+{
+    const bench_item_t *ia = *(const bench_item_t **) a;
+    const bench_item_t *ib = *(const bench_item_t **) b;
+
+    return strcmp(ia->name, ib->name);
+}
+
+static int bench_unit_cmp(const void *a, const void *b)
+{
+    const bench_item_t *ia = a;
+    const bench_item_t *ib = b;
+
+    return strcmp(ia->name, ib->name);
+}
+
+static void bench_vect(size_t size, size_t rounds, uint64_t *t)
+{
+    size_t sum = 0;
+
+    /* best round is taken, round 0 warms up malloc and is skipped */
+    for (size_t r = 0; r <= rounds; r++) {
+        nm_vect_t v = NM_INIT_VECT;
+        uint64_t ts[5];
+
+        ts[0] = bench_ns();
+        bench_fill_vect(&v, size);
+        ts[1] = bench_ns();
+        for (size_t n = 0; n < v.n_memb; n++) {
+            sum += ((bench_item_t *) nm_vect_at(&v, n))->state;
+        }
+        ts[2] = bench_ns();
+        qsort(v.data, v.n_memb, sizeof(void *), bench_ptr_cmp);
+        ts[3] = bench_ns();
+        nm_vect_free(&v, bench_item_free_cb);
+        ts[4] = bench_ns();
+
+        for (size_t n = 0; r && n < 4; n++) {
+            t[n] = nm_bench_min(t[n], ts[n + 1] - ts[n]);
+        }
+    }
+
+    bench_sink = sum;
+}
+
+static void bench_svect(size_t size, size_t rounds, uint64_t *t)
+{
+    size_t sum = 0;
+
+    for (size_t r = 0; r <= rounds; r++) {
+        nm_svect_t v = NM_INIT_SVECT(bench_item_t);
+        uint64_t ts[5];
+
+        ts[0] = bench_ns();
+        bench_fill_svect(&v, size);
+        ts[1] = bench_ns();
+        for (size_t n = 0; n < v.n_memb; n++) {
+            sum += ((bench_item_t *) nm_svect_at(&v, n))->state;
+        }
+        ts[2] = bench_ns();
+        nm_svect_sort(&v, bench_unit_cmp);
+        ts[3] = bench_ns();
+        nm_svect_free(&v, bench_item_free_cb);
+        ts[4] = bench_ns();
+
+        for (size_t n = 0; r && n < 4; n++) {
+            t[n] = nm_bench_min(t[n], ts[n + 1] - ts[n]);
+        }
+    }
+
+    bench_sink = sum;
+}
+
+static void bench_containers(size_t size, size_t rounds)
+{
+    static const char *names[] = { "fill", "iterate", "sort", "free" };
+    uint64_t t_vect[4], t_svect[4];
+
+    for (size_t n = 0; n < 4; n++) {
+        t_vect[n] = t_svect[n] = UINT64_MAX;
+    }
+
+    bench_vect(size, rounds, t_vect);
+    bench_svect(size, rounds, t_svect);
+
+    for (size_t n = 0; n < 4; n++) {
+        bench_report(names[n], size, t_vect[n], t_svect[n], size);
+    }
+}
+
+/* -drive file=...,if=virtio and alike, as nm_vmctl_gen_cmd() makes */
+static void bench_argv(size_t rounds)
+{
+    uint64_t t_vect = UINT64_MAX, t_argv = UINT64_MAX;
+    char arg[128];
+
+    for (size_t r = 0; r < rounds; r++) {
+        nm_vect_t v = NM_INIT_VECT;
+        nm_argv_t a = NM_INIT_ARGV;
+        uint64_t start;
+        char **ptrs;
+
+        start = bench_ns();
+        for (size_t n = 0; n < BENCH_ARGS; n++) {
+            snprintf(arg, sizeof(arg), "node-name=hd%zu,file=/var/lib/nemu/"
+                    "vm/vm_%zu.img,if=virtio,format=qcow2", n, n);
+            nm_vect_insert_cstr(&v, (n & 1) ? arg : "-drive");
+        }
+        nm_vect_end_zero(&v);
+        bench_sink += strlen(((char **) v.data)[BENCH_ARGS - 1]);
+        nm_vect_free(&v, NULL);
+        t_vect = nm_bench_min(t_vect, bench_ns() - start);
+
+        start = bench_ns();
+        for (size_t n = 0; n < BENCH_ARGS; n++) {
+            snprintf(arg, sizeof(arg), "node-name=hd%zu,file=/var/lib/nemu/"
+                    "vm/vm_%zu.img,if=virtio,format=qcow2", n, n);
+            nm_argv_add(&a, (n & 1) ? arg : "-drive");
+        }
+        ptrs = nm_argv_ptrs(&a);
+        bench_sink += strlen(ptrs[BENCH_ARGS - 1]);
+        free(ptrs);
+        nm_argv_free(&a);
+        t_argv = nm_bench_min(t_argv, bench_ns() - start);
+    }
+
+    bench_report("argv", BENCH_ARGS, t_vect, t_argv, BENCH_ARGS);
+}
+
+int main(int argc, char **argv)
+{
+    size_t scale = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1;
+
+    printf("%-10s %6s %12s %12s %9s\n",
+            "test", "units", "nm_vect ns", "nm_svect ns", "speedup");
+
+    for (size_t n = 0; n < sizeof(bench_sizes) / sizeof(bench_sizes[0]); n++) {
+        bench_containers(bench_sizes[n],
+                scale * BENCH_UNITS / bench_sizes[n] / 16 + 1);
+    }
+
+    bench_argv(scale * 2000);
+
+    return 0;
+}
+/* vim:set ts=4 sw=4: */
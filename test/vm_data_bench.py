@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+#
+# Cursor scroll benchmark of the VM list. Every cursor move loads VM
+# properties with nm_vmctl_get_data(), VMs are created with many
+# drives and interfaces to make this load visible.
+#
+# Run from test directory:
+#   NEMU_BIN_DIR=../build python3 vm_data_bench.py [vms] [items] [moves]
+
+import os
+import sys
+import time
+import subprocess
+from utils import Nemu
+from utils import Tmux
+from utils import fill_db
+
+VMS = int(sys.argv[1]) if len(sys.argv) > 1 else 20
+ITEMS = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+MOVES = int(sys.argv[3]) if len(sys.argv) > 3 else 2000
+BATCH = 100
+
+def cpu_ticks(pid):
+    with open("/proc/%d/stat" % pid) as stat:
+        fields = stat.read().rsplit(")", 1)[1].split()
+    return int(fields[11]) + int(fields[12])
+
+def wait_idle(pid):
+    ticks = cpu_ticks(pid)
+    while True:
+        time.sleep(0.2)
+        cur = cpu_ticks(pid)
+        if cur == ticks:
+            return cur
+        ticks = cur
+
+def main():
+    nemu = Nemu()
+    # first start creates the database
+    subprocess.run([os.getenv("NEMU_BIN_DIR") + "/nemu",
+        "--cfg", nemu.test_dir + "/nemu.cfg", "--list"], capture_output=True)
+    fill_db(nemu.test_dir + "/.nemu.db", VMS, ITEMS, "bench")
+
+    tmux = Tmux()
+    tmux.setup(nemu.test_dir)
+    with open(nemu.pidfile) as pidfile:
+        pid = int(pidfile.read())
+
+    start = wait_idle(pid)
+    wall = time.monotonic()
+    sent = 0
+    while sent < MOVES:
+        # walk the whole list down and back up
+        key = "Down" if (sent // (VMS - 1)) % 2 == 0 else "Up"
+        count = min(BATCH, MOVES - sent, (VMS - 1) - sent % (VMS - 1))
+        subprocess.run(["tmux", "-L", tmux.uuid, "send-keys"] + [key] * count)
+        sent += count
+    end = wait_idle(pid)
+    wall = time.monotonic() - wall - 0.2
+
+    hz = os.sysconf("SC_CLK_TCK")
+    print("%d VMs, %d drives and %d interfaces each, %d cursor moves"
+            % (VMS, ITEMS, ITEMS, MOVES))
+    print("cpu per move: %.3f ms" % ((end - start) * 1000.0 / hz / MOVES))
+    print("wall per move: %.3f ms" % (wall * 1000.0 / MOVES))
+
+    tmux.send("q")
+    tmux.cleanup()
+    nemu.cleanup()
+
+if __name__ == "__main__":
+    main()
@@ -24,7 +24,8 @@ node-name=hd0,media=disk,if=virtio,file=\
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
@@ -60,7 +61,8 @@ virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001
 -device virtio-net-pci,mac=de:ad:be:ef:00:02,id=dev-deadbeef0002,netdev=net-deadbeef0002 \
 -netdev tap,ifname=testvm_eth1,script=no,downscript=no,id=net-deadbeef0002,vhost=on \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
@@ -92,7 +94,8 @@ node-name=hd0,media=disk,if=virtio,file=\
 virtio-net-pci,mac=de:ad:be:ef:00:02,id=dev-deadbeef0002,netdev=net-deadbeef0002 \
 -netdev user,id=net-deadbeef0002 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm-clone/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm-clone/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm-clone/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm-clone/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5901,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm-clone"), expected)
         nemu.cleanup()
@@ -129,7 +132,8 @@ isa-serial,chardev=socket_testvm -chardev serial,path=/dev/pts/7,id=tty_testvm \
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vnc :6445"
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vnc :6445"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
 
@@ -163,7 +167,8 @@ node-name=hd0,media=disk,if=virtio,file=\
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
@@ -200,7 +205,8 @@ qemu-xhci,id=usbbus -boot d -cdrom /tmp/null.iso \
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
 
@@ -219,7 +225,8 @@ qemu-xhci,id=usbbus -boot d -cdrom /tmp/null.iso \
 virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
@@ -257,7 +264,8 @@ node-name=hd0,media=disk,if=virtio,file=\
 -device virtio-net-pci,mac=de:ad:be:ef:00:01,id=dev-deadbeef0001,netdev=net-deadbeef0001 \
 -netdev user,id=net-deadbeef0001 \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()
@@ -292,7 +300,8 @@ node-name=hd0,media=disk,if=virtio,file=\
 vmxnet3,mac=de:ad:be:ef:00:02,id=dev-deadbeef0002,netdev=net-deadbeef0002 \
 -netdev user,id=net-deadbeef0002,hostfwd=tcp::22-:2222,smb=/share \
 -pidfile /tmp/nemu_{nemu.uuid}/testvm/qemu.pid -qmp \
-unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -vga qxl \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp.sock,server,nowait -qmp \
+unix:/tmp/nemu_{nemu.uuid}/testvm/qmp-mon.sock,server,nowait -vga qxl \
 -spice port=5900,disable-ticketing=on"
         self.assertEqual(nemu.result("testvm"), expected)
         nemu.cleanup()